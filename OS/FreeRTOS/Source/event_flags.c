@@ -0,0 +1,240 @@
+/*
+    FreeRTOS V6.0.5 - Copyright (C) 2010 Real Time Engineers Ltd.
+
+    ***************************************************************************
+    *                                                                         *
+    * If you are:                                                             *
+    *                                                                         *
+    *    + New to FreeRTOS,                                                   *
+    *    + Wanting to learn FreeRTOS or multitasking in general quickly       *
+    *    + Looking for basic training,                                        *
+    *    + Wanting to improve your FreeRTOS skills and productivity           *
+    *                                                                         *
+    * then take a look at the FreeRTOS eBook                                  *
+    *                                                                         *
+    *        "Using the FreeRTOS Real Time Kernel - a Practical Guide"        *
+    *                  http://www.FreeRTOS.org/Documentation                  *
+    *                                                                         *
+    * A pdf reference manual is also available.  Both are usually delivered   *
+    * to your inbox within 20 minutes to two hours when purchased between 8am *
+    * and 8pm GMT (although please allow up to 24 hours in case of            *
+    * exceptional circumstances).  Thank you for your support!                *
+    *                                                                         *
+    ***************************************************************************
+
+    This file is part of the FreeRTOS distribution.
+
+    FreeRTOS is free software; you can redistribute it and/or modify it under
+    the terms of the GNU General Public License (version 2) as published by the
+    Free Software Foundation AND MODIFIED BY the FreeRTOS exception.
+    ***NOTE*** The exception to the GPL is included to allow you to distribute
+    a combined work that includes FreeRTOS without being obliged to provide the
+    source code for proprietary components outside of the FreeRTOS kernel.
+    FreeRTOS is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+    more details. You should have received a copy of the GNU General Public
+    License and the FreeRTOS license exception along with FreeRTOS; if not it
+    can be viewed here: http://www.freertos.org/a00114.html and also obtained
+    by writing to Richard Barry, contact details for whom are available on the
+    FreeRTOS WEB site.
+
+    1 tab == 4 spaces!
+
+    http://www.FreeRTOS.org - Documentation, latest information, license and
+    contact details.
+
+    http://www.SafeRTOS.com - A version that is certified for use in safety
+    critical systems.
+
+    http://www.OpenRTOS.com - Commercial support, development, porting,
+    licensing and training services.
+*/
+
+/*
+ * Event flags, see event_flags.h.
+ *
+ * The tasks waiting on the flags are kept in an event list, in priority order,
+ * as the tasks waiting on a queue.  Setting bits readies all of them, and each
+ * one checks its own bits again: the tasks that were not waiting for the bits
+ * just set block again for the rest of their time out.  Everything is done in
+ * critical sections, the lists are short.
+ */
+
+#include <stdlib.h>
+
+/* Defining MPU_WRAPPERS_INCLUDED_FROM_API_FILE prevents task.h from redefining
+all the API functions to use the MPU wrappers.  That should only be done when
+task.h is included from an application file. */
+#define MPU_WRAPPERS_INCLUDED_FROM_API_FILE
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "event_flags.h"
+
+#undef MPU_WRAPPERS_INCLUDED_FROM_API_FILE
+
+typedef struct EventFlagsDefinition
+{
+	volatile unsigned portBASE_TYPE uxBits;
+	xList xTasksWaiting;				/*< The tasks blocked on the flags, in priority order. */
+} xEVENT_FLAGS;
+
+/*
+ * Ready every task waiting on the flags.  Must be called with interrupts
+ * disabled.
+ *
+ * @return pdTRUE if one of them has a priority higher than or equal to the
+ * running task.
+ */
+static signed portBASE_TYPE prvReadyWaitingTasks( xEVENT_FLAGS *pxFlags ) PRIVILEGED_FUNCTION;
+/*-----------------------------------------------------------*/
+
+xEventFlagsHandle xEventFlagsCreate( void )
+{
+xEVENT_FLAGS *pxNewFlags;
+
+	pxNewFlags = ( xEVENT_FLAGS * ) pvPortMalloc( sizeof( xEVENT_FLAGS ) );
+	if( pxNewFlags != NULL )
+	{
+		pxNewFlags->uxBits = 0;
+		vListInitialise( &( pxNewFlags->xTasksWaiting ) );
+		traceEVENT_FLAGS_CREATE( pxNewFlags );
+	}
+	else
+	{
+		traceEVENT_FLAGS_CREATE_FAILED();
+	}
+
+	return ( xEventFlagsHandle ) pxNewFlags;
+}
+/*-----------------------------------------------------------*/
+
+unsigned portBASE_TYPE uxEventFlagsWait( xEventFlagsHandle xFlags, unsigned portBASE_TYPE uxBitsToWaitFor, portBASE_TYPE xClearOnExit, portTickType xTicksToWait )
+{
+xEVENT_FLAGS * const pxFlags = ( xEVENT_FLAGS * ) xFlags;
+unsigned portBASE_TYPE uxReturn;
+signed portBASE_TYPE xEntryTimeSet = pdFALSE;
+xTimeOutType xTimeOut;
+
+	for( ;; )
+	{
+		taskENTER_CRITICAL();
+		{
+			uxReturn = pxFlags->uxBits & uxBitsToWaitFor;
+			if( uxReturn != 0 )
+			{
+				if( xClearOnExit != pdFALSE )
+				{
+					pxFlags->uxBits &= ~uxReturn;
+				}
+				traceEVENT_FLAGS_WAIT( pxFlags );
+				taskEXIT_CRITICAL();
+				return uxReturn;
+			}
+
+			if( xEntryTimeSet == pdFALSE )
+			{
+				vTaskSetTimeOutState( &xTimeOut );
+				xEntryTimeSet = pdTRUE;
+			}
+
+			/* Checking the time out enters a nested critical section. */
+			if( ( xTicksToWait == ( portTickType ) 0 ) || ( xTaskCheckForTimeOut( &xTimeOut, &xTicksToWait ) != pdFALSE ) )
+			{
+				traceEVENT_FLAGS_WAIT_FAILED( pxFlags );
+				taskEXIT_CRITICAL();
+				return 0;
+			}
+
+			/* No interrupt can set the bits before the task is on the list,
+			and once it is there the interrupt readies it even if the yield
+			below has not been made yet. */
+			traceBLOCKING_ON_EVENT_FLAGS( pxFlags );
+			vTaskPlaceOnEventList( &( pxFlags->xTasksWaiting ), xTicksToWait );
+		}
+		taskEXIT_CRITICAL();
+
+		portYIELD_WITHIN_API();
+	}
+}
+/*-----------------------------------------------------------*/
+
+void vEventFlagsSet( xEventFlagsHandle xFlags, unsigned portBASE_TYPE uxBitsToSet )
+{
+xEVENT_FLAGS * const pxFlags = ( xEVENT_FLAGS * ) xFlags;
+signed portBASE_TYPE xYieldRequired;
+
+	taskENTER_CRITICAL();
+	{
+		pxFlags->uxBits |= uxBitsToSet;
+		traceEVENT_FLAGS_SET( pxFlags );
+		xYieldRequired = prvReadyWaitingTasks( pxFlags );
+	}
+	taskEXIT_CRITICAL();
+
+	if( xYieldRequired != pdFALSE )
+	{
+		portYIELD_WITHIN_API();
+	}
+}
+/*-----------------------------------------------------------*/
+
+signed portBASE_TYPE xEventFlagsSetFromISR( xEventFlagsHandle xFlags, unsigned portBASE_TYPE uxBitsToSet, signed portBASE_TYPE *pxHigherPriorityTaskWoken )
+{
+xEVENT_FLAGS * const pxFlags = ( xEVENT_FLAGS * ) xFlags;
+signed portBASE_TYPE xReturn = pdFALSE;
+unsigned portBASE_TYPE uxSavedInterruptStatus;
+
+	uxSavedInterruptStatus = portSET_INTERRUPT_MASK_FROM_ISR();
+	{
+		pxFlags->uxBits |= uxBitsToSet;
+		traceEVENT_FLAGS_SET_FROM_ISR( pxFlags );
+
+		if( listLIST_IS_EMPTY( &( pxFlags->xTasksWaiting ) ) == pdFALSE )
+		{
+			xReturn = pdTRUE;
+			if( prvReadyWaitingTasks( pxFlags ) != pdFALSE )
+			{
+				*pxHigherPriorityTaskWoken = pdTRUE;
+			}
+		}
+	}
+	portCLEAR_INTERRUPT_MASK_FROM_ISR( uxSavedInterruptStatus );
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+unsigned portBASE_TYPE uxEventFlagsClear( xEventFlagsHandle xFlags, unsigned portBASE_TYPE uxBitsToClear )
+{
+xEVENT_FLAGS * const pxFlags = ( xEVENT_FLAGS * ) xFlags;
+unsigned portBASE_TYPE uxReturn;
+
+	taskENTER_CRITICAL();
+	{
+		uxReturn = pxFlags->uxBits;
+		pxFlags->uxBits &= ~uxBitsToClear;
+	}
+	taskEXIT_CRITICAL();
+
+	return uxReturn;
+}
+/*-----------------------------------------------------------*/
+
+static signed portBASE_TYPE prvReadyWaitingTasks( xEVENT_FLAGS *pxFlags )
+{
+signed portBASE_TYPE xReturn = pdFALSE;
+
+	/* The bits each task waits for are not kept, so all of them are readied
+	and check their own bits again. */
+	while( listLIST_IS_EMPTY( &( pxFlags->xTasksWaiting ) ) == pdFALSE )
+	{
+		if( xTaskRemoveFromEventList( &( pxFlags->xTasksWaiting ) ) != pdFALSE )
+		{
+			xReturn = pdTRUE;
+		}
+	}
+
+	return xReturn;
+}
@@ -193,6 +193,11 @@ typedef portBASE_TYPE (*pdTASK_HOOK_CODE)( void * );
 #endif
 
 
+#ifndef portPOINTER_SIZE_TYPE
+	/* An unsigned integer type as large as a pointer. */
+	#define portPOINTER_SIZE_TYPE unsigned int
+#endif
+
 #ifndef portSET_INTERRUPT_MASK_FROM_ISR
 	#define portSET_INTERRUPT_MASK_FROM_ISR() 0
 #endif
@@ -376,6 +381,42 @@ typedef portBASE_TYPE (*pdTASK_HOOK_CODE)( void * );
 	#define traceTASK_INCREMENT_TICK( xTickCount )
 #endif
 
+#ifndef traceISR_ENTER
+	/* Called by the drivers and MAC layers at the start of their interrupt
+	callbacks, ucId tells which interrupt it is. */
+	#define traceISR_ENTER( ucId )
+#endif
+
+#ifndef traceEVENT_FLAGS_CREATE
+	#define traceEVENT_FLAGS_CREATE( pxNewFlags )
+#endif
+
+#ifndef traceEVENT_FLAGS_CREATE_FAILED
+	#define traceEVENT_FLAGS_CREATE_FAILED()
+#endif
+
+#ifndef traceEVENT_FLAGS_SET
+	#define traceEVENT_FLAGS_SET( pxFlags )
+#endif
+
+#ifndef traceEVENT_FLAGS_SET_FROM_ISR
+	#define traceEVENT_FLAGS_SET_FROM_ISR( pxFlags )
+#endif
+
+#ifndef traceEVENT_FLAGS_WAIT
+	/* A task found the bits it waits for, at once or after blocking. */
+	#define traceEVENT_FLAGS_WAIT( pxFlags )
+#endif
+
+#ifndef traceEVENT_FLAGS_WAIT_FAILED
+	#define traceEVENT_FLAGS_WAIT_FAILED( pxFlags )
+#endif
+
+#ifndef traceBLOCKING_ON_EVENT_FLAGS
+	/* Task is about to block because none of the bits it waits for is set. */
+	#define traceBLOCKING_ON_EVENT_FLAGS( pxFlags )
+#endif
+
 #ifndef configGENERATE_RUN_TIME_STATS
 	#define configGENERATE_RUN_TIME_STATS 0
 #endif
@@ -400,6 +441,30 @@ typedef portBASE_TYPE (*pdTASK_HOOK_CODE)( void * );
 	#define configUSE_MALLOC_FAILED_HOOK 0
 #endif
 
+#ifndef configUSE_TICKLESS_IDLE
+	#define configUSE_TICKLESS_IDLE 0
+#endif
+
+#ifndef configEXPECTED_IDLE_TIME_BEFORE_SLEEP
+	#define configEXPECTED_IDLE_TIME_BEFORE_SLEEP 2
+#endif
+
+#if configEXPECTED_IDLE_TIME_BEFORE_SLEEP < 2
+	#error configEXPECTED_IDLE_TIME_BEFORE_SLEEP must not be less than 2.
+#endif
+
+#if ( configUSE_TICKLESS_IDLE == 1 ) && !defined( portSUPPRESS_TICKS_AND_SLEEP )
+	#error configUSE_TICKLESS_IDLE is set to 1 but the port does not define portSUPPRESS_TICKS_AND_SLEEP.
+#endif
+
+#ifndef configPRE_SLEEP_PROCESSING
+	#define configPRE_SLEEP_PROCESSING( xExpectedIdleTime )
+#endif
+
+#ifndef configPOST_SLEEP_PROCESSING
+	#define configPOST_SLEEP_PROCESSING( xExpectedIdleTime )
+#endif
+
 #ifndef portPRIVILEGE_BIT
 	#define portPRIVILEGE_BIT ( ( unsigned portBASE_TYPE ) 0x00 )
 #endif
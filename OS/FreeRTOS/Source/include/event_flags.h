@@ -0,0 +1,158 @@
+/*
+    FreeRTOS V6.0.5 - Copyright (C) 2010 Real Time Engineers Ltd.
+
+    ***************************************************************************
+    *                                                                         *
+    * If you are:                                                             *
+    *                                                                         *
+    *    + New to FreeRTOS,                                                   *
+    *    + Wanting to learn FreeRTOS or multitasking in general quickly       *
+    *    + Looking for basic training,                                        *
+    *    + Wanting to improve your FreeRTOS skills and productivity           *
+    *                                                                         *
+    * then take a look at the FreeRTOS eBook                                  *
+    *                                                                         *
+    *        "Using the FreeRTOS Real Time Kernel - a Practical Guide"        *
+    *                  http://www.FreeRTOS.org/Documentation                  *
+    *                                                                         *
+    * A pdf reference manual is also available.  Both are usually delivered   *
+    * to your inbox within 20 minutes to two hours when purchased between 8am *
+    * and 8pm GMT (although please allow up to 24 hours in case of            *
+    * exceptional circumstances).  Thank you for your support!                *
+    *                                                                         *
+    ***************************************************************************
+
+    This file is part of the FreeRTOS distribution.
+
+    FreeRTOS is free software; you can redistribute it and/or modify it under
+    the terms of the GNU General Public License (version 2) as published by the
+    Free Software Foundation AND MODIFIED BY the FreeRTOS exception.
+    ***NOTE*** The exception to the GPL is included to allow you to distribute
+    a combined work that includes FreeRTOS without being obliged to provide the
+    source code for proprietary components outside of the FreeRTOS kernel.
+    FreeRTOS is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+    more details. You should have received a copy of the GNU General Public
+    License and the FreeRTOS license exception along with FreeRTOS; if not it
+    can be viewed here: http://www.freertos.org/a00114.html and also obtained
+    by writing to Richard Barry, contact details for whom are available on the
+    FreeRTOS WEB site.
+
+    1 tab == 4 spaces!
+
+    http://www.FreeRTOS.org - Documentation, latest information, license and
+    contact details.
+
+    http://www.SafeRTOS.com - A version that is certified for use in safety
+    critical systems.
+
+    http://www.OpenRTOS.com - Commercial support, development, porting,
+    licensing and training services.
+*/
+
+#ifndef INC_FREERTOS_H
+	#error "#include FreeRTOS.h" must appear in source files before "#include event_flags.h"
+#endif
+
+#ifndef EVENT_FLAGS_H
+#define EVENT_FLAGS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Event flags are a set of bits that tasks and interrupts set, and that a task
+ * waits for.  Unlike a queue of events, setting a bit that is already set does
+ * not need any room, and a task waits for several events with a single call.
+ * A task blocked on the flags is readied directly by the interrupt that sets
+ * one of the bits it waits for, so the wake up latency is that of a semaphore
+ * given from the interrupt.
+ *
+ * There are as many bits as in an unsigned portBASE_TYPE, 16 on the MSP430.
+ */
+typedef void * xEventFlagsHandle;
+
+/**
+ * event_flags. h
+ * <pre>xEventFlagsHandle xEventFlagsCreate( void );</pre>
+ *
+ * Create a set of event flags, all the bits cleared.
+ *
+ * @return A handle to the flags, or 0 if there is not enough heap.
+ */
+xEventFlagsHandle xEventFlagsCreate( void );
+
+/**
+ * event_flags. h
+ * <pre>
+ unsigned portBASE_TYPE uxEventFlagsWait(
+                              xEventFlagsHandle xFlags,
+                              unsigned portBASE_TYPE uxBitsToWaitFor,
+                              portBASE_TYPE xClearOnExit,
+                              portTickType xTicksToWait
+                          );</pre>
+ *
+ * Block until at least one of the bits of uxBitsToWaitFor is set.  The other
+ * bits are left as they are.
+ *
+ * @param xFlags The flags to wait on.
+ *
+ * @param uxBitsToWaitFor The bits waited for, any of them unblocks the task.
+ *
+ * @param xClearOnExit If pdTRUE, the bits returned are cleared before
+ * returning, so that each event is handled once.
+ *
+ * @param xTicksToWait The maximum time to block, portMAX_DELAY to wait
+ * forever if INCLUDE_vTaskSuspend is 1, 0 to poll.
+ *
+ * @return The bits of uxBitsToWaitFor that were set, 0 on time out.
+ */
+unsigned portBASE_TYPE uxEventFlagsWait( xEventFlagsHandle xFlags, unsigned portBASE_TYPE uxBitsToWaitFor, portBASE_TYPE xClearOnExit, portTickType xTicksToWait );
+
+/**
+ * event_flags. h
+ * <pre>void vEventFlagsSet( xEventFlagsHandle xFlags, unsigned portBASE_TYPE uxBitsToSet );</pre>
+ *
+ * Set bits, and ready the tasks waiting for any of them.  Must not be called
+ * from an interrupt, see xEventFlagsSetFromISR().
+ */
+void vEventFlagsSet( xEventFlagsHandle xFlags, unsigned portBASE_TYPE uxBitsToSet );
+
+/**
+ * event_flags. h
+ * <pre>
+ signed portBASE_TYPE xEventFlagsSetFromISR(
+                              xEventFlagsHandle xFlags,
+                              unsigned portBASE_TYPE uxBitsToSet,
+                              signed portBASE_TYPE *pxHigherPriorityTaskWoken
+                          );</pre>
+ *
+ * Set bits from an interrupt service routine.
+ *
+ * @param pxHigherPriorityTaskWoken Set to pdTRUE if a task was readied that
+ * has a priority higher than or equal to the interrupted task, in which case
+ * a context switch should be requested before the interrupt exits.  It is
+ * left unchanged otherwise.
+ *
+ * @return pdTRUE if a task was readied, else pdFALSE.
+ */
+signed portBASE_TYPE xEventFlagsSetFromISR( xEventFlagsHandle xFlags, unsigned portBASE_TYPE uxBitsToSet, signed portBASE_TYPE *pxHigherPriorityTaskWoken );
+
+/**
+ * event_flags. h
+ * <pre>unsigned portBASE_TYPE uxEventFlagsClear( xEventFlagsHandle xFlags, unsigned portBASE_TYPE uxBitsToClear );</pre>
+ *
+ * Clear bits, to forget the events that happened before a wait for
+ * instance.  Must not be called from an interrupt.
+ *
+ * @return The bits that were set before the call.
+ */
+unsigned portBASE_TYPE uxEventFlagsClear( xEventFlagsHandle xFlags, unsigned portBASE_TYPE uxBitsToClear );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* EVENT_FLAGS_H */
@@ -357,6 +357,27 @@ void vPortFree( void *pv ) PRIVILEGED_FUNCTION;
 void vPortInitialiseBlocks( void ) PRIVILEGED_FUNCTION;
 size_t xPortGetFreeHeapSize( void ) PRIVILEGED_FUNCTION;
 
+/*
+ * Only provided by heap_4.c.  The FromISR versions only use the fixed size
+ * block pools and can be called from interrupt service routines.
+ * xPortFreeFromISR() returns pdFALSE, and does not free the block, if it came
+ * from the fallback region.  xPortGetHeapStats() fills pxStats for the pool
+ * uxIndex, the fallback region comes after the last pool, and returns pdFALSE
+ * past the fallback region.
+ */
+typedef struct xHEAP_STATS
+{
+	size_t xBlockSize;			/*<< The pool block size, 0 for the fallback region. */
+	size_t xSize;				/*<< The bytes of the pool or region. */
+	size_t xFree;				/*<< The bytes free now. */
+	size_t xMinFree;			/*<< The lowest xFree since the start. */
+	unsigned short usFailed;	/*<< The requests that found the pool or region full. */
+} xHeapStats;
+
+void *pvPortMallocFromISR( size_t xSize ) PRIVILEGED_FUNCTION;
+portBASE_TYPE xPortFreeFromISR( void *pv ) PRIVILEGED_FUNCTION;
+portBASE_TYPE xPortGetHeapStats( unsigned portBASE_TYPE uxIndex, xHeapStats *pxStats ) PRIVILEGED_FUNCTION;
+
 /*
  * Setup the hardware ready for the scheduler to take control.  This generally
  * sets up a tick interrupt and sets timers for the correct tick frequency.
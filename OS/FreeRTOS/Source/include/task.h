@@ -1145,6 +1145,33 @@ portBASE_TYPE xTaskCallApplicationTaskHook( xTaskHandle xTask, void *pvParameter
  */
 void vTaskIncrementTick( void ) PRIVILEGED_FUNCTION;
 
+/*
+ * THIS FUNCTION MUST NOT BE USED FROM APPLICATION CODE.  IT IS ONLY
+ * INTENDED FOR USE WHEN IMPLEMENTING A PORT OF THE SCHEDULER AND IS
+ * AN INTERFACE WHICH IS FOR THE EXCLUSIVE USE OF THE SCHEDULER.
+ *
+ * Only available when configUSE_TICKLESS_IDLE is set to 1.  Called by
+ * portSUPPRESS_TICKS_AND_SLEEP(), with the scheduler suspended, to account
+ * the ticks that went by while the tick interrupt was stopped.  The jump
+ * must leave the tick count before the wake time of the first delayed task,
+ * the tick interrupt unblocks it.
+ */
+void vTaskStepTick( portTickType xTicksToJump ) PRIVILEGED_FUNCTION;
+
+/*
+ * THIS FUNCTION MUST NOT BE USED FROM APPLICATION CODE.  IT IS ONLY
+ * INTENDED FOR USE WHEN IMPLEMENTING A PORT OF THE SCHEDULER AND IS
+ * AN INTERFACE WHICH IS FOR THE EXCLUSIVE USE OF THE SCHEDULER.
+ *
+ * THIS FUNCTION MUST BE CALLED WITH INTERRUPTS DISABLED.
+ *
+ * Only available when configUSE_TICKLESS_IDLE is set to 1.  Called by
+ * portSUPPRESS_TICKS_AND_SLEEP() just before sleeping.  Returns pdFALSE if
+ * an interrupt readied a task, requested a yield or ticked since the idle
+ * time was computed, the sleep must then be abandoned.
+ */
+portBASE_TYPE xTaskConfirmSleepModeStatus( void ) PRIVILEGED_FUNCTION;
+
 /*
  * THIS FUNCTION MUST NOT BE USED FROM APPLICATION CODE.  IT IS AN
  * INTERFACE WHICH IS FOR THE EXCLUSIVE USE OF THE SCHEDULER.
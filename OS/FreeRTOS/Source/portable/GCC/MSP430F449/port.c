@@ -73,6 +73,7 @@
 /* Constants required for hardware setup.  The tick ISR runs off the ACLK,
 not the MCLK. */
 #define portACLK_FREQUENCY_HZ			( ( portTickType ) 32768 )
+#define portTICK_RELOAD					( ( unsigned short ) ( portACLK_FREQUENCY_HZ / configTICK_RATE_HZ ) )
 #define portINITIAL_CRITICAL_NESTING	( ( unsigned short ) 10 )
 #define portFLAGS_INT_ENABLED	( ( portSTACK_TYPE ) 0x08 )
 
@@ -96,6 +97,21 @@ sequence. */
 volatile unsigned short usCriticalNesting = portINITIAL_CRITICAL_NESTING;
 /*-----------------------------------------------------------*/
 
+#if configUSE_TICKLESS_IDLE == 1
+
+	/* The timer runs in up mode, a tick lasts TACCR0 + 1 ACLK periods. */
+	#define portCOUNTS_PER_TICK			( ( unsigned short ) ( portTICK_RELOAD + 1 ) )
+
+	/* The longest sleep the 16 bit timer can count. */
+	#define portMAX_SUPPRESSED_TICKS	( ( portTickType ) ( 0xffff / portCOUNTS_PER_TICK ) )
+
+	/* Set by the tick ISR, to tell a sleep that ran to its end from an early
+	wake up by another interrupt. */
+	static volatile unsigned short usTickFired = 0;
+
+#endif
+/*-----------------------------------------------------------*/
+
 /*
  * Macro to save a task context to the task stack.  This simply pushes all the
  * general purpose msp430 registers onto the stack, followed by the
@@ -295,7 +311,7 @@ static void prvSetupTimerInterrupt( void )
 	TACTL |= TACLR;
 
 	/* Set the compare match value according to the tick rate we want. */
-	TACCR0 = portACLK_FREQUENCY_HZ / configTICK_RATE_HZ;
+	TACCR0 = portTICK_RELOAD;
 
 	/* Enable the interrupts. */
 	TACCTL0 = CCIE;
@@ -308,6 +324,96 @@ static void prvSetupTimerInterrupt( void )
 }
 /*-----------------------------------------------------------*/
 
+#if configUSE_TICKLESS_IDLE == 1
+
+/*
+ * Called by the idle task, with the scheduler suspended, when no task is
+ * due for at least configEXPECTED_IDLE_TIME_BEFORE_SLEEP ticks.  TACCR0 is
+ * set to the end of the idle time and the MCU waits in LPM3, then the tick
+ * count is corrected and the timer put back in phase with the ticks.
+ *
+ * Interrupts other than the tick end the sleep only if they exit the low
+ * power mode on return, as the WSN430 drivers do when their callback
+ * returns non zero.
+ */
+void vPortSuppressTicksAndSleep( portTickType xExpectedIdleTime )
+{
+unsigned short usPhase, usElapsed;
+portTickType xCompleteTicks;
+
+	if( xExpectedIdleTime > portMAX_SUPPRESSED_TICKS )
+	{
+		xExpectedIdleTime = portMAX_SUPPRESSED_TICKS;
+	}
+
+	/* Stop the timer, it only loses the few cycles until it restarts. */
+	portDISABLE_INTERRUPTS();
+	TACTL &= ~MC_3;
+	usPhase = TAR;
+
+	/* A tick is pending or a task was readied since the idle time was
+	computed, don't sleep. */
+	if( ( TACCTL0 & CCIFG ) || ( xTaskConfirmSleepModeStatus() == pdFALSE ) )
+	{
+		TACTL |= MC_1;
+		portENABLE_INTERRUPTS();
+		return;
+	}
+
+	/* Interrupt at the end of the idle time: the rest of the current tick,
+	then the other ones. */
+	TACCR0 = ( portCOUNTS_PER_TICK - usPhase ) + ( xExpectedIdleTime - 1 ) * portCOUNTS_PER_TICK - 1;
+	TACTL |= TACLR;
+	usTickFired = 0;
+	TACTL |= MC_1;
+
+	configPRE_SLEEP_PROCESSING( xExpectedIdleTime );
+
+	/* GIE is set with the low power bits, no interrupt can be taken between
+	the two and let the MCU sleep without a wake up pending. */
+	_BIS_SR( LPM3_bits | GIE );
+
+	portDISABLE_INTERRUPTS();
+
+	configPOST_SLEEP_PROCESSING( xExpectedIdleTime );
+
+	TACTL &= ~MC_3;
+	usElapsed = TAR;
+
+	if( usTickFired || ( TACCTL0 & CCIFG ) )
+	{
+		/* The idle time went by.  The tick interrupt accounts the last
+		tick, as a missed tick, and unblocks the task that is due.  The
+		timer counts since then. */
+		xCompleteTicks = xExpectedIdleTime - 1;
+		usPhase = ( usElapsed == TACCR0 ) ? portTICK_RELOAD : usElapsed;
+	}
+	else
+	{
+		/* Woken up early by another interrupt, account the ticks that are
+		complete, the current one ends with the next tick interrupt. */
+		usElapsed += usPhase;
+		xCompleteTicks = usElapsed / portCOUNTS_PER_TICK;
+		usPhase = usElapsed % portCOUNTS_PER_TICK;
+	}
+
+	vTaskStepTick( xCompleteTicks );
+
+	/* Back to the periodic tick. */
+	if( usPhase > portTICK_RELOAD )
+	{
+		usPhase = portTICK_RELOAD;
+	}
+	TACCR0 = portTICK_RELOAD;
+	TAR = usPhase;
+	TACTL |= MC_1;
+
+	portENABLE_INTERRUPTS();
+}
+/*-----------------------------------------------------------*/
+
+#endif
+
 /*
  * The interrupt service routine used depends on whether the pre-emptive
  * scheduler is being used or not.
@@ -326,6 +432,14 @@ static void prvSetupTimerInterrupt( void )
 		/* Save the context of the interrupted task. */
 		portSAVE_CONTEXT();
 
+		#if configUSE_TICKLESS_IDLE == 1
+		{
+			/* Restoring the context clears the low power bits, this ends a
+			sleep of the idle task. */
+			usTickFired = 1;
+		}
+		#endif
+
 		/* Increment the tick count then switch to the highest priority task
 		that is ready to run. */
 		vTaskIncrementTick();
@@ -346,6 +460,14 @@ static void prvSetupTimerInterrupt( void )
 	interrupt (TIMERA0_VECTOR) prvTickISR( void )
 	{
 		vTaskIncrementTick();
+
+		#if configUSE_TICKLESS_IDLE == 1
+		{
+			/* End a sleep of the idle task. */
+			usTickFired = 1;
+			LPM3_EXIT;
+		}
+		#endif
 	}
 #endif
 
@@ -0,0 +1,515 @@
+/*
+    FreeRTOS V6.0.5 - Copyright (C) 2010 Real Time Engineers Ltd.
+
+    ***************************************************************************
+    *                                                                         *
+    * If you are:                                                             *
+    *                                                                         *
+    *    + New to FreeRTOS,                                                   *
+    *    + Wanting to learn FreeRTOS or multitasking in general quickly       *
+    *    + Looking for basic training,                                        *
+    *    + Wanting to improve your FreeRTOS skills and productivity           *
+    *                                                                         *
+    * then take a look at the FreeRTOS eBook                                  *
+    *                                                                         *
+    *        "Using the FreeRTOS Real Time Kernel - a Practical Guide"        *
+    *                  http://www.FreeRTOS.org/Documentation                  *
+    *                                                                         *
+    * A pdf reference manual is also available.  Both are usually delivered   *
+    * to your inbox within 20 minutes to two hours when purchased between 8am *
+    * and 8pm GMT (although please allow up to 24 hours in case of            *
+    * exceptional circumstances).  Thank you for your support!                *
+    *                                                                         *
+    ***************************************************************************
+
+    This file is part of the FreeRTOS distribution.
+
+    FreeRTOS is free software; you can redistribute it and/or modify it under
+    the terms of the GNU General Public License (version 2) as published by the
+    Free Software Foundation AND MODIFIED BY the FreeRTOS exception.
+    ***NOTE*** The exception to the GPL is included to allow you to distribute
+    a combined work that includes FreeRTOS without being obliged to provide the
+    source code for proprietary components outside of the FreeRTOS kernel.
+    FreeRTOS is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+    more details. You should have received a copy of the GNU General Public
+    License and the FreeRTOS license exception along with FreeRTOS; if not it
+    can be viewed here: http://www.freertos.org/a00114.html and also obtained
+    by writing to Richard Barry, contact details for whom are available on the
+    FreeRTOS WEB site.
+
+    1 tab == 4 spaces!
+
+    http://www.FreeRTOS.org - Documentation, latest information, license and
+    contact details.
+
+    http://www.SafeRTOS.com - A version that is certified for use in safety
+    critical systems.
+
+    http://www.OpenRTOS.com - Commercial support, development, porting,
+    licensing and training services.
+*/
+
+/*
+ * Port to the lib/sim host radio medium simulator.
+ *
+ * Each simulated node loads its own copy of the kernel, the MAC and the
+ * application as a shared object, so that all their static state is private,
+ * and runs against the emulated CC1101, TimerB and port 1 of the node.  Tasks
+ * are ucontext coroutines with a host stack, the stack allocated by the kernel
+ * only holds a pointer to the coroutine.
+ *
+ * The simulator is a discrete event kernel.  The tasks of a node run until
+ * they sleep or busy wait, then control goes back to the event loop:
+ *
+ *	+ vPortSleep() and the tickless idle return to the event loop until an
+ *	  interrupt wakes the MCU up.
+ *	+ Every register read of the emulated hardware made by a task lets
+ *	  portSPIN_TIME pass, so that the polling loops of the drivers and MACs
+ *	  see time going.  The node interrupts are served meanwhile, unless the
+ *	  task has disabled them.
+ *
+ * Interrupts are the simulator events of the node: the tick, the TimerB
+ * alarms and the port 1 interrupts of the radio.  They run on the simulator
+ * stack, and the switch to the highest priority ready task is made when they
+ * return, after portSWITCH_TIME.  Code runs in no simulated time apart from
+ * that and the busy waits.
+ */
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <ucontext.h>
+
+/* Scheduler includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Simulator includes. */
+#include "sim.h"
+
+/*-----------------------------------------------------------
+ * Implementation of functions defined in portable.h for the simulator port.
+ *----------------------------------------------------------*/
+
+/* The host stack of each task, large enough for the C library. */
+#define portTASK_STACK_SIZE				( 64 * 1024 )
+
+/* The time a register read takes, and so each iteration of a polling loop. */
+#define portSPIN_TIME					SIM_US( 10 )
+
+/* The time from an interrupt to the task it readied, which the drivers rely
+on: the sync word interrupt of the radio, for instance, comes before the first
+byte is in the FIFO. */
+#define portSWITCH_TIME					SIM_US( 40 )
+
+#define portTICK_TIME					( SIM_S( 1 ) / configTICK_RATE_HZ )
+
+/* A task coroutine, with the interrupt state it left. */
+typedef struct xSIM_TASK
+{
+	ucontext_t xContext;
+	pdTASK_CODE pxCode;
+	void *pvParameters;
+	unsigned portBASE_TYPE uxCriticalNesting;
+	portBASE_TYPE xInterruptsDisabled;
+} xSimTask;
+
+/* We require the address of the pxCurrentTCB variable, but don't want to know
+any details of its type.  The first member of the TCB is its top of stack,
+where pxPortInitialiseStack() stored the coroutine. */
+typedef void tskTCB;
+extern volatile tskTCB * volatile pxCurrentTCB;
+#define prvCurrentTask() ( ( xSimTask * ) **( ( portSTACK_TYPE ** ) pxCurrentTCB ) )
+
+/* The interrupt state of the running task. */
+static unsigned portBASE_TYPE uxCriticalNesting = 0;
+static portBASE_TYPE xInterruptsDisabled = pdFALSE;
+
+/* The node, and the event loop context to go back to when the tasks sleep. */
+static sim_node_t *pxNode = NULL;
+static ucontext_t xSimContext;
+
+/* pdTRUE while a task runs, pdFALSE in the event loop and the interrupts. */
+static portBASE_TYPE xInTask = pdFALSE;
+
+/* pdTRUE while the current task sleeps until the next interrupt. */
+static portBASE_TYPE xSleeping = pdFALSE;
+
+/* Generation of the pending busy wait end, older ones are ignored. */
+static uint32_t ulSpinGeneration = 0;
+
+/* Time of the last tick, and generation of the pending tick event, which is
+changed to stop the tick. */
+static sim_time_t xLastTickTime = 0;
+static uint32_t ulTickGeneration = 0;
+
+/* pdTRUE when the last event of the node was a stopped tick or a stale wake
+up, which the MCU does not see. */
+static portBASE_TYPE xStaleEvent = pdFALSE;
+
+/*
+ * Give the MCU to the current task until the tasks sleep or busy wait.
+ */
+static void prvResumeCurrentTask( void );
+
+/*
+ * Go back to the event loop from a task.
+ */
+static void prvReturnToSimulator( void );
+
+/*
+ * Task coroutine entry point.
+ */
+static void prvTaskEntry( void );
+
+/*
+ * The simulator hooks, see sim_node_t.
+ */
+static void prvSpin( sim_node_t *pxSimNode );
+static void prvInterruptExit( sim_node_t *pxSimNode );
+
+/*
+ * Simulator events.
+ */
+static void prvTickInterrupt( sim_node_t *pxSimNode, uint32_t ulGeneration );
+static void prvSpinEnd( sim_node_t *pxSimNode, uint32_t ulGeneration );
+static void prvScheduleTick( void );
+
+#if configUSE_TICKLESS_IDLE == 1
+	static void prvWakeInterrupt( sim_node_t *pxSimNode, uint32_t ulGeneration );
+#endif
+
+/*-----------------------------------------------------------*/
+
+/*
+ * See header file for description.
+ */
+portSTACK_TYPE *pxPortInitialiseStack( portSTACK_TYPE *pxTopOfStack, pdTASK_CODE pxCode, void *pvParameters )
+{
+xSimTask *pxTask;
+
+	pxTask = malloc( sizeof( xSimTask ) );
+	if( pxTask == NULL )
+	{
+		fprintf( stderr, "port: out of memory\n" );
+		abort();
+	}
+
+	pxTask->pxCode = pxCode;
+	pxTask->pvParameters = pvParameters;
+	pxTask->uxCriticalNesting = 0;
+	pxTask->xInterruptsDisabled = pdFALSE;
+
+	getcontext( &( pxTask->xContext ) );
+	pxTask->xContext.uc_stack.ss_sp = malloc( portTASK_STACK_SIZE );
+	pxTask->xContext.uc_stack.ss_size = portTASK_STACK_SIZE;
+	pxTask->xContext.uc_link = NULL;
+	if( pxTask->xContext.uc_stack.ss_sp == NULL )
+	{
+		fprintf( stderr, "port: out of memory\n" );
+		abort();
+	}
+	makecontext( &( pxTask->xContext ), prvTaskEntry, 0 );
+
+	*pxTopOfStack = ( portSTACK_TYPE ) pxTask;
+	return pxTopOfStack;
+}
+/*-----------------------------------------------------------*/
+
+portBASE_TYPE xPortStartScheduler( void )
+{
+	/* Called in the node context, from its start event. */
+	pxNode = sim_current;
+	pxNode->spin = prvSpin;
+	pxNode->irq_exit = prvInterruptExit;
+
+	xLastTickTime = sim_now();
+	prvScheduleTick();
+
+	/* Run the tasks until they sleep, the node is then driven by its
+	interrupts. */
+	prvResumeCurrentTask();
+
+	return pdTRUE;
+}
+/*-----------------------------------------------------------*/
+
+void vPortEndScheduler( void )
+{
+	/* The simulation ends with the event loop. */
+}
+/*-----------------------------------------------------------*/
+
+void vPortYield( void )
+{
+xSimTask *pxPrevious, *pxNext;
+
+	if( xInTask == pdFALSE )
+	{
+		/* From an interrupt, the switch is made when it returns. */
+		return;
+	}
+
+	pxPrevious = prvCurrentTask();
+	vTaskSwitchContext();
+	pxNext = prvCurrentTask();
+
+	if( pxNext != pxPrevious )
+	{
+		pxPrevious->uxCriticalNesting = uxCriticalNesting;
+		pxPrevious->xInterruptsDisabled = xInterruptsDisabled;
+		uxCriticalNesting = pxNext->uxCriticalNesting;
+		xInterruptsDisabled = pxNext->xInterruptsDisabled;
+
+		swapcontext( &( pxPrevious->xContext ), &( pxNext->xContext ) );
+	}
+}
+/*-----------------------------------------------------------*/
+
+void vPortDisableInterrupts( void )
+{
+	xInterruptsDisabled = pdTRUE;
+}
+/*-----------------------------------------------------------*/
+
+void vPortEnableInterrupts( void )
+{
+	xInterruptsDisabled = pdFALSE;
+}
+/*-----------------------------------------------------------*/
+
+void vPortEnterCritical( void )
+{
+	vPortDisableInterrupts();
+	uxCriticalNesting++;
+}
+/*-----------------------------------------------------------*/
+
+void vPortExitCritical( void )
+{
+	if( uxCriticalNesting > 0 )
+	{
+		uxCriticalNesting--;
+		if( uxCriticalNesting == 0 )
+		{
+			vPortEnableInterrupts();
+		}
+	}
+}
+/*-----------------------------------------------------------*/
+
+void vPortSleep( void )
+{
+	if( xInTask == pdTRUE )
+	{
+		xSleeping = pdTRUE;
+		prvReturnToSimulator();
+	}
+}
+/*-----------------------------------------------------------*/
+
+#if configUSE_TICKLESS_IDLE == 1
+
+	void vPortSuppressTicksAndSleep( portTickType xExpectedIdleTime )
+	{
+	portTickType xCompleteTicks;
+
+		/* Called by the idle task with the scheduler suspended.  A task may
+		have been readied by an interrupt since it decided to sleep. */
+		if( xTaskConfirmSleepModeStatus() == pdFALSE )
+		{
+			return;
+		}
+
+		/* Stop the tick, and wake up at the tick the next task is due. */
+		ulTickGeneration++;
+		sim_schedule_cpu( xLastTickTime + ( sim_time_t ) xExpectedIdleTime * portTICK_TIME, pxNode, prvWakeInterrupt, ulTickGeneration );
+
+		configPRE_SLEEP_PROCESSING( xExpectedIdleTime );
+		vPortSleep();
+		configPOST_SLEEP_PROCESSING( xExpectedIdleTime );
+
+		/* The wake up event is stale if it has not come yet. */
+		ulTickGeneration++;
+
+		/* Woken up by the wake up event or by another interrupt.  Step the
+		complete ticks but the last one, which is processed as a normal tick,
+		right now. */
+		xCompleteTicks = ( portTickType ) ( ( sim_now() - xLastTickTime ) / portTICK_TIME );
+		if( xCompleteTicks > xExpectedIdleTime )
+		{
+			xCompleteTicks = xExpectedIdleTime;
+		}
+		if( xCompleteTicks > 0 )
+		{
+			vTaskStepTick( xCompleteTicks - 1 );
+			xLastTickTime += ( sim_time_t ) ( xCompleteTicks - 1 ) * portTICK_TIME;
+		}
+
+		prvScheduleTick();
+	}
+
+#endif /* configUSE_TICKLESS_IDLE */
+/*-----------------------------------------------------------*/
+
+static void prvResumeCurrentTask( void )
+{
+xSimTask *pxTask = prvCurrentTask();
+
+	xSleeping = pdFALSE;
+	uxCriticalNesting = pxTask->uxCriticalNesting;
+	xInterruptsDisabled = pxTask->xInterruptsDisabled;
+	xInTask = pdTRUE;
+
+	swapcontext( &xSimContext, &( pxTask->xContext ) );
+}
+/*-----------------------------------------------------------*/
+
+static void prvReturnToSimulator( void )
+{
+xSimTask *pxTask = prvCurrentTask();
+
+	pxTask->uxCriticalNesting = uxCriticalNesting;
+	pxTask->xInterruptsDisabled = xInterruptsDisabled;
+	xInTask = pdFALSE;
+
+	/* Interrupts, and the switches they cause, are served in the event loop
+	context. */
+	uxCriticalNesting = 0;
+	xInterruptsDisabled = pdFALSE;
+
+	swapcontext( &( pxTask->xContext ), &xSimContext );
+}
+/*-----------------------------------------------------------*/
+
+static void prvTaskEntry( void )
+{
+xSimTask *pxTask = prvCurrentTask();
+
+	pxTask->pxCode( pxTask->pvParameters );
+
+	/* Tasks must not return. */
+	fprintf( stderr, "port: node %u, a task returned\n", pxNode->id );
+	abort();
+}
+/*-----------------------------------------------------------*/
+
+static void prvSpin( sim_node_t *pxSimNode )
+{
+sim_time_t xEnd;
+
+	if( xInTask == pdFALSE )
+	{
+		/* Interrupts run in no time. */
+		return;
+	}
+
+	xEnd = ( pxSimNode->busy_until > sim_now() ? pxSimNode->busy_until : sim_now() ) + portSPIN_TIME;
+	if( xInterruptsDisabled == pdTRUE )
+	{
+		/* Hold the interrupts back until the end of the busy wait. */
+		pxSimNode->busy_until = xEnd + 1;
+	}
+
+	ulSpinGeneration++;
+	sim_schedule( xEnd, pxSimNode, prvSpinEnd, ulSpinGeneration );
+	prvReturnToSimulator();
+}
+/*-----------------------------------------------------------*/
+
+static void prvSpinEnd( sim_node_t *pxSimNode, uint32_t ulGeneration )
+{
+	( void ) pxSimNode;
+
+	/* The busy waiting task may have been preempted since, and be waiting
+	again with a newer generation. */
+	if( ( ulGeneration == ulSpinGeneration ) && ( xSleeping == pdFALSE ) )
+	{
+		prvResumeCurrentTask();
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvInterruptExit( sim_node_t *pxSimNode )
+{
+volatile tskTCB *pxPrevious = pxCurrentTCB;
+
+	if( xStaleEvent == pdTRUE )
+	{
+		xStaleEvent = pdFALSE;
+		return;
+	}
+
+	#if configUSE_PREEMPTION == 1
+	{
+		vTaskSwitchContext();
+	}
+	#else
+	{
+		/* Only the sleeping idle task gives the MCU away. */
+		if( xSleeping == pdTRUE )
+		{
+			vTaskSwitchContext();
+		}
+	}
+	#endif
+
+	/* A sleeping MCU wakes up on any interrupt, a busy waiting task goes on at
+	the end of its wait unless it is preempted.  The pending wait end of the
+	task, if any, is superseded. */
+	if( ( xSleeping == pdTRUE ) || ( pxCurrentTCB != pxPrevious ) )
+	{
+		xSleeping = pdFALSE;
+		ulSpinGeneration++;
+		sim_schedule( sim_now() + portSWITCH_TIME, pxSimNode, prvSpinEnd, ulSpinGeneration );
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvTickInterrupt( sim_node_t *pxSimNode, uint32_t ulGeneration )
+{
+	( void ) pxSimNode;
+
+	if( ulGeneration != ulTickGeneration )
+	{
+		/* The tick was stopped by the tickless idle. */
+		xStaleEvent = pdTRUE;
+		return;
+	}
+
+	xLastTickTime += portTICK_TIME;
+	vTaskIncrementTick();
+	prvScheduleTick();
+}
+/*-----------------------------------------------------------*/
+
+#if configUSE_TICKLESS_IDLE == 1
+
+	static void prvWakeInterrupt( sim_node_t *pxSimNode, uint32_t ulGeneration )
+	{
+		( void ) pxSimNode;
+
+		/* Only wakes the MCU up, in prvInterruptExit(), unless an earlier
+		interrupt did already. */
+		if( ulGeneration != ulTickGeneration )
+		{
+			xStaleEvent = pdTRUE;
+		}
+	}
+
+#endif /* configUSE_TICKLESS_IDLE */
+/*-----------------------------------------------------------*/
+
+static void prvScheduleTick( void )
+{
+sim_time_t xNext = xLastTickTime + portTICK_TIME;
+
+	/* The next tick may be due already after the tickless idle. */
+	if( xNext < sim_now() )
+	{
+		xNext = sim_now();
+	}
+	sim_schedule_cpu( xNext, pxNode, prvTickInterrupt, ulTickGeneration );
+}
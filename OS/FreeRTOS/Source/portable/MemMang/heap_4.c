@@ -0,0 +1,593 @@
+/*
+    FreeRTOS V6.0.5 - Copyright (C) 2010 Real Time Engineers Ltd.
+
+    ***************************************************************************
+    *                                                                         *
+    * If you are:                                                             *
+    *                                                                         *
+    *    + New to FreeRTOS,                                                   *
+    *    + Wanting to learn FreeRTOS or multitasking in general quickly       *
+    *    + Looking for basic training,                                        *
+    *    + Wanting to improve your FreeRTOS skills and productivity           *
+    *                                                                         *
+    * then take a look at the FreeRTOS eBook                                  *
+    *                                                                         *
+    *        "Using the FreeRTOS Real Time Kernel - a Practical Guide"        *
+    *                  http://www.FreeRTOS.org/Documentation                  *
+    *                                                                         *
+    * A pdf reference manual is also available.  Both are usually delivered   *
+    * to your inbox within 20 minutes to two hours when purchased between 8am *
+    * and 8pm GMT (although please allow up to 24 hours in case of            *
+    * exceptional circumstances).  Thank you for your support!                *
+    *                                                                         *
+    ***************************************************************************
+
+    This file is part of the FreeRTOS distribution.
+
+    FreeRTOS is free software; you can redistribute it and/or modify it under
+    the terms of the GNU General Public License (version 2) as published by the
+    Free Software Foundation AND MODIFIED BY the FreeRTOS exception.
+    ***NOTE*** The exception to the GPL is included to allow you to distribute
+    a combined work that includes FreeRTOS without being obliged to provide the
+    source code for proprietary components outside of the FreeRTOS kernel.
+    FreeRTOS is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+    more details. You should have received a copy of the GNU General Public
+    License and the FreeRTOS license exception along with FreeRTOS; if not it
+    can be viewed here: http://www.freertos.org/a00114.html and also obtained
+    by writing to Richard Barry, contact details for whom are available on the
+    FreeRTOS WEB site.
+
+    1 tab == 4 spaces!
+
+    http://www.FreeRTOS.org - Documentation, latest information, license and
+    contact details.
+
+    http://www.SafeRTOS.com - A version that is certified for use in safety
+    critical systems.
+
+    http://www.OpenRTOS.com - Commercial support, development, porting,
+    licensing and training services.
+*/
+
+/*
+ * A sample implementation of pvPortMalloc() and vPortFree() that takes the
+ * same time whatever the history of the heap, for applications that keep
+ * creating and deleting queues, tasks and packet buffers.
+ *
+ * The configTOTAL_HEAP_SIZE bytes are split into four pools of fixed size
+ * blocks and a fallback region that gets the bytes the pools do not use.
+ * Pool n holds configHEAP_POOLn_BLOCKS blocks of configHEAP_POOLn_BLOCK_SIZE
+ * bytes.  A request is served by the smallest pool whose blocks are large
+ * enough, or by the next larger pools when it is empty.  Taking or giving a
+ * block back only moves the head of the pool free list, and the pools never
+ * fragment.
+ *
+ * Requests larger than the largest block, typically the task stacks, or that
+ * no pool can serve go to the fallback region.  It keeps its free blocks in
+ * address order and combines adjacent free blocks when a block is freed.
+ *
+ * pvPortMallocFromISR() and xPortFreeFromISR() only use the pools, and can be
+ * called from interrupt service routines.  xPortGetHeapStats() gives the low
+ * water mark of each pool and of the fallback region, to size the pools.
+ *
+ * See heap_1.c, heap_2.c and heap_3.c for alternative implementations, and the
+ * memory management pages of http://www.FreeRTOS.org for more information.
+ */
+#include <stdlib.h>
+
+/* Defining MPU_WRAPPERS_INCLUDED_FROM_API_FILE prevents task.h from redefining
+all the API functions to use the MPU wrappers.  That should only be done when
+task.h is included from an application file. */
+#define MPU_WRAPPERS_INCLUDED_FROM_API_FILE
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#undef MPU_WRAPPERS_INCLUDED_FROM_API_FILE
+
+/* The pool sizes.  Block sizes must be increasing multiples of
+portBYTE_ALIGNMENT, a pool with no block is skipped. */
+#ifndef configHEAP_POOL0_BLOCK_SIZE
+	#define configHEAP_POOL0_BLOCK_SIZE		16
+#endif
+#ifndef configHEAP_POOL0_BLOCKS
+	#define configHEAP_POOL0_BLOCKS			8
+#endif
+#ifndef configHEAP_POOL1_BLOCK_SIZE
+	#define configHEAP_POOL1_BLOCK_SIZE		32
+#endif
+#ifndef configHEAP_POOL1_BLOCKS
+	#define configHEAP_POOL1_BLOCKS			6
+#endif
+#ifndef configHEAP_POOL2_BLOCK_SIZE
+	#define configHEAP_POOL2_BLOCK_SIZE		64
+#endif
+#ifndef configHEAP_POOL2_BLOCKS
+	#define configHEAP_POOL2_BLOCKS			6
+#endif
+#ifndef configHEAP_POOL3_BLOCK_SIZE
+	#define configHEAP_POOL3_BLOCK_SIZE		128
+#endif
+#ifndef configHEAP_POOL3_BLOCKS
+	#define configHEAP_POOL3_BLOCKS			4
+#endif
+
+#if ( configHEAP_POOL0_BLOCK_SIZE % portBYTE_ALIGNMENT ) || ( configHEAP_POOL1_BLOCK_SIZE % portBYTE_ALIGNMENT ) || ( configHEAP_POOL2_BLOCK_SIZE % portBYTE_ALIGNMENT ) || ( configHEAP_POOL3_BLOCK_SIZE % portBYTE_ALIGNMENT )
+	#error The heap_4.c block sizes must be multiples of portBYTE_ALIGNMENT.
+#endif
+
+#if ( configHEAP_POOL1_BLOCK_SIZE <= configHEAP_POOL0_BLOCK_SIZE ) || ( configHEAP_POOL2_BLOCK_SIZE <= configHEAP_POOL1_BLOCK_SIZE ) || ( configHEAP_POOL3_BLOCK_SIZE <= configHEAP_POOL2_BLOCK_SIZE )
+	#error The heap_4.c block sizes must be increasing.
+#endif
+
+#define heapPOOLS			4
+#define heapPOOL_BYTES		( ( size_t ) ( configHEAP_POOL0_BLOCK_SIZE * configHEAP_POOL0_BLOCKS ) + \
+							  ( size_t ) ( configHEAP_POOL1_BLOCK_SIZE * configHEAP_POOL1_BLOCKS ) + \
+							  ( size_t ) ( configHEAP_POOL2_BLOCK_SIZE * configHEAP_POOL2_BLOCKS ) + \
+							  ( size_t ) ( configHEAP_POOL3_BLOCK_SIZE * configHEAP_POOL3_BLOCKS ) )
+#define heapFALLBACK_SIZE	( configTOTAL_HEAP_SIZE - heapPOOL_BYTES )
+
+/* Allocate the memory for the heap.  The struct is used to force byte
+alignment without using any non-portable code. */
+static union xRTOS_HEAP
+{
+	#if portBYTE_ALIGNMENT == 8
+		volatile portDOUBLE dDummy;
+	#else
+		volatile unsigned long ulDummy;
+	#endif
+	unsigned char ucHeap[ configTOTAL_HEAP_SIZE ];
+} xHeap;
+
+/* A free pool block holds the link to the next one. */
+typedef struct A_POOL_BLOCK
+{
+	struct A_POOL_BLOCK *pxNextFreeBlock;	/*<< The next free block of the pool. */
+} xPoolBlock;
+
+typedef struct A_POOL
+{
+	unsigned char *pucStart;				/*<< The first block of the pool. */
+	unsigned char *pucEnd;					/*<< The first byte after the last block. */
+	xPoolBlock *pxFreeList;					/*<< The free blocks, NULL if none. */
+	unsigned short usFree;					/*<< The number of free blocks. */
+	unsigned short usMinFree;				/*<< The lowest usFree since the start. */
+	unsigned short usFailed;				/*<< The requests that found the pool empty. */
+} xPool;
+
+static const size_t xPoolBlockSize[ heapPOOLS ] = { configHEAP_POOL0_BLOCK_SIZE, configHEAP_POOL1_BLOCK_SIZE, configHEAP_POOL2_BLOCK_SIZE, configHEAP_POOL3_BLOCK_SIZE };
+static const unsigned short usPoolBlocks[ heapPOOLS ] = { configHEAP_POOL0_BLOCKS, configHEAP_POOL1_BLOCKS, configHEAP_POOL2_BLOCKS, configHEAP_POOL3_BLOCKS };
+
+/* The pools must fit in the heap, and a free block must hold its link.
+These fail to compile otherwise. */
+typedef char heapPOOLS_TOO_LARGE_FOR_configTOTAL_HEAP_SIZE[ ( heapPOOL_BYTES <= configTOTAL_HEAP_SIZE ) ? 1 : -1 ];
+typedef char heapPOOL0_BLOCK_SIZE_TOO_SMALL[ ( configHEAP_POOL0_BLOCK_SIZE >= sizeof( xPoolBlock ) ) ? 1 : -1 ];
+
+static xPool xPools[ heapPOOLS ];
+
+/* The fallback region blocks start with their size, and with the link to the
+next free block while they are free. */
+typedef struct A_BLOCK_LINK
+{
+	struct A_BLOCK_LINK *pxNextFreeBlock;	/*<< The next free block in the list. */
+	size_t xBlockSize;						/*<< The size of the block. */
+} xBlockLink;
+
+static const unsigned short heapSTRUCT_SIZE	= ( ( sizeof( xBlockLink ) + portBYTE_ALIGNMENT_MASK ) & ~portBYTE_ALIGNMENT_MASK );
+#define heapMINIMUM_BLOCK_SIZE	( ( size_t ) ( heapSTRUCT_SIZE * 2 ) )
+
+/* The head of the fallback free list, which is ordered by address and ends
+with NULL. */
+static xBlockLink xStart;
+
+/* The fallback region statistics. */
+static size_t xFallbackFree = 0;
+static size_t xFallbackMinFree = 0;
+static unsigned short usFallbackFailed = 0;
+
+static portBASE_TYPE xHeapHasBeenInitialised = pdFALSE;
+
+/*
+ * Carve the pools and the fallback region out of the heap.
+ */
+static void prvHeapInit( void );
+
+/*
+ * Take a block from the smallest pool that can serve xWantedSize bytes, or
+ * from a larger one.  Returns NULL if they are all empty.  Must be called
+ * with interrupts disabled.
+ */
+static void *prvPoolTake( size_t xWantedSize );
+
+/*
+ * Give a block back to its pool.  Returns pdFALSE if pv is not a pool block.
+ * Must be called with interrupts disabled.
+ */
+static portBASE_TYPE prvPoolGive( void *pv );
+
+/*
+ * First fit allocation and combining free in the fallback region.  Must be
+ * called with the scheduler suspended.
+ */
+static void *prvFallbackTake( size_t xWantedSize );
+static void prvFallbackGive( void *pv );
+
+/*-----------------------------------------------------------*/
+
+static void prvHeapInit( void )
+{
+unsigned char *puc = xHeap.ucHeap;
+xPool *pxPool;
+xPoolBlock *pxBlock;
+xBlockLink *pxFirstFreeBlock;
+unsigned portBASE_TYPE uxPool;
+unsigned short us;
+
+	for( uxPool = 0; uxPool < heapPOOLS; uxPool++ )
+	{
+		pxPool = &xPools[ uxPool ];
+		pxPool->pucStart = puc;
+		pxPool->pxFreeList = NULL;
+
+		for( us = 0; us < usPoolBlocks[ uxPool ]; us++ )
+		{
+			/* The void cast is used to prevent byte alignment warnings. */
+			pxBlock = ( void * ) puc;
+			pxBlock->pxNextFreeBlock = pxPool->pxFreeList;
+			pxPool->pxFreeList = pxBlock;
+			puc += xPoolBlockSize[ uxPool ];
+		}
+
+		pxPool->pucEnd = puc;
+		pxPool->usFree = usPoolBlocks[ uxPool ];
+		pxPool->usMinFree = usPoolBlocks[ uxPool ];
+		pxPool->usFailed = 0;
+	}
+
+	/* The fallback region takes the remaining bytes, as a single free
+	block. */
+	if( heapFALLBACK_SIZE >= heapMINIMUM_BLOCK_SIZE )
+	{
+		pxFirstFreeBlock = ( void * ) puc;
+		pxFirstFreeBlock->xBlockSize = heapFALLBACK_SIZE & ~portBYTE_ALIGNMENT_MASK;
+		pxFirstFreeBlock->pxNextFreeBlock = NULL;
+		xStart.pxNextFreeBlock = pxFirstFreeBlock;
+		xFallbackFree = pxFirstFreeBlock->xBlockSize;
+	}
+	else
+	{
+		xStart.pxNextFreeBlock = NULL;
+		xFallbackFree = 0;
+	}
+	xStart.xBlockSize = ( size_t ) 0;
+	xFallbackMinFree = xFallbackFree;
+
+	xHeapHasBeenInitialised = pdTRUE;
+}
+/*-----------------------------------------------------------*/
+
+static void *prvPoolTake( size_t xWantedSize )
+{
+xPool *pxPool;
+xPoolBlock *pxBlock;
+unsigned portBASE_TYPE uxPool;
+portBASE_TYPE xBestFit = pdTRUE;
+
+	if( xHeapHasBeenInitialised == pdFALSE )
+	{
+		prvHeapInit();
+	}
+
+	/* At most heapPOOLS iterations, whatever the state of the heap. */
+	for( uxPool = 0; uxPool < heapPOOLS; uxPool++ )
+	{
+		pxPool = &xPools[ uxPool ];
+		if( ( xPoolBlockSize[ uxPool ] < xWantedSize ) || ( usPoolBlocks[ uxPool ] == 0 ) )
+		{
+			continue;
+		}
+
+		pxBlock = pxPool->pxFreeList;
+		if( pxBlock != NULL )
+		{
+			pxPool->pxFreeList = pxBlock->pxNextFreeBlock;
+			pxPool->usFree--;
+			if( pxPool->usFree < pxPool->usMinFree )
+			{
+				pxPool->usMinFree = pxPool->usFree;
+			}
+			return ( void * ) pxBlock;
+		}
+
+		/* Only account the failure to the pool that should have served the
+		request. */
+		if( xBestFit == pdTRUE )
+		{
+			pxPool->usFailed++;
+			xBestFit = pdFALSE;
+		}
+	}
+
+	return NULL;
+}
+/*-----------------------------------------------------------*/
+
+static portBASE_TYPE prvPoolGive( void *pv )
+{
+unsigned char *puc = ( unsigned char * ) pv;
+xPool *pxPool;
+xPoolBlock *pxBlock;
+
+	for( pxPool = xPools; pxPool < &xPools[ heapPOOLS ]; pxPool++ )
+	{
+		if( ( puc >= pxPool->pucStart ) && ( puc < pxPool->pucEnd ) )
+		{
+			pxBlock = ( void * ) puc;
+			pxBlock->pxNextFreeBlock = pxPool->pxFreeList;
+			pxPool->pxFreeList = pxBlock;
+			pxPool->usFree++;
+			return pdTRUE;
+		}
+	}
+
+	return pdFALSE;
+}
+/*-----------------------------------------------------------*/
+
+static void *prvFallbackTake( size_t xWantedSize )
+{
+xBlockLink *pxBlock, *pxPreviousBlock, *pxNewBlockLink;
+
+	/* The wanted size is increased so it can contain a xBlockLink structure
+	in addition to the requested amount of bytes, and rounded up so that the
+	blocks stay aligned. */
+	xWantedSize += heapSTRUCT_SIZE;
+	if( xWantedSize & portBYTE_ALIGNMENT_MASK )
+	{
+		xWantedSize += ( portBYTE_ALIGNMENT - ( xWantedSize & portBYTE_ALIGNMENT_MASK ) );
+	}
+
+	pxPreviousBlock = &xStart;
+	pxBlock = xStart.pxNextFreeBlock;
+	while( ( pxBlock != NULL ) && ( pxBlock->xBlockSize < xWantedSize ) )
+	{
+		pxPreviousBlock = pxBlock;
+		pxBlock = pxBlock->pxNextFreeBlock;
+	}
+
+	if( pxBlock == NULL )
+	{
+		usFallbackFailed++;
+		return NULL;
+	}
+
+	/* If the block is larger than required it is split, the end stays in
+	the free list at the same place. */
+	if( ( pxBlock->xBlockSize - xWantedSize ) > heapMINIMUM_BLOCK_SIZE )
+	{
+		pxNewBlockLink = ( void * ) ( ( ( unsigned char * ) pxBlock ) + xWantedSize );
+		pxNewBlockLink->xBlockSize = pxBlock->xBlockSize - xWantedSize;
+		pxNewBlockLink->pxNextFreeBlock = pxBlock->pxNextFreeBlock;
+		pxPreviousBlock->pxNextFreeBlock = pxNewBlockLink;
+		pxBlock->xBlockSize = xWantedSize;
+	}
+	else
+	{
+		pxPreviousBlock->pxNextFreeBlock = pxBlock->pxNextFreeBlock;
+	}
+
+	xFallbackFree -= pxBlock->xBlockSize;
+	if( xFallbackFree < xFallbackMinFree )
+	{
+		xFallbackMinFree = xFallbackFree;
+	}
+
+	/* Return the memory space - jumping over the xBlockLink structure at its
+	start. */
+	return ( void * ) ( ( ( unsigned char * ) pxBlock ) + heapSTRUCT_SIZE );
+}
+/*-----------------------------------------------------------*/
+
+static void prvFallbackGive( void *pv )
+{
+xBlockLink *pxLink, *pxIterator;
+
+	/* The memory being freed will have an xBlockLink structure immediately
+	before it. */
+	pxLink = ( void * ) ( ( ( unsigned char * ) pv ) - heapSTRUCT_SIZE );
+	xFallbackFree += pxLink->xBlockSize;
+
+	/* Find the free block just before it. */
+	for( pxIterator = &xStart; ( pxIterator->pxNextFreeBlock != NULL ) && ( pxIterator->pxNextFreeBlock < pxLink ); pxIterator = pxIterator->pxNextFreeBlock )
+	{
+		/* There is nothing to do here - just iterate to the correct position. */
+	}
+
+	/* Combine with the next free block if they are adjacent. */
+	if( ( ( unsigned char * ) pxLink ) + pxLink->xBlockSize == ( unsigned char * ) pxIterator->pxNextFreeBlock )
+	{
+		pxLink->xBlockSize += pxIterator->pxNextFreeBlock->xBlockSize;
+		pxLink->pxNextFreeBlock = pxIterator->pxNextFreeBlock->pxNextFreeBlock;
+	}
+	else
+	{
+		pxLink->pxNextFreeBlock = pxIterator->pxNextFreeBlock;
+	}
+
+	/* Combine with the previous free block if they are adjacent. */
+	if( ( pxIterator != &xStart ) && ( ( ( unsigned char * ) pxIterator ) + pxIterator->xBlockSize == ( unsigned char * ) pxLink ) )
+	{
+		pxIterator->xBlockSize += pxLink->xBlockSize;
+		pxIterator->pxNextFreeBlock = pxLink->pxNextFreeBlock;
+	}
+	else
+	{
+		pxIterator->pxNextFreeBlock = pxLink;
+	}
+}
+/*-----------------------------------------------------------*/
+
+void *pvPortMalloc( size_t xWantedSize )
+{
+void *pvReturn = NULL;
+
+	if( xWantedSize > 0 )
+	{
+		portENTER_CRITICAL();
+		{
+			pvReturn = prvPoolTake( xWantedSize );
+		}
+		portEXIT_CRITICAL();
+
+		if( pvReturn == NULL )
+		{
+			vTaskSuspendAll();
+			{
+				pvReturn = prvFallbackTake( xWantedSize );
+			}
+			xTaskResumeAll();
+		}
+	}
+
+	#if( configUSE_MALLOC_FAILED_HOOK == 1 )
+	{
+		if( pvReturn == NULL )
+		{
+			extern void vApplicationMallocFailedHook( void );
+			vApplicationMallocFailedHook();
+		}
+	}
+	#endif
+
+	return pvReturn;
+}
+/*-----------------------------------------------------------*/
+
+void *pvPortMallocFromISR( size_t xWantedSize )
+{
+void *pvReturn = NULL;
+unsigned portBASE_TYPE uxSavedInterruptStatus;
+
+	if( xWantedSize > 0 )
+	{
+		uxSavedInterruptStatus = portSET_INTERRUPT_MASK_FROM_ISR();
+		{
+			pvReturn = prvPoolTake( xWantedSize );
+		}
+		portCLEAR_INTERRUPT_MASK_FROM_ISR( uxSavedInterruptStatus );
+	}
+
+	return pvReturn;
+}
+/*-----------------------------------------------------------*/
+
+void vPortFree( void *pv )
+{
+portBASE_TYPE xInPool;
+
+	if( pv )
+	{
+		portENTER_CRITICAL();
+		{
+			xInPool = prvPoolGive( pv );
+		}
+		portEXIT_CRITICAL();
+
+		if( xInPool == pdFALSE )
+		{
+			vTaskSuspendAll();
+			{
+				prvFallbackGive( pv );
+			}
+			xTaskResumeAll();
+		}
+	}
+}
+/*-----------------------------------------------------------*/
+
+portBASE_TYPE xPortFreeFromISR( void *pv )
+{
+portBASE_TYPE xInPool = pdFALSE;
+unsigned portBASE_TYPE uxSavedInterruptStatus;
+
+	if( pv )
+	{
+		uxSavedInterruptStatus = portSET_INTERRUPT_MASK_FROM_ISR();
+		{
+			xInPool = prvPoolGive( pv );
+		}
+		portCLEAR_INTERRUPT_MASK_FROM_ISR( uxSavedInterruptStatus );
+	}
+
+	return xInPool;
+}
+/*-----------------------------------------------------------*/
+
+size_t xPortGetFreeHeapSize( void )
+{
+size_t xFree;
+unsigned portBASE_TYPE uxPool;
+
+	portENTER_CRITICAL();
+	{
+		if( xHeapHasBeenInitialised == pdFALSE )
+		{
+			prvHeapInit();
+		}
+
+		xFree = xFallbackFree;
+		for( uxPool = 0; uxPool < heapPOOLS; uxPool++ )
+		{
+			xFree += xPools[ uxPool ].usFree * xPoolBlockSize[ uxPool ];
+		}
+	}
+	portEXIT_CRITICAL();
+
+	return xFree;
+}
+/*-----------------------------------------------------------*/
+
+portBASE_TYPE xPortGetHeapStats( unsigned portBASE_TYPE uxIndex, xHeapStats *pxStats )
+{
+portBASE_TYPE xReturn = pdTRUE;
+
+	portENTER_CRITICAL();
+	{
+		if( xHeapHasBeenInitialised == pdFALSE )
+		{
+			prvHeapInit();
+		}
+
+		if( uxIndex < heapPOOLS )
+		{
+			pxStats->xBlockSize = xPoolBlockSize[ uxIndex ];
+			pxStats->xSize = usPoolBlocks[ uxIndex ] * xPoolBlockSize[ uxIndex ];
+			pxStats->xFree = xPools[ uxIndex ].usFree * xPoolBlockSize[ uxIndex ];
+			pxStats->xMinFree = xPools[ uxIndex ].usMinFree * xPoolBlockSize[ uxIndex ];
+			pxStats->usFailed = xPools[ uxIndex ].usFailed;
+		}
+		else if( uxIndex == heapPOOLS )
+		{
+			pxStats->xBlockSize = 0;
+			pxStats->xSize = heapFALLBACK_SIZE;
+			pxStats->xFree = xFallbackFree;
+			pxStats->xMinFree = xFallbackMinFree;
+			pxStats->usFailed = usFallbackFailed;
+		}
+		else
+		{
+			xReturn = pdFALSE;
+		}
+	}
+	portEXIT_CRITICAL();
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+void vPortInitialiseBlocks( void )
+{
+	/* This just exists to keep the linker quiet. */
+}
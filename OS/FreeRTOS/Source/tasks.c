@@ -322,6 +322,16 @@ static void prvInitialiseTaskLists( void ) PRIVILEGED_FUNCTION;
  */
 static portTASK_FUNCTION_PROTO( prvIdleTask, pvParameters );
 
+#if ( configUSE_TICKLESS_IDLE == 1 )
+
+	/*
+	 * Return the number of ticks the idle task can expect to run for before
+	 * a task is unblocked, or 0 if another task is ready.
+	 */
+	static portTickType prvGetExpectedIdleTime( void ) PRIVILEGED_FUNCTION;
+
+#endif
+
 /*
  * Utility to free all memory allocated by the scheduler to hold a TCB,
  * including the stack pointed to by the TCB.
@@ -417,8 +427,7 @@ tskTCB * pxNewTCB;
 		#if( portSTACK_GROWTH < 0 )
 		{
 			pxTopOfStack = pxNewTCB->pxStack + ( usStackDepth - 1 );
-			//pxTopOfStack = ( portSTACK_TYPE * ) ( ( ( unsigned long ) pxTopOfStack ) & ( ( unsigned long ) ~portBYTE_ALIGNMENT_MASK  ) );
-			pxTopOfStack = ( portSTACK_TYPE * ) ( ( (unsigned int) pxTopOfStack ) & ( (unsigned int)  ~portBYTE_ALIGNMENT_MASK  ) );
+			pxTopOfStack = ( portSTACK_TYPE * ) ( ( ( portPOINTER_SIZE_TYPE ) pxTopOfStack ) & ( ( portPOINTER_SIZE_TYPE ) ~portBYTE_ALIGNMENT_MASK  ) );
 		}
 		#else
 		{
@@ -1410,6 +1419,41 @@ void vTaskIncrementTick( void )
 }
 /*-----------------------------------------------------------*/
 
+#if ( configUSE_TICKLESS_IDLE == 1 )
+
+	void vTaskStepTick( portTickType xTicksToJump )
+	{
+		/* The tick count does not move while the scheduler is suspended, and
+		the port never jumps to or past the next unblock time, so no delayed
+		task needs checking here. */
+		xTickCount += xTicksToJump;
+	}
+
+#endif
+/*-----------------------------------------------------------*/
+
+#if ( configUSE_TICKLESS_IDLE == 1 )
+
+	portBASE_TYPE xTaskConfirmSleepModeStatus( void )
+	{
+	portBASE_TYPE xReturn = pdTRUE;
+
+		if( listCURRENT_LIST_LENGTH( &xPendingReadyList ) != ( unsigned portBASE_TYPE ) 0 )
+		{
+			/* A task was readied by an interrupt, it must run first. */
+			xReturn = pdFALSE;
+		}
+		else if( ( xMissedYield != pdFALSE ) || ( uxMissedTicks != ( unsigned portBASE_TYPE ) 0 ) )
+		{
+			xReturn = pdFALSE;
+		}
+
+		return xReturn;
+	}
+
+#endif
+/*-----------------------------------------------------------*/
+
 #if ( ( INCLUDE_vTaskCleanUpResources == 1 ) && ( INCLUDE_vTaskSuspend == 1 ) )
 
 	void vTaskCleanUpResources( void )
@@ -1827,9 +1871,65 @@ static portTASK_FUNCTION( prvIdleTask, pvParameters )
 			vApplicationIdleHook();
 		}
 		#endif
+
+		#if ( configUSE_TICKLESS_IDLE == 1 )
+		{
+		portTickType xExpectedIdleTime;
+
+			/* Stop the tick interrupt and sleep until the next task is due,
+			if that is far enough.  The first test is made without suspending
+			the scheduler, as it fails most of the time. */
+			xExpectedIdleTime = prvGetExpectedIdleTime();
+
+			if( xExpectedIdleTime >= configEXPECTED_IDLE_TIME_BEFORE_SLEEP )
+			{
+				vTaskSuspendAll();
+				{
+					/* The tick count can't change now, the port sleeps at
+					most until the next task is unblocked. */
+					xExpectedIdleTime = prvGetExpectedIdleTime();
+
+					if( xExpectedIdleTime >= configEXPECTED_IDLE_TIME_BEFORE_SLEEP )
+					{
+						portSUPPRESS_TICKS_AND_SLEEP( xExpectedIdleTime );
+					}
+				}
+				xTaskResumeAll();
+			}
+		}
+		#endif
 	}
 } /*lint !e715 pvParameters is not accessed but all task functions require the same prototype. */
 
+#if ( configUSE_TICKLESS_IDLE == 1 )
+
+	static portTickType prvGetExpectedIdleTime( void )
+	{
+	portTickType xReturn;
+
+		if( ( uxTopReadyPriority > tskIDLE_PRIORITY ) ||
+			( listCURRENT_LIST_LENGTH( &( pxReadyTasksLists[ tskIDLE_PRIORITY ] ) ) > ( unsigned portBASE_TYPE ) 1 ) ||
+			( uxMissedTicks != ( unsigned portBASE_TYPE ) 0 ) )
+		{
+			/* Another task is ready, or ticks are waiting to be processed. */
+			xReturn = 0;
+		}
+		else if( listLIST_IS_EMPTY( pxDelayedTaskList ) )
+		{
+			/* Sleep until the tick count overflows at most, the delayed
+			lists are swapped by the tick interrupt. */
+			xReturn = portMAX_DELAY - xTickCount;
+		}
+		else
+		{
+			xReturn = listGET_LIST_ITEM_VALUE( &( ( ( tskTCB * ) listGET_OWNER_OF_HEAD_ENTRY( pxDelayedTaskList ) )->xGenericListItem ) ) - xTickCount;
+		}
+
+		return xReturn;
+	}
+
+#endif
+
 
 
 
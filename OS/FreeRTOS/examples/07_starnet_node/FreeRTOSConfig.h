@@ -15,6 +15,11 @@
  * See http://www.freertos.org/a00110.html.
  *----------------------------------------------------------*/
 
+/* Set from the Makefile, 'make TRACE=1' streams a kernel trace on uart0. */
+#ifndef configUSE_TRACE_UART
+#define configUSE_TRACE_UART		0
+#endif
+
 #define configUSE_PREEMPTION		1
 #define configUSE_IDLE_HOOK			1
 #define configUSE_TICK_HOOK			0
@@ -24,11 +29,22 @@
 #define configMINIMAL_STACK_SIZE	( ( unsigned portSHORT ) 200 )
 #define configTOTAL_HEAP_SIZE		( ( size_t ) ( 6000 ) )
 #define configMAX_TASK_NAME_LEN		( 8 )
-#define configUSE_TRACE_FACILITY	0
+#define configUSE_TRACE_FACILITY	configUSE_TRACE_UART
 #define configUSE_16_BIT_TICKS		1
 #define configIDLE_SHOULD_YIELD		1
 #define configUSE_MUTEXES           1
 
+/* heap_4.c fixed size block pools, the fallback region gets the remaining
+bytes of configTOTAL_HEAP_SIZE (the task stacks). */
+#define configHEAP_POOL0_BLOCK_SIZE		16
+#define configHEAP_POOL0_BLOCKS			8
+#define configHEAP_POOL1_BLOCK_SIZE		32
+#define configHEAP_POOL1_BLOCKS			6
+#define configHEAP_POOL2_BLOCK_SIZE		64
+#define configHEAP_POOL2_BLOCKS			6
+#define configHEAP_POOL3_BLOCK_SIZE		128
+#define configHEAP_POOL3_BLOCKS			4
+
 /* Co-routine definitions. */
 #define configUSE_CO_ROUTINES 		0
 #define configMAX_CO_ROUTINE_PRIORITIES ( 2 )
@@ -44,4 +60,8 @@ to exclude the API function. */
 #define INCLUDE_vTaskDelayUntil			1
 #define INCLUDE_vTaskDelay				1
 
+#if configUSE_TRACE_UART == 1
+#include "trace.h"
+#endif
+
 #endif /* FREERTOS_CONFIG_H */
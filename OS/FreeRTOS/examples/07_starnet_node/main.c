@@ -65,18 +65,30 @@ static void prvSetupHardware( void )
 
     printf("FreeRTOS Star Network, network device\r\n");
 
+#if configUSE_TRACE_UART
+    trace_init();
+#endif
+
     /* Enable Interrupts */
     eint();
 }
 
 int putchar(int c)
 {
+#if configUSE_TRACE_UART
+    /* uart0 carries the trace */
+    return c;
+#else
     return uart0_putchar(c);
+#endif
 }
 
 void vApplicationIdleHook( void );
 void vApplicationIdleHook( void )
 {
+#if configUSE_TRACE_UART
+    trace_flush();
+#endif
     _BIS_SR(LPM0_bits);
 }
 
@@ -29,6 +29,17 @@
 #define configIDLE_SHOULD_YIELD		1
 #define configUSE_MUTEXES           1
 
+/* heap_4.c fixed size block pools, the fallback region gets the remaining
+bytes of configTOTAL_HEAP_SIZE (the task stacks). */
+#define configHEAP_POOL0_BLOCK_SIZE		16
+#define configHEAP_POOL0_BLOCKS			8
+#define configHEAP_POOL1_BLOCK_SIZE		32
+#define configHEAP_POOL1_BLOCKS			6
+#define configHEAP_POOL2_BLOCK_SIZE		64
+#define configHEAP_POOL2_BLOCKS			6
+#define configHEAP_POOL3_BLOCK_SIZE		128
+#define configHEAP_POOL3_BLOCKS			4
+
 /* Co-routine definitions. */
 #define configUSE_CO_ROUTINES 		0
 #define configMAX_CO_ROUTINE_PRIORITIES ( 2 )
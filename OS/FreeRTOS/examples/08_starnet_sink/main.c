@@ -80,7 +80,7 @@ void vApplicationIdleHook( void )
     _BIS_SR(LPM3_bits);
 }
 
-void vPacketReceivedFrom(uint8_t srcAddr, uint16_t pktLength, uint8_t* pkt)
+void vPacketReceivedFrom(starnet_addr_t srcAddr, uint16_t pktLength, uint8_t* pkt)
 {
     printf("Data received from node 0x%x (length = %d)\r\n", srcAddr, pktLength);
 }
@@ -89,7 +89,7 @@ static void vSendingTask(void* pvParameters)
 {
     while (1)
     {
-        uint8_t *nodeList;
+        starnet_addr_t *nodeList;
         uint16_t nodeNum;
 
         nodeNum = xGetAttachedNodes(&nodeList);
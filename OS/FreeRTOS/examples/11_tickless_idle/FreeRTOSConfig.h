@@ -0,0 +1,64 @@
+#ifndef FREERTOS_CONFIG_H
+#define FREERTOS_CONFIG_H
+
+#include <io.h>
+
+/*-----------------------------------------------------------
+ * Application specific definitions.
+ *
+ * These definitions should be adjusted for your particular hardware and
+ * application requirements.
+ *
+ * THESE PARAMETERS ARE DESCRIBED WITHIN THE 'CONFIGURATION' SECTION OF THE
+ * FreeRTOS API DOCUMENTATION AVAILABLE ON THE FreeRTOS.org WEB SITE.
+ *
+ * See http://www.freertos.org/a00110.html.
+ *----------------------------------------------------------*/
+
+/* Set from the Makefile, 'make TICKLESS=0' for the periodic tick. */
+#ifndef configUSE_TICKLESS_IDLE
+#define configUSE_TICKLESS_IDLE		1
+#endif
+
+#define configUSE_PREEMPTION		1
+#if configUSE_TICKLESS_IDLE == 1
+#define configUSE_IDLE_HOOK			0
+#else
+#define configUSE_IDLE_HOOK			1
+#endif
+#define configUSE_TICK_HOOK			0
+#define configCPU_CLOCK_HZ			( ( unsigned portLONG ) 8000000 ) /* Clock setup from main.c in the demo application. */
+#define configTICK_RATE_HZ			( ( portTickType ) 1000 )
+#define configMAX_PRIORITIES		( ( unsigned portBASE_TYPE ) 4 )
+#define configMINIMAL_STACK_SIZE	( ( unsigned portSHORT ) 200 )
+#define configTOTAL_HEAP_SIZE		( ( size_t ) ( 6000 ) )
+#define configMAX_TASK_NAME_LEN		( 8 )
+#define configUSE_TRACE_FACILITY	0
+#define configUSE_16_BIT_TICKS		1
+#define configIDLE_SHOULD_YIELD		1
+
+/* Sleep accounting of the benchmark, see main.c. */
+#define configEXPECTED_IDLE_TIME_BEFORE_SLEEP	2
+extern void vSleepEnter( void );
+extern void vSleepExit( void );
+#define configPRE_SLEEP_PROCESSING( x )		vSleepEnter()
+#define configPOST_SLEEP_PROCESSING( x )	vSleepExit()
+
+/* Co-routine definitions. */
+#define configUSE_CO_ROUTINES 		0
+#define configMAX_CO_ROUTINE_PRIORITIES ( 2 )
+
+/* Set the following definitions to 1 to include the API function, or zero
+to exclude the API function. */
+
+#define INCLUDE_vTaskPrioritySet		0
+#define INCLUDE_uxTaskPriorityGet		0
+#define INCLUDE_vTaskDelete				0
+#define INCLUDE_vTaskCleanUpResources	0
+#define INCLUDE_vTaskSuspend			1
+#define INCLUDE_vTaskDelayUntil			1
+#define INCLUDE_vTaskDelay				1
+
+
+
+#endif /* FREERTOS_CONFIG_H */
@@ -0,0 +1,221 @@
+/**
+ * \file main.c
+ * \brief Tickless idle benchmark
+ *
+ * A sampling task runs every 250 ms, and an event task waits for a TimerB
+ * interrupt coming at irregular times, standing for a radio interrupt that
+ * wakes the MCU between two ticks. Every 10 s the report task prints the
+ * number of wake ups, the share of time spent in LPM3, and the matching
+ * average MCU current from the datasheet typical values.
+ *
+ * 'make' builds it with the tickless idle, 'make TICKLESS=0' with the
+ * periodic tick, where the idle hook sleeps in LPM3 until the next tick.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <io.h>
+#include <signal.h>
+
+/* Scheduler includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+/* Project includes */
+#include "clock.h"
+#include "leds.h"
+#include "uart0.h"
+#include "timerB.h"
+
+/* Benchmark parameters */
+#define SAMPLE_PERIOD_MS	250
+#define REPORT_PERIOD_MS	10000
+#define EVENT_DELAY_MIN		3277	/* ACLK periods, 100 ms */
+#define EVENT_DELAY_RAND	0x3FFF	/* plus up to 500 ms */
+
+/* MSP430F1611 typical currents at 3 V, MCLK 8 MHz and LPM3 */
+#define ACTIVE_UA			4000
+#define LPM3_UA				3
+
+#define REPORT_PERIOD_ACLK	( ( unsigned long ) REPORT_PERIOD_MS * 32768 / 1000 )
+
+/* Hardware initialization */
+static void prvSetupHardware( void );
+static void vSampleTask( void* pvParameters );
+static void vEventTask( void* pvParameters );
+static void vReportTask( void* pvParameters );
+static uint16_t event_irq( void );
+
+static xSemaphoreHandle xEventS;
+
+/* Sleep accounting, in ACLK periods */
+static volatile uint16_t usSleepStart;
+static volatile unsigned long ulAsleep;
+static volatile uint16_t usWakeups;
+static volatile uint16_t usEvents;
+
+/**
+ * Putchar function required by stdio.h module to be able to use printf()
+ */
+int putchar( int c )
+{
+    return uart0_putchar( c );
+}
+
+/**
+ * The main function.
+ */
+int main( void )
+{
+    /* Setup the hardware. */
+    prvSetupHardware();
+
+    vSemaphoreCreateBinary( xEventS );
+    xSemaphoreTake( xEventS, 0 );
+
+    /* Add the tasks to the scheduler */
+    xTaskCreate( vSampleTask, ( const signed char* ) "Sample", configMINIMAL_STACK_SIZE, NULL, 1, NULL );
+    xTaskCreate( vEventTask, ( const signed char* ) "Event", configMINIMAL_STACK_SIZE, NULL, 2, NULL );
+    xTaskCreate( vReportTask, ( const signed char* ) "Report", configMINIMAL_STACK_SIZE, NULL, 1, NULL );
+
+    /* Start the scheduler. */
+    vTaskStartScheduler();
+
+    /* As the scheduler has been started we should never get here! */
+    return 0;
+}
+
+/**
+ * Initialize the main hardware parameters.
+ */
+static void prvSetupHardware( void )
+{
+    /* Stop the watchdog timer. */
+    WDTCTL = WDTPW + WDTHOLD;
+
+    /* Setup MCLK 8MHz and SMCLK 1MHz */
+    set_mcu_speed_xt2_mclk_8MHz_smclk_1MHz();
+
+    LEDS_INIT();
+    LEDS_OFF();
+
+    uart0_init( UART0_CONFIG_1MHZ_115200 );
+    printf( "FreeRTOS tickless idle benchmark, tickless %u\r\n", configUSE_TICKLESS_IDLE );
+
+    /* TimerB on ACLK, for the events and the sleep accounting */
+    timerB_init();
+    timerB_start_ACLK_div( TIMERB_DIV_1 );
+    timerB_register_cb( TIMERB_ALARM_CCR0, event_irq );
+    timerB_set_alarm_from_now( TIMERB_ALARM_CCR0, EVENT_DELAY_MIN, 0 );
+
+    /* Enable Interrupts */
+    eint();
+}
+
+/**
+ * Called by the port around the tickless sleep, interrupts disabled.
+ */
+void vSleepEnter( void )
+{
+    usSleepStart = timerB_time();
+}
+
+void vSleepExit( void )
+{
+    ulAsleep += ( uint16_t ) ( timerB_time() - usSleepStart );
+    usWakeups++;
+}
+
+#if configUSE_TICKLESS_IDLE == 0
+/**
+ * Periodic tick, sleep until the next interrupt.
+ */
+void vApplicationIdleHook( void );
+void vApplicationIdleHook( void )
+{
+    vSleepEnter();
+    _BIS_SR( LPM3_bits );
+    vSleepExit();
+}
+#endif
+
+/**
+ * The sampling task, a short job at a fixed rate.
+ */
+static void vSampleTask( void* pvParameters )
+{
+    portTickType xLastWakeTime = xTaskGetTickCount();
+    uint16_t led_state = 0;
+
+    while ( 1 )
+    {
+        LEDS_SET( led_state++ );
+        vTaskDelayUntil( &xLastWakeTime, SAMPLE_PERIOD_MS / portTICK_RATE_MS );
+    }
+}
+
+/**
+ * The event task, woken up by the TimerB interrupt.
+ */
+static void vEventTask( void* pvParameters )
+{
+    while ( 1 )
+    {
+        if ( xSemaphoreTake( xEventS, portMAX_DELAY ) == pdTRUE )
+        {
+            usEvents++;
+        }
+    }
+}
+
+/**
+ * The report task, print the counters and clear them.
+ */
+static void vReportTask( void* pvParameters )
+{
+    portTickType xLastWakeTime = xTaskGetTickCount();
+    unsigned long ulPermil;
+    uint16_t usWake, usEvt;
+
+    while ( 1 )
+    {
+        vTaskDelayUntil( &xLastWakeTime, REPORT_PERIOD_MS / portTICK_RATE_MS );
+
+        portENTER_CRITICAL();
+        ulPermil = ulAsleep * 1000 / REPORT_PERIOD_ACLK;
+        usWake = usWakeups;
+        usEvt = usEvents;
+        ulAsleep = 0;
+        usWakeups = 0;
+        usEvents = 0;
+        portEXIT_CRITICAL();
+
+        if ( ulPermil > 1000 )
+        {
+            ulPermil = 1000;
+        }
+
+        printf( "ticks %u wakeups %u events %u lpm3 %lu.%lu%% mcu %lu uA\r\n",
+                xTaskGetTickCount(), usWake, usEvt, ulPermil / 10, ulPermil % 10,
+                ( ACTIVE_UA * ( 1000 - ulPermil ) + LPM3_UA * ulPermil ) / 1000 );
+    }
+}
+
+/**
+ * The event interrupt, at a random time from the previous one.
+ */
+static uint16_t event_irq( void )
+{
+    portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
+
+    timerB_set_alarm_from_now( TIMERB_ALARM_CCR0, EVENT_DELAY_MIN + ( rand() & EVENT_DELAY_RAND ), 0 );
+
+    xSemaphoreGiveFromISR( xEventS, &xHigherPriorityTaskWoken );
+    if ( xHigherPriorityTaskWoken )
+    {
+        portYIELD();
+    }
+
+    /* Wake the CPU, it may be in the tickless sleep. */
+    return 1;
+}
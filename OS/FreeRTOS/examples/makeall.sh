@@ -10,7 +10,8 @@ SUBDIRS="\
 07_starnet_node \
 08_starnet_sink \
 09_monitor_appli_node \
-10_monitor_appli_sink"
+10_monitor_appli_sink \
+11_tickless_idle"
 
 
 echo $(date) > compile.log
@@ -47,6 +47,7 @@
 /* Project Includes */
 #include "phy.h"
 #include "mac.h"
+#include "frame_pool.h"
 #include "leds.h"
 
 /* Drivers Include */
@@ -75,6 +76,13 @@ enum {
 	ACK_WAIT_TIME = 500
 };
 
+enum {
+	RATE_ONE = 256, // busy and collision rates fixed point
+	RATE_SHIFT = 3, // EWMA weight of a new attempt, 1/8
+	NOISE_SAMPLES = 8, // RSSI samples whose minimum makes a noise sample
+	NOISE_SHIFT = 2 // EWMA weight of a new noise sample, 1/4
+};
+
 typedef union frame {
 	uint8_t data[MAX_PAYLOAD_LENGTH + HEADER_LENGTH + 1];
 	struct {
@@ -85,6 +93,7 @@ typedef union frame {
 		uint8_t length;
 	};
 } frame_t;
+FRAME_POOL_CHECK(frame_t);
 
 typedef union ack {
 	uint8_t data[HEADER_LENGTH + 1];
@@ -102,7 +111,10 @@ static uint16_t block_until_event(uint16_t event);
 static void init(void);
 static void frame_received(uint8_t * data, uint16_t length, int8_t rssi,
 		uint16_t time);
-static void set_random_wait(uint16_t range);
+static void set_random_wait(uint16_t exponent);
+static uint16_t backoff_base(void);
+static void rate_update(uint16_t *rate, uint16_t failed);
+static void noise_sample(int8_t rssi);
 static void set_ack_timeout(void);
 static inline uint16_t ntoh_s(uint8_t*);
 static inline void hton_s(uint8_t*, uint16_t);
@@ -115,8 +127,14 @@ static uint16_t timeout(void);
 /* Local Variables */
 static xQueueHandle tx_queue, event_queue;
 static mac_rx_callback_t received_cb;
-static frame_t frame_to_send, frame_to_queue;
+static frame_t *frame_to_send;
+static uint16_t ack_src; // the node the ACK is expected from, 0 if none
 static ack_t ack_frame;
+static uint16_t busy_rate, collision_rate; // RATE_ONE if all attempts fail
+static int16_t noise_floor; // in 1/16 dBm
+static int8_t noise_min;
+static uint8_t noise_count, noise_known;
+static mac_stats_t stats;
 uint16_t mac_addr;
 
 void mac_init(xSemaphoreHandle spi_mutex, mac_rx_callback_t rx_cb,
@@ -125,8 +143,9 @@ void mac_init(xSemaphoreHandle spi_mutex, mac_rx_callback_t rx_cb,
 	// Initialize the PHY layer
 	phy_init(spi_mutex, frame_received, channel, MAC_TX_POWER);
 
-	// Create a frame Queue for the frames to send
-	tx_queue = xQueueCreate(MAC_TX_QUEUE_LENGTH, sizeof(frame_t));
+	// Create a Queue for the frames to send, they come from the pool
+	frame_pool_init();
+	tx_queue = xQueueCreate(MAC_TX_QUEUE_LENGTH, sizeof(frame_t*));
 
 	// Create the Event Queue
 	event_queue = xQueueCreate(8, sizeof(uint16_t));
@@ -140,36 +159,57 @@ void mac_init(xSemaphoreHandle spi_mutex, mac_rx_callback_t rx_cb,
 
 uint16_t mac_send(uint16_t dest_addr, uint8_t* data, uint16_t length,
 		int16_t ack) {
+	frame_t *frame;
+
 	// check the packet length
 	if (length > MAX_PAYLOAD_LENGTH) {
 		return 0;
 	}
 
+	// get a frame
+	frame = frame_pool_alloc();
+	if (frame == 0x0) {
+		return 0;
+	}
+
 	// compute the frame
-	frame_to_queue.length = length + HEADER_LENGTH;
-	frame_to_queue.dst_addr[0] = dest_addr >> 8;
-	frame_to_queue.dst_addr[1] = dest_addr & 0xFF;
-	frame_to_queue.src_addr[0] = mac_addr >> 8;
-	frame_to_queue.src_addr[1] = mac_addr & 0xFF;
-	frame_to_queue.ctrl = CTRL_TYPE_DATA;
+	frame->length = length + HEADER_LENGTH;
+	frame->dst_addr[0] = dest_addr >> 8;
+	frame->dst_addr[1] = dest_addr & 0xFF;
+	frame->src_addr[0] = mac_addr >> 8;
+	frame->src_addr[1] = mac_addr & 0xFF;
+	frame->ctrl = CTRL_TYPE_DATA;
 
 	if (ack)
-		frame_to_queue.ctrl |= CTRL_ACK_REQ;
+		frame->ctrl |= CTRL_ACK_REQ;
 
 	// copy the packet
-	memcpy(frame_to_queue.payload, data, length);
+	memcpy(frame->payload, data, length);
 
-	// try to send the frame to the queue
-	if (!xQueueSendToBack(tx_queue, &frame_to_queue, 0)) {
+	// try to give the frame to the queue, the MAC task frees it
+	if (!xQueueSendToBack(tx_queue, &frame, 0)) {
+		frame_pool_free(frame);
 		return 0;
 	}
 
 	return 1;
 }
 
+void mac_get_stats(mac_stats_t *dst, uint16_t reset) {
+	taskENTER_CRITICAL();
+	*dst = stats;
+	if (reset) {
+		memset(&stats, 0, sizeof(stats));
+		stats.noise_floor = dst->noise_floor;
+		stats.cca_threshold = dst->cca_threshold;
+	}
+	taskEXIT_CRITICAL();
+	dst->backoff_exp = backoff_base();
+}
+
 static void mac_task(void* param) {
 	int16_t loop;
-	uint16_t event;
+	uint16_t event, exponent, start;
 
 	// Set the node MAC address
 	init();
@@ -183,45 +223,70 @@ static void mac_task(void* param) {
 	for (;;) {
 		LED_RED_ON();
 
-		// Clear frame_to_send destination, to prevent ack sending
-		hton_s(frame_to_send.dst_addr, 0x0);
+		// No ACK expected
+		ack_src = 0x0;
 
-		// Get a frame to send
-		if (xQueueReceive(tx_queue, &frame_to_send, portMAX_DELAY) != pdTRUE) {
+		// Get a frame to send, sample the idle channel meanwhile
+		if (xQueueReceive(tx_queue, &frame_to_send, MAC_NOISE_PERIOD) != pdTRUE) {
+			noise_sample(phy_get_rssi());
 			continue;
 		}
+		ack_src = ntoh_s(frame_to_send->dst_addr);
+		start = timerB_time();
 
+		// Start from the window the recent busy and collision rates call for
+		exponent = backoff_base();
 
 		// We have a frame to send, loop for max tries
 		for (loop = 0; loop < MAC_MAX_RETRY; loop++) {
-			// Wait a random back-off
-			set_random_wait(loop);
+			// Wait a random back-off, the window doubles at each failure
+			if (loop && exponent < MAC_BE_MAX) {
+				exponent++;
+			}
+			set_random_wait(exponent);
 			block_until_event(EVT_BACKOFF);
 
 			// Try to send
-			if (!phy_send_cca(frame_to_send.data, frame_to_send.length, 0)) {
-				// Frame send failed (channel busy?)
+			stats.attempts++;
+			if (!phy_send_cca(frame_to_send->data, frame_to_send->length, 0)) {
+				// Channel busy
+				stats.busy++;
+				rate_update(&busy_rate, 1);
 				continue;
 			}
+			rate_update(&busy_rate, 0);
 
-			if (frame_to_send.ctrl & CTRL_ACK_REQ) {
+			if (frame_to_send->ctrl & CTRL_ACK_REQ) {
 				// Set timeout
 				set_ack_timeout();
 
 				// Wait until ACK or timeout
 				event = block_until_event(EVT_ACK_RECEIVED | EVT_ACK_TIMEOUT);
 				if (event == EVT_ACK_TIMEOUT) {
-					// loop and retry
+					// Collision or loss, loop and retry
+					stats.collisions++;
+					rate_update(&collision_rate, 1);
 					continue;
 				} else {
 					// Remove timeout
 					timerB_unset_alarm(TIMERB_ALARM_CCR0);
+					rate_update(&collision_rate, 0);
 				}
 			}
 			// All good
 			break;
 		}
 
+		if (loop < MAC_MAX_RETRY) {
+			stats.sent++;
+			stats.delay += (uint16_t) (timerB_time() - start);
+		} else {
+			stats.dropped++;
+		}
+
+		// Done with the frame
+		ack_src = 0x0;
+		frame_pool_free(frame_to_send);
 	}
 }
 
@@ -263,7 +328,7 @@ static void frame_received(uint8_t * data, uint16_t length, int8_t rssi,
 		// For me, check its type:
 		if ((rx_frame->ctrl & CTRL_TYPE_MASK) == CTRL_TYPE_ACK) {
 			// It's an ACK, check if it matches our sending frame
-			if (src == ntoh_s(frame_to_send.dst_addr)) {
+			if ((ack_src != 0x0) && (src == ack_src)) {
 				uint16_t event = EVT_ACK_RECEIVED;
 				// push an ACK event
 				xQueueSendToBack(event_queue, &event, 0);
@@ -293,14 +358,14 @@ static void frame_received(uint8_t * data, uint16_t length, int8_t rssi,
 	}
 }
 
-static void set_random_wait(uint16_t range) {
+static void set_random_wait(uint16_t exponent) {
 	uint16_t wait_time;
 
 	// pick up a random time to wait
 	wait_time = rand();
 
-	// limit it by the given range
-	wait_time &= (1 << (range + 5)) - 1;
+	// limit it by the window
+	wait_time &= (1 << exponent) - 1;
 
 	// Add a minimal delay
 	wait_time += 16;
@@ -310,6 +375,58 @@ static void set_random_wait(uint16_t range) {
 	timerB_set_alarm_from_now(TIMERB_ALARM_CCR0, wait_time, 0);
 }
 
+/**
+ * Get the backoff exponent of a first attempt, one more than MAC_BE_MIN
+ * each time the failure rate doubles above 1/8.
+ */
+static uint16_t backoff_base(void) {
+	uint16_t rate, exponent;
+
+	rate = busy_rate + collision_rate;
+	exponent = MAC_BE_MIN;
+	while (rate > RATE_ONE / 8 && exponent < MAC_BE_MAX) {
+		exponent++;
+		rate >>= 1;
+	}
+	return exponent;
+}
+
+static void rate_update(uint16_t *rate, uint16_t failed) {
+	int16_t sample = failed ? RATE_ONE : 0;
+
+	*rate += (sample - (int16_t) *rate) / (1 << RATE_SHIFT);
+}
+
+/**
+ * Account an RSSI sample of the idle channel. The minimum of NOISE_SAMPLES
+ * samples ignores the frames heard meanwhile, and the CCA threshold
+ * follows its average.
+ */
+static void noise_sample(int8_t rssi) {
+	if (rssi == PHY_RSSI_INVALID) {
+		return;
+	}
+
+	if (noise_count == 0 || rssi < noise_min) {
+		noise_min = rssi;
+	}
+	if (++noise_count < NOISE_SAMPLES) {
+		return;
+	}
+	noise_count = 0;
+
+	if (noise_known) {
+		noise_floor += (noise_min * 16 - noise_floor) / (1 << NOISE_SHIFT);
+	} else {
+		noise_floor = noise_min * 16;
+		noise_known = 1;
+	}
+
+	stats.noise_floor = noise_floor / 16;
+	stats.cca_threshold = phy_set_cca_threshold(stats.noise_floor
+			+ MAC_CCA_MARGIN);
+}
+
 static void set_ack_timeout() {
 	// Set the timerB to generate an interrupt
 	timerB_register_cb(TIMERB_ALARM_CCR0, timeout);
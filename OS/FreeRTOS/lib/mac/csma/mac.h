@@ -47,6 +47,47 @@
 
 #define MAC_MAX_RETRY 5
 
+/**
+ * Bounds of the backoff exponent, an attempt waits up to 2^exponent
+ * TimerB ticks (32768Hz) before the CCA.
+ */
+#ifndef MAC_BE_MIN
+#define MAC_BE_MIN 5
+#endif
+#ifndef MAC_BE_MAX
+#define MAC_BE_MAX 10
+#endif
+
+/**
+ * CCA threshold above the measured noise floor, in dB.
+ */
+#ifndef MAC_CCA_MARGIN
+#define MAC_CCA_MARGIN 8
+#endif
+
+/**
+ * Period of the noise floor RSSI samples when there is nothing to send,
+ * in ticks.
+ */
+#ifndef MAC_NOISE_PERIOD
+#define MAC_NOISE_PERIOD (configTICK_RATE_HZ / 10 + 1)
+#endif
+
+/**
+ * Channel access statistics.
+ */
+typedef struct {
+	uint16_t sent; // frames sent, and acknowledged when asked
+	uint16_t dropped; // frames given up after MAC_MAX_RETRY attempts
+	uint16_t attempts; // CCA attempts
+	uint16_t busy; // attempts which found the channel busy
+	uint16_t collisions; // sent frames whose ACK didn't come
+	uint32_t delay; // sum of the delays from the queue to the end of the sent frames, in TimerB ticks
+	int8_t noise_floor; // in dBm, 0 until measured
+	int8_t cca_threshold; // in dBm, 0 until set
+	uint8_t backoff_exp; // backoff exponent of the next first attempt
+} mac_stats_t;
+
 typedef void (*mac_rx_callback_t)(uint16_t src_addr, uint8_t* data,
 		uint16_t length, int8_t rssi);
 
@@ -73,4 +114,11 @@ void mac_init(xSemaphoreHandle spi_m, mac_rx_callback_t cb, uint8_t channel);
  */
 uint16_t mac_send(uint16_t dest_addr, uint8_t* data, uint16_t length, int16_t ack);
 
+/**
+ * Get the channel access statistics.
+ * \param stats where to copy them
+ * \param reset 1 to start counting again, the noise floor is kept
+ */
+void mac_get_stats(mac_stats_t *stats, uint16_t reset);
+
 #endif
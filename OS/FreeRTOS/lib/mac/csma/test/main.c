@@ -21,11 +21,17 @@ static void prvSetupHardware(void);
 
 // Task that sends packets
 static void vSendingTask(void* pvParameters);
+static void print_stats(portTickType period, uint16_t offered);
 
 // function for handling received packets
 void packet_received(uint16_t from, uint8_t* pkt, uint16_t pktLength,
 		int8_t rssi);
 
+/* Offered load steps, the period between two frames in ticks */
+static const portTickType load_periods[] = { 20, 10, 5, 2, 1 };
+#define LOAD_STEPS (sizeof(load_periods) / sizeof(load_periods[0]))
+#define STEP_DURATION (30 * configTICK_RATE_HZ)
+
 /* Global Variables */
 static xSemaphoreHandle xSPIMutex;
 
@@ -93,16 +99,57 @@ void packet_received(uint16_t from, uint8_t* pkt, uint16_t length, int8_t rssi)
 }
 
 static void vSendingTask(void* pvParameters) {
+	mac_stats_t stats;
+	portTickType wake, end;
+	uint16_t step, offered;
+
 	myfriend = 0x0;
 	while (1) {
 		vTaskDelay(50);
 		printf("\nSending hello broadcast\n");
 		mac_send(MAC_BROADCAST_ADDR, (uint8_t*) "Test", sizeof("Test"), 0);
 
-		if (myfriend) {
-			vTaskDelay(50);
-			printf("\nSending frame to my friend %.4x\n", myfriend);
-			mac_send(myfriend, (uint8_t*) "Test", sizeof("Test"), 0);
+		if (!myfriend) {
+			continue;
+		}
+
+		// Load my friend more and more, with ACKs to see the collisions
+		printf("\nLoading my friend %.4x\n", myfriend);
+		for (step = 0; step < LOAD_STEPS; step++) {
+			mac_get_stats(&stats, 1);
+			offered = 0;
+
+			wake = xTaskGetTickCount();
+			end = wake + STEP_DURATION;
+			while ((signed portBASE_TYPE) (end - wake) > 0) {
+				mac_send(myfriend, (uint8_t*) "Test", sizeof("Test"), 1);
+				offered++;
+				vTaskDelayUntil(&wake, load_periods[step]);
+			}
+
+			print_stats(load_periods[step], offered);
 		}
 	}
 }
+
+static void print_stats(portTickType period, uint16_t offered) {
+	mac_stats_t stats;
+	uint16_t transmissions, busy, collisions, delay;
+
+	mac_get_stats(&stats, 0);
+	transmissions = stats.attempts - stats.busy;
+	busy = stats.attempts ? (uint32_t) stats.busy * 100 / stats.attempts : 0;
+	collisions = transmissions ?
+			(uint32_t) stats.collisions * 100 / transmissions : 0;
+
+	printf("load %u.%u frame/s: offered %u sent %u dropped %u, %lu bit/s\r\n",
+			configTICK_RATE_HZ / period, (configTICK_RATE_HZ * 10 / period) % 10,
+			offered, stats.sent, stats.dropped,
+			(uint32_t) stats.sent * sizeof("Test") * 8 * configTICK_RATE_HZ
+					/ STEP_DURATION);
+
+	// access delay in ms, from the TimerB ticks
+	delay = stats.sent ? ((stats.delay / stats.sent) * 1000) >> 15 : 0;
+	printf("busy %u%% collisions %u%% access delay %ums, noise %ddBm cca %ddBm be %u\r\n",
+			busy, collisions, delay, stats.noise_floor, stats.cca_threshold, stats.backoff_exp);
+}
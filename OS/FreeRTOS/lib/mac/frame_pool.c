@@ -0,0 +1,107 @@
+/*
+ * Copyright  2008-2009 INRIA/SensTools
+ *
+ * <dev-team@sentools.info>
+ *
+ * This software is a set of libraries designed to develop applications
+ * for the WSN430 embedded hardware platform.
+ *
+ * This software is governed by the CeCILL license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#include <io.h>
+
+/* Scheduler includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "frame_pool.h"
+
+typedef union pool_frame {
+	union pool_frame *next;
+	uint16_t _align;
+	uint8_t data[FRAME_POOL_FRAME_SIZE];
+} pool_frame_t;
+
+static pool_frame_t frames[FRAME_POOL_COUNT];
+static pool_frame_t *free_list = 0x0;
+static uint16_t free_count = 0;
+static uint16_t initialized = 0;
+
+void frame_pool_init(void) {
+	int16_t i;
+
+	if (initialized) {
+		return;
+	}
+
+	for (i = 0; i < FRAME_POOL_COUNT; i++) {
+		frames[i].next = free_list;
+		free_list = &frames[i];
+	}
+	free_count = FRAME_POOL_COUNT;
+	initialized = 1;
+}
+
+void* frame_pool_alloc_from_isr(void) {
+	pool_frame_t *frame;
+
+	frame = free_list;
+	if (frame != 0x0) {
+		free_list = frame->next;
+		free_count--;
+	}
+	return frame;
+}
+
+void* frame_pool_alloc(void) {
+	void *frame;
+
+	portENTER_CRITICAL();
+	frame = frame_pool_alloc_from_isr();
+	portEXIT_CRITICAL();
+
+	return frame;
+}
+
+void frame_pool_free_from_isr(void* frame) {
+	pool_frame_t *f = (pool_frame_t*) frame;
+
+	f->next = free_list;
+	free_list = f;
+	free_count++;
+}
+
+void frame_pool_free(void* frame) {
+	portENTER_CRITICAL();
+	frame_pool_free_from_isr(frame);
+	portEXIT_CRITICAL();
+}
+
+uint16_t frame_pool_available(void) {
+	return free_count;
+}
@@ -0,0 +1,95 @@
+/*
+ * Copyright  2008-2009 INRIA/SensTools
+ *
+ * <dev-team@sentools.info>
+ *
+ * This software is a set of libraries designed to develop applications
+ * for the WSN430 embedded hardware platform.
+ *
+ * This software is governed by the CeCILL license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL license and that you accept its terms.
+ */
+
+/**
+ * \file
+ * \brief Pool of radio frames shared by the MAC layers
+ *
+ * The MAC layers build their frames in buffers taken from this pool, and
+ * pass pointers through their queues instead of copying whole frames.
+ *
+ * A frame has a single owner at a time. The code that allocates a frame
+ * owns it; sending its pointer to a queue gives it to whoever receives
+ * the pointer, which must free it or pass it on. A frame that could not
+ * be queued is still owned by the sender.
+ */
+
+#ifndef FRAME_POOL_H_
+#define FRAME_POOL_H_
+
+/**
+ * Number of frames in the pool.
+ */
+#ifndef FRAME_POOL_COUNT
+#define FRAME_POOL_COUNT 6
+#endif
+
+/**
+ * Size of a frame, the PHY payload plus the length byte the MAC frames
+ * keep after it, rounded to a word.
+ */
+#define FRAME_POOL_FRAME_SIZE 128
+
+/**
+ * Make a MAC frame type that doesn't fit a pool frame fail to compile.
+ */
+#define FRAME_POOL_CHECK(type) \
+	typedef char type##_fits_frame_pool[(sizeof(type) <= FRAME_POOL_FRAME_SIZE) ? 1 : -1]
+
+/**
+ * Fill the pool, the calls after the first one do nothing.
+ * To be called by the MAC init functions, before the scheduler starts.
+ */
+void frame_pool_init(void);
+
+/**
+ * Take a frame from the pool.
+ * \return the frame, 0x0 if the pool is empty
+ */
+void* frame_pool_alloc(void);
+void* frame_pool_alloc_from_isr(void);
+
+/**
+ * Give a frame back to the pool.
+ */
+void frame_pool_free(void* frame);
+void frame_pool_free_from_isr(void* frame);
+
+/**
+ * Get the number of free frames.
+ */
+uint16_t frame_pool_available(void);
+
+#endif /* FRAME_POOL_H_ */
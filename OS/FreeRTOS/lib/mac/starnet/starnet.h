@@ -0,0 +1,72 @@
+/*
+ * Copyright  2008-2009 INRIA/SensTools
+ *
+ * <dev-team@sentools.info>
+ *
+ * This software is a set of libraries designed to develop applications
+ * for the WSN430 embedded hardware platform.
+ *
+ * This software is governed by the CeCILL license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL license and that you accept its terms.
+ */
+
+/**
+ * \file
+ * \brief Addresses and timings shared by the starnet node and sink
+ *
+ * The node and sink must be built with the same STARNET_ADDR16, the
+ * frame headers carry addresses of that size.
+ */
+
+#ifndef STARNET_H_
+#define STARNET_H_
+
+/**
+ * 1 for 16-bit node addresses from the two low bytes of the DS2411
+ * serial number, 0 for 8-bit ones from the lowest, which limits a star
+ * to 254 nodes and makes collisions likely well before.
+ */
+#ifndef STARNET_ADDR16
+#define STARNET_ADDR16 0
+#endif
+
+#if STARNET_ADDR16
+typedef uint16_t starnet_addr_t;
+#define STARNET_ADDR_BROADCAST 0xFFFF
+#else
+typedef uint8_t starnet_addr_t;
+#define STARNET_ADDR_BROADCAST 0xFF
+#endif
+
+/**
+ * Ticks a station waits before answering a frame, the sender of the
+ * frame only listens again 5 ticks after it.
+ */
+#ifndef STARNET_TURNAROUND
+#define STARNET_TURNAROUND 8
+#endif
+
+#endif /* STARNET_H_ */
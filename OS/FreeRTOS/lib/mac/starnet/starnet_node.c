@@ -34,6 +34,7 @@
  */
 
 #include <io.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <stdio.h>
 
@@ -42,53 +43,62 @@
 #include "task.h"
 #include "queue.h"
 #include "semphr.h"
+#include "event_flags.h"
 
 /* Project Includes */
 #include "starnet_node.h"
+#include "starnet.h"
 #include "leds.h"
+#include "frame_pool.h"
 
 /* Drivers Include */
 #include "cc1101.h"
 #include "ds2411.h"
 #include "spi1.h"
 
-#define UNKNOWN_ADDRESS 0xFF
-
 #define EVENT_FRAME_RECEIVED 0x10
 #define EVENT_FRAME_TO_SEND  0x20
+#define EVENT_FRAME_SENT     0x40
 
 #define FRAME_TYPE_ATTACH_REQUEST 0x01
 #define FRAME_TYPE_ATTACH_REPLY   0x02
 #define FRAME_TYPE_DATA           0x03
 
-#define FRAME_LENGTH_ATTACH 3
-
 #define STATE_ATTACHING 0x1
 #define STATE_ATTACHED  0x2
 
 typedef struct frame {
     uint8_t length;
-    uint8_t srcAddr;
-    uint8_t dstAddr;
     uint8_t type;
+    starnet_addr_t srcAddr;
+    starnet_addr_t dstAddr;
+    uint8_t seq;
     uint8_t payload[MAX_PACKET_LENGTH];
 } frame_t;
+FRAME_POOL_CHECK(frame_t);
+
+/* The bytes between the length and the payload */
+#define FRAME_HEADER_LENGTH (offsetof(frame_t, payload) - 1)
+#define FRAME_LENGTH_ATTACH FRAME_HEADER_LENGTH
 
 /* Function Prototypes */
 static void vMacTask(void* pvParameters);
 static void vInitMac(void);
 static void vStartRx(void);
 static void vSendAttachFrame(void);
-static void vSendFrame(void);
+static void vSendFrame(frame_t *pxFrame);
 static uint16_t xParseAttachFrame(void);
 static void vParseFrame(void);
 static uint16_t vRxOk_cb(void);
 static uint16_t vTxOk_cb(void);
+static uint16_t xEventFromISR(uint16_t usEvents);
 
 /* Local Variables */
-static xQueueHandle xEventQ, xTXFrameQ;
-static xSemaphoreHandle xSPIM, xSendingS;
-static uint8_t nodeAddr, coordAddr;
+static xQueueHandle xTXFrameQ;
+static xSemaphoreHandle xSPIM;
+static xEventFlagsHandle xMacFlags;
+static starnet_addr_t nodeAddr, coordAddr;
+static uint8_t txSeq;
 static frame_t txFrame, rxFrame;
 static uint16_t macState;
 
@@ -97,16 +107,12 @@ void vCreateMacTask( xSemaphoreHandle xSPIMutex, uint16_t usPriority )
     /* Stores the mutex handle */
     xSPIM = xSPIMutex;
 
-    /* Create an Event Queue */
-    xEventQ = xQueueCreate(TX_BUF_LENGTH + 5, sizeof(uint8_t));
-
-    /* Create a frame Queue for the frames to send */
-    xTXFrameQ = xQueueCreate(TX_BUF_LENGTH, sizeof(frame_t));
+    /* Create the event flags, set by the radio interrupts and the API */
+    xMacFlags = xEventFlagsCreate();
 
-    /* Create a Semaphore for waiting end of TX */
-    vSemaphoreCreateBinary( xSendingS );
-    /* Make sure the semaphore is taken */
-    xSemaphoreTake( xSendingS, 0 );
+    /* Create a Queue for the frames to send, they come from the pool */
+    frame_pool_init();
+    xTXFrameQ = xQueueCreate(TX_BUF_LENGTH, sizeof(frame_t*));
 
     /* Create the task */
     xTaskCreate( vMacTask, (const signed char*)"MAC", configMINIMAL_STACK_SIZE, NULL, usPriority, NULL );
@@ -114,35 +120,43 @@ void vCreateMacTask( xSemaphoreHandle xSPIMutex, uint16_t usPriority )
 
 uint16_t xSendPacket(uint16_t pktLength, uint8_t* pkt)
 {
-    uint8_t event = EVENT_FRAME_TO_SEND;
-
     if (macState == STATE_ATTACHING || pktLength > MAX_PACKET_LENGTH)
     {
         return 0;
     }
 
-    frame_t tempFrame;
+    frame_t *pxFrame = frame_pool_alloc();
+
+    if (pxFrame == NULL)
+    {
+        return 0;
+    }
+
+    pxFrame->length = (uint8_t)FRAME_HEADER_LENGTH+pktLength;
+    pxFrame->srcAddr = nodeAddr;
+    pxFrame->dstAddr = coordAddr;
+    pxFrame->type = FRAME_TYPE_DATA;
 
-    tempFrame.length = (uint8_t)3+pktLength;
-    tempFrame.srcAddr = nodeAddr;
-    tempFrame.dstAddr = coordAddr;
-    tempFrame.type = FRAME_TYPE_DATA;
+    /* The sink tracks the sequence numbers for duplicates and losses */
+    taskENTER_CRITICAL();
+    pxFrame->seq = txSeq++;
+    taskEXIT_CRITICAL();
 
     uint16_t i;
     for (i = 0; i<pktLength; i++)
     {
-        tempFrame.payload[i] = pkt[i];
+        pxFrame->payload[i] = pkt[i];
     }
 
-    if ( !xQueueSendToBack(xEventQ, &event, 0) )
+    /* Give the frame to the MAC task, which frees it */
+    if ( !xQueueSendToBack(xTXFrameQ, &pxFrame, 0) )
     {
+        frame_pool_free(pxFrame);
         return 0;
     }
 
-    if ( !xQueueSendToBack(xTXFrameQ, &tempFrame, 0) )
-    {
-        return 0;
-    }
+    /* Without the event the frame waits for the next one */
+    vEventFlagsSet(xMacFlags, EVENT_FRAME_TO_SEND);
 
     return 1;
 }
@@ -150,7 +164,8 @@ uint16_t xSendPacket(uint16_t pktLength, uint8_t* pkt)
 
 static void vMacTask(void* pvParameters)
 {
-    uint8_t event;
+    uint16_t events;
+    frame_t *pxFrame;
 
     macState = STATE_ATTACHING;
 
@@ -165,21 +180,21 @@ static void vMacTask(void* pvParameters)
 
         vStartRx();
 
-        uint16_t RXTimeout = 1000;
+        /* Random wait, the nodes started together mustn't retry together */
+        uint16_t RXTimeout = 500 + (rand() & 0x3FF);
         uint16_t time;
         while (1)
         {
             time = xTaskGetTickCount();
 
-            if ( xQueueReceive(xEventQ, &event, RXTimeout) )
+            if ( uxEventFlagsWait(xMacFlags, EVENT_FRAME_RECEIVED, pdTRUE, RXTimeout) )
             {
-                if (event == EVENT_FRAME_RECEIVED)
+                if ( xParseAttachFrame() )
                 {
-                    if ( xParseAttachFrame() )
-                    {
-                        break;
-                    }
+                    break;
                 }
+                /* The radio stopped after the frame of another node */
+                vStartRx();
             }
 
             time = xTaskGetTickCount() - time;
@@ -203,18 +218,20 @@ static void vMacTask(void* pvParameters)
     {
         vStartRx();
 
-        while ( xQueueReceive(xEventQ, &event, portMAX_DELAY))
+        while ( (events = uxEventFlagsWait(xMacFlags,
+                EVENT_FRAME_RECEIVED | EVENT_FRAME_TO_SEND, pdTRUE, portMAX_DELAY)) )
         {
-            if (event == EVENT_FRAME_RECEIVED)
+            if (events & EVENT_FRAME_RECEIVED)
             {
                 vParseFrame();
             }
-            else if (event == EVENT_FRAME_TO_SEND)
+            if (events & EVENT_FRAME_TO_SEND)
             {
                 //~ LED_BLUE_ON();
-                if ( xQueueReceive(xTXFrameQ, &txFrame, 0) )
+                while ( xQueueReceive(xTXFrameQ, &pxFrame, 0) )
                 {
-                    vSendFrame();
+                    vSendFrame(pxFrame);
+                    frame_pool_free(pxFrame);
                 }
                 //~ LED_BLUE_OFF();
             }
@@ -227,7 +244,11 @@ static void vInitMac(void)
 {
     /* Initialize the unique electronic signature and read it */
     ds2411_init();
+#if STARNET_ADDR16
+    nodeAddr = ( ((uint16_t)ds2411_id.serial1) << 8) + ds2411_id.serial0;
+#else
     nodeAddr = ds2411_id.serial0;
+#endif
 
     /* Seed the random number generator */
     uint16_t seed;
@@ -297,10 +318,10 @@ static void vSendAttachFrame(void)
 {
     txFrame.length = FRAME_LENGTH_ATTACH;
     txFrame.srcAddr = nodeAddr;
-    txFrame.dstAddr = UNKNOWN_ADDRESS;
+    txFrame.dstAddr = STARNET_ADDR_BROADCAST;
     txFrame.type = FRAME_TYPE_ATTACH_REQUEST;
 
-    vSendFrame();
+    vSendFrame(&txFrame);
 }
 
 static uint16_t xParseAttachFrame(void)
@@ -323,7 +344,7 @@ static uint16_t xParseAttachFrame(void)
     }
 
     /* Check Addresses are correct */
-    cc1101_fifo_get( (uint8_t*) &(rxFrame.srcAddr), 3);
+    cc1101_fifo_get( (uint8_t*) &(rxFrame.type), FRAME_HEADER_LENGTH);
     if ( rxFrame.dstAddr != nodeAddr )
     {
         xSemaphoreGive(xSPIM);
@@ -356,16 +377,16 @@ static void vParseFrame(void)
 
     /* Check Length is correct */
     cc1101_fifo_get( (uint8_t*) &(rxFrame.length), 1);
-    if (rxFrame.length > sizeof(rxFrame)-1)
+    if ( (rxFrame.length > sizeof(rxFrame)-1) || (rxFrame.length < FRAME_HEADER_LENGTH) )
     {
         xSemaphoreGive(xSPIM);
         return;
     }
 
     /* Check Addresses are correct */
-    cc1101_fifo_get( (uint8_t*) &(rxFrame.srcAddr), 3);
+    cc1101_fifo_get( (uint8_t*) &(rxFrame.type), FRAME_HEADER_LENGTH);
     if ( (rxFrame.srcAddr != coordAddr) ||
-        ( (rxFrame.dstAddr != nodeAddr) && (rxFrame.dstAddr != 0xFF) ) )
+        ( (rxFrame.dstAddr != nodeAddr) && (rxFrame.dstAddr != STARNET_ADDR_BROADCAST) ) )
     {
         xSemaphoreGive(xSPIM);
         return;
@@ -379,15 +400,15 @@ static void vParseFrame(void)
     }
 
     /* Get Payload */
-    cc1101_fifo_get( rxFrame.payload, rxFrame.length - 3 );
+    cc1101_fifo_get( rxFrame.payload, rxFrame.length - FRAME_HEADER_LENGTH );
 
     xSemaphoreGive(xSPIM);
 
     /* Transfer packet to higher layer */
-    vPacketReceived(rxFrame.length-3, rxFrame.payload);
+    vPacketReceived(rxFrame.length - FRAME_HEADER_LENGTH, rxFrame.payload);
 }
 
-static void vSendFrame(void)
+static void vSendFrame(frame_t *pxFrame)
 {
     uint16_t delay;
 
@@ -396,13 +417,27 @@ static void vSendFrame(void)
     cc1101_gdo2_int_disable();
 
     /* Wait until CCA */
-    while ( !(0x10 & cc1101_status_pktstatus() ) )
+    for (;;)
     {
-        cc1101_cmd_idle();
-        cc1101_cmd_flush_rx();
-        cc1101_cmd_rx();
-
-        delay = (rand() & 0x7F) +1;
+        if (cc1101_status_marcstate() != 0x0D)
+        {
+            /* The radio is IDLE after a received frame, and the channel
+             * never looks clear there: listen again, and leave the sender
+             * the time to listen too */
+            cc1101_cmd_idle();
+            cc1101_cmd_flush_rx();
+            cc1101_cmd_rx();
+
+            delay = STARNET_TURNAROUND;
+        }
+        else if (0x10 & cc1101_status_pktstatus())
+        {
+            break;
+        }
+        else
+        {
+            delay = (rand() & 0x7F) +1;
+        }
 
         xSemaphoreGive(xSPIM);
         vTaskDelay( delay );
@@ -421,21 +456,20 @@ static void vSendFrame(void)
 
     cc1101_gdo2_int_disable();
 
-    cc1101_fifo_put((uint8_t*)&txFrame, txFrame.length+1);
+    cc1101_fifo_put((uint8_t*)pxFrame, pxFrame->length+1);
 
+    uxEventFlagsClear(xMacFlags, EVENT_FRAME_SENT);
     cc1101_cmd_tx();
 
     xSemaphoreGive(xSPIM);
 
     //~ LED_GREEN_ON();
     /* Wait until frame is sent */
-    if ( !xSemaphoreTake(xSendingS, 1000) )
+    if ( !uxEventFlagsWait(xMacFlags, EVENT_FRAME_SENT, pdTRUE, 1000) )
     {
-        printf("erreur semaphore, correcting\r\n");
-        xSemaphoreGive(xSendingS);
+        printf("erreur fin TX, correcting\r\n");
         cc1101_reinit();
         vInitMac();
-        xSemaphoreTake(xSendingS, 0);
     }
     //~ LED_GREEN_OFF();
 
@@ -445,24 +479,21 @@ static void vSendFrame(void)
 
 static uint16_t vRxOk_cb(void)
 {
-	portBASE_TYPE xHigherPriorityTaskWoken;
-    uint8_t event = EVENT_FRAME_RECEIVED;
-
-    xQueueSendToBackFromISR(xEventQ, &event, &xHigherPriorityTaskWoken);
-
-    if (xHigherPriorityTaskWoken)
-    {
-        vPortYield();
-    }
-
-    return 1;
+    traceISR_ENTER(TRACE_ISR_RADIO_RX);
+    return xEventFromISR(EVENT_FRAME_RECEIVED);
 }
 
 static uint16_t vTxOk_cb(void)
 {
-    portBASE_TYPE xHigherPriorityTaskWoken;
+    traceISR_ENTER(TRACE_ISR_RADIO_TX);
+    return xEventFromISR(EVENT_FRAME_SENT);
+}
+
+static uint16_t xEventFromISR(uint16_t usEvents)
+{
+    portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
 
-    xSemaphoreGiveFromISR(xSendingS, &xHigherPriorityTaskWoken);
+    xEventFlagsSetFromISR(xMacFlags, usEvents, &xHigherPriorityTaskWoken);
 
     if (xHigherPriorityTaskWoken)
     {
@@ -34,6 +34,7 @@
  */
 
 #include <io.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <stdio.h>
 
@@ -42,102 +43,142 @@
 #include "task.h"
 #include "queue.h"
 #include "semphr.h"
+#include "event_flags.h"
 
 /* Project Includes */
 #include "starnet_sink.h"
+#include "starnet_table.h"
 
 /* Drivers Include */
 #include "cc1101.h"
 #include "ds2411.h"
 #include "leds.h"
-
-#define UNKNOWN_ADDRESS 0xFF
+#include "frame_pool.h"
 
 #define EVENT_FRAME_RECEIVED 0x10
 #define EVENT_FRAME_TO_SEND  0x20
+#define EVENT_FRAME_SENT     0x40
 
 #define FRAME_TYPE_ATTACH_REQUEST 0x01
 #define FRAME_TYPE_ATTACH_REPLY   0x02
 #define FRAME_TYPE_DATA           0x03
 
-#define FRAME_LENGTH_ATTACH 3
-
 #define STATE_ATTACHING 0x1
 #define STATE_RX        0x2
 #define STATE_TX        0x3
 
 typedef struct frame {
     uint8_t length;
-    uint8_t srcAddr;
-    uint8_t dstAddr;
     uint8_t type;
+    starnet_addr_t srcAddr;
+    starnet_addr_t dstAddr;
+    uint8_t seq;
     uint8_t payload[MAX_PACKET_LENGTH];
 } frame_t;
+FRAME_POOL_CHECK(frame_t);
+
+/* The bytes between the length and the payload */
+#define FRAME_HEADER_LENGTH (offsetof(frame_t, payload) - 1)
+#define FRAME_LENGTH_ATTACH FRAME_HEADER_LENGTH
+
+/**
+ * Period of the node table aging, and silence after which a node is
+ * removed, in seconds.
+ */
+#ifndef STARNET_AGE_PERIOD
+#define STARNET_AGE_PERIOD 1
+#endif
+#ifndef STARNET_NODE_TIMEOUT
+#define STARNET_NODE_TIMEOUT 600
+#endif
 
 /* Function Prototypes */
 static void vMacTask(void* pvParameters);
 static void vInitMac(void);
 static void vStartRx(void);
-static void vSendFrame(void);
+static void vSendFrame(frame_t *pxFrame);
 static void vParseFrame(void);
 static uint16_t vRxOk_cb(void);
 static uint16_t vTxOk_cb(void);
-static uint16_t xNodeInList(uint8_t nodeAddr);
+static uint16_t xEventFromISR(uint16_t usEvents);
+static void vUpdateClock(void);
 
 /* Local Variables */
-static xQueueHandle xEventQ;
-static xSemaphoreHandle xSPIM, xSendingS;
-static uint8_t coordAddr;
+static xQueueHandle xTXFrameQ;
+static xSemaphoreHandle xSPIM;
+static xEventFlagsHandle xMacFlags;
+static starnet_addr_t coordAddr;
 static frame_t txFrame, rxFrame;
 static uint16_t macState;
+static uint8_t txSeq;
 
-static uint8_t nodeList[10];
-static uint16_t nodeNumber;
+/* Time in seconds for the node table */
+static uint16_t seconds;
+static portTickType lastTick, tickRemainder;
 
 void vCreateMacTask( xSemaphoreHandle xSPIMutex, uint16_t usPriority )
 {
     /* Stores the mutex handle */
     xSPIM = xSPIMutex;
 
-    /* Create an Event Queue */
-    xEventQ = xQueueCreate(5, sizeof(uint8_t));
+    /* Create the event flags, set by the radio interrupts and the API */
+    xMacFlags = xEventFlagsCreate();
 
-    /* Create a Semaphore for waiting end of TX */
-    vSemaphoreCreateBinary( xSendingS );
-    /* Make sure the semaphore is taken */
-    xSemaphoreTake( xSendingS, 0 );
+    /* Create a Queue for the frames to send, they come from the pool */
+    frame_pool_init();
+    xTXFrameQ = xQueueCreate(TX_BUF_LENGTH, sizeof(frame_t*));
 
     /* Create the task */
     xTaskCreate( vMacTask, (const signed char*)"MAC", configMINIMAL_STACK_SIZE, NULL, usPriority, NULL );
 }
 
-uint16_t xSendPacketTo(uint8_t dstAddr, uint16_t pktLength, uint8_t* pkt)
+uint16_t xSendPacketTo(starnet_addr_t dstAddr, uint16_t pktLength, uint8_t* pkt)
 {
-    uint8_t event = EVENT_FRAME_TO_SEND;
+    if (pktLength > MAX_PACKET_LENGTH || macState == STATE_ATTACHING)
+    {
+        return 0;
+    }
 
-    if (pktLength > MAX_PACKET_LENGTH || macState != STATE_RX)
+    frame_t *pxFrame = frame_pool_alloc();
+
+    if (pxFrame == NULL)
     {
         return 0;
     }
 
-    txFrame.length = 3+pktLength;
-    txFrame.srcAddr = coordAddr;
-    txFrame.dstAddr = dstAddr;
-    txFrame.type = FRAME_TYPE_DATA;
+    pxFrame->length = FRAME_HEADER_LENGTH+pktLength;
+    pxFrame->srcAddr = coordAddr;
+    pxFrame->dstAddr = dstAddr;
+    pxFrame->type = FRAME_TYPE_DATA;
+
+    taskENTER_CRITICAL();
+    pxFrame->seq = txSeq++;
+    taskEXIT_CRITICAL();
 
     uint16_t i;
     for (i = 0; i<pktLength; i++)
     {
-        txFrame.payload[i] = pkt[i];
+        pxFrame->payload[i] = pkt[i];
+    }
+
+    /* Give the frame to the MAC task, which frees it */
+    if ( !xQueueSendToBack(xTXFrameQ, &pxFrame, 0) )
+    {
+        frame_pool_free(pxFrame);
+        return 0;
     }
 
-    return xQueueSendToBack(xEventQ, &event, 0);
+    /* Without the event the frame waits for the next one */
+    vEventFlagsSet(xMacFlags, EVENT_FRAME_TO_SEND);
+
+    return 1;
 }
 
 
 static void vMacTask(void* pvParameters)
 {
-    uint8_t event;
+    uint16_t events;
+    frame_t *pxFrame;
 
     macState = STATE_ATTACHING;
 
@@ -145,37 +186,69 @@ static void vMacTask(void* pvParameters)
 
 
     /* Packet Sending/Receiving */
+    vStartRx();
     for (;;)
     {
-        vStartRx();
         macState = STATE_RX;
 
-        if ( xQueueReceive(xEventQ, &event, portMAX_DELAY))
+        /* Wake up at least every aging period, RX goes on meanwhile */
+        events = uxEventFlagsWait(xMacFlags, EVENT_FRAME_RECEIVED | EVENT_FRAME_TO_SEND,
+                pdTRUE, STARNET_AGE_PERIOD * configTICK_RATE_HZ);
+        if (events)
         {
-            if (event == EVENT_FRAME_RECEIVED)
+            if (events & EVENT_FRAME_RECEIVED)
             {
                 //~ LED_GREEN_ON();
                 vParseFrame();
                 //~ LED_GREEN_OFF();
-            } else if (event == EVENT_FRAME_TO_SEND)
+            }
+            if (events & EVENT_FRAME_TO_SEND)
             {
                 //~ LED_RED_ON();
                 macState = STATE_TX;
-                vSendFrame();
+                while ( xQueueReceive(xTXFrameQ, &pxFrame, 0) )
+                {
+                    vSendFrame(pxFrame);
+                    frame_pool_free(pxFrame);
+                }
                 //~ LED_RED_OFF();
             }
+            vStartRx();
         }
+
+        vUpdateClock();
+        xNodeTableAge(seconds, STARNET_NODE_TIMEOUT);
+    }
+}
+
+static void vUpdateClock(void)
+{
+    portTickType now = xTaskGetTickCount();
+
+    /* Called at least once per aging period, the tick count can't wrap
+     * in between */
+    tickRemainder += now - lastTick;
+    lastTick = now;
+    while (tickRemainder >= configTICK_RATE_HZ)
+    {
+        tickRemainder -= configTICK_RATE_HZ;
+        seconds++;
     }
 }
 
 static void vInitMac(void)
 {
     /* Reset attached node list */
-    nodeNumber = 0;
+    vNodeTableInit();
+    lastTick = xTaskGetTickCount();
 
     /* Initialize the unique electronic signature and read it */
     ds2411_init();
+#if STARNET_ADDR16
+    coordAddr = ( ((uint16_t)ds2411_id.serial1) << 8) + ds2411_id.serial0;
+#else
     coordAddr = ds2411_id.serial0;
+#endif
 
     /* Seed the random number generator */
     uint16_t seed;
@@ -242,6 +315,8 @@ static void vStartRx(void)
 
 static void vParseFrame(void)
 {
+    node_t* node;
+
     xSemaphoreTake(xSPIM, portMAX_DELAY);
 
     /* Check CRC is correct */
@@ -253,15 +328,15 @@ static void vParseFrame(void)
 
     /* Check Length is correct */
     cc1101_fifo_get( (uint8_t*) &(rxFrame.length), 1);
-    if (rxFrame.length > sizeof(rxFrame)-1)
+    if ( (rxFrame.length > sizeof(rxFrame)-1) || (rxFrame.length < FRAME_HEADER_LENGTH) )
     {
         xSemaphoreGive(xSPIM);
         return;
     }
 
     /* Check Addresses are correct */
-    cc1101_fifo_get( (uint8_t*) &(rxFrame.srcAddr), 3);
-    if ( (rxFrame.dstAddr != coordAddr) && (rxFrame.dstAddr != UNKNOWN_ADDRESS))
+    cc1101_fifo_get( (uint8_t*) &(rxFrame.type), FRAME_HEADER_LENGTH);
+    if ( (rxFrame.dstAddr != coordAddr) && (rxFrame.dstAddr != STARNET_ADDR_BROADCAST))
     {
         xSemaphoreGive(xSPIM);
         return;
@@ -269,6 +344,8 @@ static void vParseFrame(void)
 
     xSemaphoreGive(xSPIM);
 
+    vUpdateClock();
+
     /* Check Frame Type */
     switch ( rxFrame.type)
     {
@@ -277,30 +354,37 @@ static void vParseFrame(void)
             {
                 break;
             }
-            if ( !xNodeInList(rxFrame.srcAddr) )
+            if ( pxNodeTableAttach(rxFrame.srcAddr, seconds) == NULL )
             {
-                if (nodeNumber == 10)
-                {
-                    break;
-                }
-                nodeList[nodeNumber] = rxFrame.srcAddr;
-                nodeNumber++;
+                break;
             }
             txFrame.srcAddr = coordAddr;
             txFrame.dstAddr = rxFrame.srcAddr;
             txFrame.type = FRAME_TYPE_ATTACH_REPLY;
             txFrame.length = FRAME_LENGTH_ATTACH;
-            vSendFrame();
+            vSendFrame(&txFrame);
             break;
 
         case FRAME_TYPE_DATA:
+            /* A node removed while silent is attached again, a frame
+             * from a node that doesn't fit the table isn't tracked */
+            node = pxNodeTableFind(rxFrame.srcAddr);
+            if (node == NULL)
+            {
+                node = pxNodeTableAttach(rxFrame.srcAddr, seconds);
+            }
+            if ( (node != NULL) && !xNodeTableFrame(node, rxFrame.seq, seconds) )
+            {
+                break;
+            }
+
             /* Get Payload */
             xSemaphoreTake(xSPIM, portMAX_DELAY);
-            cc1101_fifo_get( rxFrame.payload, rxFrame.length - 3 );
+            cc1101_fifo_get( rxFrame.payload, rxFrame.length - FRAME_HEADER_LENGTH );
             xSemaphoreGive(xSPIM);
 
             /* Transfer packet to higher layer */
-            vPacketReceivedFrom(rxFrame.srcAddr, rxFrame.length-3, rxFrame.payload);
+            vPacketReceivedFrom(rxFrame.srcAddr, rxFrame.length - FRAME_HEADER_LENGTH, rxFrame.payload);
             break;
 
         default :
@@ -309,7 +393,7 @@ static void vParseFrame(void)
 
 }
 
-static void vSendFrame(void)
+static void vSendFrame(frame_t *pxFrame)
 {
     uint16_t delay;
 
@@ -319,13 +403,27 @@ static void vSendFrame(void)
     cc1101_gdo2_int_disable();
 
     /* Wait until CCA */
-    while ( !(0x10 & cc1101_status_pktstatus() ) )
+    for (;;)
     {
-        cc1101_cmd_idle();
-        cc1101_cmd_flush_rx();
-        cc1101_cmd_rx();
-
-        delay = (rand() & 0x7F) +1;
+        if (cc1101_status_marcstate() != 0x0D)
+        {
+            /* The radio is IDLE after a received frame, and the channel
+             * never looks clear there: listen again, and leave the sender
+             * the time to listen too */
+            cc1101_cmd_idle();
+            cc1101_cmd_flush_rx();
+            cc1101_cmd_rx();
+
+            delay = STARNET_TURNAROUND;
+        }
+        else if (0x10 & cc1101_status_pktstatus())
+        {
+            break;
+        }
+        else
+        {
+            delay = (rand() & 0x7F) +1;
+        }
 
         xSemaphoreGive(xSPIM);
         vTaskDelay( delay );
@@ -344,33 +442,31 @@ static void vSendFrame(void)
 
     cc1101_gdo2_int_disable();
 
-    cc1101_fifo_put((uint8_t*)&txFrame, txFrame.length+1);
+    cc1101_fifo_put((uint8_t*)pxFrame, pxFrame->length+1);
 
+    uxEventFlagsClear(xMacFlags, EVENT_FRAME_SENT);
     cc1101_cmd_tx();
 
     xSemaphoreGive(xSPIM);
 
-    xSemaphoreTake(xSendingS, portMAX_DELAY);
+    uxEventFlagsWait(xMacFlags, EVENT_FRAME_SENT, pdTRUE, portMAX_DELAY);
 }
 
 static uint16_t vRxOk_cb(void)
 {
-    portBASE_TYPE xHigherPriorityTaskWoken;
-    uint8_t event = EVENT_FRAME_RECEIVED;
-    xQueueSendToBackFromISR(xEventQ, &event, &xHigherPriorityTaskWoken);
-
-    if (xHigherPriorityTaskWoken)
-    {
-        vPortYield();
-    }
-    return 1;
+    return xEventFromISR(EVENT_FRAME_RECEIVED);
 }
 
 static uint16_t vTxOk_cb(void)
 {
-    portBASE_TYPE xHigherPriorityTaskWoken;
+    return xEventFromISR(EVENT_FRAME_SENT);
+}
+
+static uint16_t xEventFromISR(uint16_t usEvents)
+{
+    portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
 
-    xSemaphoreGiveFromISR(xSendingS, &xHigherPriorityTaskWoken);
+    xEventFlagsSetFromISR(xMacFlags, usEvents, &xHigherPriorityTaskWoken);
 
     if (xHigherPriorityTaskWoken)
     {
@@ -380,21 +476,26 @@ static uint16_t vTxOk_cb(void)
     return 1;
 }
 
-static uint16_t xNodeInList(uint8_t nodeAddr)
+uint16_t xGetAttachedNodes(starnet_addr_t** nodeL)
 {
-    uint16_t i;
-    for (i=0;i<nodeNumber;i++)
-    {
-        if (nodeList[i] == nodeAddr)
-        {
-            return 1;
-        }
-    }
-    return 0;
+    return xNodeTableList(nodeL);
 }
 
-uint16_t xGetAttachedNodes(uint8_t** nodeL)
+uint16_t xGetNodeStats(starnet_addr_t nodeAddr, uint16_t* received, uint16_t* lost, uint16_t* duplicated)
 {
-    *nodeL = nodeList;
-    return nodeNumber;
+    node_t* node;
+    uint16_t found = 0;
+
+    vTaskSuspendAll();
+    node = pxNodeTableFind(nodeAddr);
+    if (node != NULL)
+    {
+        *received = node->received;
+        *lost = node->lost;
+        *duplicated = node->duplicated;
+        found = 1;
+    }
+    xTaskResumeAll();
+
+    return found;
 }
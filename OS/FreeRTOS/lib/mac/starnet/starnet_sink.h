@@ -36,11 +36,18 @@
 #ifndef _MAC_H
 #define _MAC_H
 
+#include "starnet.h"
+
 /**
  * Maximum packet size. Should not exceed 60.
  */
 #define MAX_PACKET_LENGTH 48
 
+/**
+ * TX frames buffer length
+ */
+#define TX_BUF_LENGTH     5
+
 /**
  * Initialize and create the MAC task.
  * \param xSPIMutex mutex handle for preventing SPI access confusion
@@ -53,7 +60,17 @@ void vCreateMacTask(xSemaphoreHandle xSPIMutex, uint16_t usPriority);
  * \param nodeList pointer that will point to the list
  * \return the number of attached nodes
  */
-uint16_t xGetAttachedNodes(uint8_t** nodeList);
+uint16_t xGetAttachedNodes(starnet_addr_t** nodeList);
+
+/**
+ * Get the data frame counts of a node, since it attached.
+ * \param nodeAddr the node address
+ * \param received where to write the number of frames received
+ * \param lost where to write the number of frames missed
+ * \param duplicated where to write the number of duplicates dropped
+ * \return 1 if the node is attached, 0 if not
+ */
+uint16_t xGetNodeStats(starnet_addr_t nodeAddr, uint16_t* received, uint16_t* lost, uint16_t* duplicated);
 
 /**
  * Request the MAC sublayer to send a packet to a node
@@ -62,7 +79,7 @@ uint16_t xGetAttachedNodes(uint8_t** nodeList);
  * \param pkt a pointer to the packet
  * \return 1 if the packet will be sent, 0 if it won't
  */
-uint16_t xSendPacketTo(uint8_t dstAddr, uint16_t pktLength, uint8_t* pkt);
+uint16_t xSendPacketTo(starnet_addr_t dstAddr, uint16_t pktLength, uint8_t* pkt);
 
 /**
  * Function that should be provided outside of the 'mac' module.
@@ -71,6 +88,6 @@ uint16_t xSendPacketTo(uint8_t dstAddr, uint16_t pktLength, uint8_t* pkt);
  * \param pktLength length of the packet
  * \param pkt pointer to the packet
  */
-extern void vPacketReceivedFrom(uint8_t srcAddr, uint16_t pktLength, uint8_t* pkt);
+extern void vPacketReceivedFrom(starnet_addr_t srcAddr, uint16_t pktLength, uint8_t* pkt);
 
 #endif
@@ -0,0 +1,216 @@
+/*
+ * Copyright  2008-2009 INRIA/SensTools
+ *
+ * <dev-team@sentools.info>
+ *
+ * This software is a set of libraries designed to develop applications
+ * for the WSN430 embedded hardware platform.
+ *
+ * This software is governed by the CeCILL license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#include <io.h>
+#include <stdlib.h>
+
+#include "starnet_table.h"
+
+#if (STARNET_TABLE_SLOTS & (STARNET_TABLE_SLOTS - 1)) || \
+    (STARNET_TABLE_SLOTS <= STARNET_MAX_NODES)
+#error "STARNET_TABLE_SLOTS must be a power of 2 above STARNET_MAX_NODES"
+#endif
+
+#define SLOT_MASK (STARNET_TABLE_SLOTS - 1)
+#define SLOT_FREE(i) (slots[i].addr == STARNET_ADDR_BROADCAST)
+
+static node_t slots[STARNET_TABLE_SLOTS];
+static starnet_addr_t addrList[STARNET_MAX_NODES];
+static uint16_t nodeCount;
+static uint16_t ageCursor;
+
+static uint16_t xHash(starnet_addr_t addr)
+{
+    /* Multiplicative hash, folded to keep its high bits */
+    uint16_t h = (uint16_t) addr * 40503u;
+
+    return (h ^ (h >> 8)) & SLOT_MASK;
+}
+
+static uint16_t xSlotOf(starnet_addr_t addr)
+{
+    uint16_t i = xHash(addr);
+
+    /* There is always a free slot, the probe ends */
+    while ( !SLOT_FREE(i) && (slots[i].addr != addr) )
+    {
+        i = (i + 1) & SLOT_MASK;
+    }
+    return i;
+}
+
+static void vRemove(uint16_t i)
+{
+    uint16_t j, home;
+    starnet_addr_t moved;
+
+    /* Move the last address of the list in the hole */
+    nodeCount--;
+    if (slots[i].index != nodeCount)
+    {
+        moved = addrList[nodeCount];
+        addrList[slots[i].index] = moved;
+        slots[xSlotOf(moved)].index = slots[i].index;
+    }
+
+    /* Shift back the entries whose probe went through the slot */
+    slots[i].addr = STARNET_ADDR_BROADCAST;
+    j = i;
+    for (;;)
+    {
+        j = (j + 1) & SLOT_MASK;
+        if (SLOT_FREE(j))
+        {
+            break;
+        }
+
+        home = xHash(slots[j].addr);
+        /* the entry stays if its home is cyclically within (i, j] */
+        if ( (i <= j) ? ((i < home) && (home <= j)) : ((i < home) || (home <= j)) )
+        {
+            continue;
+        }
+
+        slots[i] = slots[j];
+        slots[j].addr = STARNET_ADDR_BROADCAST;
+        i = j;
+    }
+}
+
+void vNodeTableInit(void)
+{
+    uint16_t i;
+
+    for (i = 0; i < STARNET_TABLE_SLOTS; i++)
+    {
+        slots[i].addr = STARNET_ADDR_BROADCAST;
+    }
+    nodeCount = 0;
+    ageCursor = 0;
+}
+
+node_t* pxNodeTableFind(starnet_addr_t addr)
+{
+    uint16_t i = xSlotOf(addr);
+
+    return SLOT_FREE(i) ? NULL : &slots[i];
+}
+
+node_t* pxNodeTableAttach(starnet_addr_t addr, uint16_t now)
+{
+    uint16_t i;
+    node_t* node;
+
+    if (addr == STARNET_ADDR_BROADCAST)
+    {
+        return NULL;
+    }
+
+    i = xSlotOf(addr);
+    node = &slots[i];
+
+    if (SLOT_FREE(i))
+    {
+        if (nodeCount == STARNET_MAX_NODES)
+        {
+            return NULL;
+        }
+
+        node->addr = addr;
+        node->index = nodeCount;
+        node->received = 0;
+        node->lost = 0;
+        node->duplicated = 0;
+        addrList[nodeCount] = addr;
+        nodeCount++;
+    }
+
+    node->seqValid = 0;
+    node->heard = now;
+    return node;
+}
+
+uint16_t xNodeTableFrame(node_t* node, uint8_t seq, uint16_t now)
+{
+    uint8_t gap;
+
+    node->heard = now;
+
+    if (node->seqValid)
+    {
+        gap = seq - node->seq;
+        if (gap == 0)
+        {
+            node->duplicated++;
+            return 0;
+        }
+        if (gap < 0x80)
+        {
+            node->lost += gap - 1;
+        }
+        /* else the frame is older than the last one, or the node
+         * restarted without attaching again, follow it */
+    }
+
+    node->seq = seq;
+    node->seqValid = 1;
+    node->received++;
+    return 1;
+}
+
+uint16_t xNodeTableAge(uint16_t now, uint16_t maxAge)
+{
+    uint16_t n, removed = 0;
+
+    for (n = 0; n < STARNET_TABLE_AGE_STEP; n++)
+    {
+        if ( !SLOT_FREE(ageCursor) &&
+             ((uint16_t) (now - slots[ageCursor].heard) > maxAge) )
+        {
+            /* an entry may be shifted in the slot, check it again */
+            vRemove(ageCursor);
+            removed++;
+            continue;
+        }
+        ageCursor = (ageCursor + 1) & SLOT_MASK;
+    }
+    return removed;
+}
+
+uint16_t xNodeTableList(starnet_addr_t** list)
+{
+    *list = addrList;
+    return nodeCount;
+}
@@ -0,0 +1,131 @@
+/*
+ * Copyright  2008-2009 INRIA/SensTools
+ *
+ * <dev-team@sentools.info>
+ *
+ * This software is a set of libraries designed to develop applications
+ * for the WSN430 embedded hardware platform.
+ *
+ * This software is governed by the CeCILL license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL license and that you accept its terms.
+ */
+
+/**
+ * \file
+ * \brief Table of the nodes attached to a starnet sink
+ *
+ * The nodes are kept in a hash table with linear probing, so finding
+ * the node of a received frame doesn't depend on the number of nodes.
+ * The addresses are also kept in a dense list given to the application
+ * as is.
+ *
+ * Each node has the sequence number of its last data frame, to drop
+ * the duplicates and count the lost frames, and the time it was last
+ * heard, to remove the nodes gone silent.
+ */
+
+#ifndef STARNET_TABLE_H_
+#define STARNET_TABLE_H_
+
+#include "starnet.h"
+
+/**
+ * Maximum number of attached nodes.
+ */
+#ifndef STARNET_MAX_NODES
+#define STARNET_MAX_NODES 32
+#endif
+
+/**
+ * Number of hash table slots, a power of 2 above STARNET_MAX_NODES.
+ * Twice as many keeps the probe sequences short.
+ */
+#ifndef STARNET_TABLE_SLOTS
+#define STARNET_TABLE_SLOTS (2 * STARNET_MAX_NODES)
+#endif
+
+/**
+ * Number of slots checked by each xNodeTableAge() call.
+ */
+#ifndef STARNET_TABLE_AGE_STEP
+#define STARNET_TABLE_AGE_STEP 8
+#endif
+
+typedef struct
+{
+    starnet_addr_t addr;    /* STARNET_ADDR_BROADCAST if the slot is free */
+    uint8_t seq;            /* sequence number of the last data frame */
+    uint8_t seqValid;       /* 0 until a data frame is received */
+    uint16_t heard;         /* time when last heard */
+    uint16_t index;         /* position in the address list */
+    uint16_t received;      /* data frames received */
+    uint16_t lost;          /* data frames missed, from the sequence gaps */
+    uint16_t duplicated;    /* data frames received twice */
+} node_t;
+
+/**
+ * Empty the table.
+ */
+void vNodeTableInit(void);
+
+/**
+ * Find a node.
+ * \return the node, NULL if it isn't attached
+ */
+node_t* pxNodeTableFind(starnet_addr_t addr);
+
+/**
+ * Attach a node, or attach again a node already in the table, which
+ * then restarts its sequence numbers.
+ * \param now the current time, in the unit of xNodeTableAge()
+ * \return the node, NULL if the table is full
+ */
+node_t* pxNodeTableAttach(starnet_addr_t addr, uint16_t now);
+
+/**
+ * Account a data frame of a node.
+ * \param seq the frame sequence number
+ * \param now the current time
+ * \return 1 if the frame is new, 0 if it is a duplicate
+ */
+uint16_t xNodeTableFrame(node_t* node, uint8_t seq, uint16_t now);
+
+/**
+ * Remove the nodes not heard for more than maxAge, checking
+ * STARNET_TABLE_AGE_STEP slots from where the previous call stopped.
+ * \param now the current time
+ * \return the number of nodes removed
+ */
+uint16_t xNodeTableAge(uint16_t now, uint16_t maxAge);
+
+/**
+ * Get the addresses of the attached nodes, in no particular order.
+ * \param list where to write the address of the list
+ * \return the number of nodes
+ */
+uint16_t xNodeTableList(starnet_addr_t** list);
+
+#endif /* STARNET_TABLE_H_ */
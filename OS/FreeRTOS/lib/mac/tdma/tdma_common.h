@@ -61,6 +61,20 @@
 #define BEACON_LOSS_MAX 10
 #endif
 
+/*
+ * The coordinator reclaims the slot of a node not heard for
+ * TDMA_LEASE_PERIODS beacon periods. An associated node with nothing to
+ * send sends an empty data frame every TDMA_KEEPALIVE_PERIODS periods to
+ * keep its slot.
+ */
+#ifndef TDMA_LEASE_PERIODS
+#define TDMA_LEASE_PERIODS 64
+#endif
+
+#ifndef TDMA_KEEPALIVE_PERIODS
+#define TDMA_KEEPALIVE_PERIODS (TDMA_LEASE_PERIODS / 4)
+#endif
+
 #ifndef RADIO_CHANNEL
 #define RADIO_CHANNEL 4
 #endif
@@ -107,10 +121,31 @@ enum mac_timing {
 enum mac_frame_type {
 	FRAME_TYPE_BEACON = 0x1, FRAME_TYPE_MGT = 0x2, FRAME_TYPE_DATA = 0x3
 };
+/*
+ * Frame type field: low 4 bits are the frame type, the high bits of data
+ * frames may acknowledge the last downlink data received in a beacon.
+ * | 7 | 6 5 4 | 3 2 1 0 |
+ * | A |  seq  |  type   |
+ */
+#define FRAME_TYPE_MASK 0x0F
+#define FRAME_ACK_FLAG 0x80
+#define FRAME_ACK_SEQ(seq) (((seq) & 0x7) << 4)
+#define FRAME_GET_ACK_SEQ(type) (((type) >> 4) & 0x7)
 
+/*
+ * MGT_RECLAIM tells a node its slot was given back, because its lease
+ * expired or the coordinator doesn't know it, so it must associate again.
+ */
 enum mac_mgt_value {
-	MGT_ASSOCIATE = 0x1, MGT_DISSOCIATE = 0x2, MGT_DATA = 0x3
+	MGT_ASSOCIATE = 0x1, MGT_DISSOCIATE = 0x2, MGT_DATA = 0x3, MGT_RECLAIM = 0x4
 };
+/*
+ * Acknowledged downlink data: the beacon entry type is MGT_DOWNLINK
+ * with the sequence number in the low 3 bits, and it is repeated in
+ * every beacon until the node acknowledges it in its slot.
+ */
+#define MGT_DOWNLINK 0x8
+#define MGT_DOWNLINK_SEQ_MASK 0x7
 #define MGT_TYPE_MASK 0x0F
 #define MGT_LENGTH_MASK  0xF0
 
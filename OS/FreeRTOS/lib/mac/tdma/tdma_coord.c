@@ -43,6 +43,7 @@
 #include "task.h"
 #include "queue.h"
 #include "semphr.h"
+#include "event_flags.h"
 
 /* Project Includes */
 #include "phy.h"
@@ -77,25 +78,46 @@ static void mac_init(void);
 static void beacon_send(void);
 static uint16_t beacon_append(uint16_t dest_addr, uint8_t type, uint8_t length,
 		uint8_t* data);
+static void beacon_append_downlinks(void);
+static void beacon_append_restored(void);
+static void reclaim_send(uint16_t node);
+static void table_update(void);
 static uint16_t slot_time_evt(void);
 static uint16_t block_until_event(uint16_t event);
 
 /* Local Variables */
-static xQueueHandle xEventQueue;
+static xEventFlagsHandle xEventFlags;
+static xSemaphoreHandle spi_mutex;
 uint16_t mac_addr;
 static beacon_t beacon_frame;
 static uint8_t* beacon_data_ptr;
 static uint16_t beacon_time;
 uint16_t slot_running;
 
+typedef struct {
+	uint16_t node;
+	uint8_t pending;
+	uint8_t seq;
+	uint8_t length;
+	uint8_t data[MAX_COORD_SEND_LENGTH];
+} downlink_t;
+static downlink_t downlinks[SLOT_COUNT];
+static uint16_t downlink_next;
+
+// Restored slots announced per beacon, until their node is heard
+#define RESTORED_ANNOUNCE_MAX 4
+static uint16_t restored_count, restored_next;
+static uint16_t reclaim_last;
+
 static void (*node_associated_handler)(uint16_t node);
 static void (*data_received_handler)(uint16_t node, uint8_t* data,
 		uint16_t length);
 static void (*beacon_handler)(uint8_t id, uint16_t timestamp);
 
 void mac_create_task(xSemaphoreHandle xSPIMutex) {
-	// Create the Event Queue
-	xEventQueue = xQueueCreate(8, sizeof(uint16_t));
+	// Create the event flags
+	xEventFlags = xEventFlagsCreate();
+	spi_mutex = xSPIMutex;
 
 	// Create the PHY task
 	phy_init(xSPIMutex, frame_received, RADIO_CHANNEL, RADIO_POWER);
@@ -110,10 +132,30 @@ void mac_create_task(xSemaphoreHandle xSPIMutex) {
 }
 
 uint16_t mac_send(uint16_t node, uint8_t* data, uint16_t length) {
+	uint16_t slot;
+	downlink_t* dl;
+
 	if (length > MAX_COORD_SEND_LENGTH) {
 		return 0;
 	}
-	return beacon_append(node, MGT_DATA, length, data);
+
+	slot = tdma_table_pos(node);
+	if ((node == 0xFFFF) || (slot == 0)) {
+		// Nobody to acknowledge it, send it once
+		return beacon_append(node, MGT_DATA, length, data);
+	}
+
+	dl = &downlinks[slot - 1];
+	if (dl->pending) {
+		return 0;
+	}
+
+	dl->node = node;
+	dl->length = length;
+	memcpy(dl->data, data, length);
+	dl->pending = 1;
+
+	return 1;
 }
 
 void mac_set_node_associated_handler(void(*handler)(uint16_t node)) {
@@ -149,6 +191,9 @@ static void vMacTask(void* pvParameters) {
 			beacon_handler(beacon_frame.beacon_id - 1, beacon_time);
 		}
 
+		// Use the rest of the beacon slot for the table
+		table_update();
+
 		// Block until slot time
 		block_until_event(EVENT_SLOT_TIME);
 
@@ -178,8 +223,13 @@ static void mac_init(void) {
 	/* Seed the random number generator */
 	srand(mac_addr);
 
-	// Clear the association table
-	tdma_table_clear();
+	// Restore the association table, the nodes keep their slots
+	xSemaphoreTake(spi_mutex, portMAX_DELAY);
+	restored_count = tdma_table_load();
+	xSemaphoreGive(spi_mutex);
+	restored_next = 0;
+	memset(downlinks, 0, sizeof(downlinks));
+	downlink_next = 0;
 
 	// Set RX
 	phy_rx();
@@ -200,6 +250,10 @@ static void mac_init(void) {
 }
 
 static void beacon_send(void) {
+	// Give the restored nodes their slots back, then the downlink data
+	beacon_append_restored();
+	beacon_append_downlinks();
+
 	// Compute length
 	beacon_frame.length = beacon_data_ptr - beacon_frame.raw;
 
@@ -208,6 +262,7 @@ static void beacon_send(void) {
 
 	// Update fields
 	beacon_data_ptr = beacon_frame.beacon_data;
+	reclaim_last = 0x0;
 	beacon_frame.beacon_id++;
 }
 
@@ -225,35 +280,105 @@ static uint16_t beacon_append(uint16_t dest_addr, uint8_t type, uint8_t length,
 	*beacon_data_ptr = (type & MGT_TYPE_MASK) | (length << 4);
 	beacon_data_ptr++;
 
-	memcpy(beacon_data_ptr, data, length);
-	beacon_data_ptr += length;
+	if (length) {
+		memcpy(beacon_data_ptr, data, length);
+		beacon_data_ptr += length;
+	}
 
 	return 1;
 }
 
+static void beacon_append_downlinks(void) {
+	uint16_t i, slot;
+	downlink_t* dl;
+
+	// Start from a different slot each beacon to share the space
+	for (i = 0; i < SLOT_COUNT; i++) {
+		slot = (downlink_next + i) % SLOT_COUNT;
+		dl = &downlinks[slot];
+
+		if (dl->pending) {
+			beacon_append(dl->node, MGT_DOWNLINK | (dl->seq
+					& MGT_DOWNLINK_SEQ_MASK), dl->length, dl->data);
+		}
+	}
+	downlink_next = (downlink_next + 1) % SLOT_COUNT;
+}
+
+static void beacon_append_restored(void) {
+	uint16_t i, n = 0;
+	uint8_t slot;
+
+	if (restored_count == 0) {
+		return;
+	}
+
+	// Resume where the previous beacon stopped
+	for (i = 0; (i < SLOT_COUNT) && (n < RESTORED_ANNOUNCE_MAX); i++) {
+		slot = (restored_next + i) % SLOT_COUNT + 1;
+		if (tdma_table_node(slot) && !tdma_table_confirmed(slot)) {
+			n++;
+			if (!beacon_append(tdma_table_node(slot), MGT_ASSOCIATE, 1,
+					&slot)) {
+				break;
+			}
+		}
+	}
+	restored_next = (restored_next + i) % SLOT_COUNT;
+
+	// Stop once they have all been heard or have expired
+	if (n == 0) {
+		restored_count = 0;
+	}
+}
+
+static void table_update(void) {
+	uint16_t node;
+	uint8_t slot;
+
+	// Reclaim a slot whose lease expired, and tell its node
+	slot = tdma_table_expire(&node);
+	if (slot != 0) {
+		PRINTF("Lease expired %.4x slot %u\n", node, slot);
+		downlinks[slot - 1].pending = 0;
+		reclaim_send(node);
+	}
+
+	xSemaphoreTake(spi_mutex, portMAX_DELAY);
+	tdma_table_sync();
+	xSemaphoreGive(spi_mutex);
+}
+
+static void reclaim_send(uint16_t node) {
+	// Once per beacon, the node may send several frames in a slot
+	if ((node != reclaim_last) && beacon_append(node, MGT_RECLAIM, 0, 0x0)) {
+		reclaim_last = node;
+	}
+}
+
 static uint16_t slot_time_evt(void) {
 	const uint16_t evt = EVENT_SLOT_TIME;
 	portBASE_TYPE yield = pdFALSE;
 
-	if (xQueueSendFromISR(xEventQueue, &evt, &yield) == pdTRUE) {
+	xEventFlagsSetFromISR(xEventFlags, evt, &yield);
 #if configUSE_PREEMPTION
-		if (yield) {
-			portYIELD();
-		}
-#endif
+	if (yield) {
+		portYIELD();
 	}
+#endif
 	return 1;
 }
 
 static uint16_t block_until_event(uint16_t mask) {
 	uint16_t evt;
-	do {
-		xQueueReceive(xEventQueue, &evt, portMAX_DELAY);
-		if ((evt & mask) != evt) {
-			PRINTF("Discarded event %x (mask %x)\n", evt, mask);
-		}
-	} while ((evt & mask) != evt);
-	return evt;
+
+	// Drop the events that came while nobody waited for them
+	evt = uxEventFlagsClear(xEventFlags, ~mask) & ~mask;
+	if (evt) {
+		PRINTF("Discarded event %x (mask %x)\n", evt, mask);
+	}
+
+	return uxEventFlagsWait(xEventFlags, mask, pdTRUE, portMAX_DELAY);
 }
 
 static void frame_received(uint8_t * data, uint16_t length, int8_t rssi,
@@ -280,14 +405,35 @@ static void frame_received(uint8_t * data, uint16_t length, int8_t rssi,
 
 	srcAddr = ntoh_s(frame->srcAddr);
 
-	switch (frame->type) {
+	switch (frame->type & FRAME_TYPE_MASK) {
 	case FRAME_TYPE_DATA:
 		slot_result = tdma_table_pos(srcAddr);
-		if ((slot_running == slot_result) && data_received_handler) {
+		if (slot_result == 0) {
+			// Unknown, its slot was reclaimed or forgotten
+			PRINTF("RX: unknown %.4x\n", srcAddr);
+			reclaim_send(srcAddr);
+			break;
+		}
+		if (slot_running != slot_result) {
+			PRINTF("RX: out of slot\n");
+			break;
+		}
+		tdma_table_heard(slot_result);
+
+		// Check if the pending downlink data is acknowledged
+		if ((frame->type & FRAME_ACK_FLAG)
+				&& downlinks[slot_result - 1].pending
+				&& (FRAME_GET_ACK_SEQ(frame->type)
+						== (downlinks[slot_result - 1].seq
+								& MGT_DOWNLINK_SEQ_MASK))) {
+			downlinks[slot_result - 1].pending = 0;
+			downlinks[slot_result - 1].seq++;
+		}
+
+		// Frames with no payload only carry the acknowledgement
+		if ((length > FRAME_HEADER_LENGTH) && data_received_handler) {
 			data_received_handler(srcAddr, frame->data, length
 					- FRAME_HEADER_LENGTH);
-		} else {
-			PRINTF("RX: out of slot\n");
 		}
 		break;
 	case FRAME_TYPE_MGT:
@@ -303,6 +449,9 @@ static void frame_received(uint8_t * data, uint16_t length, int8_t rssi,
 			break;
 		case MGT_DISSOCIATE:
 			slot_result = tdma_table_del(srcAddr);
+			if (slot_result != 0) {
+				downlinks[slot_result - 1].pending = 0;
+			}
 			beacon_append(srcAddr, MGT_DISSOCIATE, 1, &slot_result);
 			if (node_associated_handler) {
 				node_associated_handler(srcAddr);
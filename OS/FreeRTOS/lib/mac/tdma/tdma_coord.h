@@ -67,6 +67,9 @@ void mac_set_beacon_handler(void (*handler)(uint8_t id, uint16_t timestamp));
 
 /**
  * Send data to a node. Maximum length is 15 bytes per send.
+ * The data is piggybacked in the beacons. If the node is associated it
+ * is repeated until the node acknowledges it, and only one send per node
+ * may be pending. Otherwise (or for broadcast) it is sent once.
  * \param node the destination node address
  * \param data a pointer to the data to send
  * \param length the number of bytes to send
@@ -43,11 +43,13 @@
 #include "task.h"
 #include "queue.h"
 #include "semphr.h"
+#include "event_flags.h"
 
 /* Project Includes */
 #include "phy.h"
 #include "tdma_node.h"
 #include "tdma_common.h"
+#include "frame_pool.h"
 #include "leds.h"
 
 /* Drivers Include */
@@ -66,6 +68,10 @@
 
 #define LEDS 0
 
+// Beacons to draw the association attempt from, doubled after each lost
+// attempt up to one per slot so that a full cell still settles
+#define ASSOCIATE_WINDOW_MIN 16
+
 /* Function Prototypes */
 static void vMacTask(void* pvParameters);
 
@@ -80,6 +86,8 @@ static void beacon_search(uint16_t timeout);
 
 static void slot_wait(uint16_t slot);
 static void attach_send(void);
+static void ack_send(void);
+static int16_t slot_time_left(uint16_t length);
 
 /* static uint16_t data_send(void); */ /* unused */
 static void interpacket_wait(void);
@@ -87,17 +95,21 @@ static void interpacket_wait(void);
 static uint16_t beacon_time_evt(void);
 static uint16_t slot_time_evt(void);
 static uint16_t timeout_evt(void);
+static uint16_t event_from_isr(uint16_t evt);
 
 /* Local Variables */
-static xQueueHandle xEventQueue;
+static xEventFlagsHandle xEventFlags;
 static xQueueHandle tx_queue;
 uint16_t mac_addr;
 static uint16_t coordAddr;
-static uint16_t beacon_loss, associate_wait;
+static uint16_t beacon_loss, associate_wait, associate_window;
+static uint16_t idle_periods; // beacon periods since the last frame sent
 
 static enum mac_state state;
 
-static frame_t data_frame;
+static frame_t data_frame; // management and ACK frames
+static frame_t *tx_frame; // data frame from the queue
+FRAME_POOL_CHECK(frame_t);
 static uint16_t beacon_time;
 
 static void (*handler_beacon)(uint8_t id, uint16_t beacon) = 0x0;
@@ -108,15 +120,19 @@ static void (*handler_lost)(void) = 0x0;
 
 static uint8_t slot_dedicated;
 
+static uint8_t downlink_seq;
+static uint8_t ack_pending, ack_seq;
+
 void mac_create_task(xSemaphoreHandle xSPIMutex) {
 	// Start the PHY layer
 	phy_init(xSPIMutex, frame_received, RADIO_CHANNEL, RADIO_POWER);
 
-	// Create a frame Queue for the frames to send
-	tx_queue = xQueueCreate(MAC_TX_QUEUE_LENGTH, sizeof(frame_t));
+	// Create a Queue for the frames to send, they come from the pool
+	frame_pool_init();
+	tx_queue = xQueueCreate(MAC_TX_QUEUE_LENGTH, sizeof(frame_t*));
 
-	// Create the Event Queue
-	xEventQueue = xQueueCreate(8, sizeof(uint16_t));
+	// Create the event flags
+	xEventFlags = xEventFlagsCreate();
 
 	// Create the task
 	xTaskCreate(vMacTask, (const signed char * const ) "MAC",
@@ -124,15 +140,12 @@ void mac_create_task(xSemaphoreHandle xSPIMutex) {
 }
 
 void mac_send_command(enum mac_command cmd) {
-	uint16_t evt;
 	switch (cmd) {
 	case MAC_ASSOCIATE:
-		evt = EVENT_ASSOCIATE_REQ;
-		xQueueSendToBack(xEventQueue, &evt, 0);
+		vEventFlagsSet(xEventFlags, EVENT_ASSOCIATE_REQ);
 		break;
 	case MAC_DISASSOCIATE:
-		evt = EVENT_DISSOCIATE_REQ;
-		xQueueSendToBack(xEventQueue, &evt, 0);
+		vEventFlagsSet(xEventFlags, EVENT_DISSOCIATE_REQ);
 		break;
 	}
 }
@@ -160,10 +173,7 @@ void mac_set_data_received_handler(void(*handler)(uint8_t* data,
 }
 
 uint16_t mac_send(uint8_t* data, uint16_t length) {
-	// we need to have a dedicated frame,
-	// and static so it is not taken from the stack
-	// let's hope it is not called concurrently...
-	static frame_t frame_to_send;
+	frame_t *frame;
 
 	// Routine checks
 	if (state != STATE_ASSOCIATED) {
@@ -174,18 +184,25 @@ uint16_t mac_send(uint8_t* data, uint16_t length) {
 		return 0;
 	}
 
+	// Get a frame, each caller fills its own
+	frame = frame_pool_alloc();
+	if (frame == 0x0) {
+		return 0;
+	}
+
 	// Prepare data frame
-	hton_s(mac_addr, frame_to_send.srcAddr);
-	hton_s(coordAddr, frame_to_send.dstAddr);
-	frame_to_send.type = FRAME_TYPE_DATA;
-	memcpy(frame_to_send.data, data, length);
-	frame_to_send.length = FRAME_HEADER_LENGTH + length;
-
-	// Put frame in queue
-	if (xQueueSendToBack(tx_queue, &frame_to_send, 0) == pdTRUE) {
+	hton_s(mac_addr, frame->srcAddr);
+	hton_s(coordAddr, frame->dstAddr);
+	frame->type = FRAME_TYPE_DATA;
+	memcpy(frame->data, data, length);
+	frame->length = FRAME_HEADER_LENGTH + length;
+
+	// Give the frame to the queue, the MAC task frees it
+	if (xQueueSendToBack(tx_queue, &frame, 0) == pdTRUE) {
 		return 1;
 	}
 
+	frame_pool_free(frame);
 	return 0;
 }
 static void vMacTask(void* pvParameters) {
@@ -214,14 +231,18 @@ static void vMacTask(void* pvParameters) {
 			beacon_loss = 0;
 			block_until_event(EVENT_RX);
 			phy_idle();
-			state = STATE_ASSOCIATING;
-			associate_wait = 0;
+			// The beacon may have given the slot back already
+			if (state == STATE_BEACON_SEARCH) {
+				state = STATE_ASSOCIATING;
+				associate_wait = 0;
+				associate_window = ASSOCIATE_WINDOW_MIN;
+			}
 			break;
 
 		case STATE_ASSOCIATING:
 			block_until_event(EVENT_BEACON_TIME);
 			beacon_search(TIME_SLOT / 2);
-			if (block_until_event(EVENT_RX | EVENT_TIMEOUT) == EVENT_RX) {
+			if (block_until_event(EVENT_RX | EVENT_TIMEOUT) & EVENT_RX) {
 				timerB_unset_alarm(ALARM_TIMEOUT);
 				phy_idle();
 				if (associate_wait == 1) {
@@ -230,10 +251,10 @@ static void vMacTask(void* pvParameters) {
 					attach_send();
 				} else if ((associate_wait == 0)
 						&& (state == STATE_ASSOCIATING)) {
-					do {
-						associate_wait = rand() & 0xF;
-					} while (associate_wait > 16);
-					associate_wait += 2;
+					associate_wait = 2 + rand() % associate_window;
+					if (associate_window < SLOT_COUNT) {
+						associate_window *= 2;
+					}
 				}
 				associate_wait--;
 			} else {
@@ -250,9 +271,14 @@ static void vMacTask(void* pvParameters) {
 			// Loop on the synchronized beacon
 			block_until_event(EVENT_BEACON_TIME);
 			beacon_search(TIME_SLOT / 2);
-			if (block_until_event(EVENT_RX | EVENT_TIMEOUT) == EVENT_RX) {
+			if (block_until_event(EVENT_RX | EVENT_TIMEOUT) & EVENT_RX) {
 				timerB_unset_alarm(ALARM_TIMEOUT);
 				phy_idle();
+				// The beacon may have reclaimed the slot
+				if (state != STATE_ASSOCIATED) {
+					break;
+				}
+				idle_periods++;
 				// Set slot alarm
 				slot_wait(slot_dedicated);
 				// Wait until beginning of slot
@@ -260,38 +286,42 @@ static void vMacTask(void* pvParameters) {
 
 				// Send all data we have while we have time
 
-				while (xQueueReceive(tx_queue, &data_frame, 0) == pdTRUE) {
+				while (xQueueReceive(tx_queue, &tx_frame, 0) == pdTRUE) {
 					// There is a frame to send, check time
+					if (slot_time_left(tx_frame->length) > 0) {
+						// Piggyback the downlink acknowledgement
+						if (ack_pending) {
+							tx_frame->type |= FRAME_ACK_FLAG | FRAME_ACK_SEQ(
+									ack_seq);
+							ack_pending = 0;
+						}
 
-					int16_t time_to_max;
-
-					// Get next slot time
-					time_to_max = (beacon_time + (slot_dedicated + 1)
-							* TIME_SLOT);
-					// Remove interpacket and estimate pkt duration
-					time_to_max -= phy_get_estimate_tx_duration(
-						data_frame.length) + TIME_INTERPACKET;
-
-					//time_to_max -= phy_get_max_tx_duration() + TIME_INTERPACKET;
-
-					// Remove actual time
-					time_to_max -= timerB_time();
-
-					// Check not too late
-					if (time_to_max > 0) {
 						// Send frame
-						phy_send(data_frame.raw, data_frame.length, 0);
+						phy_send(tx_frame->raw, tx_frame->length, 0);
+						frame_pool_free(tx_frame);
+						idle_periods = 0;
 
 						// Wait interpacket
 						interpacket_wait();
 						block_until_event(EVENT_TIMEOUT);
 					} else {
 						// Too late, put the frame back in queue
-						xQueueSendToFront(tx_queue, &data_frame, 0);
+						if (xQueueSendToFront(tx_queue, &tx_frame, 0) != pdTRUE) {
+							frame_pool_free(tx_frame);
+						}
 						// Stop the loop
 						break;
 					}
 				}
+
+				// No data frame carried the acknowledgement, send it alone,
+				// or keep the slot lease of an idle node
+				if ((ack_pending || (idle_periods >= TDMA_KEEPALIVE_PERIODS))
+						&& (slot_time_left(FRAME_HEADER_LENGTH) > 0)) {
+					ack_send();
+					interpacket_wait();
+					block_until_event(EVENT_TIMEOUT);
+				}
 				phy_idle();
 
 			} else {
@@ -380,12 +410,32 @@ static void frame_received(uint8_t * data, uint16_t length, int8_t rssi,
 		beacon_length = *beacon_data_ptr >> 4; // high 4 bits
 		beacon_data_ptr++;
 
-		if (dst == mac_addr || dst == 0xFFFF) {
+		if ((dst == mac_addr) && (beacon_type & MGT_DOWNLINK)) {
+			if (state == STATE_ASSOCIATED) {
+				// Deliver only once, but acknowledge every copy
+				if ((beacon_type & MGT_DOWNLINK_SEQ_MASK) != downlink_seq) {
+					downlink_seq = beacon_type & MGT_DOWNLINK_SEQ_MASK;
+					if (handler_rx) {
+						handler_rx(beacon_data_ptr, beacon_length);
+					}
+				}
+				ack_seq = beacon_type & MGT_DOWNLINK_SEQ_MASK;
+				ack_pending = 1;
+			}
+		} else if (dst == mac_addr || dst == 0xFFFF) {
 			switch (beacon_type) {
 			case MGT_ASSOCIATE:
-				if (beacon_length == 1) {
+				if ((beacon_length == 1) && (state == STATE_ASSOCIATED)
+						&& (slot_dedicated == *beacon_data_ptr)) {
+					// A restarted coordinator gives the slot back until it
+					// hears the node, send a keepalive in the next slot
+					idle_periods = TDMA_KEEPALIVE_PERIODS;
+				} else if (beacon_length == 1) {
 					slot_dedicated = *beacon_data_ptr;
 					state = STATE_ASSOCIATED;
+					downlink_seq = 0xFF;
+					ack_pending = 0;
+					idle_periods = 0;
 					if (handler_asso) {
 						handler_asso();
 					}
@@ -400,6 +450,18 @@ static void frame_received(uint8_t * data, uint16_t length, int8_t rssi,
 					}
 				}
 				break;
+			case MGT_RECLAIM:
+				// Lost the slot, associate again
+				if ((dst == mac_addr) && (state == STATE_ASSOCIATED)) {
+					slot_dedicated = 0;
+					state = STATE_ASSOCIATING;
+					associate_wait = 0;
+					associate_window = ASSOCIATE_WINDOW_MIN;
+					if (handler_lost) {
+						handler_lost();
+					}
+				}
+				break;
 			case MGT_DATA:
 				if (handler_rx) {
 					handler_rx(beacon_data_ptr, beacon_length);
@@ -412,8 +474,7 @@ static void frame_received(uint8_t * data, uint16_t length, int8_t rssi,
 		beacon_data_ptr += beacon_length;
 	}
 
-	uint16_t event = EVENT_RX;
-	xQueueSendToBack(xEventQueue, &event, 0);
+	vEventFlagsSet(xEventFlags, EVENT_RX);
 
 	if ((state == STATE_ASSOCIATED) && handler_beacon) {
 		handler_beacon(frame->beacon_id, beacon_time);
@@ -473,42 +534,56 @@ static void attach_send(void) {
 	data_frame.length = 0;
 }
 
+static void ack_send(void) {
+	// Prepare a data frame with no payload
+	hton_s(mac_addr, data_frame.srcAddr);
+	hton_s(coordAddr, data_frame.dstAddr);
+	data_frame.type = FRAME_TYPE_DATA;
+	if (ack_pending) {
+		data_frame.type |= FRAME_ACK_FLAG | FRAME_ACK_SEQ(ack_seq);
+	}
+	ack_pending = 0;
+	idle_periods = 0;
+
+	phy_send(data_frame.raw, FRAME_HEADER_LENGTH, 0);
+
+	data_frame.length = 0;
+}
+
+static int16_t slot_time_left(uint16_t length) {
+	int16_t time_to_max;
+
+	// Get next slot time
+	time_to_max = (beacon_time + (slot_dedicated + 1) * TIME_SLOT);
+	// Remove interpacket and estimate pkt duration
+	time_to_max -= phy_get_estimate_tx_duration(length) + TIME_INTERPACKET;
+	// Remove actual time
+	time_to_max -= timerB_time();
+
+	return time_to_max;
+}
+
 static void interpacket_wait(void) {
 	timerB_set_alarm_from_now(ALARM_TIMEOUT, TIME_INTERPACKET, 0);
 	timerB_register_cb(ALARM_TIMEOUT, timeout_evt);
 }
 
 static uint16_t beacon_time_evt(void) {
-	const uint16_t evt = EVENT_BEACON_TIME;
-	portBASE_TYPE wakeup = pdFALSE;
-
-	xQueueSendFromISR(xEventQueue, &evt, &wakeup);
-
-	// wake-up if needed
-	if (wakeup == pdTRUE) {
-		taskYIELD();
-	}
-	return 1;
+	return event_from_isr(EVENT_BEACON_TIME);
 }
 
 static uint16_t slot_time_evt(void) {
-	const uint16_t evt = EVENT_SLOT_TIME;
-	portBASE_TYPE wakeup = pdFALSE;
-
-	xQueueSendFromISR(xEventQueue, &evt, &wakeup);
-
-	// wake-up if needed
-	if (wakeup == pdTRUE) {
-		taskYIELD();
-	}
-	return 1;
+	return event_from_isr(EVENT_SLOT_TIME);
 }
 
 static uint16_t timeout_evt(void) {
-	const uint16_t evt = EVENT_TIMEOUT;
+	return event_from_isr(EVENT_TIMEOUT);
+}
+
+static uint16_t event_from_isr(uint16_t evt) {
 	portBASE_TYPE wakeup = pdFALSE;
 
-	xQueueSendFromISR(xEventQueue, &evt, &wakeup);
+	xEventFlagsSetFromISR(xEventFlags, evt, &wakeup);
 
 	// wake-up if needed
 	if (wakeup == pdTRUE) {
@@ -519,11 +594,12 @@ static uint16_t timeout_evt(void) {
 
 static uint16_t block_until_event(uint16_t mask) {
 	uint16_t evt;
-	do {
-		xQueueReceive(xEventQueue, &evt, portMAX_DELAY);
-		if ((evt & mask) != evt) {
-			PRINTF("D%xM%xS%u\n", evt, mask, state);
-		}
-	} while ((evt & mask) != evt);
-	return evt;
+
+	// Drop the events that came while nobody waited for them
+	evt = uxEventFlagsClear(xEventFlags, ~mask) & ~mask;
+	if (evt) {
+		PRINTF("D%xM%xS%u\n", evt, mask, state);
+	}
+
+	return uxEventFlagsWait(xEventFlags, mask, pdTRUE, portMAX_DELAY);
 }
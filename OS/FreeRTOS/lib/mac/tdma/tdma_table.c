@@ -35,46 +35,298 @@
 
 
 #include <io.h>
+#include <string.h>
 #include "tdma_common.h"
 #include "tdma_table.h"
+#if TDMA_TABLE_FLASH
+#include "m25p80.h"
+#endif
 
-static uint16_t table[SLOT_COUNT];
+#if (TDMA_TABLE_HASH & (TDMA_TABLE_HASH - 1)) || (TDMA_TABLE_HASH <= SLOT_COUNT)
+#error "TDMA_TABLE_HASH must be a power of 2 above SLOT_COUNT"
+#endif
+
+#define HASH_MASK (TDMA_TABLE_HASH - 1)
+
+static uint16_t table[SLOT_COUNT]; // node of each slot, 0 if free
+static uint16_t lease[SLOT_COUNT]; // beacon periods left
+static uint8_t restored[SLOT_COUNT]; // 1 until heard after a restore
+static uint8_t hash[TDMA_TABLE_HASH]; // slot of each node, 0 if free
+static uint8_t free_slots[SLOT_COUNT]; // stack, lowest slot on top
+static uint8_t free_count;
+static uint8_t dirty;
+
+static uint16_t hash_home(uint16_t node) {
+	// Multiplicative hash, folded to keep its high bits
+	uint16_t h = node * 40503u;
+
+	return (h ^ (h >> 8)) & HASH_MASK;
+}
+
+static uint16_t hash_find(uint16_t node) {
+	uint16_t i = hash_home(node);
+
+	// There is always a free entry, the probe ends
+	while (hash[i] && (table[hash[i] - 1] != node)) {
+		i = (i + 1) & HASH_MASK;
+	}
+	return i;
+}
+
+static void hash_remove(uint16_t i) {
+	uint16_t j, home;
+
+	// Shift back the entries whose probe went through the hole
+	hash[i] = 0;
+	for (j = (i + 1) & HASH_MASK; hash[j]; j = (j + 1) & HASH_MASK) {
+		home = hash_home(table[hash[j] - 1]);
+		// the entry stays if its home is cyclically within (i, j]
+		if ((i <= j) ? ((i < home) && (home <= j)) : ((i < home) || (home
+				<= j))) {
+			continue;
+		}
+		hash[i] = hash[j];
+		hash[j] = 0;
+		i = j;
+	}
+}
+
+static void slot_free(uint8_t slot) {
+	hash_remove(hash_find(table[slot - 1]));
+	table[slot - 1] = 0x0;
+	free_slots[free_count++] = slot;
+	dirty = 1;
+}
+
+static void slot_take(uint16_t i, uint8_t slot, uint16_t node) {
+	table[slot - 1] = node;
+	lease[slot - 1] = TDMA_LEASE_PERIODS;
+	restored[slot - 1] = 0;
+	hash[i] = slot;
+}
 
 void tdma_table_clear(void) {
 	int16_t i;
 	for (i = 0; i < SLOT_COUNT; i++) {
 		table[i] = 0x0;
+		free_slots[i] = SLOT_COUNT - i;
 	}
+	memset(hash, 0, sizeof(hash));
+	free_count = SLOT_COUNT;
+	dirty = 1;
 }
 
 uint8_t tdma_table_add(uint16_t node) {
-	int16_t i;
-	for (i = 0; i < SLOT_COUNT; i++) {
-		if ((table[i] == 0x0) || (table[i] == node)) {
-			table[i] = node;
-			return i+1;
-		}
+	uint16_t i;
+	uint8_t slot;
+
+	i = hash_find(node);
+	if (hash[i]) {
+		// Already there, it keeps its slot
+		slot = hash[i];
+	} else if (free_count) {
+		slot = free_slots[--free_count];
+		dirty = 1;
+	} else {
+		return 0;
 	}
-	return 0;
+
+	slot_take(i, slot, node);
+	return slot;
 }
 
 uint8_t tdma_table_del(uint16_t node) {
-	int16_t i;
-	for (i = 0; i < SLOT_COUNT; i++) {
-		if (table[i] == node) {
-			table[i] = 0x0;
-			return i+1;
-		}
+	uint8_t slot = hash[hash_find(node)];
+
+	if (slot) {
+		slot_free(slot);
 	}
-	return 0;
+	return slot;
 }
 
 uint16_t tdma_table_pos(uint16_t node) {
-	int16_t i;
+	return hash[hash_find(node)];
+}
+
+uint16_t tdma_table_node(uint8_t slot) {
+	return table[slot - 1];
+}
+
+void tdma_table_heard(uint8_t slot) {
+	lease[slot - 1] = TDMA_LEASE_PERIODS;
+	restored[slot - 1] = 0;
+}
+
+uint8_t tdma_table_confirmed(uint8_t slot) {
+	return !restored[slot - 1];
+}
+
+uint8_t tdma_table_expire(uint16_t* node) {
+	uint16_t i;
+	uint8_t slot = 0;
+
 	for (i = 0; i < SLOT_COUNT; i++) {
-		if (table[i] == node) {
-			return i+1;
+		if (table[i] == 0x0) {
+			continue;
+		}
+		if (lease[i]) {
+			lease[i]--;
+		} else if (slot == 0) {
+			slot = i + 1;
 		}
 	}
+
+	if (slot) {
+		*node = table[slot - 1];
+		slot_free(slot);
+	}
+	return slot;
+}
+
+#if TDMA_TABLE_FLASH
+
+#if 8 + 2 * SLOT_COUNT > M25P80_PAGE_SIZE
+#error "The table snapshot must fit in a M25P80 page"
+#endif
+
+#define SNAPSHOT_MAGIC 0x7D3A
+#define SNAPSHOT_PAGES (2 * M25P80_SECTOR_SIZE)
+#define SNAPSHOT_ADDR(page) \
+	(((uint32_t) TDMA_TABLE_SECTOR * M25P80_SECTOR_SIZE + (page)) << 8)
+
+typedef struct {
+	uint16_t magic;
+	uint16_t seq; // the highest is the latest snapshot
+	uint16_t nodes[SLOT_COUNT];
+	uint16_t slot_count;
+	uint16_t check;
+} snapshot_t;
+
+static snapshot_t snapshot;
+static uint16_t snapshot_seq;
+static uint16_t snapshot_page; // next page to write
+static uint8_t flash_ok, sector_erased;
+
+static uint16_t snapshot_check(void) {
+	uint16_t *w = (uint16_t*) (void*) &snapshot;
+	uint16_t sum = 0, n;
+
+	for (n = 0; n < sizeof(snapshot_t) / 2 - 1; n++) {
+		sum = ((sum << 1) | (sum >> 15)) + w[n];
+	}
+	return ~sum;
+}
+
+static uint16_t snapshot_read(uint16_t page) {
+	m25p80_read(SNAPSHOT_ADDR(page), (uint8_t*) &snapshot, 4);
+	if (snapshot.magic != SNAPSHOT_MAGIC) {
+		return 0;
+	}
+
+	m25p80_read(SNAPSHOT_ADDR(page), (uint8_t*) &snapshot,
+			sizeof(snapshot_t));
+	return (snapshot.slot_count == SLOT_COUNT) && (snapshot.check
+			== snapshot_check());
+}
+
+uint16_t tdma_table_load(void) {
+	uint16_t page, latest = SNAPSHOT_PAGES, count = 0;
+	uint8_t slot;
+
+	tdma_table_clear();
+
+	flash_ok = (m25p80_init() == 0x13);
+	if (!flash_ok) {
+		return 0;
+	}
+
+	for (page = 0; page < SNAPSHOT_PAGES; page++) {
+		if (snapshot_read(page) && ((latest == SNAPSHOT_PAGES)
+				|| ((int16_t) (snapshot.seq - snapshot_seq) > 0))) {
+			latest = page;
+			snapshot_seq = snapshot.seq;
+		}
+	}
+
+	if (latest == SNAPSHOT_PAGES) {
+		// Nothing saved, start from a freshly erased sector
+		snapshot_seq = 0;
+		snapshot_page = 0;
+		sector_erased = 0;
+		return 0;
+	}
+
+	snapshot_read(latest);
+	free_count = 0;
+	for (slot = SLOT_COUNT; slot > 0; slot--) {
+		if (snapshot.nodes[slot - 1] && !hash[hash_find(
+				snapshot.nodes[slot - 1])]) {
+			slot_take(hash_find(snapshot.nodes[slot - 1]), slot,
+					snapshot.nodes[slot - 1]);
+			restored[slot - 1] = 1;
+			count++;
+		} else {
+			free_slots[free_count++] = slot;
+		}
+	}
+	dirty = 0;
+
+	// Append after the latest snapshot, or in the other sector if its
+	// next page was not left erased
+	snapshot_page = (latest + 1) % SNAPSHOT_PAGES;
+	sector_erased = (snapshot_page % M25P80_SECTOR_SIZE) != 0;
+	m25p80_read(SNAPSHOT_ADDR(snapshot_page), (uint8_t*) &snapshot, 2);
+	if (sector_erased && (snapshot.magic != 0xFFFF)) {
+		snapshot_page = (snapshot_page + M25P80_SECTOR_SIZE)
+				& ~(M25P80_SECTOR_SIZE - 1) & (SNAPSHOT_PAGES - 1);
+		sector_erased = 0;
+	}
+
+	return count;
+}
+
+uint16_t tdma_table_sync(void) {
+	uint16_t i;
+
+	if (!flash_ok || !dirty || (m25p80_get_state() & M25P80_STATE_WIP)) {
+		return 0;
+	}
+
+	if (!sector_erased) {
+		// The other sector keeps the latest snapshot meanwhile
+		m25p80_erase_sector_start(TDMA_TABLE_SECTOR + snapshot_page
+				/ M25P80_SECTOR_SIZE);
+		sector_erased = 1;
+		return 0;
+	}
+
+	// A change while copying sets it again, it is saved next time
+	dirty = 0;
+
+	snapshot.magic = SNAPSHOT_MAGIC;
+	snapshot.seq = ++snapshot_seq;
+	for (i = 0; i < SLOT_COUNT; i++) {
+		snapshot.nodes[i] = table[i];
+	}
+	snapshot.slot_count = SLOT_COUNT;
+	snapshot.check = snapshot_check();
+	m25p80_write(SNAPSHOT_ADDR(snapshot_page), (uint8_t*) &snapshot,
+			sizeof(snapshot_t));
+
+	snapshot_page = (snapshot_page + 1) % SNAPSHOT_PAGES;
+	sector_erased = (snapshot_page % M25P80_SECTOR_SIZE) != 0;
+	return 1;
+}
+
+#else
+
+uint16_t tdma_table_load(void) {
+	tdma_table_clear();
 	return 0;
 }
+
+uint16_t tdma_table_sync(void) {
+	return 0;
+}
+
+#endif
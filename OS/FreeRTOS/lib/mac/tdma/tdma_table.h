@@ -34,13 +34,104 @@
  */
 
 
+/**
+ * \file
+ * \brief Slot table of the TDMA coordinator
+ *
+ * The node of a slot is read from an array, the slot of a node from a
+ * hash table with linear probing, so both lookups are O(1).
+ *
+ * Each slot has a lease, renewed when its node is heard and decremented
+ * every beacon period, the slot is reclaimed when it runs out.
+ *
+ * The table may be saved in the M25P80 flash, one snapshot per page in
+ * two sectors used in turn, so that a restarted coordinator gives the
+ * nodes their slots back.
+ */
+
 #ifndef TDMA_TABLE_H_
 #define TDMA_TABLE_H_
 
+#include "tdma_common.h"
+
+/**
+ * Number of hash table entries, a power of 2 above SLOT_COUNT.
+ * Twice as many keeps the probe sequences short.
+ */
+#ifndef TDMA_TABLE_HASH
+#if SLOT_COUNT <= 8
+#define TDMA_TABLE_HASH 16
+#elif SLOT_COUNT <= 32
+#define TDMA_TABLE_HASH 64
+#else
+#define TDMA_TABLE_HASH 256
+#endif
+#endif
+
+/**
+ * Keep the table snapshots in the M25P80 flash, 0 to keep the table in
+ * RAM only.
+ */
+#ifndef TDMA_TABLE_FLASH
+#ifdef __MDS__
+#define TDMA_TABLE_FLASH 0
+#else
+#define TDMA_TABLE_FLASH 1
+#endif
+#endif
+
+/**
+ * First of the two M25P80 sectors holding the snapshots.
+ */
+#ifndef TDMA_TABLE_SECTOR
+#define TDMA_TABLE_SECTOR 14
+#endif
+
 void tdma_table_clear(void);
 uint8_t tdma_table_add(uint16_t node);
 uint8_t tdma_table_del(uint16_t node);
 
 uint16_t tdma_table_pos(uint16_t node);
 
+/**
+ * Get the node of a slot.
+ * \return the node address, 0 if the slot is free
+ */
+uint16_t tdma_table_node(uint8_t slot);
+
+/**
+ * Renew the lease of a slot, its node was heard.
+ */
+void tdma_table_heard(uint8_t slot);
+
+/**
+ * Check whether the node of a slot was heard since it was restored
+ * from the flash.
+ * \return 0 if the node was restored and not heard yet
+ */
+uint8_t tdma_table_confirmed(uint8_t slot);
+
+/**
+ * Age the leases, to be called once per beacon period. At most one slot
+ * is reclaimed per call, the next calls reclaim the other ones.
+ * \param node where to write the node of the reclaimed slot
+ * \return the reclaimed slot, 0 if none
+ */
+uint8_t tdma_table_expire(uint16_t* node);
+
+/**
+ * Restore the latest snapshot saved in the flash, or clear the table
+ * if there is none. The M25P80 and its SPI are initialized here.
+ * \return the number of restored nodes
+ */
+uint16_t tdma_table_load(void);
+
+/**
+ * Save the table in the flash if it changed since the last snapshot.
+ * Nothing is done while a sector erase is going on, it only starts
+ * the erase when a new sector is needed.
+ * \return 1 if a snapshot was written, 0 otherwise
+ */
+uint16_t tdma_table_sync(void);
+
 #endif /* TDMA_TABLE_H_ */
@@ -43,6 +43,13 @@
 #define MAC_BROADCAST_ADDR 0xFFFF
 #define MAC_TX_QUEUE_LENGTH 6
 
+/**
+ * Maximum number of frames sent back to back after the first one, once
+ * the destination is awake.
+ */
+#ifndef MAC_BURST_MAX
+#define MAC_BURST_MAX MAC_TX_QUEUE_LENGTH
+#endif
 
 
 typedef void (*mac_rx_callback_t)(uint16_t src_addr, uint8_t* data,
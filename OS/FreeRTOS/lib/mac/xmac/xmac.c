@@ -47,6 +47,7 @@
 /* Project Includes */
 #include "mac.h"
 #include "phy.h"
+#include "frame_pool.h"
 #include "leds.h"
 
 /* Drivers Include */
@@ -54,12 +55,13 @@
 #include "timerB.h"
 
 enum {
-	HEADER_LENGTH = 5, MAX_PAYLOAD_LENGTH = 120
+	HEADER_LENGTH = 5, ACK_LENGTH = 6, MAX_PAYLOAD_LENGTH = 120
 };
 
 enum {
-	FRAME_TYPE_PREAMB = 0x1, FRAME_TYPE_ACK = 0x2, FRAME_TYPE_DATA = 0x3
-
+	FRAME_TYPE_PREAMB = 0x1, FRAME_TYPE_ACK = 0x2, FRAME_TYPE_DATA = 0x3,
+	FRAME_TYPE_MASK = 0x7F,
+	FRAME_MORE_DATA = 0x80 // data only, another data frame follows
 };
 
 enum {
@@ -72,13 +74,36 @@ enum {
 
 // XMAC time constants
 enum {
-	RECEIVER_WAKEUP_PERIOD = 32768 * 128 / 1000, // 128ms
+	RECEIVER_WAKEUP_PERIOD_MIN = 32768 * 64 / 1000, // 64ms
 	RECEIVER_WAKEUP_DURATION = 32768 * 6 / 1000, // 6ms
 	SENDER_PREAMBLE_TX_DURATION = 32768 * 2 / 1000, // 2ms
 	SENDER_ACK_RX_DURATION = 32768 * 4 / 1000, // 4ms
 	RECEIVER_DATA_RX_DURATION = 32768 * 15 / 1000, // 15ms
 	SENDER_INTERPACKET_DURATION = 32768 * 1 / 1000, // 1ms
 };
+
+/*
+ * Adaptive wake-up period: the receiver wakes up every
+ * RECEIVER_WAKEUP_PERIOD_MIN << wakeup_level. The level grows by one every
+ * ADAPT_PERIOD without traffic and is halved each time a frame is sent or
+ * received. It is advertised in the preamble ACKs, so that the senders
+ * only send preambles for as long as the destination may sleep.
+ */
+#ifndef WAKEUP_LEVEL_MAX
+#define WAKEUP_LEVEL_MAX 4 // 1s
+#endif
+#if WAKEUP_LEVEL_MAX > 4
+#error "WAKEUP_LEVEL_MAX too big, the wake-up period would overflow timerB"
+#endif
+#ifndef ADAPT_PERIOD
+#define ADAPT_PERIOD configTICK_RATE_HZ // 1s
+#endif
+#define RECEIVER_WAKEUP_PERIOD_MAX ((uint16_t) RECEIVER_WAKEUP_PERIOD_MIN << WAKEUP_LEVEL_MAX)
+
+// number of neighbours whose wake-up level is remembered
+#ifndef NEIGHBOUR_MAX
+#define NEIGHBOUR_MAX 8
+#endif
 typedef union frame {
 	uint8_t data[HEADER_LENGTH + MAX_PAYLOAD_LENGTH + 1];
 	struct {
@@ -89,17 +114,24 @@ typedef union frame {
 		uint8_t length;
 	};
 } frame_t;
+FRAME_POOL_CHECK(frame_t);
 
 typedef union frame_small {
-	uint8_t data[HEADER_LENGTH + 1];
+	uint8_t data[ACK_LENGTH + 1];
 	struct {
 		uint8_t type;
 		uint8_t dst_addr[2];
 		uint8_t src_addr[2];
+		uint8_t level; // ACK only
 		uint8_t length;
 	};
 } frame_small_t;
 
+typedef struct {
+	uint16_t addr;
+	uint16_t level;
+} neighbour_t;
+
 /* Function Prototypes */
 static void mac_task(void* param);
 static uint16_t wait_until(uint16_t mask);
@@ -112,9 +144,16 @@ static uint16_t sender_tx_first_preamble(void);
 static void sender_wait_tx(void);
 static void sender_tx_preamble(void);
 static void receiver_send_ack(void);
-static void sender_tx_data(void);
+static void sender_tx_data(uint16_t dst);
+static frame_t* sender_next_frame(uint16_t dst);
+static void sender_wait_interpacket(void);
 static uint16_t sender_handle_ack(void);
 static uint16_t receiver_handle_frame(void);
+static void adapt(void);
+static void traffic_seen(void);
+static void neighbour_update(uint16_t addr, uint16_t level);
+static void neighbour_forget(uint16_t addr);
+static uint16_t neighbour_period(uint16_t addr);
 
 static void frame_received_cb(uint8_t * data, uint16_t length, int8_t rssi,
 		uint16_t time);
@@ -127,20 +166,29 @@ static uint16_t timeout(void);
 /* Local Variables */
 static xQueueHandle tx_queue, event_queue;
 static mac_rx_callback_t received_cb;
-static frame_t frame_to_send, frame_to_queue, frame_received;
+static frame_t *frame_to_send, frame_received;
 static frame_small_t frame_small;
 uint16_t mac_addr;
 static uint16_t frame_received_dst, frame_received_src;
 static int8_t frame_received_rssi;
 static uint8_t keep_rx;
+static uint8_t tx_pending; // an EVENT_TX came while not wanted
+
+/* Wake-up period adaptation */
+static uint16_t wakeup_level;
+static uint8_t traffic;
+static portTickType adapt_time;
+static neighbour_t neighbours[NEIGHBOUR_MAX];
+static uint16_t neighbour_next;
 
 void mac_init(xSemaphoreHandle spi_mutex, mac_rx_callback_t rx_cb,
 		uint8_t channel) {
 	// Initialize the PHY layer
 	phy_init(spi_mutex, frame_received_cb, channel, MAC_TX_POWER);
 
-	// Create a frame queue for the frames to send
-	tx_queue = xQueueCreate(MAC_TX_QUEUE_LENGTH, sizeof(frame_t));
+	// Create a queue for the frames to send, they come from the pool
+	frame_pool_init();
+	tx_queue = xQueueCreate(MAC_TX_QUEUE_LENGTH, sizeof(frame_t*));
 
 	// Create a frame queue for the events
 	event_queue = xQueueCreate(8, sizeof(uint16_t));
@@ -153,24 +201,33 @@ void mac_init(xSemaphoreHandle spi_mutex, mac_rx_callback_t rx_cb,
 }
 
 uint16_t mac_send(uint16_t dest_addr, uint8_t* data, uint16_t length) {
+	frame_t *frame;
+
 	// check the packet length
 	if (length > MAX_PAYLOAD_LENGTH) {
 		return 0;
 	}
 
+	// get a frame
+	frame = frame_pool_alloc();
+	if (frame == 0x0) {
+		return 0;
+	}
+
 	// compute the frame
-	frame_to_queue.length = length + HEADER_LENGTH;
-	frame_to_queue.type = FRAME_TYPE_DATA;
-	frame_to_queue.dst_addr[0] = dest_addr >> 8;
-	frame_to_queue.dst_addr[1] = dest_addr & 0xFF;
-	frame_to_queue.src_addr[0] = mac_addr >> 8;
-	frame_to_queue.src_addr[1] = mac_addr & 0xFF;
+	frame->length = length + HEADER_LENGTH;
+	frame->type = FRAME_TYPE_DATA;
+	frame->dst_addr[0] = dest_addr >> 8;
+	frame->dst_addr[1] = dest_addr & 0xFF;
+	frame->src_addr[0] = mac_addr >> 8;
+	frame->src_addr[1] = mac_addr & 0xFF;
 
 	// copy the packet
-	memcpy(frame_to_queue.payload, data, length);
+	memcpy(frame->payload, data, length);
 
-	// try to send the frame to the queue
-	if (!xQueueSendToBack(tx_queue, &frame_to_queue, 0)) {
+	// try to give the frame to the queue, the MAC task frees it
+	if (!xQueueSendToBack(tx_queue, &frame, 0)) {
+		frame_pool_free(frame);
 		return 0;
 	}
 
@@ -182,7 +239,7 @@ uint16_t mac_send(uint16_t dest_addr, uint8_t* data, uint16_t length) {
 }
 
 static void mac_task(void* param) {
-	uint16_t event;
+	uint16_t event, more;
 
 	// Set the node MAC address
 	init();
@@ -198,10 +255,13 @@ static void mac_task(void* param) {
 			//			keep_rx--;
 			// Stay in RX, set timeout
 			timerB_set_alarm_from_now(TIMERB_ALARM_CCR0,
-					RECEIVER_WAKEUP_PERIOD, 0);
+					RECEIVER_WAKEUP_PERIOD_MAX, 0);
 			timerB_register_cb(TIMERB_ALARM_CCR0, timeout);
 
 		} else {
+			// Update the wake-up period
+			adapt();
+
 			// Set Idle and RX timeout for one sleep period
 			receiver_idle();
 
@@ -215,10 +275,14 @@ static void mac_task(void* param) {
 				}
 				sender_rx_ack();
 
+				uint16_t dst = ((uint16_t) frame_to_send->dst_addr[0]) << 8;
+				dst += frame_to_send->dst_addr[1];
+				uint16_t period = neighbour_period(dst);
+				uint16_t acked = 0;
 				uint16_t start = timerB_time();
 
 				// CCA is clear, let's send!
-				while (timerB_time() - start < RECEIVER_WAKEUP_PERIOD) {
+				while ((uint16_t) (timerB_time() - start) < period) {
 					sender_wait_tx();
 					event = wait_until(EVENT_TX_TIME | EVENT_RX);
 					if (event == EVENT_TX_TIME) {
@@ -226,21 +290,25 @@ static void mac_task(void* param) {
 					} else {
 						// Handle the received frame
 						if (sender_handle_ack()) {
+							acked = 1;
 							break;
 						}
 					}
 				}
+				if (!acked && dst != MAC_BROADCAST_ADDR) {
+					// The destination may sleep longer than we thought
+					neighbour_forget(dst);
+				}
 				// We're if the ACK has been received from the destination node,
 				// or if we have sent all our preamble frames
-				if (frame_to_send.dst_addr[0] == 0xFF
-						&& frame_to_send.dst_addr[1] == 0xFF) {
-					start = timerB_time();
-					while (timerB_time()-start < SENDER_INTERPACKET_DURATION) {
-						nop();
-					}
-
+				if (frame_to_send->dst_addr[0] == 0xFF
+						&& frame_to_send->dst_addr[1] == 0xFF) {
+					sender_wait_interpacket();
 				}
-				sender_tx_data();
+
+				// Send the frame, and the next ones for an awake destination
+				sender_tx_data(acked ? dst : MAC_BROADCAST_ADDR);
+				traffic_seen();
 				// OK, tx done
 				continue;
 			}
@@ -272,16 +340,21 @@ static void mac_task(void* param) {
 
 			if (frame_received_dst == mac_addr) {
 				frame_received.length = 0;
+				traffic_seen();
 
 				// For me! Send an ACK
 				receiver_send_ack();
 
-				// Set RX for data RX
-				receiver_rx_data();
+				// Set RX for data RX, again while the sender has more
+				do {
+					receiver_rx_data();
+
+					// Wait for RX  or RX timeout
+					event = wait_until(EVENT_RX | EVENT_TIMEOUT);
+					if (event != EVENT_RX) {
+						break;
+					}
 
-				// Wait for RX  or RX timeout
-				event = wait_until(EVENT_RX | EVENT_TIMEOUT);
-				if (event == EVENT_RX) {
 					// Compute src/dst
 					frame_received_dst
 							= ((uint16_t) frame_received.dst_addr[0]) << 8;
@@ -291,7 +364,9 @@ static void mac_task(void* param) {
 					frame_received_src += frame_received.src_addr[1];
 
 					// Check frame
+					more = 0;
 					if (receiver_handle_frame() == FRAME_TYPE_DATA) {
+						more = frame_received.type & FRAME_MORE_DATA;
 						if (received_cb) {
 							received_cb(frame_received_src,
 									frame_received.payload,
@@ -299,7 +374,7 @@ static void mac_task(void* param) {
 						}
 					}
 					frame_received.length = 0;
-				}
+				} while (more);
 
 			} else if (frame_received_dst == MAC_BROADCAST_ADDR) {
 				frame_received.length = 0;
@@ -308,6 +383,7 @@ static void mac_task(void* param) {
 			}
 			break;
 		case FRAME_TYPE_DATA:
+			traffic_seen();
 			if (received_cb) {
 				received_cb(frame_received_src, frame_received.payload,
 						frame_received.length - HEADER_LENGTH, frame_received_rssi);
@@ -324,14 +400,20 @@ static void mac_task(void* param) {
 static uint16_t wait_until(uint16_t mask) {
 	uint16_t event;
 
+	if ((mask & EVENT_TX) && tx_pending) {
+		tx_pending = 0;
+		return EVENT_TX;
+	}
+
 	do {
 		if (xQueueReceive(event_queue, &event, portMAX_DELAY) != pdTRUE) {
 			continue;
 		}
 
-		// if TX received, but not wanted, put event back in queue for later
+		// if TX received, but not wanted, keep it for later, putting it back
+		// in the queue would spin until the wanted event comes
 		if ((event == EVENT_TX) && ((mask & EVENT_TX) == 0)) {
-			xQueueSendToBack(event_queue, &event, 0);
+			tx_pending = 1;
 		}
 
 		// if RX received, but not wanted, discard frame
@@ -356,8 +438,18 @@ static void init() {
 	timerB_start_ACLK_div(TIMERB_DIV_1);
 
 	keep_rx = 0;
+	tx_pending = 0;
 
 	frame_received.length = 0;
+
+	// Start with the shortest wake-up period
+	wakeup_level = 0;
+	traffic = 0;
+	adapt_time = xTaskGetTickCount();
+	for (neighbour_next = 0; neighbour_next < NEIGHBOUR_MAX; neighbour_next++) {
+		neighbours[neighbour_next].level = WAKEUP_LEVEL_MAX;
+	}
+	neighbour_next = 0;
 }
 
 static void receiver_idle() {
@@ -365,8 +457,8 @@ static void receiver_idle() {
 	phy_idle();
 
 	// Set RX time
-	timerB_set_alarm_from_now(TIMERB_ALARM_CCR0, RECEIVER_WAKEUP_PERIOD
-			- RECEIVER_WAKEUP_DURATION, 0);
+	timerB_set_alarm_from_now(TIMERB_ALARM_CCR0, ((uint16_t) RECEIVER_WAKEUP_PERIOD_MIN
+			<< wakeup_level) - RECEIVER_WAKEUP_DURATION, 0);
 	timerB_register_cb(TIMERB_ALARM_CCR0, rx_time);
 }
 
@@ -421,13 +513,15 @@ static uint16_t sender_tx_first_preamble() {
 	frame_small.src_addr[0] = mac_addr >> 8;
 	frame_small.src_addr[1] = mac_addr;
 
-	frame_small.dst_addr[0] = frame_to_send.dst_addr[0];
-	frame_small.dst_addr[1] = frame_to_send.dst_addr[1];
+	frame_small.dst_addr[0] = frame_to_send->dst_addr[0];
+	frame_small.dst_addr[1] = frame_to_send->dst_addr[1];
 
 	if (phy_send_cca(frame_small.data, frame_small.length, 0x0)) {
 		return 1;
 	}
 
+	// Channel busy, the frame is dropped
+	frame_pool_free(frame_to_send);
 	return 0;
 }
 
@@ -444,18 +538,75 @@ static void receiver_send_ack() {
 	// Start PHY RX for Data
 	phy_rx();
 
-	frame_small.length = HEADER_LENGTH;
+	frame_small.length = ACK_LENGTH;
 	frame_small.dst_addr[0] = frame_received.src_addr[0];
 	frame_small.dst_addr[1] = frame_received.src_addr[1];
 	frame_small.src_addr[0] = mac_addr >> 8;
 	frame_small.src_addr[1] = mac_addr & 0xFF;
 	frame_small.type = FRAME_TYPE_ACK;
+	frame_small.level = wakeup_level;
 
 	phy_send(frame_small.data, frame_small.length, 0x0);
 }
 
-static void sender_tx_data() {
-	phy_send(frame_to_send.data, frame_to_send.length, 0x0);
+/**
+ * Send frame_to_send and free it. When a destination is given, the frames
+ * queued next for it follow back to back, each telling if more data comes.
+ */
+static void sender_tx_data(uint16_t dst) {
+	frame_t *next;
+	uint16_t count;
+
+	for (count = 0;; count++) {
+		next = 0x0;
+		if (dst != MAC_BROADCAST_ADDR && count < MAC_BURST_MAX) {
+			next = sender_next_frame(dst);
+		}
+		if (next) {
+			frame_to_send->type |= FRAME_MORE_DATA;
+		}
+
+		phy_send(frame_to_send->data, frame_to_send->length, 0x0);
+		frame_pool_free(frame_to_send);
+
+		if (next == 0x0) {
+			break;
+		}
+		frame_to_send = next;
+
+		// Leave the destination the time to listen again
+		sender_wait_interpacket();
+	}
+}
+
+/**
+ * Take the frame at the head of the TX queue if it goes to a destination.
+ * Only the MAC task takes frames from the queue, so the peeked frame is
+ * the one received, and the queue order is kept.
+ * \return the frame, 0x0 if none
+ */
+static frame_t* sender_next_frame(uint16_t dst) {
+	frame_t *frame;
+
+	if (xQueuePeek(tx_queue, &frame, 0) != pdTRUE) {
+		return 0x0;
+	}
+	if (frame->dst_addr[0] != (dst >> 8) || frame->dst_addr[1] != (dst
+			& 0xFF)) {
+		return 0x0;
+	}
+
+	xQueueReceive(tx_queue, &frame, 0);
+	return frame;
+}
+
+static void sender_wait_interpacket() {
+	uint16_t start;
+
+	start = timerB_time();
+	while ((uint16_t) (timerB_time() - start) < SENDER_INTERPACKET_DURATION) {
+		nop();
+	}
 }
 
 static uint16_t receiver_handle_frame() {
@@ -466,7 +617,7 @@ static uint16_t receiver_handle_frame() {
 		return 0;
 	}
 
-	if (frame_received.type == FRAME_TYPE_DATA) {
+	if ((frame_received.type & FRAME_TYPE_MASK) == FRAME_TYPE_DATA) {
 		if (frame_received.length < HEADER_LENGTH) {
 			// Discard the frame
 			frame_received.length = 0;
@@ -491,27 +642,106 @@ static uint16_t receiver_handle_frame() {
 }
 
 static uint16_t sender_handle_ack(void) {
-	uint16_t dst;
+	uint16_t dst, src;
 
-	if ((frame_received.length != HEADER_LENGTH) || (frame_received.type
+	if ((frame_received.length != ACK_LENGTH) || (frame_received.type
 			!= FRAME_TYPE_ACK)) {
 		frame_received.length = 0;
 		return 0;
 	}
 
-	memcpy(frame_small.data, frame_received.data, frame_received.length);
+	// Read the ACK in place, frame_small holds the preamble being repeated
 	frame_received.length = 0;
 
-	dst = ((uint16_t) frame_small.dst_addr[0]) << 8;
-	dst += frame_small.dst_addr[1];
+	dst = ((uint16_t) frame_received.dst_addr[0]) << 8;
+	dst += frame_received.dst_addr[1];
+	src = ((uint16_t) frame_received.src_addr[0]) << 8;
+	src += frame_received.src_addr[1];
 
 	if (dst != mac_addr) {
 		return 0;
 	}
 
+	// The wake-up level follows the header
+	neighbour_update(src, frame_received.payload[0]);
+
 	return 1;
 }
 
+/*-------------WAKE-UP PERIOD--------------*/
+
+static void adapt(void) {
+	uint16_t i;
+
+	while ((portTickType) (xTaskGetTickCount() - adapt_time) >= ADAPT_PERIOD) {
+		adapt_time += ADAPT_PERIOD;
+
+		if (traffic) {
+			traffic = 0;
+		} else if (wakeup_level < WAKEUP_LEVEL_MAX) {
+			// Idle for a whole period, sleep twice longer
+			wakeup_level++;
+		}
+
+		// The neighbours' levels grow by at most one per period
+		for (i = 0; i < NEIGHBOUR_MAX; i++) {
+			if (neighbours[i].level < WAKEUP_LEVEL_MAX) {
+				neighbours[i].level++;
+			}
+		}
+	}
+}
+
+static void traffic_seen(void) {
+	wakeup_level >>= 1;
+	traffic = 1;
+}
+
+static void neighbour_update(uint16_t addr, uint16_t level) {
+	uint16_t i;
+
+	for (i = 0; i < NEIGHBOUR_MAX; i++) {
+		if (neighbours[i].addr == addr) {
+			break;
+		}
+	}
+	if (i == NEIGHBOUR_MAX) {
+		i = neighbour_next;
+		neighbour_next = (neighbour_next + 1) % NEIGHBOUR_MAX;
+	}
+
+	neighbours[i].addr = addr;
+	neighbours[i].level = level;
+}
+
+static void neighbour_forget(uint16_t addr) {
+	uint16_t i;
+
+	for (i = 0; i < NEIGHBOUR_MAX; i++) {
+		if (neighbours[i].addr == addr) {
+			neighbours[i].level = WAKEUP_LEVEL_MAX;
+		}
+	}
+}
+
+static uint16_t neighbour_period(uint16_t addr) {
+	uint16_t i, level;
+
+	level = WAKEUP_LEVEL_MAX;
+	for (i = 0; i < NEIGHBOUR_MAX; i++) {
+		if (neighbours[i].addr == addr) {
+			// Add one for our periods not being aligned with the neighbour's
+			level = neighbours[i].level + 1;
+			if (level > WAKEUP_LEVEL_MAX) {
+				level = WAKEUP_LEVEL_MAX;
+			}
+			break;
+		}
+	}
+
+	return (uint16_t) RECEIVER_WAKEUP_PERIOD_MIN << level;
+}
+
 /*-------------TIMER ISR--------------*/
 
 static uint16_t tx_time() {
@@ -89,6 +89,24 @@ uint16_t phy_send(uint8_t* data, uint16_t length, uint16_t *timestamp);
  */
 uint16_t phy_send_cca(uint8_t* data, uint16_t length, uint16_t *timestamp);
 
+/**
+ * The RSSI returned when the channel can't be measured.
+ */
+#define PHY_RSSI_INVALID (-128)
+
+/**
+ * Measure the power on the radio channel, in RX only.
+ * \return the RSSI in dBm, PHY_RSSI_INVALID if not in RX.
+ */
+int8_t phy_get_rssi(void);
+
+/**
+ * Set the power above which phy_send_cca finds the channel busy.
+ * \param dbm the threshold in dBm.
+ * \return the threshold set, rounded to what the radio supports, in dBm.
+ */
+int8_t phy_set_cca_threshold(int8_t dbm);
+
 /**
  * Get the maximum TX duration
  */
@@ -43,6 +43,7 @@
 #include "task.h"
 #include "queue.h"
 #include "semphr.h"
+#include "event_flags.h"
 
 /* Project Includes */
 #include "leds.h"
@@ -70,6 +71,25 @@ enum phy_state {
 
 #define TX_MAX_DURATION 190
 
+/* Event flags set by the GDO interrupts */
+#define PHY_EVT_SYNC 0x01 // sync word received, in RX
+#define PHY_EVT_EOP  0x02 // end of packet, in RX or TX
+#define PHY_EVT_FIFO 0x04 // RX FIFO above, or TX FIFO below, the threshold
+
+/* Bound of the waits for the FIFO and the end of packet, the pins are
+ * checked again after it in case an edge was missed */
+#define PHY_WAIT_TICKS ((portTickType) (1 + ((uint32_t) TX_MAX_DURATION \
+		* configTICK_RATE_HZ) / 32768))
+
+/* Radio status values */
+#define MARCSTATE_RX 0x0D
+#define PKTSTATUS_CCA 0x10
+
+/* RSSI in dBm at which the carrier sense asserts with a null absolute
+ * threshold, about what MAGN_TARGET gives at 250kbps */
+#define PHY_CS_BASE (-95)
+#define PHY_CS_THR_MAX 7
+
 /* Function Prototypes */
 static void cc1101_task(void* param);
 static void cc1101_driver_init(void);
@@ -77,13 +97,17 @@ static void handle_received_frame(void);
 static void restore_state(void);
 
 /* CC1101 callback functions */
-static uint16_t sync_irq(void);
-/* static uint16_t rx_irq(void); */     /* unused */
+static uint16_t gdo0_irq(void);
+static uint16_t gdo2_irq(void);
+static uint16_t signal_from_isr(uint16_t events);
 
 /* Static variables */
-static xSemaphoreHandle rx_sem, spi_mutex;
+static xSemaphoreHandle spi_mutex;
+static xEventFlagsHandle phy_flags;
+static volatile uint8_t gdo0_in_packet;
 static phy_rx_callback_t rx_cb;
 static uint8_t radio_channel, radio_power;
+static int8_t cs_abs_thr; // carrier sense threshold, relative to PHY_CS_BASE
 static volatile enum phy_state state, old_state;
 static volatile uint16_t sync_word_time;
 static uint8_t rx_data[PHY_MAX_LENGTH + PHY_FOOTER_LENGTH];
@@ -119,8 +143,8 @@ void phy_init(xSemaphoreHandle spi_m, phy_rx_callback_t callback,
 		break;
 	}
 
-	// Initialize the semaphore
-	vSemaphoreCreateBinary(rx_sem);
+	// Create the event flags of the interrupts
+	phy_flags = xEventFlagsCreate();
 
 	// Set initial state
 	state = IDLE;
@@ -138,8 +162,11 @@ void phy_rx(void) {
 	cc1101_cmd_flush_rx();
 	cc1101_cmd_flush_tx();
 
-	// Set gdo2 RXFIFO
+	// Set gdo2 RXFIFO, its interrupt tells when to empty the FIFO
 	cc1101_cfg_gdo2(CC1101_GDOx_RX_FIFO);
+	cc1101_gdo2_int_set_rising_edge();
+	cc1101_gdo2_int_clear();
+	cc1101_gdo2_int_enable();
 
 	// Start RX
 	cc1101_cmd_rx();
@@ -189,8 +216,11 @@ uint16_t phy_send(uint8_t* data, uint16_t length, uint16_t *timestamp) {
 	cc1101_cmd_idle();
 	cc1101_cmd_flush_tx();
 
-	// Configure gdo2 to TX FIFO
+	// Configure gdo2 to TX FIFO, its interrupt tells when to refill the FIFO
 	cc1101_cfg_gdo2(CC1101_GDOx_TX_FIFO);
+	cc1101_gdo2_int_set_falling_edge();
+	cc1101_gdo2_int_clear();
+	cc1101_gdo2_int_enable();
 
 	// Send length byte and first set
 	length = tx_length > 63 ? 63 : tx_length;
@@ -205,17 +235,22 @@ uint16_t phy_send(uint8_t* data, uint16_t length, uint16_t *timestamp) {
 
 	// Loop for sending everything
 	while (tx_length != 0) {
-		if (cc1101_gdo2_read() == 0) {
-			length = tx_length > 31 ? 31 : tx_length;
-			cc1101_fifo_put(tx_data, length);
-			tx_data += length;
-			tx_length -= length;
+		uxEventFlagsClear(phy_flags, PHY_EVT_FIFO);
+		if (cc1101_gdo2_read()) {
+			// Wait until the FIFO goes below the threshold
+			uxEventFlagsWait(phy_flags, PHY_EVT_FIFO, pdTRUE, PHY_WAIT_TICKS);
+			continue;
 		}
+		length = tx_length > 31 ? 31 : tx_length;
+		cc1101_fifo_put(tx_data, length);
+		tx_data += length;
+		tx_length -= length;
 	}
 
 	// Wait while there are bytes in TX FIFO and EOP has not happened
+	uxEventFlagsClear(phy_flags, PHY_EVT_EOP);
 	while (cc1101_status_txbytes() || cc1101_gdo0_read()) {
-		nop();
+		uxEventFlagsWait(phy_flags, PHY_EVT_EOP, pdTRUE, PHY_WAIT_TICKS);
 	}
 
 	// Release semaphore
@@ -231,10 +266,76 @@ uint16_t phy_send(uint8_t* data, uint16_t length, uint16_t *timestamp) {
 }
 
 uint16_t phy_send_cca(uint8_t* data, uint16_t length, uint16_t *timestamp) {
-	// TODO real cca
+	uint8_t clear;
+
+	if (state != RX) {
+		// The channel can only be sensed in RX
+		return phy_send(data, length, timestamp);
+	}
+
+	xSemaphoreTake(spi_mutex, portMAX_DELAY);
+
+	// The radio is IDLE after a received frame until the task restarts RX,
+	// the channel isn't clear then
+	clear = (cc1101_status_marcstate() == MARCSTATE_RX)
+			&& (cc1101_status_pktstatus() & PKTSTATUS_CCA);
+
+	xSemaphoreGive(spi_mutex);
+
+	if (!clear) {
+		return 0;
+	}
 	return phy_send(data, length, timestamp);
 }
 
+int8_t phy_get_rssi(void) {
+	int16_t rssi;
+	uint8_t marcstate;
+
+	if (state != RX) {
+		return PHY_RSSI_INVALID;
+	}
+
+	xSemaphoreTake(spi_mutex, portMAX_DELAY);
+	rssi = cc1101_status_rssi();
+	marcstate = cc1101_status_marcstate();
+	xSemaphoreGive(spi_mutex);
+
+	if (marcstate != MARCSTATE_RX) {
+		return PHY_RSSI_INVALID;
+	}
+
+	// Same conversion as the appended status
+	if (rssi >= 128) {
+		rssi -= 256;
+	}
+	rssi -= 148;
+	rssi /= 2;
+	return rssi;
+}
+
+int8_t phy_set_cca_threshold(int8_t dbm) {
+	int16_t thr;
+
+	// The radio sets it in 1dB steps around PHY_CS_BASE
+	thr = dbm - PHY_CS_BASE;
+	if (thr > PHY_CS_THR_MAX) {
+		thr = PHY_CS_THR_MAX;
+	} else if (thr < -PHY_CS_THR_MAX) {
+		thr = -PHY_CS_THR_MAX;
+	}
+
+	if (thr != cs_abs_thr) {
+		cs_abs_thr = thr;
+
+		xSemaphoreTake(spi_mutex, portMAX_DELAY);
+		cc1101_cfg_carrier_sense_abs_thr(cs_abs_thr);
+		xSemaphoreGive(spi_mutex);
+	}
+
+	return PHY_CS_BASE + cs_abs_thr;
+}
+
 uint16_t phy_get_max_tx_duration(void) {
 	return TX_MAX_DURATION;
 }
@@ -261,12 +362,12 @@ static void cc1101_task(void* param) {
 	// Initialize the radio
 	cc1101_driver_init();
 
-	// Make sure the semaphore is taken
-	xSemaphoreTake(rx_sem, 0);
+	// Forget the sync words seen before
+	uxEventFlagsClear(phy_flags, PHY_EVT_SYNC);
 
 	// Infinite loop for handling received frames
 	while (1) {
-		if (xSemaphoreTake(rx_sem, portMAX_DELAY) == pdTRUE) {
+		if (uxEventFlagsWait(phy_flags, PHY_EVT_SYNC, pdTRUE, portMAX_DELAY)) {
 			handle_received_frame();
 		}
 	}
@@ -313,13 +414,24 @@ static void cc1101_driver_init(void) {
 	// Set FIFO threshold to middle
 	cc1101_cfg_fifo_thr(7);
 
-	// Set gdo0 SYNC word detection (both RX and TX)
+	// The channel is clear below the carrier sense threshold and out of
+	// the frames being received
+	cc1101_cfg_cca_mode(CC1101_CCA_MODE_RSSI_PKT_RX);
+	cc1101_cfg_carrier_sense_abs_thr(cs_abs_thr);
+
+	// Set gdo0 SYNC word detection (both RX and TX), the interrupt edge
+	// follows the pin to catch the end of packet too
 	cc1101_gdo0_int_disable();
 	cc1101_cfg_gdo0(CC1101_GDOx_SYNC_WORD);
 	cc1101_gdo0_int_set_rising_edge();
-	cc1101_gdo0_register_callback(sync_irq);
+	gdo0_in_packet = 0;
+	cc1101_gdo0_register_callback(gdo0_irq);
+	cc1101_gdo0_int_clear();
 	cc1101_gdo0_int_enable();
 
+	cc1101_gdo2_int_disable();
+	cc1101_gdo2_register_callback(gdo2_irq);
+
 	// Calibrate a first time
 	cc1101_cmd_calibrate();
 
@@ -376,6 +488,7 @@ static void handle_received_frame(void) {
 	rx_ptr = rx_data;
 
 	// Loop until end of packet
+	uxEventFlagsClear(phy_flags, PHY_EVT_FIFO | PHY_EVT_EOP);
 	while (cc1101_gdo0_read()) {
 		// get the bytes in FIFO
 		length = cc1101_status_rxbytes();
@@ -400,14 +513,17 @@ static void handle_received_frame(void) {
 		}
 
 		// Read every byte but one, to prevent CC1101 bug.
-		length -= 1;
-		cc1101_fifo_get(rx_ptr, length);
-		rx_ptr += length;
-		rx_length -= length;
+		if (length > 1) {
+			length -= 1;
+			cc1101_fifo_get(rx_ptr, length);
+			rx_ptr += length;
+			rx_length -= length;
+		}
 
 		// Wait until FIFO is filled above threshold, or EOP
-		while (!cc1101_gdo2_read() && cc1101_gdo0_read()) {
-			;
+		if (!cc1101_gdo2_read() && cc1101_gdo0_read()) {
+			uxEventFlagsWait(phy_flags, PHY_EVT_FIFO | PHY_EVT_EOP, pdTRUE,
+					PHY_WAIT_TICKS);
 		}
 	}
 
@@ -465,18 +581,61 @@ static void handle_received_frame(void) {
 	restore_state();
 }
 
-static uint16_t sync_irq(void) {
-	sync_word_time = TBR;
+static uint16_t gdo0_irq(void) {
+	uint16_t events = 0;
+
+	if (!gdo0_in_packet) {
+		// Rising edge, sync word sent or received
+		sync_word_time = TBR;
+		traceISR_ENTER(TRACE_ISR_RADIO_SYNC);
 
-	if (state == RX) {
-		portBASE_TYPE yield;
-		if (xSemaphoreGiveFromISR(rx_sem, &yield) == pdTRUE) {
+		cc1101_gdo0_int_set_falling_edge();
+		cc1101_gdo0_int_clear();
+		gdo0_in_packet = 1;
+
+		if (state == RX) {
+			events = PHY_EVT_SYNC;
+		}
+
+		// A very short packet may have ended already
+		if (cc1101_gdo0_read()) {
+			return signal_from_isr(events);
+		}
+	} else {
+		traceISR_ENTER(TRACE_ISR_RADIO_EOP);
+	}
+
+	// Falling edge, end of packet or radio stopped
+	cc1101_gdo0_int_set_rising_edge();
+	cc1101_gdo0_int_clear();
+	gdo0_in_packet = 0;
+
+	return signal_from_isr(events | PHY_EVT_EOP);
+}
+
+static uint16_t gdo2_irq(void) {
+	traceISR_ENTER(TRACE_ISR_RADIO_FIFO);
+	return signal_from_isr(PHY_EVT_FIFO);
+}
+
+/**
+ * Set event flags, and switch to the task waiting for them if it has a
+ * higher priority.
+ * \return 1 to wake the CPU up if a task was readied
+ */
+static uint16_t signal_from_isr(uint16_t events) {
+	portBASE_TYPE yield = pdFALSE;
+
+	if (events == 0) {
+		return 0;
+	}
+
+	if (xEventFlagsSetFromISR(phy_flags, events, &yield) == pdTRUE) {
 #if configUSE_PREEMPTION
-			if (yield) {
-				portYIELD();
-			}
-#endif
+		if (yield) {
+			portYIELD();
 		}
+#endif
 		return 1;
 	}
 	return 0;
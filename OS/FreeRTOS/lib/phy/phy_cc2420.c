@@ -262,6 +262,35 @@ uint16_t phy_send_cca(uint8_t* data, uint16_t length, uint16_t *timestamp) {
 	return 1;
 }
 
+int8_t phy_get_rssi(void) {
+	int8_t rssi = PHY_RSSI_INVALID;
+
+	if (state != RX) {
+		return PHY_RSSI_INVALID;
+	}
+
+	xSemaphoreTake(spi_mutex, portMAX_DELAY);
+	if (cc2420_get_status() & CC2420_STATUS_RSSI_VALID) {
+		rssi = (int8_t) cc2420_get_rssi() - 45;
+	}
+	xSemaphoreGive(spi_mutex);
+
+	return rssi;
+}
+
+int8_t phy_set_cca_threshold(int8_t dbm) {
+	// Same offset as the RSSI
+	if (dbm > 127 - 45) {
+		dbm = 127 - 45;
+	}
+
+	xSemaphoreTake(spi_mutex, portMAX_DELAY);
+	cc2420_set_ccathr((uint8_t) (dbm + 45));
+	xSemaphoreGive(spi_mutex);
+
+	return dbm;
+}
+
 uint16_t phy_get_max_tx_duration(void) {
 	return TX_MAX_DURATION;
 }
@@ -70,6 +70,14 @@ enum phy_state {
 
 #define TX_MAX_DURATION 190
 
+#define MARCSTATE_RX 0x0D
+#define PKTSTATUS_CCA 0x10
+
+/* RSSI in dBm at which the carrier sense asserts with a null absolute
+ * threshold, about what MAGN_TARGET gives at 250kbps */
+#define PHY_CS_BASE (-90)
+#define PHY_CS_THR_MAX 7
+
 /* Function Prototypes */
 static void cc2500_task(void* param);
 static void cc2500_driver_init(void);
@@ -83,6 +91,7 @@ static uint16_t sync_irq(void);
 static xSemaphoreHandle rx_sem, spi_mutex;
 static phy_rx_callback_t rx_cb;
 static uint8_t radio_channel, radio_power;
+static int8_t cs_abs_thr; // carrier sense threshold, relative to PHY_CS_BASE
 static volatile enum phy_state state, old_state;
 static volatile uint16_t sync_word_time;
 static uint8_t rx_data[PHY_MAX_LENGTH + PHY_FOOTER_LENGTH];
@@ -231,10 +240,76 @@ uint16_t phy_send(uint8_t* data, uint16_t length, uint16_t *timestamp) {
 }
 
 uint16_t phy_send_cca(uint8_t* data, uint16_t length, uint16_t *timestamp) {
-	// TODO real cca
+	uint8_t clear;
+
+	if (state != RX) {
+		// The channel can only be sensed in RX
+		return phy_send(data, length, timestamp);
+	}
+
+	xSemaphoreTake(spi_mutex, portMAX_DELAY);
+
+	// The radio is IDLE after a received frame until the task restarts RX,
+	// the channel isn't clear then
+	clear = (cc2500_status_marcstate() == MARCSTATE_RX)
+			&& (cc2500_status_pktstatus() & PKTSTATUS_CCA);
+
+	xSemaphoreGive(spi_mutex);
+
+	if (!clear) {
+		return 0;
+	}
 	return phy_send(data, length, timestamp);
 }
 
+int8_t phy_get_rssi(void) {
+	int16_t rssi;
+	uint8_t marcstate;
+
+	if (state != RX) {
+		return PHY_RSSI_INVALID;
+	}
+
+	xSemaphoreTake(spi_mutex, portMAX_DELAY);
+	rssi = cc2500_status_rssi();
+	marcstate = cc2500_status_marcstate();
+	xSemaphoreGive(spi_mutex);
+
+	if (marcstate != MARCSTATE_RX) {
+		return PHY_RSSI_INVALID;
+	}
+
+	// Same conversion as the appended status
+	if (rssi >= 128) {
+		rssi -= 256;
+	}
+	rssi -= 148;
+	rssi /= 2;
+	return rssi;
+}
+
+int8_t phy_set_cca_threshold(int8_t dbm) {
+	int16_t thr;
+
+	// The radio sets it in 1dB steps around PHY_CS_BASE
+	thr = dbm - PHY_CS_BASE;
+	if (thr > PHY_CS_THR_MAX) {
+		thr = PHY_CS_THR_MAX;
+	} else if (thr < -PHY_CS_THR_MAX) {
+		thr = -PHY_CS_THR_MAX;
+	}
+
+	if (thr != cs_abs_thr) {
+		cs_abs_thr = thr;
+
+		xSemaphoreTake(spi_mutex, portMAX_DELAY);
+		cc2500_cfg_carrier_sense_abs_thr(cs_abs_thr);
+		xSemaphoreGive(spi_mutex);
+	}
+
+	return PHY_CS_BASE + cs_abs_thr;
+}
+
 uint16_t phy_get_max_tx_duration(void) {
 	return TX_MAX_DURATION;
 }
@@ -295,6 +370,11 @@ static void cc2500_driver_init(void) {
 	// Set FIFO threshold to middle
 	cc2500_cfg_fifo_thr(7);
 
+	// The channel is clear below the carrier sense threshold and out of
+	// the frames being received
+	cc2500_cfg_cca_mode(CC2500_CCA_MODE_RSSI_PKT_RX);
+	cc2500_cfg_carrier_sense_abs_thr(cs_abs_thr);
+
 	// Set gdo0 SYNC word detection (both RX and TX)
 	cc2500_gdo0_int_disable();
 	cc2500_cfg_gdo0(CC2500_GDOx_SYNC_WORD);
@@ -0,0 +1,267 @@
+/*
+ * Copyright  2008-2009 INRIA/SensTools
+ *
+ * <dev-team@sentools.info>
+ *
+ * This software is a set of libraries designed to develop applications
+ * for the WSN430 embedded hardware platform.
+ *
+ * This software is governed by the CeCILL license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#include <io.h>
+#include <signal.h>
+
+/* Scheduler includes. */
+#include "FreeRTOS.h"
+
+#include "trace.h"
+#include "uart0.h"
+
+#if (TRACE_RING_SIZE & (TRACE_RING_SIZE - 1)) || TRACE_RING_SIZE > 256
+#error "TRACE_RING_SIZE must be a power of 2, up to 256"
+#endif
+
+#if configUSE_TRACE_FACILITY != 1
+#error "the trace needs configUSE_TRACE_FACILITY for the task numbers"
+#endif
+
+#define RECORD_SIZE 4
+#define RING_MASK (TRACE_RING_SIZE - 1)
+
+/* The TimerB clock source, divider and mode */
+#define TIMER_CTL_MASK (TBSSEL_3 | ID_3 | MC_3)
+
+static uint8_t ring[TRACE_RING_SIZE * RECORD_SIZE];
+/* Record counts, the ring index is the count modulo the ring size */
+static uint16_t head = 0, tail = 0;
+/* Number of records in the DMA transfer, from tail */
+static uint16_t sending = 0;
+static uint8_t lost = 0;
+
+static uint16_t timer_ctl = 0;
+static uint16_t timer_last = 0;
+static uint16_t timer_wraps = 0;
+static uint8_t current_task = 0xFF;
+
+static uint16_t dma_done(void);
+
+static uint16_t irq_save(void) {
+	uint16_t sr;
+
+	__asm__ __volatile__("mov r2, %0" : "=r" (sr));
+	dint();
+	return sr;
+}
+
+static void irq_restore(uint16_t sr) {
+	if (sr & GIE) {
+		eint();
+	}
+}
+
+static void start_dma(void) {
+	uint16_t count, index;
+
+	index = tail & RING_MASK;
+	count = (uint16_t) (head - tail);
+	if (count > TRACE_RING_SIZE - index) {
+		count = TRACE_RING_SIZE - index;
+	}
+
+	if (count && uart0_dma_putchars(&ring[index * RECORD_SIZE],
+			count * RECORD_SIZE)) {
+		sending = count;
+	}
+}
+
+static void put(uint8_t type, uint8_t arg, uint16_t time) {
+	uint8_t *record;
+	uint16_t used;
+
+	used = (uint16_t) (head - tail);
+	if (used >= TRACE_RING_SIZE - (lost ? 1 : 0)) {
+		// the TRACE_LOST record needs a slot of its own
+		if (lost < 0xFF) {
+			lost++;
+		}
+		return;
+	}
+
+	if (lost) {
+		record = &ring[(head & RING_MASK) * RECORD_SIZE];
+		record[0] = TRACE_LOST;
+		record[1] = lost;
+		record[2] = time & 0xFF;
+		record[3] = time >> 8;
+		head++;
+		lost = 0;
+	}
+
+	record = &ring[(head & RING_MASK) * RECORD_SIZE];
+	record[0] = type;
+	record[1] = arg;
+	record[2] = time & 0xFF;
+	record[3] = time >> 8;
+	head++;
+
+	if ( (sending == 0) && ((uint16_t) (head - tail) >= TRACE_FLUSH_THRESHOLD) ) {
+		start_dma();
+	}
+}
+
+/**
+ * Read the TimerB, and record the clock changes and the wraps.
+ * Interrupts must be disabled.
+ */
+static uint16_t now(void) {
+	uint16_t time, ctl;
+
+	time = TBR;
+	ctl = TBCTL & TIMER_CTL_MASK;
+
+	if (ctl != timer_ctl) {
+		// someone restarted the timer, the time base is new
+		timer_ctl = ctl;
+		timer_wraps = 0;
+		put(TRACE_START, ctl >> 4, time);
+	} else if (time < timer_last) {
+		timer_wraps++;
+		put(TRACE_SYNC, timer_wraps & 0xFF, time);
+	}
+	timer_last = time;
+
+	return time;
+}
+
+void trace_init(void) {
+	uint16_t sr;
+
+	sr = irq_save();
+
+	if ((TBCTL & MC_3) == 0) {
+		TBCTL = TBSSEL_1 | MC_2;
+	}
+	uart0_register_dma_callback(dma_done);
+
+	// force the TRACE_START record
+	timer_ctl = 0xFFFF;
+	now();
+
+	irq_restore(sr);
+}
+
+void trace_flush(void) {
+	uint16_t sr;
+
+	sr = irq_save();
+	if (sending == 0) {
+		start_dma();
+	}
+	irq_restore(sr);
+}
+
+uint32_t trace_time(void) {
+	uint16_t sr, time;
+	uint32_t result;
+
+	sr = irq_save();
+	time = now();
+	result = ((uint32_t) timer_wraps << 16) | time;
+	irq_restore(sr);
+
+	return result;
+}
+
+void trace_tick(void) {
+	uint16_t sr;
+
+	sr = irq_save();
+	now();
+	irq_restore(sr);
+}
+
+void trace_event(uint8_t type, uint8_t arg) {
+	uint16_t sr;
+
+	sr = irq_save();
+	put(type, arg, now());
+	irq_restore(sr);
+}
+
+void trace_queue(uint8_t type, const void *queue) {
+	uint16_t id;
+
+	// the queues are not numbered, fold their address
+	id = (uint16_t) queue;
+	id = (id >> 1) ^ (id >> 9);
+	trace_event(type, id & 0xFF);
+}
+
+void trace_task_create(uint8_t number, const signed char *name) {
+	uint16_t sr, i;
+	uint8_t c[3];
+
+	sr = irq_save();
+	put(TRACE_TASK_CREATE, number, now());
+
+	// 3 chars per record, up to the terminating 0
+	for (i = 0; i < configMAX_TASK_NAME_LEN; i += 3) {
+		c[0] = name[i];
+		c[1] = (c[0] && i + 1 < configMAX_TASK_NAME_LEN) ? name[i + 1] : 0;
+		c[2] = (c[1] && i + 2 < configMAX_TASK_NAME_LEN) ? name[i + 2] : 0;
+		put(TRACE_TASK_NAME, c[0], c[1] | ((uint16_t) c[2] << 8));
+		if (c[2] == 0) {
+			break;
+		}
+	}
+	irq_restore(sr);
+}
+
+void trace_switch_in(uint8_t number) {
+	uint16_t sr;
+
+	// the scheduler picks the same task again at most ticks
+	if (number == current_task) {
+		return;
+	}
+	current_task = number;
+
+	sr = irq_save();
+	put(TRACE_SWITCH_IN, number, now());
+	irq_restore(sr);
+}
+
+static uint16_t dma_done(void) {
+	tail += sending;
+	sending = 0;
+
+	if (head != tail) {
+		start_dma();
+	}
+	return 0;
+}
@@ -0,0 +1,172 @@
+/*
+ * Copyright  2008-2009 INRIA/SensTools
+ *
+ * <dev-team@sentools.info>
+ *
+ * This software is a set of libraries designed to develop applications
+ * for the WSN430 embedded hardware platform.
+ *
+ * This software is governed by the CeCILL license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL license and that you accept its terms.
+ */
+
+/**
+ * \file
+ * \brief Kernel event trace streamed on uart0
+ *
+ * The kernel trace macros record the context switches, the queue and
+ * semaphore operations, the delays and the interrupts into a RAM ring of
+ * 4-byte records, which is sent by DMA on uart0 while the tasks run.
+ * trace_decode.py turns the stream into per-task CPU share, blocking
+ * time and interrupt to task latencies.
+ *
+ * A record is a type byte, an argument byte and the low then high byte
+ * of the TimerB counter. The timestamps are 16-bit, a TRACE_SYNC record
+ * marks each counter wrap, and a TRACE_START record every change of the
+ * TimerB clock, so the decoder can rebuild the time. A wrap is only
+ * noticed if the counter is read at least once per period, which the
+ * kernel tick does.
+ *
+ * The trace is enabled by including this file at the end of
+ * FreeRTOSConfig.h, with configUSE_TRACE_FACILITY set to 1 for the task
+ * numbers. uart0 then belongs to the trace, the application must not
+ * print on it.
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+/**
+ * Number of records in the ring, a power of 2.
+ */
+#ifndef TRACE_RING_SIZE
+#define TRACE_RING_SIZE 128
+#endif
+
+/**
+ * Number of records that start a DMA transfer when the uart is idle.
+ */
+#ifndef TRACE_FLUSH_THRESHOLD
+#define TRACE_FLUSH_THRESHOLD (TRACE_RING_SIZE / 4)
+#endif
+
+/**
+ * \name Record types
+ * @{
+ */
+#define TRACE_START              0x01 /* arg: TBCTL bits 4 to 9 */
+#define TRACE_SYNC               0x02 /* arg: wrap count */
+#define TRACE_LOST               0x03 /* arg: records dropped, ring full */
+#define TRACE_TASK_CREATE        0x04 /* arg: task number */
+#define TRACE_TASK_NAME          0x05 /* arg and time: 3 name chars */
+#define TRACE_SWITCH_IN          0x06 /* arg: task number */
+#define TRACE_DELAY              0x07
+#define TRACE_SUSPEND            0x08 /* arg: task number */
+#define TRACE_RESUME             0x09 /* arg: task number */
+#define TRACE_QUEUE_SEND         0x10 /* arg: queue id */
+#define TRACE_QUEUE_SEND_FAILED  0x11
+#define TRACE_QUEUE_RECV         0x12
+#define TRACE_QUEUE_RECV_FAILED  0x13
+#define TRACE_QUEUE_BLOCK_SEND   0x14
+#define TRACE_QUEUE_BLOCK_RECV   0x15
+#define TRACE_QUEUE_SEND_ISR     0x16
+#define TRACE_QUEUE_RECV_ISR     0x17
+#define TRACE_FLAGS_SET          0x18 /* arg: event flags id */
+#define TRACE_FLAGS_SET_ISR      0x19
+#define TRACE_FLAGS_WAIT         0x1A
+#define TRACE_FLAGS_WAIT_FAILED  0x1B
+#define TRACE_FLAGS_BLOCK        0x1C
+#define TRACE_ISR                0x20 /* arg: interrupt id */
+/** @} */
+
+/**
+ * \name Interrupt ids given to traceISR_ENTER()
+ * @{
+ */
+#define TRACE_ISR_RADIO_RX       1
+#define TRACE_ISR_RADIO_TX       2
+#define TRACE_ISR_RADIO_SYNC     3
+#define TRACE_ISR_RADIO_EOP      4
+#define TRACE_ISR_RADIO_FIFO     5
+#define TRACE_ISR_APP            16 /* first id free for the application */
+/** @} */
+
+/**
+ * Start the TimerB if it is stopped, and record a TRACE_START.
+ * uart0 must be initialized. To be called before the first task is
+ * created, so that the task names are in the trace.
+ */
+void trace_init(void);
+
+/**
+ * Send the pending records even if there are less than
+ * TRACE_FLUSH_THRESHOLD, from the idle hook for instance.
+ */
+void trace_flush(void);
+
+/**
+ * Get the TimerB counter extended to 32 bits with the wrap count,
+ * for the run-time statistics of the kernel.
+ */
+uint32_t trace_time(void);
+
+void trace_tick(void);
+void trace_event(uint8_t type, uint8_t arg);
+void trace_queue(uint8_t type, const void *queue);
+void trace_task_create(uint8_t number, const signed char *name);
+void trace_switch_in(uint8_t number);
+
+/* Kernel hooks */
+#define traceTASK_SWITCHED_IN()                 trace_switch_in( ( uint8_t ) pxCurrentTCB->uxTCBNumber )
+#define traceTASK_CREATE( pxNewTCB )            trace_task_create( ( uint8_t ) ( pxNewTCB )->uxTCBNumber, ( pxNewTCB )->pcTaskName )
+#define traceTASK_DELAY()                       trace_event( TRACE_DELAY, 0 )
+#define traceTASK_DELAY_UNTIL()                 trace_event( TRACE_DELAY, 0 )
+#define traceTASK_SUSPEND( pxTCB )              trace_event( TRACE_SUSPEND, ( uint8_t ) ( pxTCB )->uxTCBNumber )
+#define traceTASK_RESUME( pxTCB )               trace_event( TRACE_RESUME, ( uint8_t ) ( pxTCB )->uxTCBNumber )
+#define traceTASK_RESUME_FROM_ISR( pxTCB )      trace_event( TRACE_RESUME, ( uint8_t ) ( pxTCB )->uxTCBNumber )
+#define traceTASK_INCREMENT_TICK( xTickCount )  trace_tick()
+#define traceQUEUE_SEND( pxQueue )              trace_queue( TRACE_QUEUE_SEND, pxQueue )
+#define traceQUEUE_SEND_FAILED( pxQueue )       trace_queue( TRACE_QUEUE_SEND_FAILED, pxQueue )
+#define traceQUEUE_RECEIVE( pxQueue )           trace_queue( TRACE_QUEUE_RECV, pxQueue )
+#define traceQUEUE_RECEIVE_FAILED( pxQueue )    trace_queue( TRACE_QUEUE_RECV_FAILED, pxQueue )
+#define traceBLOCKING_ON_QUEUE_SEND( pxQueue )  trace_queue( TRACE_QUEUE_BLOCK_SEND, pxQueue )
+#define traceBLOCKING_ON_QUEUE_RECEIVE( pxQueue ) trace_queue( TRACE_QUEUE_BLOCK_RECV, pxQueue )
+#define traceQUEUE_SEND_FROM_ISR( pxQueue )     trace_queue( TRACE_QUEUE_SEND_ISR, pxQueue )
+#define traceQUEUE_RECEIVE_FROM_ISR( pxQueue )  trace_queue( TRACE_QUEUE_RECV_ISR, pxQueue )
+#define traceEVENT_FLAGS_SET( pxFlags )         trace_queue( TRACE_FLAGS_SET, pxFlags )
+#define traceEVENT_FLAGS_SET_FROM_ISR( pxFlags ) trace_queue( TRACE_FLAGS_SET_ISR, pxFlags )
+#define traceEVENT_FLAGS_WAIT( pxFlags )        trace_queue( TRACE_FLAGS_WAIT, pxFlags )
+#define traceEVENT_FLAGS_WAIT_FAILED( pxFlags ) trace_queue( TRACE_FLAGS_WAIT_FAILED, pxFlags )
+#define traceBLOCKING_ON_EVENT_FLAGS( pxFlags ) trace_queue( TRACE_FLAGS_BLOCK, pxFlags )
+#define traceISR_ENTER( ucId )                  trace_event( TRACE_ISR, ucId )
+
+/* Run-time statistics clock */
+#if configGENERATE_RUN_TIME_STATS == 1
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()
+#define portGET_RUN_TIME_COUNTER_VALUE()        trace_time()
+#endif
+
+#endif /* TRACE_H_ */
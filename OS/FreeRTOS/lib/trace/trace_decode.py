@@ -0,0 +1,377 @@
+#!/usr/bin/env python3
+"""
+Decode the kernel trace streamed on uart0 by lib/trace/trace.c.
+
+Capture the stream with the serial port in raw mode, for instance
+    stty -F /dev/ttyUSB0 115200 raw && cat /dev/ttyUSB0 > trace.bin
+then run
+    trace_decode.py trace.bin
+
+It prints, for each task, the CPU share, the time spent blocked and the
+time spent ready but waiting for the CPU, then the histograms of the
+latency between an interrupt and the switch to the task it woke up.
+A task that waits for the CPU a long time is starved by the tasks and
+interrupts of higher priority.
+"""
+
+import sys
+import argparse
+
+RECORD_SIZE = 4
+
+TRACE_START = 0x01
+TRACE_SYNC = 0x02
+TRACE_LOST = 0x03
+TRACE_TASK_CREATE = 0x04
+TRACE_TASK_NAME = 0x05
+TRACE_SWITCH_IN = 0x06
+TRACE_DELAY = 0x07
+TRACE_SUSPEND = 0x08
+TRACE_RESUME = 0x09
+TRACE_QUEUE_SEND = 0x10
+TRACE_QUEUE_SEND_FAILED = 0x11
+TRACE_QUEUE_RECV = 0x12
+TRACE_QUEUE_RECV_FAILED = 0x13
+TRACE_QUEUE_BLOCK_SEND = 0x14
+TRACE_QUEUE_BLOCK_RECV = 0x15
+TRACE_QUEUE_SEND_ISR = 0x16
+TRACE_QUEUE_RECV_ISR = 0x17
+TRACE_FLAGS_SET = 0x18
+TRACE_FLAGS_SET_ISR = 0x19
+TRACE_FLAGS_WAIT = 0x1A
+TRACE_FLAGS_WAIT_FAILED = 0x1B
+TRACE_FLAGS_BLOCK = 0x1C
+TRACE_ISR = 0x20
+
+TYPES = set([TRACE_START, TRACE_SYNC, TRACE_LOST, TRACE_TASK_CREATE,
+             TRACE_TASK_NAME, TRACE_SWITCH_IN, TRACE_DELAY, TRACE_SUSPEND,
+             TRACE_RESUME, TRACE_QUEUE_SEND, TRACE_QUEUE_SEND_FAILED,
+             TRACE_QUEUE_RECV, TRACE_QUEUE_RECV_FAILED,
+             TRACE_QUEUE_BLOCK_SEND, TRACE_QUEUE_BLOCK_RECV,
+             TRACE_QUEUE_SEND_ISR, TRACE_QUEUE_RECV_ISR, TRACE_FLAGS_SET,
+             TRACE_FLAGS_SET_ISR, TRACE_FLAGS_WAIT, TRACE_FLAGS_WAIT_FAILED,
+             TRACE_FLAGS_BLOCK, TRACE_ISR])
+
+QUEUE_NAMES = {
+    TRACE_QUEUE_SEND: 'send',
+    TRACE_QUEUE_SEND_FAILED: 'send failed',
+    TRACE_QUEUE_RECV: 'receive',
+    TRACE_QUEUE_RECV_FAILED: 'receive failed',
+    TRACE_QUEUE_BLOCK_SEND: 'block on send',
+    TRACE_QUEUE_BLOCK_RECV: 'block on receive',
+    TRACE_QUEUE_SEND_ISR: 'send from ISR',
+    TRACE_QUEUE_RECV_ISR: 'receive from ISR',
+    TRACE_FLAGS_SET: 'set flags',
+    TRACE_FLAGS_SET_ISR: 'set flags from ISR',
+    TRACE_FLAGS_WAIT: 'wait flags',
+    TRACE_FLAGS_WAIT_FAILED: 'wait flags timed out',
+    TRACE_FLAGS_BLOCK: 'block on flags',
+}
+
+# Event flags are traced as queues, with their own record types
+BLOCKS = (TRACE_QUEUE_BLOCK_SEND, TRACE_QUEUE_BLOCK_RECV, TRACE_FLAGS_BLOCK)
+FAILS = (TRACE_QUEUE_SEND_FAILED, TRACE_QUEUE_RECV_FAILED,
+         TRACE_FLAGS_WAIT_FAILED)
+TAKES = (TRACE_QUEUE_SEND, TRACE_QUEUE_RECV, TRACE_FLAGS_WAIT)
+FROM_ISR = (TRACE_QUEUE_SEND_ISR, TRACE_QUEUE_RECV_ISR, TRACE_FLAGS_SET_ISR)
+
+ISR_NAMES = {1: 'radio rx', 2: 'radio tx', 3: 'radio sync',
+             4: 'radio end of packet', 5: 'radio fifo'}
+
+# Latency histogram bucket upper bounds, in microseconds
+BUCKETS = [32, 64, 128, 256, 512, 1024, 2048, 4096, 8192, 16384]
+
+RUNNING, READY, BLOCKED = range(3)
+
+
+def records(data):
+    """Find the record alignment and yield (type, arg, time) from the
+    first TRACE_START, the capture may begin in the middle of a record."""
+    best, best_count = 0, -1
+    for offset in range(RECORD_SIZE):
+        count = sum(1 for i in range(offset, min(len(data), 4096), RECORD_SIZE)
+                    if data[i] in TYPES)
+        if count > best_count:
+            best, best_count = offset, count
+
+    started = False
+    for i in range(best, len(data) - RECORD_SIZE + 1, RECORD_SIZE):
+        rtype = data[i]
+        if rtype == TRACE_START:
+            started = True
+        if started:
+            yield rtype, data[i + 1], data[i + 2] | (data[i + 3] << 8)
+
+
+class Task:
+    def __init__(self, number):
+        self.number = number
+        self.name = 'task%u' % number
+        self.state = READY
+        self.since = None
+        self.running = 0.0
+        self.ready = 0.0
+        self.blocked = 0.0
+        self.ready_max = 0.0
+        self.switches = 0
+        self.blocking = False
+        self.block_queue = None
+        self.woken = None
+        self.latencies = []
+
+
+class Decoder:
+    def __init__(self, smclk):
+        self.smclk = smclk
+        self.rate = 32768.0
+        self.time = 0.0
+        self.last = None
+        self.tasks = {}
+        self.current = None
+        self.naming = None
+        self.naming_task = None
+        self.isr = None
+        self.isr_counts = {}
+        self.isr_latencies = {}
+        self.queues = {}
+        self.lost = 0
+        self.restarts = 0
+
+    def task(self, number):
+        if number not in self.tasks:
+            self.tasks[number] = Task(number)
+        return self.tasks[number]
+
+    def clock(self, arg):
+        mode, div, source = arg & 3, (arg >> 2) & 3, (arg >> 4) & 3
+        if mode == 0:
+            return None
+        base = 32768.0 if source == 1 else float(self.smclk)
+        return base / (1 << div)
+
+    def advance(self, ts):
+        if self.last is not None and self.rate:
+            self.time += ((ts - self.last) & 0xFFFF) / self.rate
+        self.last = ts
+
+    def feed(self, rtype, arg, ts):
+        if rtype == TRACE_TASK_NAME:
+            # no time in a name record
+            if self.naming is not None:
+                for c in (arg, ts & 0xFF, ts >> 8):
+                    if c == 0:
+                        self.naming = None
+                        break
+                    self.naming.append(chr(c))
+                    self.task(self.naming_task).name = ''.join(self.naming)
+            return
+
+        if rtype not in TYPES:
+            return
+
+        if rtype == TRACE_START:
+            # the timer was restarted, the gap is unknown
+            self.restarts += 1
+            self.rate = self.clock(arg)
+            self.last = ts
+            return
+
+        self.advance(ts)
+        self.naming = None
+
+        if rtype == TRACE_SYNC:
+            pass
+        elif rtype == TRACE_LOST:
+            self.lost += arg
+        elif rtype == TRACE_TASK_CREATE:
+            self.task(arg).since = self.time
+            self.naming_task = arg
+            self.naming = []
+        elif rtype == TRACE_SWITCH_IN:
+            self.switch_in(arg)
+        elif rtype == TRACE_DELAY:
+            if self.current is not None:
+                self.current.blocking = True
+                self.current.block_queue = None
+        elif rtype == TRACE_SUSPEND:
+            t = self.task(arg)
+            if t is self.current:
+                t.blocking = True
+                t.block_queue = None
+            elif t.state == READY:
+                self.leave(t)
+                t.state, t.since = BLOCKED, self.time
+        elif rtype == TRACE_RESUME:
+            t = self.task(arg)
+            if t.state == BLOCKED:
+                self.wake(t, None)
+        elif rtype == TRACE_ISR:
+            self.isr = (self.time, arg)
+            self.isr_counts[arg] = self.isr_counts.get(arg, 0) + 1
+        else:
+            self.queue(rtype, arg)
+
+        # an interrupt ends with the next record from a task
+        if rtype not in (TRACE_ISR, TRACE_SYNC, TRACE_LOST) + FROM_ISR:
+            self.isr = None
+
+    def queue(self, rtype, q):
+        ops = self.queues.setdefault(q, {})
+        ops[rtype] = ops.get(rtype, 0) + 1
+
+        if rtype in BLOCKS:
+            if self.current is not None:
+                self.current.blocking = True
+                self.current.block_queue = q
+            return
+        if rtype in FAILS:
+            return
+        if rtype in TAKES and self.current:
+            # the queue was ready after all, the task goes on
+            self.current.blocking = False
+
+        # a send or a receive readies the tasks blocked on the queue, the
+        # kernel only readies one of them but the trace doesn't tell which;
+        # setting flags readies them all
+        woken = None
+        if rtype in FROM_ISR:
+            # from the interrupt entry if it was traced, else the queue call
+            woken = self.isr if self.isr is not None else (self.time, None)
+        for t in self.tasks.values():
+            if t.state == BLOCKED and t.block_queue == q:
+                self.wake(t, woken)
+
+    def wake(self, t, woken):
+        self.leave(t)
+        t.state = READY
+        t.woken = woken
+
+    def leave(self, t):
+        """Account the time of a task in its current state."""
+        if t.since is None:
+            t.since = self.time
+            return
+        spent = self.time - t.since
+        if t.state == RUNNING:
+            t.running += spent
+        elif t.state == READY:
+            t.ready += spent
+            t.ready_max = max(t.ready_max, spent)
+        else:
+            t.blocked += spent
+        t.since = self.time
+
+    def switch_in(self, number):
+        prev = self.current
+        if prev is not None:
+            self.leave(prev)
+            prev.state = BLOCKED if prev.blocking else READY
+            prev.blocking = False
+            prev.woken = None
+
+        t = self.task(number)
+        if t.state != RUNNING:
+            self.leave(t)
+        if t.woken is not None:
+            start, isr = t.woken
+            latency = (self.time - start) * 1e6
+            t.latencies.append(latency)
+            if isr is not None:
+                self.isr_latencies.setdefault(isr, []).append(latency)
+        t.state = RUNNING
+        t.switches += 1
+        t.woken = None
+        self.current = t
+
+    def finish(self):
+        for t in self.tasks.values():
+            self.leave(t)
+
+
+def histogram(values):
+    counts = [0] * (len(BUCKETS) + 1)
+    for v in values:
+        for i, bound in enumerate(BUCKETS):
+            if v < bound:
+                counts[i] += 1
+                break
+        else:
+            counts[-1] += 1
+    top = max(counts) or 1
+    lines = []
+    low = 0
+    for i, c in enumerate(counts):
+        label = ('%6u-%-6u' % (low, BUCKETS[i])) if i < len(BUCKETS) \
+            else ('%6u+      ' % low)
+        if c:
+            lines.append('    %s us %6u %s' % (label, c, '#' * (40 * c // top or 1)))
+        if i < len(BUCKETS):
+            low = BUCKETS[i]
+    return lines
+
+
+def report(d, out):
+    total = d.time
+    out.write('trace: %.3f s, %u clock starts, %u records lost\n\n'
+              % (total, d.restarts, d.lost))
+    if total <= 0:
+        return
+
+    out.write('%-10s %6s %10s %10s %10s %10s %7s\n'
+              % ('task', 'cpu%', 'run ms', 'blocked ms', 'ready ms',
+                 'ready max', 'switch'))
+    for t in sorted(d.tasks.values(), key=lambda t: -t.running):
+        out.write('%-10s %6.2f %10.1f %10.1f %10.1f %10.2f %7u\n'
+                  % (t.name, 100.0 * t.running / total, t.running * 1e3,
+                     t.blocked * 1e3, t.ready * 1e3, t.ready_max * 1e3,
+                     t.switches))
+
+    for t in sorted(d.tasks.values(), key=lambda t: t.number):
+        if not t.latencies:
+            continue
+        out.write('\ninterrupt to %s latency, %u wake ups, max %.0f us\n'
+                  % (t.name, len(t.latencies), max(t.latencies)))
+        out.write('\n'.join(histogram(t.latencies)) + '\n')
+
+    for isr in sorted(d.isr_counts):
+        name = ISR_NAMES.get(isr, 'isr %u' % isr)
+        lat = d.isr_latencies.get(isr, [])
+        out.write('\n%s: %u interrupts, %u task wake ups\n'
+                  % (name, d.isr_counts[isr], len(lat)))
+        if lat:
+            out.write('\n'.join(histogram(lat)) + '\n')
+
+    if d.queues:
+        out.write('\nqueue and event flags operations\n')
+        for q in sorted(d.queues):
+            ops = ', '.join('%s %u' % (QUEUE_NAMES[k], v)
+                            for k, v in sorted(d.queues[q].items()))
+            out.write('  queue %02x: %s\n' % (q, ops))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[1])
+    parser.add_argument('capture', help='raw capture of the uart0 stream, - for stdin')
+    parser.add_argument('--smclk', type=int, default=1000000,
+                        help='SMCLK frequency if TimerB runs on it (default 1MHz)')
+    parser.add_argument('--dump', action='store_true',
+                        help='print the records with their time')
+    args = parser.parse_args()
+
+    if args.capture == '-':
+        data = sys.stdin.buffer.read()
+    else:
+        with open(args.capture, 'rb') as f:
+            data = f.read()
+
+    d = Decoder(args.smclk)
+    for rtype, arg, ts in records(data):
+        d.feed(rtype, arg, ts)
+        if args.dump:
+            sys.stdout.write('%12.6f %02x %02x %04x\n' % (d.time, rtype, arg, ts))
+    d.finish()
+    report(d, sys.stdout)
+
+
+if __name__ == '__main__':
+    main()
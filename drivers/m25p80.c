@@ -245,7 +245,7 @@ static void m25p80_write_enable()
 /* ************************************************** */
 /* ************************************************** */
 
-critical void m25p80_erase_sector(uint8_t ix)
+critical void m25p80_erase_sector_start(uint8_t ix)
 {
   m25p80_block_wip();
   m25p80_write_enable();
@@ -255,7 +255,15 @@ critical void m25p80_erase_sector(uint8_t ix)
   spi1_write_single(0  & 0xff);
   spi1_write_single(0  & 0xff);
   spi1_deselect(SPI1_M25P80);
+}
+
+/* ************************************************** */
+/* ************************************************** */
+/* ************************************************** */
 
+critical void m25p80_erase_sector(uint8_t ix)
+{
+  m25p80_erase_sector_start(ix);
   m25p80_block_wip();
 }
 
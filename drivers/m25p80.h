@@ -70,6 +70,9 @@
 /** \brief Number of sectors */
 #define M25P80_SECTOR_NUMBER          16
 
+/** \brief Write In Progress bit of the state register */
+#define M25P80_STATE_WIP              0x01
+
 /**
  * @}
  */
@@ -110,6 +113,15 @@ void  m25p80_power_down  (void);
  */
 void  m25p80_erase_sector(uint8_t sector);
 
+/**
+ * \brief Start erasing a memory sector, without waiting for the end.
+ *
+ * The erase lasts up to 3s, M25P80_STATE_WIP is set in the state
+ * register until it is done. The other functions wait for it.
+ * \param sector the sector number to erase
+ */
+void  m25p80_erase_sector_start(uint8_t sector);
+
 /**
  * \brief Erase the whole memory.
  *
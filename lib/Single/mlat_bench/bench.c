@@ -0,0 +1,109 @@
+#include <stdint.h>
+
+#include "mlat.h"
+#include "bench.h"
+
+/* ----DEFINES---- */
+#define GRID      4
+#define SPACING   100 // decimetres
+#define MOBILES   4
+#define STEP      3   // decimetres per report
+#define RSSI_1M   (-40)
+
+/* ----PROTOTYPES---- */
+static uint16_t rand16(void);
+static int16_t rssi_at(int16_t dx, int16_t dy);
+static uint16_t isqrt(uint32_t x);
+
+/* ----DATA---- */
+static uint32_t seed;
+static mlat_point_t mobiles[MOBILES];
+static uint16_t now;
+
+void bench_init(uint16_t s)
+{
+    int i;
+
+    seed = s;
+    now = 0;
+
+    mlat_init();
+    for (i=0; i<GRID*GRID; i++) {
+        mlat_set_anchor(0x100+i, (i%GRID)*SPACING, (i/GRID)*SPACING);
+    }
+    for (i=0; i<MOBILES; i++) {
+        mobiles[i].x = rand16() % ((GRID-1)*SPACING);
+        mobiles[i].y = rand16() % ((GRID-1)*SPACING);
+    }
+}
+
+uint16_t bench_run(uint16_t count, uint32_t *error)
+{
+    mlat_point_t *m, pos;
+    uint16_t solved = 0, a;
+    int16_t dx, dy;
+
+    while (count--) {
+        m = &mobiles[rand16() % MOBILES];
+        a = rand16() % (GRID*GRID);
+        now++;
+
+        // random walk inside the grid
+        m->x += (int16_t)(rand16() % (2*STEP+1)) - STEP;
+        m->y += (int16_t)(rand16() % (2*STEP+1)) - STEP;
+        if (m->x < 0) m->x = 0;
+        if (m->y < 0) m->y = 0;
+        if (m->x > (GRID-1)*SPACING) m->x = (GRID-1)*SPACING;
+        if (m->y > (GRID-1)*SPACING) m->y = (GRID-1)*SPACING;
+
+        dx = (a%GRID)*SPACING - m->x;
+        dy = (a/GRID)*SPACING - m->y;
+        if (mlat_report(0x200 + (m-mobiles), 0x100+a, rssi_at(dx, dy), now, &pos)) {
+            solved++;
+            dx = pos.x - m->x;
+            dy = pos.y - m->y;
+            *error += isqrt((int32_t)dx*dx + (int32_t)dy*dy);
+        }
+    }
+
+    return solved;
+}
+
+static uint16_t rand16(void)
+{
+    seed = seed * 1103515245 + 12345;
+    return seed >> 16;
+}
+
+/**
+ * Invert the distance table of mlat.c, and add the noise.
+ */
+static int16_t rssi_at(int16_t dx, int16_t dy)
+{
+    uint16_t d = isqrt((int32_t)dx*dx + (int32_t)dy*dy);
+    int16_t rssi = RSSI_1M;
+
+    while ( (mlat_distance(rssi) < d) && (rssi > RSSI_1M - 100) ) {
+        rssi--;
+    }
+    return rssi + (int16_t)(rand16() % (2*BENCH_NOISE+1)) - BENCH_NOISE;
+}
+
+static uint16_t isqrt(uint32_t x)
+{
+    uint32_t r = 0, bit = 1L<<30;
+
+    while (bit > x) {
+        bit >>= 2;
+    }
+    while (bit) {
+        if (x >= r + bit) {
+            x -= r + bit;
+            r = (r>>1) + bit;
+        } else {
+            r >>= 1;
+        }
+        bit >>= 2;
+    }
+    return r;
+}
@@ -0,0 +1,29 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+/**
+ * Multilateration benchmark, shared by the MSP430 and the host programs.
+ *
+ * 16 anchors on a 4x4 grid with 10m spacing hear mobiles walking in the
+ * grid. The RSSI of each report follows the default path loss model of
+ * mlat.c, plus a uniform noise of BENCH_NOISE dB.
+ */
+
+#ifndef BENCH_NOISE
+#define BENCH_NOISE 2
+#endif
+
+/**
+ * Set the anchors and the random seed.
+ */
+void bench_init(uint16_t seed);
+
+/**
+ * Feed reports to mlat_report().
+ * \param count the number of reports
+ * \param error where to add the position errors, in decimetres
+ * \return the number of reports that gave a position
+ */
+uint16_t bench_run(uint16_t count, uint32_t *error);
+
+#endif
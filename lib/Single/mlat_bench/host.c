@@ -0,0 +1,33 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "mlat.h"
+#include "bench.h"
+
+#define BATCH 10000
+
+int main(int argc, char *argv[])
+{
+    struct timespec start, end;
+    uint32_t error = 0, solved = 0, reports = 0;
+    double elapsed;
+    int batches = argc > 1 ? atoi(argv[1]) : 100;
+
+    bench_init(1);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    while (batches--) {
+        solved += bench_run(BATCH, &error);
+        reports += BATCH;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("reports %lu solved %lu mean error %.1fm\n", (unsigned long)reports,
+           (unsigned long)solved, solved ? error / 10.0 / solved : 0.0);
+    printf("%.0f solves/s\n", solved / elapsed);
+
+    return 0;
+}
@@ -0,0 +1,63 @@
+#include <io.h>
+#include <signal.h>
+#include <stdio.h>
+
+#include "clock.h"
+#include "uart0.h"
+#include "leds.h"
+#include "timerA.h"
+
+#include "mlat.h"
+#include "bench.h"
+
+#define BATCH 64 // reports per measure, well below the timer wrap
+
+int putchar(int c)
+{
+    return uart0_putchar(c);
+}
+
+int main (void)
+{
+    uint32_t error, ticks;
+    uint16_t start, solved, round = 0;
+
+    WDTCTL = WDTPW+WDTHOLD;                   // Stop watchdog timer
+
+    set_mcu_speed_xt2_mclk_8MHz_smclk_1MHz();
+    set_aclk_div(1);
+
+    LEDS_INIT();
+    LEDS_OFF();
+
+    uart0_init(UART0_CONFIG_1MHZ_115200);
+    printf("-----------------------------------\n");
+    printf("MLAT benchmark, MCLK 8MHz\r\n");
+    eint();
+
+    // 4096 ticks per second
+    timerA_init();
+    timerA_start_ACLK_div(TIMERA_DIV_8);
+
+    while (1)
+    {
+        bench_init(1);
+        error = 0;
+        ticks = 0;
+        solved = 0;
+
+        LED_GREEN_ON();
+        while (ticks < 10*4096L)
+        {
+            start = timerA_time();
+            solved += bench_run(BATCH, &error);
+            ticks += (uint16_t)(timerA_time() - start);
+        }
+        LED_GREEN_OFF();
+
+        printf("#%u solved %u mean error %lu dm, %lu solves/s\n", round++,
+               solved, solved ? error / solved : 0, (uint32_t)solved * 4096 / ticks);
+    }
+
+    return 0;
+}
@@ -47,6 +47,7 @@
 #include "timerA.h"
 
 #include "single.h"
+#include "sched.h"
 
 /**********************************************************************/
 
@@ -55,6 +56,22 @@ uint16_t my_parent;
 uint8_t new_seqnum;
 uint8_t my_nbhops;
 
+/* slot map from the sink */
+uint8_t my_colour;
+uint8_t sched_version;
+uint8_t sched_colours;
+
+/* anchors heard, sent to the sink every NEIGHB_FRAMES beacons */
+uint16_t nbh_addr[NEIGHBOURS_MAX];
+uint8_t nbh_age[NEIGHBOURS_MAX];
+uint8_t nbh_count;
+uint8_t cpt_beacon;
+uint8_t neighb_pending;
+
+/* reports waiting for the sub-slot */
+spt_report_t pending[PENDING_MAX];
+uint8_t pending_count;
+
 /**********************************************************************/
 
 void init_app(void)
@@ -62,9 +79,134 @@ void init_app(void)
   printf("# ANCHOR MODE\n");
   my_seqnum = 0;
   new_seqnum = 0;
+  my_colour = SCHED_NO_COLOUR;
+  sched_version = 0;
+  sched_colours = SCHED_COLOURS_MAX;
+  nbh_count = 0;
+  cpt_beacon = 0;
+  neighb_pending = 0;
+  pending_count = 0;
   init_buffer(BUFFER_ON);
 }
 
+/**********************************************************************/
+
+void neighbour_heard(uint16_t addr)
+{
+  uint16_t i;
+
+  for (i=0; i<nbh_count; i++)
+    {
+      if ( nbh_addr[i] == addr )
+	{
+	  nbh_age[i] = 0;
+	  return;
+	}
+    }
+  if ( nbh_count < NEIGHBOURS_MAX )
+    {
+      nbh_addr[nbh_count] = addr;
+      nbh_age[nbh_count] = 0;
+      nbh_count++;
+    }
+}
+
+/**********************************************************************/
+
+uint16_t subslot_alarm(void)
+{
+  static spt_neighb_t pkt;
+  uint16_t i;
+
+  if ( neighb_pending )
+    {
+      neighb_pending = 0;
+      pkt.type = SPT_NEIGHB;
+      pkt.count = nbh_count;
+      pkt.id_source = node_addr;
+      pkt.id_dest = my_parent;
+      pkt.ttl = DEFAULT_TTL;
+      for (i=0; i<nbh_count; i++)
+	pkt.neighbours[i] = nbh_addr[i];
+      PRINTF("#> sending NEIGHB (%u)\n", nbh_count);
+      /* broadcast so that the other anchors hear it too */
+      my_send((uint8_t *)&pkt, sizeof(pkt), MAC_BROADCAST);
+    }
+
+  for (i=0; i<pending_count; i++)
+    my_send((uint8_t *)&pending[i], sizeof(spt_report_t), my_parent);
+  pending_count = 0;
+
+  return 0;
+}
+
+/**********************************************************************/
+
+void set_subslot_alarm(uint16_t subslot)
+{
+  timerA_register_cb(TIMERA_ALARM_CCR1, subslot_alarm);
+  timerA_set_alarm_from_now(TIMERA_ALARM_CCR1, subslot * SUBSLOT, 0);
+}
+
+/**********************************************************************/
+
+void beacon_accepted(void)
+{
+  uint16_t i;
+
+  /* the beacon starts slot 1 of the sink */
+  align_slots(1);
+
+  for (i=0; i<nbh_count; )
+    {
+      if ( ++nbh_age[i] > NEIGHBOUR_AGE_MAX )
+	{
+	  nbh_count--;
+	  nbh_addr[i] = nbh_addr[nbh_count];
+	  nbh_age[i] = nbh_age[nbh_count];
+	}
+      else
+	i++;
+    }
+
+  cpt_beacon++;
+  if ( cpt_beacon >= NEIGHB_FRAMES )
+    {
+      cpt_beacon = 0;
+      neighb_pending = 1;
+      /* sub-slot 0 is for the slot map */
+      if ( my_colour != SCHED_NO_COLOUR )
+	set_subslot_alarm(1 + my_colour);
+      else
+	set_subslot_alarm(1 + rand() % sched_colours);
+    }
+}
+
+/**********************************************************************/
+
+void schedule_received(spt_sched_t *pkt)
+{
+  uint16_t i;
+
+  if ( pkt->count > SCHED_ENTRIES )
+    return;
+
+  if ( pkt->version != sched_version )
+    {
+      /* the old colour may conflict with the new map */
+      sched_version = pkt->version;
+      my_colour = SCHED_NO_COLOUR;
+    }
+  sched_colours = pkt->colours ? pkt->colours : 1;
+  set_schedule(pkt->period, pkt->frame_size, pkt->active_slots);
+
+  for (i=0; i<pkt->count; i++)
+    {
+      if ( pkt->addr[i] == node_addr )
+	my_colour = pkt->colour[i];
+    }
+}
+
 uint16_t send_packet(void) {
   activity_schedule();
   if ( num_slot == 0 )
@@ -79,6 +221,7 @@ uint16_t packet_received(uint8_t packet[], uint16_t length, uint16_t src_addr, i
   spt_hello_t *pkt=(spt_hello_t *)packet;
   spt_beacon_t *pkt_beacon;
   spt_report_t *pkt_report, my_report;
+  spt_neighb_t *pkt_neighb;
 
   //  notice_packet_received_mac();
 
@@ -105,7 +248,15 @@ uint16_t packet_received(uint8_t packet[], uint16_t length, uint16_t src_addr, i
 	my_report.info.time_anchor = timerA_time();
 	my_report.info.id_mobile = src_addr;
 	my_report.info.rssi_dbm = rssi;
-	my_send((uint8_t *)&my_report, sizeof(spt_report_t), my_parent);
+	if ( my_colour == SCHED_NO_COLOUR )
+	  my_send((uint8_t *)&my_report, sizeof(spt_report_t), my_parent);
+	else if ( pending_count < PENDING_MAX )
+	  {
+	    /* wait for the sub-slot, counted from the HELLO */
+	    pending[pending_count++] = my_report;
+	    if ( pending_count == 1 )
+	      set_subslot_alarm(1 + my_colour);
+	  }
 #ifdef DEBUG
 	LED_RED_OFF();
 #endif
@@ -122,6 +273,7 @@ uint16_t packet_received(uint8_t packet[], uint16_t length, uint16_t src_addr, i
 	    my_parent = src_addr;
 	    my_state = STATE_ACTIVE;
 	    cpt_last_beacon = 0;
+	    beacon_accepted();
 	  }
 	else
 	  if ( my_state == STATE_ACTIVE )
@@ -131,6 +283,7 @@ uint16_t packet_received(uint8_t packet[], uint16_t length, uint16_t src_addr, i
 		  my_seqnum = pkt_beacon->seqnum;
 		  my_nbhops = pkt_beacon->nbhops+1;
 		  cpt_last_beacon = 0;
+		  beacon_accepted();
 		}
 	      else
 		if ( TIME_CMP(my_seqnum, pkt_beacon->seqnum) < 0 )
@@ -139,6 +292,7 @@ uint16_t packet_received(uint8_t packet[], uint16_t length, uint16_t src_addr, i
 		    my_nbhops = pkt_beacon->nbhops+1;
 		    my_parent = src_addr;
 		    cpt_last_beacon = 0;
+		    beacon_accepted();
 		  }
 	    }
       }
@@ -160,6 +314,22 @@ uint16_t packet_received(uint8_t packet[], uint16_t length, uint16_t src_addr, i
 	LED_GREEN_OFF();
 #endif
       }
+    break;
+  case SPT_NEIGHB: /******************************/
+    pkt_neighb = (spt_neighb_t *)packet;
+    neighbour_heard(src_addr);
+    if ( my_state == STATE_ACTIVE && pkt_neighb->id_dest == node_addr
+	 && pkt_neighb->ttl != 0 )
+      {
+	PRINTF("#> relaying NEIGHB (from %4x to %4x)\n", src_addr, my_parent);
+	pkt_neighb->ttl--;
+	pkt_neighb->id_dest = my_parent;
+	my_send((uint8_t *)pkt_neighb, sizeof(spt_neighb_t), my_parent);
+      }
+    break;
+  case SPT_SCHED: /******************************/
+    schedule_received((spt_sched_t *)packet);
+    break;
   }
 
   return 0;
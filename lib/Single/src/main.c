@@ -85,6 +85,9 @@ uint8_t cpt_blank; /**< the number of cycles without packet reception
 
 uint16_t num_slot;
 uint16_t num_frame;
+uint16_t slot_period;
+uint8_t frame_size;
+uint8_t active_slots;
 uint8_t my_radio_state;
 
 uint8_t buffer_state;
@@ -155,6 +158,9 @@ int main(void)
     my_state = STATE_DEFAULT;
     num_slot = 0;
     num_frame = 0;
+    slot_period = PERIOD;
+    frame_size = FRAME_SIZE;
+    active_slots = ACTIVE_SLOTS;
 
     init_buffer(BUFFER_OFF);
     init_app();
@@ -162,7 +168,7 @@ int main(void)
     timerA_init();
     timerA_start_ACLK_div(TIMERA_DIV_8);
     timerA_register_cb(TIMERA_ALARM_CCR0, send_packet);
-    timerA_set_alarm_from_now(TIMERA_ALARM_CCR0, PERIOD, PERIOD);
+    timerA_set_alarm_from_now(TIMERA_ALARM_CCR0, slot_period, slot_period);
 
     LEDS_OFF();
     /* end of initialization phase */
@@ -196,6 +202,30 @@ void synchronize_mac(void)
 
 /**********************************************************************/
 
+void set_schedule(uint16_t period, uint8_t frame, uint8_t active)
+{
+  if ( period == 0 || frame == 0 || active >= frame )
+    return;
+
+  if ( period != slot_period )
+    timerA_update_alarm_period(TIMERA_ALARM_CCR0, period);
+  slot_period = period;
+  frame_size = frame;
+  active_slots = active;
+  if ( num_slot >= frame_size )
+    num_slot = 0;
+}
+
+/**********************************************************************/
+
+void align_slots(uint16_t slot)
+{
+  num_slot = slot;
+  timerA_set_alarm_from_now(TIMERA_ALARM_CCR0, slot_period, slot_period);
+}
+
+/**********************************************************************/
+
 void notice_packet_received_mac(void)
 {
   cpt_blank = 0;
@@ -349,7 +379,7 @@ void radio_off()
 uint16_t activity_schedule()
 {
   num_slot++;
-  if ( num_slot >= FRAME_SIZE )
+  if ( num_slot >= frame_size )
     {
       num_slot = 0;
       if ( my_state == STATE_ACTIVE )
@@ -382,7 +412,7 @@ uint16_t activity_schedule()
 	}
   }
 
-  if ( my_state == STATE_ACTIVE && num_slot == ACTIVE_SLOTS )
+  if ( my_state == STATE_ACTIVE && num_slot == active_slots )
     {
       radio_off();
       PRINTF("#> active mode: mac off\n");
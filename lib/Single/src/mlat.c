@@ -0,0 +1,329 @@
+/*
+ * Copyright  2008-2009 INRIA/SensTools
+ *
+ * <dev-team@sentools.info>
+ *
+ * This software is a set of libraries designed to develop applications
+ * for the WSN430 embedded hardware platform.
+ *
+ * This software is governed by the CeCILL license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL license and that you accept its terms.
+ */
+
+/**
+ * \file
+ * \brief Fixed-point multilateration of the mobiles from the anchor reports
+ * \date October 2026
+ *
+ * The solver takes the anchor with the shortest distance as reference,
+ * and subtracts its circle equation from the others, which gives a
+ * linear system in the position relative to the reference:
+ *     (xi-x0)*X + (yi-y0)*Y = ((xi-x0)^2 + (yi-y0)^2 + d0^2 - di^2) / 2
+ * The 2x2 normal equations are accumulated in 64 bits, with a weight
+ * falling with the distance since the RSSI error grows with it.
+ */
+
+#include <stdint.h>
+
+#include "mlat.h"
+
+/* ----DEFINES---- */
+#define DISTANCE_STEPS 64   // distance table, 1dB steps from the 1m RSSI
+#define DISTANCE_MAX   5000 // decimetres, far reports are not worth more
+#define COORD_MAX      8191 // decimetres, keeps the equations in 32 bits
+#define WEIGHT_D       100  // decimetres, weight halves from 1 at this distance
+#define COND_SHIFT     6    // det must be above 1/64 of Sxx*Syy
+#define SUM_MAX        (1L<<30)
+#define LN10_Q16       150902L
+
+#define NO_ANCHOR 0xFF
+
+#if MLAT_ANCHORS_MAX >= NO_ANCHOR
+#error "MLAT_ANCHORS_MAX must fit a byte"
+#endif
+#if MLAT_REPORTS_MAX < 3
+#error "MLAT_REPORTS_MAX must be at least 3"
+#endif
+
+/* ----STRUCTURES---- */
+typedef struct {
+  uint16_t id;
+  int16_t x, y;
+} anchor_t;
+
+typedef struct {
+  uint8_t anchor; // index in anchors[], NO_ANCHOR if the entry is free
+  uint16_t dist;
+  uint16_t time;
+} report_t;
+
+typedef struct {
+  uint16_t id; // 0 if the entry is free
+  uint16_t heard;
+  report_t reports[MLAT_REPORTS_MAX];
+} mobile_t;
+
+/* ----PROTOTYPES---- */
+static mobile_t* find_mobile(uint16_t id, uint16_t now);
+static uint16_t solve(mobile_t *m, uint16_t now, mlat_point_t *pos);
+static int64_t div_round(int64_t num, int64_t den);
+
+/* ----DATA---- */
+static anchor_t anchors[MLAT_ANCHORS_MAX];
+static uint16_t anchor_count;
+static mobile_t mobiles[MLAT_MOBILES_MAX];
+static uint16_t distances[DISTANCE_STEPS];
+static int16_t model_rssi_1m;
+
+void mlat_init(void)
+{
+  int i;
+
+  anchor_count = 0;
+  for (i=0; i<MLAT_MOBILES_MAX; i++)
+    {
+      mobiles[i].id = 0;
+    }
+  mlat_set_model(-40, 30);
+}
+
+void mlat_set_model(int16_t rssi_1m, uint16_t exponent10)
+{
+  uint32_t x, r;
+  uint64_t d;
+  int i;
+
+  if (exponent10 < 10)
+    exponent10 = 10;
+
+  // r = exp(ln(10)/exponent10) is the distance ratio of one dB
+  x = LN10_Q16 / exponent10;
+  r = 65536 + x;
+  r += (x * x) >> 17;
+  r += (((x * x) >> 16) * x) / (6L<<16);
+  r += (((((x * x) >> 16) * x) >> 16) * x) / (24L<<16);
+
+  d = 10L<<16;
+  for (i=0; i<DISTANCE_STEPS; i++)
+    {
+      distances[i] = (d>>16) > DISTANCE_MAX ? DISTANCE_MAX : (d>>16);
+      d = (d * r) >> 16;
+      if ((d>>16) > DISTANCE_MAX)
+	d = (uint64_t)DISTANCE_MAX<<16;
+    }
+  model_rssi_1m = rssi_1m;
+}
+
+uint16_t mlat_set_anchor(uint16_t id, int16_t x, int16_t y)
+{
+  uint16_t i;
+
+  if (x > COORD_MAX) x = COORD_MAX;
+  if (x < -COORD_MAX) x = -COORD_MAX;
+  if (y > COORD_MAX) y = COORD_MAX;
+  if (y < -COORD_MAX) y = -COORD_MAX;
+
+  for (i=0; i<anchor_count; i++)
+    {
+      if (anchors[i].id == id)
+	break;
+    }
+  if (i == MLAT_ANCHORS_MAX)
+    return 0;
+
+  anchors[i].id = id;
+  anchors[i].x = x;
+  anchors[i].y = y;
+  if (i == anchor_count)
+    anchor_count++;
+  return 1;
+}
+
+uint16_t mlat_distance(int16_t rssi)
+{
+  int16_t loss = model_rssi_1m - rssi;
+
+  if (loss < 0)
+    return distances[0];
+  if (loss >= DISTANCE_STEPS)
+    return distances[DISTANCE_STEPS-1];
+  return distances[loss];
+}
+
+uint16_t mlat_report(uint16_t mobile, uint16_t anchor, int16_t rssi,
+		     uint16_t now, mlat_point_t *pos)
+{
+  mobile_t *m;
+  report_t *r;
+  uint16_t a, i;
+
+  for (a=0; a<anchor_count; a++)
+    {
+      if (anchors[a].id == anchor)
+	break;
+    }
+  if (a == anchor_count)
+    return 0;
+
+  m = find_mobile(mobile, now);
+
+  // the entry of this anchor, else the oldest one
+  r = &m->reports[0];
+  for (i=0; i<MLAT_REPORTS_MAX; i++)
+    {
+      if (m->reports[i].anchor == a)
+	{
+	  r = &m->reports[i];
+	  break;
+	}
+      if ( (r->anchor != NO_ANCHOR) &&
+	   ( (m->reports[i].anchor == NO_ANCHOR) ||
+	     (uint16_t)(now - m->reports[i].time) > (uint16_t)(now - r->time) ) )
+	r = &m->reports[i];
+    }
+
+  r->anchor = a;
+  r->dist = mlat_distance(rssi);
+  r->time = now;
+
+  return solve(m, now, pos);
+}
+
+/**
+ * Get the entry of a mobile, taking a free or the least recently heard
+ * one if it is not known.
+ */
+static mobile_t* find_mobile(uint16_t id, uint16_t now)
+{
+  mobile_t *m = &mobiles[0];
+  int i;
+
+  for (i=0; i<MLAT_MOBILES_MAX; i++)
+    {
+      if (mobiles[i].id == id)
+	{
+	  mobiles[i].heard = now;
+	  return &mobiles[i];
+	}
+      if ( (m->id != 0) &&
+	   ( (mobiles[i].id == 0) ||
+	     (uint16_t)(now - mobiles[i].heard) > (uint16_t)(now - m->heard) ) )
+	m = &mobiles[i];
+    }
+
+  m->id = id;
+  m->heard = now;
+  for (i=0; i<MLAT_REPORTS_MAX; i++)
+    {
+      m->reports[i].anchor = NO_ANCHOR;
+    }
+  return m;
+}
+
+/**
+ * Weighted least squares over the fresh reports of a mobile.
+ * \return the number of reports used, 0 if there are too few of them or
+ * the anchors are about aligned.
+ */
+static uint16_t solve(mobile_t *m, uint16_t now, mlat_point_t *pos)
+{
+  report_t *ref = 0x0, *r;
+  int32_t ax, ay, b, d0_2;
+  int64_t sxx, sxy, syy, sxb, syb, det, px, py;
+  int32_t w;
+  uint16_t i, n;
+
+  // the nearest anchor is the reference, its distance is the most accurate
+  n = 0;
+  for (i=0; i<MLAT_REPORTS_MAX; i++)
+    {
+      r = &m->reports[i];
+      if ( (r->anchor == NO_ANCHOR) ||
+	   (uint16_t)(now - r->time) > MLAT_AGE_MAX )
+	continue;
+      n++;
+      if ( (ref == 0x0) || (r->dist < ref->dist) )
+	ref = r;
+    }
+  if (n < 3)
+    return 0;
+
+  d0_2 = (int32_t)ref->dist * ref->dist;
+  sxx = sxy = syy = sxb = syb = 0;
+  for (i=0; i<MLAT_REPORTS_MAX; i++)
+    {
+      r = &m->reports[i];
+      if ( (r == ref) || (r->anchor == NO_ANCHOR) ||
+	   (uint16_t)(now - r->time) > MLAT_AGE_MAX )
+	continue;
+
+      ax = anchors[r->anchor].x - anchors[ref->anchor].x;
+      ay = anchors[r->anchor].y - anchors[ref->anchor].y;
+      b = (ax*ax + ay*ay + d0_2 - (int32_t)r->dist * r->dist) / 2;
+
+      // (1/(1+d/WEIGHT_D))^2, 256 is 1
+      w = ((int32_t)256 * WEIGHT_D) / (r->dist + WEIGHT_D);
+      w = (w * w) >> 8;
+
+      sxx += (int64_t)(w * ax) * ax;
+      sxy += (int64_t)(w * ax) * ay;
+      syy += (int64_t)(w * ay) * ay;
+      sxb += (int64_t)(w * ax) * b;
+      syb += (int64_t)(w * ay) * b;
+    }
+
+  // scale the sums down so that the products below fit 63 bits
+  while ( sxx >= SUM_MAX || syy >= SUM_MAX ||
+	  sxy >= SUM_MAX || sxy <= -SUM_MAX ||
+	  sxb >= SUM_MAX || sxb <= -SUM_MAX ||
+	  syb >= SUM_MAX || syb <= -SUM_MAX )
+    {
+      sxx >>= 1;
+      sxy >>= 1;
+      syy >>= 1;
+      sxb >>= 1;
+      syb >>= 1;
+    }
+
+  det = sxx * syy - sxy * sxy;
+  if ( (det <= 0) || det < ((sxx * syy) >> COND_SHIFT) )
+    return 0;
+
+  px = anchors[ref->anchor].x + div_round(syy * sxb - sxy * syb, det);
+  py = anchors[ref->anchor].y + div_round(sxx * syb - sxy * sxb, det);
+
+  pos->x = px > 0x7FFF ? 0x7FFF : (px < -0x7FFF ? -0x7FFF : px);
+  pos->y = py > 0x7FFF ? 0x7FFF : (py < -0x7FFF ? -0x7FFF : py);
+  return n;
+}
+
+static int64_t div_round(int64_t num, int64_t den)
+{
+  // den is positive
+  if (num < 0)
+    return -((-num + den/2) / den);
+  return (num + den/2) / den;
+}
@@ -0,0 +1,128 @@
+/*
+ * Copyright  2008-2009 INRIA/SensTools
+ *
+ * <dev-team@sentools.info>
+ *
+ * This software is a set of libraries designed to develop applications
+ * for the WSN430 embedded hardware platform.
+ *
+ * This software is governed by the CeCILL license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL license and that you accept its terms.
+ */
+
+/**
+ * \file
+ * \brief Fixed-point multilateration of the mobiles from the anchor reports
+ * \date October 2026
+ *
+ * Each report gives the RSSI an anchor measured on a mobile hello. The
+ * RSSI is turned into a distance with a log-distance path loss model,
+ * and every new report updates the position of the mobile by weighted
+ * least squares over the latest report of each anchor.
+ *
+ * Only integer arithmetic is used, so the same code runs on the sink
+ * and on a PC. Positions and distances are in decimetres.
+ */
+
+#ifndef _MLAT_H_
+#define _MLAT_H_
+
+#include <stdint.h>
+
+/**
+ * Number of anchors whose position is known.
+ */
+#ifndef MLAT_ANCHORS_MAX
+#define MLAT_ANCHORS_MAX 32
+#endif
+
+/**
+ * Number of mobiles tracked at once, the least recently heard is
+ * replaced.
+ */
+#ifndef MLAT_MOBILES_MAX
+#define MLAT_MOBILES_MAX 4
+#endif
+
+/**
+ * Number of reports kept per mobile, the oldest is replaced.
+ */
+#ifndef MLAT_REPORTS_MAX
+#define MLAT_REPORTS_MAX 8
+#endif
+
+/**
+ * Age after which a report is not used anymore, in the time unit of
+ * mlat_report().
+ */
+#ifndef MLAT_AGE_MAX
+#define MLAT_AGE_MAX 16
+#endif
+
+typedef struct {
+  int16_t x, y;
+} mlat_point_t;
+
+/**
+ * Forget the anchors and the mobiles, and set the default path loss
+ * model (-40dBm at 1m, exponent 3).
+ */
+void mlat_init(void);
+
+/**
+ * Set the path loss model.
+ * \param rssi_1m the RSSI at 1 meter, in dBm
+ * \param exponent10 ten times the path loss exponent, 15 to 60
+ */
+void mlat_set_model(int16_t rssi_1m, uint16_t exponent10);
+
+/**
+ * Set the position of an anchor.
+ * \param id the anchor address
+ * \return 1 if ok, 0 if the table is full
+ */
+uint16_t mlat_set_anchor(uint16_t id, int16_t x, int16_t y);
+
+/**
+ * Get the distance matching an RSSI.
+ * \param rssi the RSSI in dBm
+ * \return the distance in decimetres
+ */
+uint16_t mlat_distance(int16_t rssi);
+
+/**
+ * Account a report, and update the position of the mobile.
+ * \param mobile the mobile address
+ * \param anchor the anchor address, reports of unknown anchors are ignored
+ * \param rssi the RSSI in dBm
+ * \param now the current time, in any unit, for the report ages
+ * \param pos where to write the position
+ * \return the number of reports used, 0 if the position is unknown
+ */
+uint16_t mlat_report(uint16_t mobile, uint16_t anchor, int16_t rssi,
+		     uint16_t now, mlat_point_t *pos);
+
+#endif
@@ -92,6 +92,7 @@ uint16_t packet_received(uint8_t packet[], uint16_t length,
 			 uint16_t src_addr, int16_t rssi)
 {
   spt_beacon_t *pkt=(spt_beacon_t *)packet;
+  spt_sched_t *pkt_sched=(spt_sched_t *)packet;
 
 #ifdef DEBUG
   LED_RED_ON();
@@ -102,10 +103,14 @@ uint16_t packet_received(uint8_t packet[], uint16_t length,
     {
       my_state = STATE_ACTIVE;
       cpt_last_beacon = 0;
-      num_slot = 1;
+      /* the HELLO is sent one slot after the beacon */
+      align_slots(1);
       my_seqnum = pkt->seqnum;
       beacon_received = 1;
     }
+  else if ( pkt->type == SPT_SCHED )
+    set_schedule(pkt_sched->period, pkt_sched->frame_size,
+		 pkt_sched->active_slots);
 #ifdef DEBUG
   LED_RED_OFF();
 #endif
@@ -0,0 +1,259 @@
+/*
+ * Copyright  2008-2009 INRIA/SensTools
+ *
+ * <dev-team@sentools.info>
+ *
+ * This software is a set of libraries designed to develop applications
+ * for the WSN430 embedded hardware platform.
+ *
+ * This software is governed by the CeCILL license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL license and that you accept its terms.
+ */
+
+/**
+ * \file
+ * \brief Report slot schedule computed by the sink
+ * \date October 2026
+ *
+ * Vertex 0 is the sink, edges are kept as the neighbour bitmap each
+ * vertex reported and made symmetric when colouring. The colouring is
+ * the greedy largest degree first one, on the square of the graph.
+ */
+
+#include <stdint.h>
+
+#include "sched.h"
+
+#if SCHED_NODES_MAX > 32
+#error "SCHED_NODES_MAX must fit the 32 bits neighbour bitmaps"
+#endif
+#if SCHED_COLOURS_MAX > 32
+#error "SCHED_COLOURS_MAX must fit the 32 bits colour bitmaps"
+#endif
+
+/* ----STRUCTURES---- */
+typedef struct {
+  uint16_t addr;
+  uint32_t heard; // bitmap of the vertices this one reported
+  uint8_t age;
+  uint8_t colour;
+} vertex_t;
+
+/* ----PROTOTYPES---- */
+static int16_t find(uint16_t addr, uint16_t add);
+static void drop(uint16_t v);
+static uint16_t bit_count(uint32_t x);
+
+/* ----DATA---- */
+static vertex_t vertices[SCHED_NODES_MAX];
+static uint16_t vertex_count;
+
+void sched_init(uint16_t sink)
+{
+  vertices[0].addr = sink;
+  vertices[0].heard = 0;
+  vertices[0].age = 0;
+  vertices[0].colour = SCHED_NO_COLOUR;
+  vertex_count = 1;
+}
+
+uint16_t sched_neighbours(uint16_t addr, const uint16_t *neighbours,
+			  uint16_t count)
+{
+  uint32_t heard = 0;
+  int16_t v, n;
+  uint16_t i;
+
+  v = find(addr, 1);
+  if ( v < 0 )
+    return 0;
+  vertices[v].age = 0;
+
+  for (i=0; i<count; i++)
+    {
+      n = find(neighbours[i], 1);
+      if ( n >= 0 && n != v )
+	heard |= 1UL<<n;
+    }
+
+  if ( heard == vertices[v].heard )
+    return 0;
+  vertices[v].heard = heard;
+  return 1;
+}
+
+uint16_t sched_heard(uint16_t addr)
+{
+  int16_t v = find(addr, 1);
+
+  if ( v <= 0 || (vertices[0].heard & (1UL<<v)) )
+    return 0;
+  vertices[0].heard |= 1UL<<v;
+  return 1;
+}
+
+uint16_t sched_age(void)
+{
+  uint16_t v, changed = 0;
+
+  for (v=vertex_count-1; v>0; v--)
+    {
+      if ( ++vertices[v].age > SCHED_AGE_MAX )
+	{
+	  drop(v);
+	  changed = 1;
+	}
+    }
+  return changed;
+}
+
+uint16_t sched_compile(void)
+{
+  uint32_t adj[SCHED_NODES_MAX], conflict[SCHED_NODES_MAX];
+  uint32_t done, used;
+  uint16_t degree[SCHED_NODES_MAX];
+  uint16_t u, v, best, colours = 0;
+
+  // symmetric adjacency
+  for (u=0; u<vertex_count; u++)
+    {
+      adj[u] = vertices[u].heard;
+      for (v=0; v<vertex_count; v++)
+	{
+	  if ( vertices[v].heard & (1UL<<u) )
+	    adj[u] |= 1UL<<v;
+	}
+    }
+
+  // two hops conflicts, the sink excluded since it doesn't report
+  for (u=1; u<vertex_count; u++)
+    {
+      conflict[u] = adj[u];
+      for (v=0; v<vertex_count; v++)
+	{
+	  if ( adj[u] & (1UL<<v) )
+	    conflict[u] |= adj[v];
+	}
+      conflict[u] &= ~((1UL<<u) | 1UL);
+      degree[u] = bit_count(conflict[u]);
+      vertices[u].colour = SCHED_NO_COLOUR;
+    }
+
+  // colour the most constrained anchors first
+  done = 1UL;
+  while ( done != (vertex_count == 32 ? 0xFFFFFFFFUL : (1UL<<vertex_count)-1) )
+    {
+      best = 0;
+      for (u=1; u<vertex_count; u++)
+	{
+	  if ( !(done & (1UL<<u)) && (best == 0 || degree[u] > degree[best]) )
+	    best = u;
+	}
+      done |= 1UL<<best;
+
+      used = 0;
+      for (v=1; v<vertex_count; v++)
+	{
+	  if ( (conflict[best] & (1UL<<v)) && vertices[v].colour != SCHED_NO_COLOUR )
+	    used |= 1UL<<vertices[v].colour;
+	}
+      for (u=0; u<SCHED_COLOURS_MAX && (used & (1UL<<u)); u++)
+	;
+      if ( u < SCHED_COLOURS_MAX )
+	{
+	  vertices[best].colour = u;
+	  if ( u >= colours )
+	    colours = u+1;
+	}
+    }
+
+  return colours;
+}
+
+uint16_t sched_count(void)
+{
+  return vertex_count-1;
+}
+
+uint16_t sched_node(uint16_t i, uint8_t *colour)
+{
+  *colour = vertices[i+1].colour;
+  return vertices[i+1].addr;
+}
+
+/**
+ * Get the index of a vertex.
+ * \param add 1 to add it if it is unknown
+ * \return the index, -1 if unknown or the table is full
+ */
+static int16_t find(uint16_t addr, uint16_t add)
+{
+  uint16_t v;
+
+  for (v=0; v<vertex_count; v++)
+    {
+      if ( vertices[v].addr == addr )
+	return v;
+    }
+  if ( !add || vertex_count == SCHED_NODES_MAX )
+    return -1;
+
+  vertices[v].addr = addr;
+  vertices[v].heard = 0;
+  vertices[v].age = 0;
+  vertices[v].colour = SCHED_NO_COLOUR;
+  vertex_count++;
+  return v;
+}
+
+/**
+ * Remove a vertex, the last one takes its index.
+ */
+static void drop(uint16_t v)
+{
+  uint16_t last = vertex_count-1, u;
+
+  for (u=0; u<vertex_count; u++)
+    {
+      vertices[u].heard &= ~(1UL<<v);
+      if ( vertices[u].heard & (1UL<<last) )
+	vertices[u].heard = (vertices[u].heard & ~(1UL<<last)) | (1UL<<v);
+    }
+  vertices[v] = vertices[last];
+  vertex_count--;
+}
+
+static uint16_t bit_count(uint32_t x)
+{
+  uint16_t n = 0;
+
+  while ( x )
+    {
+      x &= x-1;
+      n++;
+    }
+  return n;
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright  2008-2009 INRIA/SensTools
+ *
+ * <dev-team@sentools.info>
+ *
+ * This software is a set of libraries designed to develop applications
+ * for the WSN430 embedded hardware platform.
+ *
+ * This software is governed by the CeCILL license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL license and that you accept its terms.
+ */
+
+/**
+ * \file
+ * \brief Report slot schedule computed by the sink
+ * \date October 2026
+ *
+ * The anchors report their neighbours to the sink, which builds the
+ * topology and colours it so that two anchors within two hops of each
+ * other, hence sharing a receiver, never report in the same sub-slot.
+ * The sink itself is a vertex of the graph but gets no colour.
+ *
+ * There is no radio nor timer code here, the sink feeds the neighbour
+ * lists and broadcasts the result.
+ */
+
+#ifndef _SCHED_H_
+#define _SCHED_H_
+
+#include <stdint.h>
+
+/**
+ * Number of vertices, the sink included, a bitmap of them must fit
+ * 32 bits.
+ */
+#ifndef SCHED_NODES_MAX
+#define SCHED_NODES_MAX 32
+#endif
+
+/**
+ * Number of sched_age() calls after which an anchor that didn't report
+ * its neighbours is removed.
+ */
+#ifndef SCHED_AGE_MAX
+#define SCHED_AGE_MAX 8
+#endif
+
+/**
+ * Number of colours, an anchor that can't get one isn't scheduled.
+ */
+#ifndef SCHED_COLOURS_MAX
+#define SCHED_COLOURS_MAX 16
+#endif
+
+#define SCHED_NO_COLOUR 0xFF
+
+/**
+ * Empty the graph.
+ * \param sink the sink address
+ */
+void sched_init(uint16_t sink);
+
+/**
+ * Set the neighbours of an anchor, replacing the previous ones.
+ * \param addr the anchor address
+ * \param neighbours the addresses the anchor hears
+ * \param count the number of neighbours
+ * \return 1 if the graph changed
+ */
+uint16_t sched_neighbours(uint16_t addr, const uint16_t *neighbours,
+			  uint16_t count);
+
+/**
+ * Add a link between the sink and an anchor it heard.
+ * \return 1 if the graph changed
+ */
+uint16_t sched_heard(uint16_t addr);
+
+/**
+ * Age the anchors and remove the ones that are silent.
+ * \return 1 if the graph changed
+ */
+uint16_t sched_age(void);
+
+/**
+ * Colour the graph, two anchors within two hops get different colours.
+ * \return the number of colours used
+ */
+uint16_t sched_compile(void);
+
+/**
+ * Get the number of anchors in the graph.
+ */
+uint16_t sched_count(void);
+
+/**
+ * Get an anchor of the graph and its colour.
+ * \param i the anchor index, less than sched_count()
+ * \param colour where to write the colour
+ * \return the anchor address
+ */
+uint16_t sched_node(uint16_t i, uint8_t *colour);
+
+#endif
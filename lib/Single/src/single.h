@@ -51,6 +51,16 @@
 #define ACTIVE_SLOTS 4
 #define FRAME_PERIOD 4
 
+/* report schedule, see sched.h: the sink sends its slot map right after
+   the beacon, then each anchor sends its neighbours in its sub-slot of
+   slot 1 and its reports in its sub-slot after the mobile HELLO */
+#define SUBSLOT 41                /* 10ms */
+#define SLOT_PERIOD_MIN (PERIOD/8)
+#define NEIGHB_FRAMES 4           /* beacons between two neighbour reports */
+#define NEIGHBOURS_MAX 8
+#define NEIGHBOUR_AGE_MAX 12      /* beacons */
+#define PENDING_MAX 4             /* reports waiting for the sub-slot */
+
 // WARNING this is from csma.c !
 #define PACKET_LENGTH_MAX 58
 
@@ -61,12 +71,26 @@ typedef struct {
   int rssi_dbm;
 } mobile_info_t;
 
+/* SINK LOCALIZATION */
+
+/* anchor positions known by the sink, { address, x, y } in decimetres,
+   e.g. -DANCHOR_POSITIONS="{0xb020,0,0},{0xbc97,100,0},{0xa3f1,0,100}," */
+#ifndef ANCHOR_POSITIONS
+#define ANCHOR_POSITIONS
+#endif
+
+/* path loss model: RSSI at 1m in dBm, ten times the exponent */
+#define MODEL_RSSI_1M (-40)
+#define MODEL_EXPONENT10 30
+
 /* SINGLE PACKET TYPES */
 
 #define SPT_BEACON 42
 #define SPT_REPORT 43
 #define SPT_ACKRPT 34
 #define SPT_HELLO  74
+#define SPT_NEIGHB 75
+#define SPT_SCHED  76
 
 typedef struct {
   uint8_t type;
@@ -93,6 +117,30 @@ typedef struct {
   uint8_t bourinator[12]; /* to ensure sufficient length for RSSI evaluation */
 } spt_hello_t;
 
+typedef struct {
+  uint8_t type;
+  uint8_t count;
+  uint16_t id_source;
+  uint16_t id_dest;
+  uint8_t ttl;
+  uint8_t rfu;
+  uint16_t neighbours[NEIGHBOURS_MAX];
+} spt_neighb_t;
+
+#define SCHED_ENTRIES 12
+
+typedef struct {
+  uint8_t type;
+  uint8_t version;
+  uint16_t period;
+  uint8_t frame_size;
+  uint8_t active_slots;
+  uint8_t colours;
+  uint8_t count;
+  uint16_t addr[SCHED_ENTRIES];
+  uint8_t colour[SCHED_ENTRIES];
+} spt_sched_t;
+
 #define UNKNOWN_NB_HOPS 255
 #define DEFAULT_TTL 20
 
@@ -108,6 +156,14 @@ extern uint16_t num_slot;
 
 extern uint16_t cpt_last_beacon;
 
+/* FRAME_SIZE, ACTIVE_SLOTS and PERIOD until the sink sends its schedule */
+extern uint16_t slot_period;
+extern uint8_t frame_size;
+extern uint8_t active_slots;
+
+void set_schedule(uint16_t period, uint8_t frame, uint8_t active);
+void align_slots(uint16_t slot);
+
 /**********************************************************************/
 
 #define THRESHOLD_BEACON_MOBILE 3
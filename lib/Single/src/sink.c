@@ -47,6 +47,8 @@
 #include "timerA.h"
 
 #include "single.h"
+#include "mlat.h"
+#include "sched.h"
 
 
 /**********************************************************************/
@@ -54,15 +56,92 @@
 uint16_t my_seqnum;
 uint16_t my_clock;
 
+uint8_t sched_version;
+uint8_t sched_colours;
+uint8_t sched_changed;
+uint16_t sched_next; /* first anchor of the next slot map */
+
+static const struct {
+  uint16_t id;
+  int16_t x, y;
+} anchor_positions[] = { ANCHOR_POSITIONS {0, 0, 0} };
+
 /**********************************************************************/
 
 void init_app(void)
 {
+  uint16_t i;
+
   printf("# SINK MODE\n");
   my_seqnum = 0;
   my_clock = 0;
+
+  sched_init(node_addr);
+  sched_version = 0;
+  sched_colours = SCHED_COLOURS_MAX;
+  sched_changed = 0;
+  sched_next = 0;
+
+  mlat_init();
+  mlat_set_model(MODEL_RSSI_1M, MODEL_EXPONENT10);
+  for (i=0; anchor_positions[i].id != 0; i++)
+    {
+      mlat_set_anchor(anchor_positions[i].id,
+		      anchor_positions[i].x, anchor_positions[i].y);
+    }
 }
 
+/**********************************************************************/
+
+void compile_schedule(void)
+{
+  uint16_t period;
+
+  sched_colours = sched_compile();
+  sched_version++;
+  sched_changed = 0;
+
+  /* slot 1 holds the slot map and the neighbour sub-slots */
+  period = (sched_colours + 2) * SUBSLOT;
+  if ( period < SLOT_PERIOD_MIN )
+    period = SLOT_PERIOD_MIN;
+  if ( period > PERIOD )
+    period = PERIOD;
+  set_schedule(period, FRAME_SIZE, ACTIVE_SLOTS);
+
+  printf("# schedule %u: %u anchors, %u colours, period %u\n",
+	 sched_version, sched_count(), sched_colours, period);
+}
+
+/**********************************************************************/
+
+uint16_t send_schedule(void)
+{
+  static spt_sched_t pkt;
+  uint16_t i;
+
+  pkt.type = SPT_SCHED;
+  pkt.version = sched_version;
+  pkt.period = slot_period;
+  pkt.frame_size = frame_size;
+  pkt.active_slots = active_slots;
+  pkt.colours = sched_colours;
+
+  if ( sched_next >= sched_count() )
+    sched_next = 0;
+  for (i=0; i<SCHED_ENTRIES && sched_next<sched_count(); i++, sched_next++)
+    {
+      pkt.addr[i] = sched_node(sched_next, &pkt.colour[i]);
+    }
+  pkt.count = i;
+
+  PRINTF("#> sending SCHED\n");
+  mac_send((uint8_t *)&pkt, sizeof(pkt), MAC_BROADCAST);
+  return 0;
+}
+
+/**********************************************************************/
+
 uint16_t send_packet(void) {
   static spt_beacon_t pkt;
 
@@ -70,8 +149,12 @@ uint16_t send_packet(void) {
   LED_GREEN_TOGGLE();
 
   num_slot++;
-  if ( num_slot >= FRAME_SIZE )
-    num_slot = 0;
+  if ( num_slot >= frame_size )
+    {
+      num_slot = 0;
+      if ( sched_age() || sched_changed )
+	compile_schedule();
+    }
 
   PRINTF("#> slot %u\r\n", num_slot);
 
@@ -86,6 +169,10 @@ uint16_t send_packet(void) {
       mac_send((uint8_t *)&pkt, sizeof(pkt), MAC_BROADCAST);
       /* note that we do not use my_send since the sink sends only few
 	 packets */
+
+      /* the slot map follows in sub-slot 0 */
+      timerA_register_cb(TIMERA_ALARM_CCR1, send_schedule);
+      timerA_set_alarm_from_now(TIMERA_ALARM_CCR1, SUBSLOT/2, 0);
     }
 
   my_clock++;
@@ -98,6 +185,9 @@ uint16_t send_packet(void) {
 uint16_t packet_received(uint8_t packet[], uint16_t length, uint16_t src_addr, int16_t rssi)
 {
   spt_report_t *pkt_report=(spt_report_t *)packet;
+  spt_neighb_t *pkt_neighb=(spt_neighb_t *)packet;
+  mlat_point_t pos;
+  uint16_t used;
 
   LED_RED_ON();
   notice_packet_received_mac();
@@ -112,6 +202,23 @@ uint16_t packet_received(uint8_t packet[], uint16_t length, uint16_t src_addr, i
 	     pkt_report->info.id_mobile,
 	     pkt_report->info.rssi_dbm,
 	     pkt_report->nbh_source);
+
+      /* the MAC RSSI is 2*dBm+8 */
+      used = mlat_report(pkt_report->info.id_mobile,
+			 pkt_report->info.id_anchor,
+			 (pkt_report->info.rssi_dbm - 8) / 2,
+			 my_clock, &pos);
+      if ( used )
+	printf("P %5u %04x %5d %5d %2u\n", my_clock,
+	       pkt_report->info.id_mobile, pos.x, pos.y, used);
+    }
+  else if ( pkt_neighb->type == SPT_NEIGHB && pkt_neighb->count <= NEIGHBOURS_MAX )
+    {
+      if ( src_addr == pkt_neighb->id_source )
+	sched_changed |= sched_heard(src_addr);
+      sched_changed |= sched_neighbours(pkt_neighb->id_source,
+					pkt_neighb->neighbours,
+					pkt_neighb->count);
     }
   LED_RED_OFF();
 
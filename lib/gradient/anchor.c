@@ -82,12 +82,21 @@ static uint8_t hop_threshold = 0;
 static uint8_t my_hop = 99;
 static uint16_t my_parent;
 
+/* Aggregates being filled, free when count is 0 */
+static struct {
+  aggreg_t frame;
+  uint8_t wait; /* ticks before it is sent */
+} pending[AGGREG_PENDING];
+
 /**********************************************************************/
 
 // Hardware initialization
 static void prvSetupHardware(void);
 // Task that sends packets
 static void vSendingTask(void* pvParameters);
+// Merge a report in the pending aggregates
+static void aggreg_add(const uint8_t mobile_id[2], const uint8_t seqnum[2],
+		       const uint8_t anchor_id[2], int8_t rssi);
 
 /**********************************************************************/
 
@@ -159,9 +168,15 @@ void packet_received(uint16_t src_addr, uint8_t* data, uint16_t length,
 		     int8_t rssi) {
   hello_t *hello = (hello_t *) (void *) data;
   beacon_t *beacon;
-  report_t report;
+  report_t *report;
+  aggreg_t *aggreg;
   uint16_t beacon_seqnum;
   uint8_t crc;
+  uint8_t id[2], my_id[2];
+  uint16_t i;
+
+  my_id[0] = (uint8_t) mac_addr;
+  my_id[1] = (uint8_t) (mac_addr >> 8);
 
   /********** if packet is a BEACON *********/
   if (length == sizeof(beacon_t) && hello->type == BEACON_T) {
@@ -184,11 +199,14 @@ void packet_received(uint16_t src_addr, uint8_t* data, uint16_t length,
 
 	// resend beacon
 	beacon->hop++;
+	my_hop = beacon->hop;
 	my_seqnum = beacon_seqnum;
 
 	beacon->crc = crc8_bytes((uint8_t *) beacon->raw,
 				 (uint16_t) ST_OFFSET(beacon_t, crc));
 	mac_send(MAC_BROADCAST_ADDR, beacon->raw, sizeof(beacon_t), 0);
+      } else {
+	hop_threshold++;
       }
     } else {
       hop_threshold++;
@@ -203,37 +221,141 @@ void packet_received(uint16_t src_addr, uint8_t* data, uint16_t length,
 		     (uint16_t) ST_OFFSET(hello_t, crc));
 
     if (crc == hello->crc) {
-      report.type = REPORT_T;
-      report.mobile_id[0] = (uint8_t) src_addr;
-      report.mobile_id[1] = (uint8_t) (src_addr >> 8);
-      report.anchor_id[0] = (uint8_t) mac_addr;
-      report.anchor_id[1] = (uint8_t) (mac_addr >> 8);
-      report.seqnum[0] = (uint8_t) hello->seqnum[0];
-      report.seqnum[1] = (uint8_t) hello->seqnum[1];
-
-      report.rssi = rssi;
-      report.crc = crc8_bytes((uint8_t *) report.raw,
-			      (uint16_t) ST_OFFSET(report_t, crc));
-
-      mac_send(my_parent, report.raw, sizeof(report_t), 1);
+      id[0] = (uint8_t) src_addr;
+      id[1] = (uint8_t) (src_addr >> 8);
+      aggreg_add(id, hello->seqnum, my_id, rssi);
     }
   }
 
   /********** if packet is a REPORT *********/
   if (length == sizeof(report_t) &&  hello->type == REPORT_T) {
-    mac_send(my_parent, data, sizeof(report_t), 1);
+    report = (report_t *) (void *) data;
+    crc = crc8_bytes((uint8_t *) report->raw,
+		     (uint16_t) ST_OFFSET(report_t, crc));
+
+    if (crc == report->crc) {
+      aggreg_add(report->mobile_id, report->seqnum, report->anchor_id,
+		 report->rssi);
+    }
+  }
+
+  /********** if packet is an AGGREGATE *********/
+  if (length > ST_OFFSET(aggreg_t, count) && hello->type == AGGREG_T) {
+    aggreg = (aggreg_t *) (void *) data;
+
+    if (aggreg->count <= AGGREG_MAX &&
+	length == AGGREG_LENGTH(aggreg->count)) {
+      crc = crc8_bytes(aggreg->raw, length - 1);
+
+      if (crc == aggreg->raw[length - 1]) {
+	for (i = 0; i < aggreg->count; i++) {
+	  aggreg_add(aggreg->mobile_id, aggreg->seqnum,
+		     aggreg->entries[i].anchor_id, aggreg->entries[i].rssi);
+	}
+      }
+    }
   }
 
 }
 
+/**
+ * Add a report to the aggregate of its mobile and seqnum, ignoring the
+ * anchors already in it. Anchors far from the sink send their aggregate
+ * first, so that the ones on the way can merge it in theirs.
+ */
+static void aggreg_add(const uint8_t mobile_id[2], const uint8_t seqnum[2],
+		       const uint8_t anchor_id[2], int8_t rssi) {
+  aggreg_t *frame;
+  uint16_t i, j, free_slot = AGGREG_PENDING;
+  aggreg_t single;
+
+  taskENTER_CRITICAL();
+
+  for (i = 0; i < AGGREG_PENDING; i++) {
+    frame = &pending[i].frame;
+
+    if (frame->count == 0) {
+      free_slot = i;
+      continue;
+    }
+    if (frame->count == AGGREG_MAX ||
+	memcmp(frame->mobile_id, mobile_id, 2) != 0 ||
+	memcmp(frame->seqnum, seqnum, 2) != 0) {
+      continue;
+    }
+
+    // same mobile and seqnum, add the anchor once
+    for (j = 0; j < frame->count; j++) {
+      if (memcmp(frame->entries[j].anchor_id, anchor_id, 2) == 0) {
+	taskEXIT_CRITICAL();
+	return;
+      }
+    }
+    break;
+  }
+
+  if (i == AGGREG_PENDING) {
+    if (free_slot == AGGREG_PENDING) {
+      // no room, send this report alone
+      taskEXIT_CRITICAL();
+      frame = &single;
+      frame->count = 0;
+    } else {
+      i = free_slot;
+      frame = &pending[i].frame;
+      pending[i].wait = AGGREG_WINDOW *
+	(AGGREG_HOPS - (my_hop < AGGREG_HOPS ? my_hop : AGGREG_HOPS) + 1);
+    }
+    frame->type = AGGREG_T;
+    memcpy(frame->mobile_id, mobile_id, 2);
+    memcpy(frame->seqnum, seqnum, 2);
+  }
+
+  memcpy(frame->entries[frame->count].anchor_id, anchor_id, 2);
+  frame->entries[frame->count].rssi = rssi;
+  frame->count++;
+
+  if (frame == &single) {
+    single.raw[AGGREG_LENGTH(1) - 1] = crc8_bytes(single.raw, AGGREG_LENGTH(1) - 1);
+    mac_send(my_parent, single.raw, AGGREG_LENGTH(1), 1);
+    return;
+  }
+
+  if (frame->count == AGGREG_MAX) {
+    // full, send it at the next tick
+    pending[i].wait = 0;
+  }
+
+  taskEXIT_CRITICAL();
+}
+
 static void vSendingTask(void* pvParameters) {
+  aggreg_t frame;
+  uint16_t i, length;
+
   /* initialize variables */
   my_seqnum = 0;
   hop_threshold = 0;
   my_hop = 99;
 
   while (1) {
-    vTaskDelay(20);
+    vTaskDelay(1);
+
+    /* send the aggregates whose window is over */
+    for (i = 0; i < AGGREG_PENDING; i++) {
+      taskENTER_CRITICAL();
+      if (pending[i].frame.count == 0 || pending[i].wait-- > 0) {
+	taskEXIT_CRITICAL();
+	continue;
+      }
+      length = AGGREG_LENGTH(pending[i].frame.count);
+      memcpy(frame.raw, pending[i].frame.raw, length - 1);
+      pending[i].frame.count = 0;
+      taskEXIT_CRITICAL();
+
+      frame.raw[length - 1] = crc8_bytes(frame.raw, length - 1);
+      mac_send(my_parent, frame.raw, length, 1);
+    }
   }
 }
 
@@ -39,6 +39,13 @@
 #define BEACON_T 16
 #define HELLO_T 42
 #define REPORT_T 34
+#define AGGREG_T 57
+
+/* Anchors merge the reports about the same hello in an aggregate */
+#define AGGREG_MAX 16 /* reports per aggregate frame */
+#define AGGREG_PENDING 4 /* aggregates being filled at once */
+#define AGGREG_HOPS 6 /* anchors this far from the sink wait one window */
+#define AGGREG_WINDOW 2 /* ticks, waited once more per hop closer to the sink */
 
 #define ST_OFFSET(st, field)\
   ( (uint16_t ) &((st *)(0))->field )
@@ -76,6 +83,29 @@ typedef union {
   uint8_t raw[1];
 } report_t;
 
+/* One report of an aggregate */
+typedef struct {
+  uint8_t anchor_id[2];
+  int8_t rssi;
+} aggreg_entry_t;
+
+/* Reports of several anchors about the same mobile and seqnum,
+ * the crc follows the count entries */
+typedef union {
+  struct {
+    uint8_t type;
+    uint8_t mobile_id[2];
+    uint8_t seqnum[2];
+    uint8_t count;
+    aggreg_entry_t entries[AGGREG_MAX];
+    uint8_t crc_max;
+  };
+  uint8_t raw[1];
+} aggreg_t;
+
+#define AGGREG_LENGTH(count)\
+  ( ST_OFFSET(aggreg_t, entries) + (count) * sizeof(aggreg_entry_t) + 1 )
+
 uint16_t char_rx(uint8_t c);
 uint16_t send_packet(void);
 
@@ -167,10 +167,29 @@ static void process_report(report_t *report){
 
 }
 
+/* Give each report of an aggregate to process_report */
+static void process_aggreg(aggreg_t *aggreg){
+  report_t report;
+  uint16_t i;
+
+  report.type = REPORT_T;
+  memcpy(report.mobile_id, aggreg->mobile_id, 2);
+  memcpy(report.seqnum, aggreg->seqnum, 2);
+
+  for (i = 0; i < aggreg->count; i++) {
+    memcpy(report.anchor_id, aggreg->entries[i].anchor_id, 2);
+    report.rssi = aggreg->entries[i].rssi;
+    report.crc = crc8_bytes(report.raw, ST_OFFSET(report_t, crc));
+
+    process_report(&report);
+  }
+}
+
 void packet_received(uint16_t src_addr, uint8_t* data,
 		uint16_t length, int8_t rssi) {
   hello_t *hello = (hello_t *)(void *) data;
   report_t *report;
+  aggreg_t *aggreg;
 
   /********** if packet is a REPORT *********/
   if( length == sizeof(report_t) && hello->type == REPORT_T ){
@@ -179,6 +198,16 @@ void packet_received(uint16_t src_addr, uint8_t* data,
     process_report(report);
   }
 
+  /********** if packet is an AGGREGATE *********/
+  if( length > ST_OFFSET(aggreg_t, count) && hello->type == AGGREG_T ){
+    aggreg = (aggreg_t *)hello;
+
+    if( aggreg->count <= AGGREG_MAX && length == AGGREG_LENGTH(aggreg->count)
+        && crc8_bytes(aggreg->raw, length - 1) == aggreg->raw[length - 1] ){
+      process_aggreg(aggreg);
+    }
+  }
+
 }
 
 static void vSendingTask(void* pvParameters) {
@@ -60,6 +60,10 @@
 #define PACKET_LENGTH_MAX 58
 
 #define HEADER_LENGTH   sizeof(ack_t)-1
+
+#if PBUF_HEADROOM < 6
+#error "PBUF_HEADROOM must fit the frame header"
+#endif
 #define TYPE_DATA 0xAA
 #define TYPE_ACK  0xBB
 
@@ -93,6 +97,7 @@ uint16_t node_addr;
 
 // callback for received packets
 static mac_received_t received_cb;
+static mac_received_buf_t received_buf_cb;
 static mac_sent_t sent_cb;
 static mac_error_t error_cb;
 
@@ -100,6 +105,10 @@ static mac_error_t error_cb;
 static frame_t rxframe, txframe;
 static ack_t ack;
 
+// frame being sent, txframe or in tx_buf, 0 if none
+static frame_t *tx;
+static pbuf_t *tx_buf;
+
 // retry count
 static uint16_t delay_count;
 
@@ -112,6 +121,8 @@ static uint16_t tx_try(void);
 static uint16_t tx_delay(void);
 static uint16_t tx_done(void);
 static uint16_t tx_ack(void);
+static void tx_end(void);
+static uint16_t rx_deliver(frame_t *rx, pbuf_t *buf, uint16_t src, int16_t rssi);
 
 void mac_init(uint8_t channel)
 {
@@ -124,6 +135,7 @@ void mac_init(uint8_t channel)
 
     // reset callbacks
     received_cb = 0x0;
+    received_buf_cb = 0x0;
     sent_cb = 0x0;
     error_cb = 0x0;
 
@@ -203,13 +215,17 @@ void mac_init(uint8_t channel)
     // start the machine
     rx_set();
 
-    txframe.length = 0;
+    tx_end();
 }
 
 void mac_set_rx_cb(mac_received_t cb) {
     received_cb = cb;
 }
 
+void mac_set_rx_buf_cb(mac_received_buf_t cb) {
+    received_buf_cb = cb;
+}
+
 void mac_set_sent_cb(mac_sent_t cb) {
     sent_cb = cb;
 }
@@ -226,12 +242,13 @@ critical uint16_t mac_send(uint8_t packet[], uint16_t length, uint16_t dst_addr)
     }
 
     // check state
-    if (txframe.length != 0) {
+    if (tx != 0x0) {
         PRINTF("mac_send already sending\n");
         // already sending, can't do anything
         return 1;
     }
     // prepare header
+    tx = &txframe;
     txframe.length = length + HEADER_LENGTH;
     txframe.type = TYPE_DATA;
     txframe.dst_addr[0] = dst_addr>>8;
@@ -248,6 +265,44 @@ critical uint16_t mac_send(uint8_t packet[], uint16_t length, uint16_t dst_addr)
     return 0;
 }
 
+critical uint16_t mac_send_buf(pbuf_t *buf, uint16_t dst_addr) {
+    frame_t *frame;
+
+    // check length
+    if (buf->length>PACKET_LENGTH_MAX) {
+        PRINTF("mac_send_buf length error\n");
+        return 2;
+    }
+
+    // check state
+    if (tx != 0x0) {
+        PRINTF("mac_send_buf already sending\n");
+        return 1;
+    }
+
+    // prepend the header, the payload stays in place
+    frame = (frame_t*) pbuf_push(buf, HEADER_LENGTH+1);
+    if (frame == 0x0) {
+        PRINTF("mac_send_buf no headroom\n");
+        return 2;
+    }
+    frame->length = buf->length - 1;
+    frame->type = TYPE_DATA;
+    frame->dst_addr[0] = dst_addr>>8;
+    frame->dst_addr[1] = dst_addr & 0xFF;
+    frame->src_addr[0] = node_addr>>8;
+    frame->src_addr[1] = node_addr & 0xFF;
+
+    pbuf_ref(buf);
+    tx = frame;
+    tx_buf = buf;
+
+    // try to send
+    delay_count = 0;
+    tx_delay();
+    return 0;
+}
+
 critical void mac_stop(void) {
     cc1101_cmd_idle();
     cc1101_gdo0_int_disable();
@@ -301,7 +356,7 @@ static uint16_t tx_delay(void) {
     } else if (delay_count >= DELAY_COUNT_MAX) {
         // to many tries, abort
         // delete packet
-        txframe.length = 0;
+        tx_end();
         // reset callback
         cc1101_gdo0_register_callback(rx_parse);
 
@@ -331,7 +386,7 @@ static uint16_t tx_delay(void) {
 static uint16_t tx_try(void) {
     uint8_t status;
 
-    if (txframe.length == 0) {
+    if (tx == 0x0) {
         PRINTF("tx_try no packet error\n");
         return rx_set();
     }
@@ -362,7 +417,7 @@ static uint16_t tx_try(void) {
     // if status is not RX
     if ( status != 0x10) {
         // put data in fifo
-        cc1101_fifo_put((uint8_t*)&txframe, txframe.length+1);
+        cc1101_fifo_put((uint8_t*)tx, tx->length+1);
         cc1101_gdo0_register_callback(tx_done);
     } else {
         tx_delay();
@@ -374,9 +429,9 @@ static uint16_t tx_try(void) {
 
 static uint16_t tx_done(void) {
     // if destination is broadcast, don't wait for ACK
-    if ((txframe.dst_addr[0]==0xFF) && (txframe.dst_addr[1]==0xFF)) {
+    if ((tx->dst_addr[0]==0xFF) && (tx->dst_addr[1]==0xFF)) {
         cc1101_gdo0_register_callback(rx_parse);
-        txframe.length = 0;
+        tx_end();
         rx_set();
         if (sent_cb) {
             return sent_cb();
@@ -424,9 +479,9 @@ static uint16_t tx_ack(void) {
     dst = (((uint16_t)ack.dst_addr[0])<<8) + ack.dst_addr[1];
 
     /* Check addresses */
-    if ( (dst==node_addr) && (ack.src_addr[0]==txframe.dst_addr[0]) \
-                           && (ack.src_addr[1]==txframe.dst_addr[1]) ) {
-        txframe.length = 0;
+    if ( (dst==node_addr) && (ack.src_addr[0]==tx->dst_addr[0]) \
+                           && (ack.src_addr[1]==tx->dst_addr[1]) ) {
+        tx_end();
         timerB_unset_alarm(ALARM_RETRY);
         cc1101_gdo0_register_callback(rx_parse);
         rx_set();
@@ -442,6 +497,8 @@ static uint16_t rx_parse(void) {
     uint16_t src, dst;
     uint16_t ret_val;
     int16_t rssi;
+    frame_t *rx;
+    pbuf_t *buf;
 
     /* Check if there are bytes in FIFO */
     if ( (cc1101_status_rxbytes() == 0) || (cc1101_status_rxbytes() > 64) ) {
@@ -455,32 +512,40 @@ static uint16_t rx_parse(void) {
         return rx_set();
     }
 
+    /* Read in a buffer if the upper layer takes them, the payload
+     * then starts at the headroom */
+    rx = &rxframe;
+    buf = 0x0;
+    if (received_buf_cb) {
+        buf = pbuf_alloc(PBUF_HEADROOM - (HEADER_LENGTH+1));
+        if (buf) {
+            rx = (frame_t*) buf->head;
+            rx->length = rxframe.length;
+        }
+    }
+
     /* Get Data */
-    cc1101_fifo_get( (uint8_t*) &(rxframe.length)+1, rxframe.length);
+    cc1101_fifo_get( (uint8_t*) &(rx->length)+1, rx->length);
 
     /* Get Status Bytes */
     cc1101_fifo_get(status, 2);
 
-    /* Check CRC */
-    if ( (status[1] & 0x80) == 0 ) {
-        return rx_set();
-    }
-
-    /* Check for min length */
-    if ( rxframe.length < HEADER_LENGTH ) {
+    /* Check CRC, min length, and that a buffer was free if needed
+     * (the frame is not acknowledged otherwise) */
+    if ( ((status[1] & 0x80) == 0) || (rx->length < HEADER_LENGTH) ||
+         (received_buf_cb && !buf) ) {
+        if (buf) {
+            pbuf_free(buf);
+        }
         return rx_set();
     }
 
     /* Compute addresses */
-    dst = (((uint16_t)rxframe.dst_addr[0])<<8) + rxframe.dst_addr[1];
-    src = (((uint16_t)rxframe.src_addr[0])<<8) + rxframe.src_addr[1];
+    dst = (((uint16_t)rx->dst_addr[0])<<8) + rx->dst_addr[1];
+    src = (((uint16_t)rx->src_addr[0])<<8) + rx->src_addr[1];
 
     ret_val = 0;
 
-    int len;
-    len = rxframe.length;
-    len -= HEADER_LENGTH;
-
     rssi = status[0] >= 128 ? status[0]-256 : status[0];
     rssi -= 140;
 
@@ -488,10 +553,10 @@ static uint16_t rx_parse(void) {
     if (dst==node_addr) {
         ack.length = HEADER_LENGTH;
         ack.type = TYPE_ACK;
-        ack.dst_addr[0] = rxframe.src_addr[0];
-        ack.dst_addr[1] = rxframe.src_addr[1];
-        ack.src_addr[0] = rxframe.dst_addr[0];
-        ack.src_addr[1] = rxframe.dst_addr[1];
+        ack.dst_addr[0] = rx->src_addr[0];
+        ack.dst_addr[1] = rx->src_addr[1];
+        ack.src_addr[0] = rx->dst_addr[0];
+        ack.src_addr[1] = rx->dst_addr[1];
         if (cc1101_status_txbytes()) {
             cc1101_cmd_flush_tx();
         }
@@ -499,20 +564,50 @@ static uint16_t rx_parse(void) {
         cc1101_fifo_put((uint8_t*)&ack, ack.length+1);
         cc1101_gdo0_register_callback(rx_ackdone);
 
-        if (received_cb) {
-            return received_cb(rxframe.payload, len, src, rssi);
-        }
+        return rx_deliver(rx, buf, src, rssi);
 
-    } else if ( (dst==0xFFFF) && received_cb ) {
+    } else if ( (dst==0xFFFF) && (received_cb || buf) ) {
         /* Call the packet received function */
-        ret_val = received_cb(rxframe.payload, len, src, rssi);
+        ret_val = rx_deliver(rx, buf, src, rssi);
         ret_val |= rx_set();
         return ret_val;
-    } else {
-        return rx_set();
     }
 
-    return 0;
+    if (buf) {
+        pbuf_free(buf);
+    }
+    return rx_set();
+}
+
+/**
+ * Give a received frame to the upper layer, in its buffer if any.
+ */
+static uint16_t rx_deliver(frame_t *rx, pbuf_t *buf, uint16_t src, int16_t rssi) {
+    uint16_t ret_val = 0;
+
+    if (buf) {
+        buf->length = rx->length + 1;
+        pbuf_pull(buf, HEADER_LENGTH+1);
+        ret_val = received_buf_cb(buf, src, rssi);
+        pbuf_free(buf);
+    } else if (received_cb) {
+        ret_val = received_cb(rx->payload, rx->length - HEADER_LENGTH, src, rssi);
+    }
+    return ret_val;
+}
+
+/**
+ * Forget the frame being sent, giving its buffer back.
+ */
+static void tx_end(void) {
+    pbuf_t *buf = tx_buf;
+
+    tx = 0x0;
+    tx_buf = 0x0;
+    if (buf) {
+        pbuf_pull(buf, HEADER_LENGTH+1);
+        pbuf_free(buf);
+    }
 }
 
 static uint16_t rx_ackdone(void) {
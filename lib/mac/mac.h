@@ -43,6 +43,8 @@
 #ifndef _MAC_H
 #define _MAC_H
 
+#include "pbuf.h"
+
 #define MAC_BROADCAST 0xFFFF
 
 /**
@@ -53,6 +55,7 @@
  * \return 1 if the CPU should we waken up, 0 if it should stay in LPM
  */
 typedef uint16_t (*mac_received_t)(uint8_t packet[], uint16_t length, uint16_t src_addr, int16_t rssi);
+typedef uint16_t (*mac_received_buf_t)(pbuf_t *buf, uint16_t src_addr, int16_t rssi);
 typedef uint16_t (*mac_sent_t)(void);
 typedef uint16_t (*mac_error_t)(void);
 
@@ -76,6 +79,17 @@ void mac_init(uint8_t channel);
  */
 uint16_t mac_send(uint8_t packet[], uint16_t length, uint16_t dst_addr);
 
+/**
+ * Send a packet buffer to a node, without copying it.
+ * The MAC writes its header in the headroom and keeps a reference on the
+ * buffer; the header is stripped again before the sent or error callback.
+ * Only csma_cc1101 and xmac implement it.
+ * \param buf the buffer, PBUF_HEADROOM bytes of headroom at least
+ * \param dst_addr address of the destination node
+ * \return 0 if OK, 1 if a packet is being sent, 2 if length too big.
+ */
+uint16_t mac_send_buf(pbuf_t *buf, uint16_t dst_addr);
+
 /**
  * Register a function callback that'll be called
  * when a packet has been received.
@@ -83,6 +97,17 @@ uint16_t mac_send(uint8_t packet[], uint16_t length, uint16_t dst_addr);
  */
 void mac_set_rx_cb(mac_received_t cb);
 
+/**
+ * Register a function callback that'll be called with a packet buffer
+ * when a packet has been received, instead of the one of mac_set_rx_cb().
+ * The buffer head is the MAC payload, with PBUF_HEADROOM bytes before it.
+ * The callback takes a reference on the buffer to keep it.
+ * When the pool is empty the frame is not acknowledged.
+ * Only csma_cc1101 and xmac implement it.
+ * \param cb function pointer
+ */
+void mac_set_rx_buf_cb(mac_received_buf_t cb);
+
 /**
  * Register a function callback that'll be called
  * when a packet has been sent successfully.
@@ -0,0 +1,128 @@
+/*
+ * Copyright  2008-2009 INRIA/SensTools
+ *
+ * <dev-team@sentools.info>
+ *
+ * This software is a set of libraries designed to develop applications
+ * for the WSN430 embedded hardware platform.
+ *
+ * This software is governed by the CeCILL license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL license and that you accept its terms.
+ */
+
+/**
+ * \file
+ * \brief packet buffer pool
+ * \date October 2026
+ */
+
+#include <io.h>
+
+#include "pbuf.h"
+
+/* ----DATA---- */
+static pbuf_t pool[PBUF_COUNT];
+static pbuf_t *free_list;
+static uint16_t free_count;
+
+void pbuf_init(void) {
+    int i;
+
+    free_list = 0x0;
+    for (i=0; i<PBUF_COUNT; i++) {
+        pool[i].ref = 0;
+        pool[i].next = free_list;
+        free_list = &pool[i];
+    }
+    free_count = PBUF_COUNT;
+}
+
+critical pbuf_t* pbuf_alloc(uint16_t headroom) {
+    pbuf_t *buf;
+
+    if ( (free_list == 0x0) || (headroom > PBUF_SIZE) ) {
+        return 0x0;
+    }
+
+    buf = free_list;
+    free_list = buf->next;
+    free_count--;
+
+    buf->next = 0x0;
+    buf->head = buf->data + headroom;
+    buf->length = 0;
+    buf->ref = 1;
+    return buf;
+}
+
+critical void pbuf_ref(pbuf_t *buf) {
+    buf->ref++;
+}
+
+critical void pbuf_free(pbuf_t *buf) {
+    if ( (buf->ref == 0) || (--buf->ref != 0) ) {
+        return;
+    }
+
+    buf->next = free_list;
+    free_list = buf;
+    free_count++;
+}
+
+uint8_t* pbuf_push(pbuf_t *buf, uint16_t length) {
+    if ( (uint16_t)(buf->head - buf->data) < length ) {
+        return 0x0;
+    }
+
+    buf->head -= length;
+    buf->length += length;
+    return buf->head;
+}
+
+uint8_t* pbuf_pull(pbuf_t *buf, uint16_t length) {
+    if (buf->length < length) {
+        return 0x0;
+    }
+
+    buf->head += length;
+    buf->length -= length;
+    return buf->head;
+}
+
+uint8_t* pbuf_put(pbuf_t *buf, uint16_t length) {
+    uint8_t *tail = buf->head + buf->length;
+
+    if ( (uint16_t)(buf->data + PBUF_SIZE - tail) < length ) {
+        return 0x0;
+    }
+
+    buf->length += length;
+    return tail;
+}
+
+uint16_t pbuf_available(void) {
+    return free_count;
+}
@@ -0,0 +1,131 @@
+/*
+ * Copyright  2008-2009 INRIA/SensTools
+ *
+ * <dev-team@sentools.info>
+ *
+ * This software is a set of libraries designed to develop applications
+ * for the WSN430 embedded hardware platform.
+ *
+ * This software is governed by the CeCILL license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL license and that you accept its terms.
+ */
+
+/**
+ * \file
+ * \brief packet buffers shared by the MAC and network layers
+ * \date October 2026
+ *
+ * A packet buffer holds one frame, with room before it for the headers
+ * of the lower layers. A layer prepends its header with pbuf_push() and
+ * strips it with pbuf_pull(), so a packet goes down and up the stack
+ * without being copied. Buffers are reference counted: a layer that
+ * keeps a buffer beyond the call it got it from takes a reference, and
+ * the buffer goes back to the pool when the last one is released.
+ *
+ * The pool is static, pbuf_init() is to be called once, by the network
+ * layer, before any buffer is used.
+ */
+
+#ifndef _PBUF_H
+#define _PBUF_H
+
+/**
+ * Number of buffers in the pool, one per netq entry and one for the
+ * frame being received.
+ */
+#ifndef PBUF_COUNT
+#define PBUF_COUNT 7
+#endif
+
+/**
+ * Room kept before the packet for the lower layer headers.
+ */
+#ifndef PBUF_HEADROOM
+#define PBUF_HEADROOM 6
+#endif
+
+/**
+ * Maximum packet length after the headroom, the MAC payload.
+ */
+#define PBUF_DATA_MAX 58
+
+#define PBUF_SIZE (PBUF_HEADROOM + PBUF_DATA_MAX)
+
+typedef struct pbuf {
+    struct pbuf *next; // free list
+    uint8_t *head; // first byte of the packet
+    uint8_t length; // number of bytes from head
+    uint8_t ref; // number of references, 0 if free
+    uint8_t data[PBUF_SIZE];
+} pbuf_t;
+
+/**
+ * Put all the buffers in the pool.
+ */
+void pbuf_init(void);
+
+/**
+ * Get a buffer from the pool, with one reference.
+ * \param headroom the room to keep before the packet, PBUF_HEADROOM
+ * for a packet handed to the MAC
+ * \return the empty buffer, 0 if none is free
+ */
+pbuf_t* pbuf_alloc(uint16_t headroom);
+
+/**
+ * Take a reference on a buffer.
+ */
+void pbuf_ref(pbuf_t *buf);
+
+/**
+ * Release a reference, the buffer goes back to the pool with the last one.
+ */
+void pbuf_free(pbuf_t *buf);
+
+/**
+ * Prepend bytes to the packet, in the headroom.
+ * \return the new head, 0 if there is not enough room
+ */
+uint8_t* pbuf_push(pbuf_t *buf, uint16_t length);
+
+/**
+ * Strip bytes from the start of the packet.
+ * \return the new head, 0 if the packet is shorter
+ */
+uint8_t* pbuf_pull(pbuf_t *buf, uint16_t length);
+
+/**
+ * Append bytes to the packet.
+ * \return the first appended byte, 0 if there is not enough room
+ */
+uint8_t* pbuf_put(pbuf_t *buf, uint16_t length);
+
+/**
+ * Get the number of free buffers.
+ */
+uint16_t pbuf_available(void);
+
+#endif
@@ -47,6 +47,7 @@
 #include "tdma_timings.h"
 #include "tdma_frames.h"
 #include "tdma_mgt.h"
+#include "tdma_hop.h"
 #include "cc1101.h"
 #include "ds2411.h"
 #include "timerB.h"
@@ -87,6 +88,8 @@ static uint16_t beacon_send(void);
 static uint16_t beacon_sent(void);
 static uint16_t slot_data(void);
 static uint16_t slot_control(void);
+static void beacon_fill_downlink(void);
+static void slot_hop(void);
 
 /* GLOBAL VARIABLES */
 slot_t mac_slots[DATA_SLOT_MAX];
@@ -101,6 +104,19 @@ static footer_t footer;
 // times
 static uint16_t beacon_eop_time;
 
+// downlink
+typedef struct {
+    uint8_t length; // 0 if nothing is pending
+    uint8_t seq;
+    uint8_t data[DOWNLINK_PAYLOAD_MAX];
+} downlink_t;
+static downlink_t downlinks[DATA_SLOT_MAX];
+static uint8_t downlink_next;
+
+// channels
+static uint8_t home_channel;
+static uint8_t frame_seq;
+
 // other
 static uint16_t slot_count;
 static uint16_t (*new_data_cb)(int16_t);
@@ -147,6 +163,7 @@ void mac_init(uint8_t channel) {
     cc1101_cfg_chanspc_e(0x3);
     cc1101_cfg_chanspc_m(0x6C);
     cc1101_cfg_chan(channel<<1); // channel x2 to get 600kHz spacing
+    home_channel = channel;
 
     // set channel bandwidth (560 kHz)
     cc1101_cfg_chanbw_e(0);
@@ -178,6 +195,7 @@ void mac_init(uint8_t channel) {
     HEADER_SET_ADDR(beacon_msg.hdr, node_addr);
     HEADER_SET_TYPE(beacon_msg.hdr,BEACON_TYPE);
     beacon_msg.seq=0;
+    beacon_msg.cell=channel;
 
     // initialize the slot management service
     tdma_mgt_init();
@@ -188,7 +206,10 @@ void mac_init(uint8_t channel) {
     for (i=0;i<DATA_SLOT_MAX;i++) {
         mac_slots[i].ready=0;
         mac_slots[i].addr=0;
+        downlinks[i].length=0;
+        downlinks[i].seq=0;
     }
+    downlink_next = 0;
 
     // reset the callback
     new_data_cb = 0x0;
@@ -198,6 +219,25 @@ void mac_set_new_data_cb(uint16_t (*cb)(int16_t)) {
     new_data_cb = cb;
 }
 
+int16_t mac_is_downlink_free(int16_t slot) {
+    if ( (slot<0) || (slot>=DATA_SLOT_MAX) || (mac_slots[slot].addr==0) ) {
+        return 0;
+    }
+    return (downlinks[slot].length==0);
+}
+
+int16_t mac_send_downlink(int16_t slot, const uint8_t* data, uint16_t length) {
+    if ( (length==0) || (length>DOWNLINK_PAYLOAD_MAX) ||
+            !mac_is_downlink_free(slot) ) {
+        return 0;
+    }
+
+    memcpy(downlinks[slot].data, data, length);
+    // the length is set last, the beacon is built from an interrupt
+    downlinks[slot].length = length;
+    return 1;
+}
+
 static void set_rx(void) {
     // idle, flush
     cc1101_cmd_idle();
@@ -219,18 +259,35 @@ static uint16_t slot_alarm(void) {
         beacon_send();
     } else if (slot_count<=DATA_SLOT_MAX) {
         // dataslot
+        slot_hop();
         cc1101_gdo0_register_callback(slot_data);
 
     } else {
         // controlslot
         LED_GREEN_OFF();
         LED_BLUE_ON();
+        slot_hop();
         cc1101_gdo0_register_callback(slot_control);
 
     }
     return 0;
 }
 
+static void slot_hop(void) {
+#if HOPPING
+    // the nodes wait HOP_TX_OFFSET before sending, time to calibrate
+    cc1101_cmd_idle();
+    cc1101_cmd_flush_rx();
+    cc1101_cmd_flush_tx();
+    cc1101_cfg_chan(tdma_hop_channel(beacon_msg.cell, frame_seq, slot_count)<<1);
+    cc1101_cmd_calibrate();
+    cc1101_cmd_rx();
+
+    cc1101_gdo0_int_clear();
+    cc1101_gdo2_int_clear();
+#endif
+}
+
 static uint16_t beacon_send(void) {
     LED_RED_ON();
     LED_GREEN_OFF();
@@ -241,6 +298,12 @@ static uint16_t beacon_send(void) {
     cc1101_cmd_flush_rx();
     cc1101_cmd_flush_tx();
 
+#if HOPPING
+    // beacons are always sent on the home channel
+    cc1101_cfg_chan(home_channel<<1);
+#endif
+    frame_seq = beacon_msg.seq;
+
     // calibrate
     cc1101_cmd_calibrate();
 
@@ -249,6 +312,9 @@ static uint16_t beacon_send(void) {
     cc1101_gdo0_int_clear();
     cc1101_gdo0_int_enable();
 
+    // append the pending downlink data
+    beacon_fill_downlink();
+
     // start TX
     cc1101_cmd_tx();
 
@@ -260,6 +326,34 @@ static uint16_t beacon_send(void) {
     return 0;
 }
 
+static void beacon_fill_downlink(void) {
+    uint8_t *ptr, *end;
+    int16_t i, slot;
+
+    ptr = beacon_msg.downlink;
+    end = beacon_msg.downlink + DOWNLINK_LENGTH_MAX;
+
+    // start from a different slot every beacon, to share the space
+    for (i=0;i<DATA_SLOT_MAX;i++) {
+        slot = (downlink_next+i) % DATA_SLOT_MAX;
+
+        if (downlinks[slot].length==0) {
+            continue;
+        }
+        if (ptr+DOWNLINK_HEADER_LENGTH+downlinks[slot].length > end) {
+            continue;
+        }
+
+        *ptr++ = DOWNLINK_CTL(downlinks[slot].seq, mac_slots[slot].addr);
+        *ptr++ = downlinks[slot].length;
+        memcpy(ptr, downlinks[slot].data, downlinks[slot].length);
+        ptr += downlinks[slot].length;
+    }
+    downlink_next = (downlink_next+1) % DATA_SLOT_MAX;
+
+    beacon_msg.hdr.length = (ptr - (uint8_t*)&beacon_msg) - 1;
+}
+
 static uint16_t beacon_sent(void) {
     beacon_eop_time = timerB_time();
     LED_RED_OFF();
@@ -311,6 +405,11 @@ static uint16_t slot_data(void) {
         return 0;
     }
 
+    // check there is at least the ack field
+    if (data_msg.hdr.length<(DATA_ACK_LENGTH-1)) {
+        return 0;
+    }
+
     // check type, destination
     if (HEADER_GET_TYPE(data_msg.hdr) != DATA_TYPE) {
         //~ printf("not_data");
@@ -325,6 +424,19 @@ static uint16_t slot_data(void) {
         return 0;
     }
 
+    // check if the pending downlink data is acknowledged
+    if ( (data_msg.ack&DATA_ACK_VALID) &&
+            (downlinks[slot_count-1].length!=0) &&
+            ((data_msg.ack&DATA_ACK_SEQ_MASK)==downlinks[slot_count-1].seq) ) {
+        downlinks[slot_count-1].seq = (downlinks[slot_count-1].seq+1) & DATA_ACK_SEQ_MASK;
+        downlinks[slot_count-1].length = 0;
+    }
+
+    // nothing more if the frame only carries the ack
+    if (data_msg.hdr.length!=(DATA_LENGTH-1)) {
+        return 0;
+    }
+
     // check data has been read
     if (mac_slots[slot_count-1].ready==0) {
         memcpy(mac_slots[slot_count-1].data, data_msg.payload, MAC_PAYLOAD_SIZE);
@@ -93,4 +93,24 @@ extern slot_t mac_slots[MAC_SLOT_NUMBER];
  */
 void mac_set_new_data_cb(uint16_t (*cb)(int16_t slot));
 
+#define MAC_DOWNLINK_SIZE DOWNLINK_PAYLOAD_MAX
+/**
+ * Queue data to be sent to the node attached to a slot.
+ * The data is piggybacked in the following beacons, until the node
+ * acknowledges it in its next uplink frame. Only one payload per node
+ * may be pending at a time.
+ * \param slot the slot number, index of \ref mac_slots
+ * \param data pointer to the data to send
+ * \param length the number of bytes, at most MAC_DOWNLINK_SIZE
+ * \return 1 if the data is queued, 0 if the slot is busy or invalid
+ */
+int16_t mac_send_downlink(int16_t slot, const uint8_t* data, uint16_t length);
+
+/**
+ * Check if a new downlink payload may be queued for a slot.
+ * \param slot the slot number, index of \ref mac_slots
+ * \return 1 if mac_send_downlink may be called, 0 otherwise
+ */
+int16_t mac_is_downlink_free(int16_t slot);
+
 #endif
@@ -0,0 +1,199 @@
+/*
+ * Copyright  2008-2009 INRIA/SensTools
+ *
+ * <dev-team@sentools.info>
+ *
+ * This software is a set of libraries designed to develop applications
+ * for the WSN430 embedded hardware platform.
+ *
+ * This software is governed by the CeCILL license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL license and that you accept its terms.
+ */
+
+/**
+ * \file
+ * \brief Clock drift estimation module
+ * \date October 2026
+ */
+
+#include <io.h>
+#include "tdma_drift.h"
+#include "tdma_timings.h"
+
+#if (DRIFT_GAP_MAX * BEACON_PERIOD) > 0x7FFF
+#error "DRIFT_GAP_MAX beacon periods must fit in the 16bit timerB"
+#endif
+
+#if BEACON_SKIP_MAX >= DRIFT_GAP_MAX
+#error "BEACON_SKIP_MAX must be lower than DRIFT_GAP_MAX"
+#endif
+
+typedef struct {
+    uint16_t x; // beacon periods elapsed since the reset
+    int16_t d;  // local ticks in excess of the nominal periods
+} drift_sample_t;
+
+static drift_sample_t samples[DRIFT_SAMPLES];
+static uint8_t sample_count, sample_head;
+
+static uint8_t last_seq;
+static uint16_t last_sync;
+
+static int16_t skew;
+
+static void drift_restart(uint8_t seq, uint16_t sync_time);
+static void drift_compute(void);
+
+void tdma_drift_init(void) {
+    sample_count = 0;
+    sample_head = 0;
+    skew = 0;
+}
+
+int16_t tdma_drift_locked(void) {
+    return (sample_count >= DRIFT_SAMPLES_MIN);
+}
+
+int16_t tdma_drift_skew(void) {
+    return skew;
+}
+
+uint16_t tdma_drift_adjust(uint16_t ticks) {
+    int32_t corr;
+
+    if (!tdma_drift_locked()) {
+        return ticks;
+    }
+
+    // ticks*skew/2^20, rounded
+    corr = ((int32_t)ticks * skew + (1L<<19)) >> 20;
+    return ticks + (int16_t)corr;
+}
+
+void tdma_drift_sample(uint8_t seq, uint16_t sync_time) {
+    uint8_t periods;
+    uint16_t nominal;
+    int16_t err, expected;
+    drift_sample_t *last;
+
+    periods = seq - last_seq;
+
+    if ( (sample_count == 0) || (periods == 0) || (periods > DRIFT_GAP_MAX) ) {
+        // no reference, or too far from it
+        drift_restart(seq, sync_time);
+        return;
+    }
+
+    // measured error over the elapsed periods
+    nominal = (uint16_t)periods * BEACON_PERIOD;
+    err = (int16_t)(sync_time - last_sync - nominal);
+
+    // compare it with what the current estimate predicts
+    expected = (int16_t)(tdma_drift_adjust(nominal) - nominal);
+    if ( (err - expected > DRIFT_ERROR_MAX) ||
+         (expected - err > DRIFT_ERROR_MAX) ) {
+        // coordinator restarted, or bad sync detection
+        drift_restart(seq, sync_time);
+        return;
+    }
+
+    // store the new point, overwriting the oldest if full
+    last = &samples[(sample_head + DRIFT_SAMPLES - 1) % DRIFT_SAMPLES];
+    samples[sample_head].x = last->x + periods;
+    samples[sample_head].d = last->d + err;
+    sample_head = (sample_head + 1) % DRIFT_SAMPLES;
+    if (sample_count < DRIFT_SAMPLES) {
+        sample_count++;
+    }
+
+    last_seq = seq;
+    last_sync = sync_time;
+
+    drift_compute();
+}
+
+static void drift_restart(uint8_t seq, uint16_t sync_time) {
+    tdma_drift_init();
+
+    samples[0].x = 0;
+    samples[0].d = 0;
+    sample_head = 1;
+    sample_count = 1;
+
+    last_seq = seq;
+    last_sync = sync_time;
+}
+
+static void drift_compute(void) {
+    int16_t i, idx, oldest;
+    int16_t x, d;
+    int16_t shift;
+    int32_t sx, sd, sxx, sxd, num, den, q, q_max;
+
+    if (sample_count < 2) {
+        return;
+    }
+
+    // compute the sums relative to the oldest point, to keep them small
+    oldest = (sample_head + DRIFT_SAMPLES - sample_count) % DRIFT_SAMPLES;
+    sx = sd = sxx = sxd = 0;
+    for (i=0; i<sample_count; i++) {
+        idx = (oldest + i) % DRIFT_SAMPLES;
+        x = (int16_t)(samples[idx].x - samples[oldest].x);
+        d = (int16_t)(samples[idx].d - samples[oldest].d);
+
+        sx += x;
+        sd += d;
+        sxx += (int32_t)x * x;
+        sxd += (int32_t)x * d;
+    }
+
+    // least squares slope is num/den, in ticks per beacon period
+    num = sample_count * sxd - sx * sd;
+    den = sample_count * sxx - sx * sx;
+    if (den <= 0) {
+        return;
+    }
+
+    // skew = num * 2^20 / (den * BEACON_PERIOD),
+    // split in two divisions to stay within 32 bits
+    shift = 20;
+    while ( (shift > 0) &&
+            ( (num > (0x3FFFFFFFL >> shift)) ||
+              (num < -(0x3FFFFFFFL >> shift)) ) ) {
+        shift--;
+    }
+    q = (num * (1L << shift)) / den;
+
+    q_max = ((int32_t)DRIFT_SKEW_MAX * BEACON_PERIOD) >> (20 - shift);
+    if (q > q_max) {
+        q = q_max;
+    } else if (q < -q_max) {
+        q = -q_max;
+    }
+
+    skew = (int16_t)((q * (1L << (20 - shift))) / BEACON_PERIOD);
+}
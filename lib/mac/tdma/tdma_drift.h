@@ -0,0 +1,83 @@
+/*
+ * Copyright  2008-2009 INRIA/SensTools
+ *
+ * <dev-team@sentools.info>
+ *
+ * This software is a set of libraries designed to develop applications
+ * for the WSN430 embedded hardware platform.
+ *
+ * This software is governed by the CeCILL license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL license and that you accept its terms.
+ */
+
+/**
+ * \file
+ * \brief Header file for the clock drift estimation module
+ * \date October 2026
+ *
+ * The node estimates the skew of its ACLK crystal relative to the
+ * coordinator from successive beacon sync times, with a fixed-point
+ * linear regression over the last DRIFT_SAMPLES beacons.
+ * Intervals expressed in coordinator ticks can then be converted to
+ * local ticks, which allows smaller guard times.
+ */
+
+#ifndef _TDMA_DRIFT_H_
+#define _TDMA_DRIFT_H_
+
+/**
+ * Reset the estimator, e.g. when synchronizing to a new coordinator.
+ */
+void tdma_drift_init(void);
+
+/**
+ * Feed the estimator with a received beacon.
+ * \param seq the beacon sequence number
+ * \param sync_time the local time of the beacon slot start
+ */
+void tdma_drift_sample(uint8_t seq, uint16_t sync_time);
+
+/**
+ * Check if enough beacons have been sampled for the skew to be used.
+ * \return 1 if the estimate is valid, 0 otherwise
+ */
+int16_t tdma_drift_locked(void);
+
+/**
+ * Get the current skew estimate.
+ * \return the skew in 2^-20 units (about 1ppm), positive if the local
+ * clock runs faster than the coordinator's
+ */
+int16_t tdma_drift_skew(void);
+
+/**
+ * Convert a duration from coordinator ticks to local ticks.
+ * \param ticks the duration in coordinator ticks
+ * \return the corrected duration in local ticks
+ */
+uint16_t tdma_drift_adjust(uint16_t ticks);
+
+#endif
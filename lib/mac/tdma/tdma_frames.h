@@ -72,14 +72,39 @@ typedef struct {
 
 #define FOOTER_LENGTH sizeof(footer_t)
 
+/*
+ * Downlink entries are appended to the beacon after the data byte,
+ * as many as fit in DOWNLINK_LENGTH_MAX bytes:
+ * | dl_ctl | length | payload[length] |
+ *
+ * DL_CTL format:
+ * | 7 6 5 4 3 2 1 0 |
+ * |   seq  |  addr  |
+ * |        |  dst   |
+ */
+#define DOWNLINK_LENGTH_MAX    40
+#define DOWNLINK_HEADER_LENGTH 2
+#define DOWNLINK_PAYLOAD_MAX   16
+
+#define DOWNLINK_SEQ_MASK  0xF0
+#define DOWNLINK_ADDR_MASK 0x0F
+#define DOWNLINK_CTL(seq, addr) \
+        ((((seq)<<4)&DOWNLINK_SEQ_MASK)|((addr)&DOWNLINK_ADDR_MASK))
+#define DOWNLINK_GET_SEQ(ctl) (((ctl)&DOWNLINK_SEQ_MASK)>>4)
+#define DOWNLINK_GET_ADDR(ctl) ((ctl)&DOWNLINK_ADDR_MASK)
+
 typedef struct {
     header_t hdr;
     uint8_t seq;
+    uint8_t cell;
     uint8_t ctl;
     uint8_t data;
+    uint8_t downlink[DOWNLINK_LENGTH_MAX];
 } beacon_msg_t;
 
-#define BEACON_LENGTH sizeof(beacon_msg_t)
+// length of a beacon without downlink data
+#define BEACON_LENGTH (sizeof(beacon_msg_t)-DOWNLINK_LENGTH_MAX)
+#define BEACON_LENGTH_MAX sizeof(beacon_msg_t)
 #define BEACON_TYPE 0x10
 
 typedef struct {
@@ -87,7 +112,7 @@ typedef struct {
     uint8_t ctl;
 } control_msg_t;
 
-#define CONTROL_LENGTH sizeof(beacon_msg_t)
+#define CONTROL_LENGTH sizeof(control_msg_t)
 #define CONTROL_TYPE       0x20
 #define CONTROL_ATTACH_REQ 0xA0
 #define CONTROL_ATTACH_OK  0xB0
@@ -99,15 +124,27 @@ typedef struct {
 #define CONTROL_GET_ADDR(msg) (msg.ctl&0x0F)
 
 #define PACKET_SIZE_MAX 64
-#define PAYLOAD_LENGTH_MAX PACKET_SIZE_MAX-(HEADER_LENGTH+FOOTER_LENGTH)
+#define PAYLOAD_LENGTH_MAX PACKET_SIZE_MAX-(HEADER_LENGTH+FOOTER_LENGTH+1)
 
 typedef struct {
     header_t hdr;
+    uint8_t ack;
     uint8_t payload[PAYLOAD_LENGTH_MAX];
 } data_msg_t;
 
 #define DATA_LENGTH sizeof(data_msg_t)
+// length of a data frame carrying only the downlink acknowledgement
+#define DATA_ACK_LENGTH (HEADER_LENGTH+1)
 #define DATA_TYPE 0x30
 
+/*
+ * ACK format:
+ * | 7 6 5 4 3 2 1 0 |
+ * | V 0 0 0 |  seq  |
+ * V is set if seq acknowledges the last downlink entry received
+ */
+#define DATA_ACK_VALID 0x80
+#define DATA_ACK_SEQ_MASK 0x0F
+
 
 #endif
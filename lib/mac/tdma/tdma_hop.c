@@ -0,0 +1,107 @@
+/*
+ * Copyright  2008-2009 INRIA/SensTools
+ *
+ * <dev-team@sentools.info>
+ *
+ * This software is a set of libraries designed to develop applications
+ * for the WSN430 embedded hardware platform.
+ *
+ * This software is governed by the CeCILL license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL license and that you accept its terms.
+ */
+
+/**
+ * \file
+ * \brief Channel hopping module
+ * \date October 2026
+ */
+
+#include <io.h>
+#include "tdma_hop.h"
+#include "tdma_timings.h"
+
+#define SLOTS_PER_FRAME (CTRL_SLOT+1)
+
+#if HOP_CHANNELS != 8
+#error "the cell permutations are drawn for HOP_CHANNELS 8"
+#endif
+
+// 7! permutations of the channels after the first, prime to the multiplier
+#define HOP_PERMUTATIONS 5040
+// spreads consecutive cell IDs, which then share at most 4 of the 8 channels
+#define HOP_CELL_MUL 1013
+
+// the permutation of the hopping channels of the last cell asked for
+static uint8_t hop_sequence[HOP_CHANNELS];
+static uint8_t hop_cell;
+static uint8_t hop_ready = 0;
+
+/**
+ * Draw the channel permutation of a cell.
+ * The cell rank is decoded in the factorial number system into a
+ * permutation of the channels 1 to 7, after channel 0: a sequence of
+ * another cell is neither the same nor a time shift of it.
+ */
+static void hop_sequence_set(uint8_t cell) {
+    uint8_t left[HOP_CHANNELS-1];
+    uint16_t rank, base;
+    uint8_t i, n, d;
+
+    rank = (uint16_t)(((uint32_t)cell * HOP_CELL_MUL) % HOP_PERMUTATIONS);
+
+    for (i=0; i<HOP_CHANNELS-1; i++) {
+        left[i] = i+1;
+    }
+
+    hop_sequence[0] = 0;
+    base = HOP_PERMUTATIONS;
+    for (n=HOP_CHANNELS-1; n>0; n--) {
+        base /= n;
+        d = rank / base;
+        rank %= base;
+
+        hop_sequence[HOP_CHANNELS-n] = left[d];
+        for (i=d; i<n-1; i++) {
+            left[i] = left[i+1];
+        }
+    }
+
+    hop_cell = cell;
+    hop_ready = 1;
+}
+
+uint8_t tdma_hop_channel(uint8_t cell, uint8_t seq, uint8_t slot) {
+    uint16_t asn;
+
+    if (!hop_ready || cell != hop_cell) {
+        hop_sequence_set(cell);
+    }
+
+    // absolute slot number, 256 frames wrap to a multiple of HOP_CHANNELS
+    asn = (uint16_t)seq * SLOTS_PER_FRAME + slot;
+
+    return HOP_CHANNEL_FIRST + hop_sequence[asn % HOP_CHANNELS];
+}
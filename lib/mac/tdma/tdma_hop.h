@@ -0,0 +1,68 @@
+/*
+ * Copyright  2008-2009 INRIA/SensTools
+ *
+ * <dev-team@sentools.info>
+ *
+ * This software is a set of libraries designed to develop applications
+ * for the WSN430 embedded hardware platform.
+ *
+ * This software is governed by the CeCILL license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL license and that you accept its terms.
+ */
+
+/**
+ * \file
+ * \brief Header file for the channel hopping module
+ * \date October 2026
+ *
+ * When HOPPING is set, the beacons are sent on the cell home channel
+ * (the one given to mac_init) while the data and control slots hop
+ * over HOP_CHANNELS channels. The channel of a slot is derived from its
+ * absolute slot number (beacon sequence number and slot index) through
+ * a permutation drawn from the cell ID announced in the beacon. Distinct
+ * cell IDs get distinct permutations, none a time shift of another, so
+ * unsynchronized coordinators sharing the same area collide on some of
+ * their slots only: with 8 channels, no set of sequences can keep them
+ * apart on every slot. The home channels should be chosen outside the
+ * hopping channels.
+ */
+
+#ifndef _TDMA_HOP_H_
+#define _TDMA_HOP_H_
+
+#define HOP_CHANNEL_FIRST 4
+#define HOP_CHANNELS      8 // must divide 256, the permutations are for 8
+
+/**
+ * Get the radio channel of a slot.
+ * \param cell the cell ID, from the beacon
+ * \param seq the beacon sequence number starting the slot frame
+ * \param slot the slot index in the frame
+ * \return the channel to give to cc1101_cfg_chan (before x2 spacing)
+ */
+uint8_t tdma_hop_channel(uint8_t cell, uint8_t seq, uint8_t slot);
+
+#endif
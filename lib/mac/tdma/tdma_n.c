@@ -46,6 +46,8 @@
 #include "tdma_n.h"
 #include "tdma_frames.h"
 #include "tdma_timings.h"
+#include "tdma_drift.h"
+#include "tdma_hop.h"
 #include "cc1101.h"
 #include "ds2411.h"
 #include "timerB.h"
@@ -82,10 +84,20 @@ enum {
 };
 
 
+#if ((BEACON_SKIP_MAX+1)*TIMEOUT_COUNT_MAX*BEACON_PERIOD) > 0xFFFF
+#error "BEACON_SKIP_MAX too big, beacon alarms would overflow timerB"
+#endif
+
 #define ALARM_BEACON    TIMERB_ALARM_CCR0
 #define ALARM_TIMEOUT TIMERB_ALARM_CCR1
 #define ALARM_SEND      TIMERB_ALARM_CCR2
 
+#if HOPPING
+#define TX_OFFSET HOP_TX_OFFSET
+#else
+#define TX_OFFSET 0
+#endif
+
 uint8_t node_addr=0x0;
 static volatile uint8_t send_ready=0;
 
@@ -99,12 +111,17 @@ static uint16_t control_send(void);
 static uint16_t control_sent(void);
 static uint16_t slot_send(void);
 static uint16_t slot_sent(void);
+static void beacon_wait(void);
+static uint16_t beacon_downlink(uint16_t length);
+static void slot_prepare(uint8_t slot);
 
 /* STATIC VARIABLES */
 static beacon_msg_t beacon_msg;
 static uint16_t beacon_sync_time;
 static uint16_t beacon_eop_time;
 static uint16_t beacon_timeout_count;
+static uint16_t beacon_guard_time;
+static uint8_t beacon_skip;
 
 static control_msg_t control_msg;
 static uint16_t attach_backoff;
@@ -114,10 +131,17 @@ uint8_t* const mac_payload=data_msg.payload;
 
 static uint16_t sync_time;
 static uint8_t coord_addr;
+static uint8_t coord_cell;
+static uint8_t home_channel;
 static uint8_t my_slot;
 static uint8_t state;
 
+static uint8_t downlink_seq;
+static uint8_t ack_pending;
+static uint8_t ack_seq;
+
 static uint16_t (*access_allowed_cb)(void);
+static uint16_t (*downlink_cb)(uint8_t* data, uint16_t length);
 
 void mac_init(uint8_t channel) {
     // initialize the unique serial number chip and set node address accordingly
@@ -156,6 +180,7 @@ void mac_init(uint8_t channel) {
     cc1101_cfg_chanspc_e(0x3);
     cc1101_cfg_chanspc_m(0x6C);
     cc1101_cfg_chan(channel<<1); // channel x2 to get 600kHz spacing
+    home_channel = channel;
 
     // set channel bandwidth (560 kHz)
     cc1101_cfg_chanbw_e(0);
@@ -200,8 +225,16 @@ void mac_init(uint8_t channel) {
 
     // initialize the flag
     send_ready = 0;
-    // reset the callback
+    // reset the callbacks
     access_allowed_cb = 0x0;
+    downlink_cb = 0x0;
+
+    // no downlink data received yet
+    downlink_seq = 0xFF;
+    ack_pending = 0;
+
+    // reset the clock drift estimation
+    tdma_drift_init();
 }
 
 int16_t mac_is_access_allowed(void) {
@@ -216,11 +249,19 @@ void mac_set_access_allowed_cb(uint16_t (*cb)(void)) {
     access_allowed_cb = cb;
 }
 
+void mac_set_downlink_cb(uint16_t (*cb)(uint8_t* data, uint16_t length)) {
+    downlink_cb = cb;
+}
+
 static void set_rx(void) {
     // idle, flush, calibrate
     cc1101_cmd_idle();
     cc1101_cmd_flush_rx();
     cc1101_cmd_flush_tx();
+#if HOPPING
+    // beacons are always received on the home channel
+    cc1101_cfg_chan(home_channel<<1);
+#endif
     cc1101_cmd_calibrate();
 
     // set RX
@@ -230,21 +271,23 @@ static void set_rx(void) {
 
 static uint16_t beacon_received() {
     uint8_t coord, seq;
-    uint16_t now;
+    uint16_t now, len, wakeup;
     now = timerB_time();
+    wakeup = 0;
 
     // test CRC and bytes in FIFO
+    len = cc1101_status_rxbytes();
     if ( ((cc1101_status_crc_lqi()&0x80)==0) ||
-         (cc1101_status_rxbytes()!=BEACON_LENGTH) ) {
+         (len<BEACON_LENGTH) || (len>BEACON_LENGTH_MAX) ) {
         set_rx();
         return 0;
     }
 
     // data
-    cc1101_fifo_get((uint8_t*)&beacon_msg, BEACON_LENGTH);
+    cc1101_fifo_get((uint8_t*)&beacon_msg, len);
 
     // check length, type
-    if ( (beacon_msg.hdr.length != (BEACON_LENGTH-1)) ||
+    if ( (beacon_msg.hdr.length != (len-1)) ||
          (HEADER_GET_TYPE(beacon_msg.hdr) != BEACON_TYPE) ) {
         set_rx();
         return 0;
@@ -259,8 +302,12 @@ static uint16_t beacon_received() {
 
     if (state==STATE_BEACON_SEARCH) {
         // we were looking for a beacon, store the coordinator addr
+        if (coord != coord_addr) {
+            tdma_drift_init();
+        }
         coord_addr = coord;
-    } else if (coord != coord_addr) {
+        coord_cell = beacon_msg.cell;
+    } else if ( (coord != coord_addr) || (beacon_msg.cell != coord_cell) ) {
         // beacon from unknown coordinator
         set_rx();
         return 0;
@@ -274,11 +321,23 @@ static uint16_t beacon_received() {
     // save beacon time
     beacon_sync_time = sync_time-BEACON_OVERHEAD;
 
+    // update the clock skew estimate
+    tdma_drift_sample(seq, beacon_sync_time);
+
+    // look for downlink data for us
+    if (state==STATE_ATTACHED) {
+        wakeup = beacon_downlink(len);
+    }
+
+    // an idle node with a known skew may sleep through some beacons
+    beacon_skip = 0;
+    if ( (state==STATE_ATTACHED) && !send_ready && !ack_pending &&
+            tdma_drift_locked() ) {
+        beacon_skip = BEACON_SKIP_MAX;
+    }
+
     // set alarm to receive beacon
-    timerB_set_alarm_from_time(ALARM_BEACON,  // alarm #
-                            BEACON_PERIOD,  // ticks
-                            0,  // no period
-                            beacon_sync_time-SAFETY_TIME); // reference
+    beacon_wait();
     timerB_register_cb(ALARM_BEACON, beacon_rx);
 
     // check state
@@ -304,10 +363,11 @@ static uint16_t beacon_received() {
 
             // set timer to send attach request
             timerB_set_alarm_from_time(ALARM_SEND,
-                            CTRL_SLOT*SLOT_LENGTH, // ticks
+                            tdma_drift_adjust(CTRL_SLOT*SLOT_LENGTH)+TX_OFFSET, // ticks
                             0,
                             beacon_sync_time);
             timerB_register_cb(ALARM_SEND, control_send);
+            slot_prepare(CTRL_SLOT);
 
             // update state
             state = STATE_ATTACHING_WAIT_RX;
@@ -320,37 +380,88 @@ static uint16_t beacon_received() {
             // store my_slot
             my_slot = beacon_msg.data;
             state = STATE_ATTACHED;
+            downlink_seq = 0xFF;
+            ack_pending = 0;
         } else {
             // attach failed, retry at next beacon
             state = STATE_BEACON_SEARCH;
         }
         break;
     case STATE_ATTACHED:
-        if (send_ready) {
-            // prepare data frame
-            data_msg.hdr.length = DATA_LENGTH-1;
+        if (send_ready || ack_pending) {
+            // prepare data frame, without payload if only acknowledging
+            data_msg.hdr.length = send_ready ? (DATA_LENGTH-1) : (DATA_ACK_LENGTH-1);
             HEADER_SET_TYPE(data_msg.hdr, DATA_TYPE);
             HEADER_SET_ADDR(data_msg.hdr, node_addr);
+            data_msg.ack = ack_pending ? (DATA_ACK_VALID|ack_seq) : 0;
+            ack_pending = 0;
 
             timerB_set_alarm_from_time(ALARM_SEND, // alarm #
-                                    my_slot*SLOT_LENGTH, // ticks
+                                    tdma_drift_adjust(my_slot*SLOT_LENGTH)+TX_OFFSET, // ticks
                                     0, // period
                                     beacon_sync_time); // ref
             // set alarm callback
             timerB_register_cb(ALARM_SEND, slot_send);
+            slot_prepare(my_slot);
 
             // put the data in the FIFO
             cc1101_fifo_put((uint8_t*)&data_msg, data_msg.hdr.length+1);
-            send_ready=0;
-            if (access_allowed_cb && access_allowed_cb()) {
-                // if wanted we return 1 to wake the CPU up
-                return 1;
+            if (send_ready) {
+                send_ready=0;
+                if (access_allowed_cb && access_allowed_cb()) {
+                    // if wanted we return 1 to wake the CPU up
+                    wakeup = 1;
+                }
             }
         }
         break;
     }
 
-    return 0;
+    return wakeup;
+}
+
+static void slot_prepare(uint8_t slot) {
+#if HOPPING
+    // the radio is idle after the beacon, switch to the slot channel now
+    // so the synthesizer is calibrated well before the slot
+    cc1101_cfg_chan(tdma_hop_channel(coord_cell, beacon_msg.seq, slot)<<1);
+    cc1101_cmd_calibrate();
+#endif
+}
+
+static uint16_t beacon_downlink(uint16_t length) {
+    uint8_t *ptr, *end;
+    uint8_t ctl, dl_len;
+    uint16_t wakeup = 0;
+
+    ptr = beacon_msg.downlink;
+    end = (uint8_t*)&beacon_msg + length;
+
+    while (ptr+DOWNLINK_HEADER_LENGTH <= end) {
+        ctl = ptr[0];
+        dl_len = ptr[1];
+        ptr += DOWNLINK_HEADER_LENGTH;
+
+        if (ptr+dl_len > end) {
+            // malformed entry
+            break;
+        }
+
+        if (DOWNLINK_GET_ADDR(ctl)==node_addr) {
+            // deliver it only once, but acknowledge each copy
+            if (DOWNLINK_GET_SEQ(ctl)!=downlink_seq) {
+                downlink_seq = DOWNLINK_GET_SEQ(ctl);
+                if (downlink_cb && downlink_cb(ptr, dl_len)) {
+                    wakeup = 1;
+                }
+            }
+            ack_seq = DOWNLINK_GET_SEQ(ctl);
+            ack_pending = 1;
+        }
+        ptr += dl_len;
+    }
+
+    return wakeup;
 }
 
 static uint16_t sync_detected(void) {
@@ -367,9 +478,10 @@ static uint16_t beacon_rx(void) {
     cc1101_gdo0_int_clear();
     cc1101_gdo0_int_enable();
 
-    // set alarm for beacon timeout
+    // set alarm for beacon timeout, the beacon is expected
+    // BEACON_OVERHEAD after the guard time
     timerB_set_alarm_from_now(ALARM_TIMEOUT,  // alarm #
-                            TIMEOUT_TIME,  // ticks
+                            2*beacon_guard_time+TIMEOUT_TIME,  // ticks
                             0);  // no period
     timerB_register_cb(ALARM_TIMEOUT, beacon_timeout);
     return 0;
@@ -392,14 +504,28 @@ static uint16_t beacon_timeout(void) {
     }
 
     // reset alarm to receive beacon
-    timerB_set_alarm_from_time(ALARM_BEACON,  // alarm #
-                            BEACON_PERIOD*(beacon_timeout_count+1),  // ticks
-                            0,  // period (same)
-                            beacon_sync_time-(SAFETY_TIME*(beacon_timeout_count+1))); // reference
+    beacon_wait();
 
     return 0;
 }
 
+static void beacon_wait(void) {
+    uint16_t periods, guard;
+
+    // number of beacon periods since the last received beacon
+    periods = (beacon_skip+1)*(beacon_timeout_count+1);
+
+    // the guard time covers the drift uncertainty, which is much smaller
+    // once the skew is compensated
+    guard = tdma_drift_locked() ? SAFETY_TIME_LOCKED : SAFETY_TIME;
+    beacon_guard_time = guard*periods;
+
+    timerB_set_alarm_from_time(ALARM_BEACON,  // alarm #
+                            tdma_drift_adjust(BEACON_PERIOD*periods),  // ticks
+                            0,  // no period
+                            beacon_sync_time-beacon_guard_time); // reference
+}
+
 static uint16_t control_send(void) {
     LED_BLUE_ON();
     cc1101_gdo0_register_callback(control_sent);
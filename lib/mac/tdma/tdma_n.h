@@ -77,6 +77,15 @@ void mac_set_access_allowed_cb(uint16_t (*cb)(void));
  */
 int16_t mac_is_access_allowed(void);
 
+/**
+ * This function registers a callback function that will be called
+ * when the coordinator has sent data to this node in a beacon.
+ * The data is acknowledged in the next frame sent in our slot.
+ * \param cb the callback function to register, it should return
+ * 1 to wake the CPU up, 0 otherwise
+ */
+void mac_set_downlink_cb(uint16_t (*cb)(uint8_t* data, uint16_t length));
+
 /**
  * Pointer to the data payload. You can only write to this buffer
  * when mac_is_access_allowed returns 1.
@@ -86,6 +95,6 @@ extern uint8_t* const mac_payload;
 /**
  * The size of the mac_data_payload buffer.
  */
-#define TDMA_PAYLOAD_SIZE 60
+#define TDMA_PAYLOAD_SIZE 59
 
 #endif
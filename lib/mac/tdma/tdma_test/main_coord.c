@@ -47,6 +47,11 @@ int main (void)
             uart0_putchar('0'+(char)i);
             uart0_putchar(mac_slots[i].data[0]);
             mac_slots[i].ready = 0;
+
+            // echo the first byte back to the node
+            if (mac_is_downlink_free(i)) {
+                mac_send_downlink(i, mac_slots[i].data, 1);
+            }
         }
     }
     return 0;
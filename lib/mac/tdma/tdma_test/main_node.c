@@ -9,6 +9,7 @@
 #include "tdma_n.h"
 
 uint16_t mac_ready(void);
+uint16_t mac_downlink(uint8_t* data, uint16_t length);
 
 int putchar(int c)
 {
@@ -32,6 +33,7 @@ int main (void)
 
     mac_init(0);
     mac_set_access_allowed_cb(mac_ready);
+    mac_set_downlink_cb(mac_downlink);
 
     printf("*** I'm %u ***\n", node_addr);
 
@@ -56,3 +58,10 @@ uint16_t mac_ready(void) {
     // return 1 to wake the cpu up
     return 1;
 }
+
+uint16_t mac_downlink(uint8_t* data, uint16_t length) {
+    uart0_putchar('d');
+    uart0_putchar(data[0]);
+    // no need to wake the cpu up
+    return 0;
+}
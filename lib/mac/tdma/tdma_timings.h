@@ -54,4 +54,26 @@
 
 #define BEACON_OVERHEAD       (48-8)
 
+// clock drift compensation (see tdma_drift.h)
+#define DRIFT_SAMPLES         8 // beacons kept for the regression
+#define DRIFT_SAMPLES_MIN     4 // beacons needed before correcting
+#define DRIFT_GAP_MAX         16 // max beacon periods between two samples
+#define DRIFT_ERROR_MAX       33 // 1ms, max prediction error before reset
+#define DRIFT_SKEW_MAX        1048 // 1000ppm, in 2^-20 units
+#define SAFETY_TIME_LOCKED    16 // 0.5ms, guard time once the skew is known
+
+// channel hopping for the data and control slots (see tdma_hop.h),
+// the radio channel is changed within BEACON_TO_SLOT before the slot and
+// the frames are sent HOP_TX_OFFSET after the slot start, leaving time
+// for the coordinator to calibrate on the new channel
+#ifndef HOPPING
+#define HOPPING               0
+#endif
+#define HOP_TX_OFFSET         33 // 1ms
+
+// beacons an idle attached node may sleep through (0 to wake up on each)
+#ifndef BEACON_SKIP_MAX
+#define BEACON_SKIP_MAX       0
+#endif
+
 #endif
@@ -52,6 +52,11 @@
 #define PACKET_LENGTH_MAX 56
 
 #define HEADER_LENGTH   0x5
+#define ACK_LENGTH      0x6
+
+#if PBUF_HEADROOM < HEADER_LENGTH+1
+#error "PBUF_HEADROOM must fit the frame header"
+#endif
 
 #define STATE_WOR       0x0
 #define STATE_RX        0x10
@@ -68,12 +73,42 @@
 #define ALARM_PREAMBLE TIMERB_ALARM_CCR0
 #define ALARM_TIMEOUT TIMERB_ALARM_CCR1
 #define ALARM_RETRY TIMERB_ALARM_CCR2
+#define ALARM_ADAPT TIMERB_ALARM_CCR3
 
 // timing
 #define SEND_PERIOD 108
-#define MAX_PREAMBLE_COUNT 64
 #define ACK_TIMEOUT 131
 
+/*
+ * Adaptive wake-up interval: the WOR period is WOR_EVENT0_MIN << wor_level.
+ * The level grows by one every ADAPT_PERIOD without traffic and is halved
+ * each time the node sends or receives a frame. The current level is
+ * advertised in the ACKs, so that a sender only sends the preambles
+ * needed to cover the destination's interval.
+ */
+#ifndef WOR_EVENT0_MIN
+#define WOR_EVENT0_MIN 2104 // 61ms
+#endif
+#ifndef WOR_LEVEL_MAX
+#define WOR_LEVEL_MAX 4 // 971ms
+#endif
+#if WOR_LEVEL_MAX > 4
+#error "WOR_LEVEL_MAX must not exceed 4 (16-bit EVENT0 and preamble alarm)"
+#endif
+#ifndef ADAPT_PERIOD
+#define ADAPT_PERIOD 32768 // 1s
+#endif
+// RX_TIME for the shortest interval, each level halves the RX_TIME ratio
+#define WOR_RX_TIME_MIN 1
+// number of preambles covering the shortest interval
+#define PREAMBLE_COUNT_MIN 20
+#define MAX_PREAMBLE_COUNT (PREAMBLE_COUNT_MIN << WOR_LEVEL_MAX)
+
+// number of neighbours whose wake-up interval is remembered
+#ifndef NEIGHBOUR_MAX
+#define NEIGHBOUR_MAX 8
+#endif
+
 typedef struct {
     uint8_t length;
     uint8_t type;
@@ -89,16 +124,35 @@ typedef struct {
     uint8_t src_addr[2];
 } preamble_t;
 
+typedef struct {
+    uint8_t length;
+    uint8_t type;
+    uint8_t dst_addr[2];
+    uint8_t src_addr[2];
+    uint8_t level;
+} ack_t;
+
+typedef struct {
+    uint16_t addr;
+    uint16_t level;
+} neighbour_t;
+
 // node's MAC address
 uint16_t node_addr;
 
 // callback for received packets
 static mac_received_t received_cb;
+static mac_received_buf_t received_buf_cb;
 static mac_sent_t sent_cb;
 static mac_error_t error_cb;
 
 // frames
 static frame_t frame, txframe;
+static ack_t ackframe;
+
+// frame being sent, txframe or in tx_buf
+static frame_t *tx;
+static pbuf_t *tx_buf;
 
 // internal state
 static uint16_t state;
@@ -107,6 +161,13 @@ static uint16_t frame_to_send=0;
 // count
 static uint16_t delay_count;
 static uint16_t preamble_count;
+static uint16_t preamble_max;
+
+// wake-up interval adaptation
+static uint8_t wor_level;
+static uint8_t traffic;
+static neighbour_t neighbours[NEIGHBOUR_MAX];
+static uint8_t neighbour_next;
 
 // prototypes
 static uint16_t set_wor(void);
@@ -122,10 +183,19 @@ static uint16_t send_done(void);
 static uint16_t read_dataack(void);
 static uint16_t ack_timeout(void);
 static uint16_t delay_send(void);
+static uint16_t adapt(void);
+static void traffic_seen(void);
+static void neighbour_update(uint16_t addr, uint8_t level);
+static void neighbour_forget(uint16_t addr);
+static uint16_t neighbour_preambles(uint16_t addr);
+static void prepare_ack(uint8_t type);
+static void tx_end(void);
 
 
 void mac_init(uint8_t channel)
 {
+    uint16_t i;
+
     // initialize the unique serial number chip and set node address accordingly
     ds2411_init();
     node_addr = (((uint16_t)ds2411_id.serial1)<<8) + (ds2411_id.serial0);
@@ -135,6 +205,7 @@ void mac_init(uint8_t channel)
 
     // reset callbacks
     received_cb = 0x0;
+    received_buf_cb = 0x0;
     sent_cb = 0x0;
     error_cb = 0x0;
 
@@ -182,10 +253,8 @@ void mac_init(uint8_t channel)
     cc1101_cfg_rxoff_mode(CC1101_RXOFF_MODE_IDLE);
     cc1101_cfg_txoff_mode(CC1101_TXOFF_MODE_IDLE);
 
-    // configure WOR
-    cc1101_cfg_rx_time(2); ///FIXME
+    // configure WOR, the period is set by set_wor()
     cc1101_cfg_wor_res(0);
-    cc1101_cfg_event0(4208);
     cc1101_cfg_event1(4);
     cc1101_cfg_rc_pd(CC1101_RC_OSC_ENABLE);
 
@@ -207,7 +276,18 @@ void mac_init(uint8_t channel)
     cc1101_gdo0_int_clear();
     cc1101_gdo0_int_enable();
 
+    // start with the shortest interval, forget the neighbours
+    wor_level = 0;
+    traffic = 0;
+    neighbour_next = 0;
+    for (i = 0; i < NEIGHBOUR_MAX; i++)
+        neighbours[i].level = WOR_LEVEL_MAX;
+
+    timerB_set_alarm_from_now(ALARM_ADAPT, ADAPT_PERIOD, ADAPT_PERIOD);
+    timerB_register_cb(ALARM_ADAPT, adapt);
+
     // start the machine
+    tx_end();
     set_wor();
 }
 
@@ -215,6 +295,10 @@ void mac_set_rx_cb(mac_received_t cb) {
     received_cb = cb;
 }
 
+void mac_set_rx_buf_cb(mac_received_buf_t cb) {
+    received_buf_cb = cb;
+}
+
 void mac_set_sent_cb(mac_sent_t cb) {
     sent_cb = cb;
 }
@@ -238,6 +322,7 @@ uint16_t mac_send(uint8_t packet[], uint16_t length, uint16_t dst_addr) {
     }
 
     // prepare header
+    tx = &txframe;
     txframe.length = length + HEADER_LENGTH;
     txframe.type = TYPE_DATA;
     txframe.dst_addr[0] = dst_addr>>8;
@@ -259,6 +344,44 @@ uint16_t mac_send(uint8_t packet[], uint16_t length, uint16_t dst_addr) {
     return 0;
 }
 
+uint16_t mac_send_buf(pbuf_t *buf, uint16_t dst_addr) {
+    // check length
+    if (buf->length>PACKET_LENGTH_MAX) {
+        printf("mac_send_buf, packet length error\n");
+        return 2;
+    }
+
+    // check state
+    if (frame_to_send) {
+        printf("mac_send_buf, frame_to_send=1 error\n");
+        return 1;
+    }
+
+    // prepend the header, the payload stays in place
+    tx = (frame_t*) pbuf_push(buf, HEADER_LENGTH+1);
+    if (tx == 0x0) {
+        printf("mac_send_buf, headroom error\n");
+        return 2;
+    }
+    tx->length = buf->length - 1;
+    tx->type = TYPE_DATA;
+    tx->dst_addr[0] = dst_addr>>8;
+    tx->dst_addr[1] = dst_addr & 0xFF;
+    tx->src_addr[0] = node_addr>>8;
+    tx->src_addr[1] = node_addr & 0xFF;
+
+    pbuf_ref(buf);
+    tx_buf = buf;
+
+    // update frame to send flag
+    frame_to_send = 1;
+    delay_count = 0;
+
+    // call try_send to start TX procedure
+    try_send();
+    return 0;
+}
+
 static uint16_t set_wor(void) {
     cc1101_cmd_idle();
 
@@ -268,6 +391,10 @@ static uint16_t set_wor(void) {
     cc1101_cfg_rc_pd(CC1101_RC_OSC_ENABLE);
     cc1101_cfg_fs_autocal(CC1101_AUTOCAL_IDLE_TO_TX_RX);
 
+    // keep the RX window length constant when the period changes
+    cc1101_cfg_event0(WOR_EVENT0_MIN << wor_level);
+    cc1101_cfg_rx_time(WOR_RX_TIME_MIN + wor_level);
+
     cc1101_gdo0_register_callback(read_frame);
     cc1101_gdo0_int_clear();
 
@@ -313,7 +440,7 @@ static uint16_t delay_send(void) {
     //~ printf("delay\n");
     if (delay_count >= MAX_DELAY_COUNT) {
         // abort
-        frame_to_send = 0;
+        tx_end();
         if (error_cb)
             return error_cb();
     } else {
@@ -350,8 +477,8 @@ static uint16_t medium_clear(void) {
     // prepare frame
     frame.length = HEADER_LENGTH;
     frame.type = TYPE_PREAMBLE;
-    frame.dst_addr[0] = txframe.dst_addr[0];
-    frame.dst_addr[1] = txframe.dst_addr[1];
+    frame.dst_addr[0] = tx->dst_addr[0];
+    frame.dst_addr[1] = tx->dst_addr[1];
     frame.src_addr[0] = node_addr>>8;
     frame.src_addr[1] = node_addr & 0xFF;
 
@@ -359,6 +486,7 @@ static uint16_t medium_clear(void) {
     timerB_set_alarm_from_now(ALARM_PREAMBLE, SEND_PERIOD, SEND_PERIOD);
     timerB_register_cb(ALARM_PREAMBLE, send_preamble);
     preamble_count = 0;
+    preamble_max = neighbour_preambles((((uint16_t)tx->dst_addr[0])<<8) + tx->dst_addr[1]);
 
     send_preamble();
 
@@ -368,7 +496,7 @@ static uint16_t medium_clear(void) {
 static uint16_t send_preamble(void) {
     preamble_count ++;
 
-    if (preamble_count >= MAX_PREAMBLE_COUNT) {
+    if (preamble_count >= preamble_max) {
         send_data();
         return 0;
     }
@@ -383,7 +511,7 @@ static uint16_t send_preamble(void) {
 
 static uint16_t read_ack(void) {
     static struct {
-        uint8_t length, type, dst_addr[2], src_addr[2], status[2];
+        uint8_t length, type, dst_addr[2], src_addr[2], level, status[2];
     } ack;
 
     // check if radio state is idle
@@ -400,7 +528,7 @@ static uint16_t read_ack(void) {
     // we got a frame
     // Check Length is correct
     cc1101_fifo_get( (uint8_t*) &(ack.length), 1);
-    if (ack.length != HEADER_LENGTH) {
+    if (ack.length != ACK_LENGTH) {
         // length doesn't match the frame
         return 0;
     }
@@ -416,11 +544,13 @@ static uint16_t read_ack(void) {
 
     // Check address
     if ( (ack.dst_addr[0] != (node_addr>>8)) || (ack.dst_addr[1] != (node_addr&0xFF)) ||
-        (ack.src_addr[0] != txframe.dst_addr[0]) || (ack.src_addr[1] != txframe.dst_addr[1]) ) {
+        (ack.src_addr[0] != tx->dst_addr[0]) || (ack.src_addr[1] != tx->dst_addr[1]) ) {
         // addresses don't match
         return 0;
     }
 
+    neighbour_update((((uint16_t)ack.src_addr[0])<<8) + ack.src_addr[1], ack.level);
+
     // everything's good, send data
     send_data();
     return 0;
@@ -436,7 +566,7 @@ static uint16_t send_data(void) {
     cc1101_cfg_txoff_mode(CC1101_TXOFF_MODE_IDLE);
 
     cc1101_cmd_tx();
-    cc1101_fifo_put((uint8_t*)(&txframe.length), txframe.length+1);
+    cc1101_fifo_put((uint8_t*)(&tx->length), tx->length+1);
     cc1101_gdo0_register_callback(send_done);
     return 0;
 }
@@ -445,9 +575,10 @@ static uint16_t send_done(void) {
     //~ printf("sent\n");
     // data has been sent
     // if broadcast, don't wait for ACK
-    if ((txframe.dst_addr[0]==0xFF) && (txframe.dst_addr[1])==0xFF) {
+    if ((tx->dst_addr[0]==0xFF) && (tx->dst_addr[1])==0xFF) {
         //~ printf("send_done, after %u preambles\n", preamble_count);
-        frame_to_send = 0;
+        tx_end();
+        traffic_seen();
         set_wor();
         if (sent_cb) return sent_cb();
     } else {
@@ -477,7 +608,7 @@ static uint16_t send_done(void) {
 static uint16_t read_dataack(void) {
     //~ printf("ack\n");
     static struct {
-        uint8_t length, type, dst_addr[2], src_addr[2];
+        uint8_t length, type, dst_addr[2], src_addr[2], level;
     } ack;
 
     // Check CRC
@@ -491,7 +622,7 @@ static uint16_t read_dataack(void) {
     // we got a frame
     // Check Length is correct
     cc1101_fifo_get( (uint8_t*) &(ack.length), 1);
-    if (ack.length != HEADER_LENGTH) {
+    if (ack.length != ACK_LENGTH) {
         // length doesn't match the frame
         cc1101_cmd_flush_rx();
         cc1101_cmd_rx();
@@ -511,7 +642,7 @@ static uint16_t read_dataack(void) {
 
     // Check address
     if ( (ack.dst_addr[0] != (node_addr>>8)) || (ack.dst_addr[1] != (node_addr&0xFF)) ||
-        (ack.src_addr[0] != txframe.dst_addr[0]) || (ack.src_addr[1] != txframe.dst_addr[1]) ) {
+        (ack.src_addr[0] != tx->dst_addr[0]) || (ack.src_addr[1] != tx->dst_addr[1]) ) {
         // addresses don't match
         cc1101_cmd_flush_rx();
         cc1101_cmd_rx();
@@ -520,14 +651,18 @@ static uint16_t read_dataack(void) {
 
     // everything's good, send is really done
     timerB_unset_alarm(ALARM_TIMEOUT);
+    neighbour_update((((uint16_t)ack.src_addr[0])<<8) + ack.src_addr[1], ack.level);
+    traffic_seen();
     set_wor();
-    frame_to_send = 0;
+    tx_end();
     if (sent_cb) return sent_cb();
 
     return 0;
 }
 
 static uint16_t ack_timeout(void) {
+    // the destination may sleep longer than we thought
+    neighbour_forget((((uint16_t)tx->dst_addr[0])<<8) + tx->dst_addr[1]);
     set_wor();
     delay_send();
     return 0;
@@ -556,12 +691,29 @@ static uint16_t medium_busy(void) {
     return 0;
 }
 
+/**
+ * Forget the frame being sent, giving its buffer back.
+ */
+static void tx_end(void) {
+    pbuf_t *buf = tx_buf;
+
+    frame_to_send = 0;
+    tx = &txframe;
+    tx_buf = 0x0;
+    if (buf) {
+        pbuf_pull(buf, HEADER_LENGTH+1);
+        pbuf_free(buf);
+    }
+}
+
 /*------------------------RX--------------------------*/
 
 static uint16_t read_frame(void) {
-    uint16_t src, dst;
+    uint16_t src, dst, ret_val;
     uint8_t status[2];
+    uint8_t *payload;
     int16_t rssi;
+    pbuf_t *buf;
 
     state = STATE_RX;
 
@@ -585,28 +737,43 @@ static uint16_t read_frame(void) {
         return 0;
     }
 
-    // Get Frame
-    cc1101_fifo_get( (uint8_t*) &(frame.length)+1, frame.length);
-
-    // Get Status
-    cc1101_fifo_get( (uint8_t*) status, 2);
+    // Get Header
+    cc1101_fifo_get( (uint8_t*) &(frame.length)+1, HEADER_LENGTH);
 
     // Compute addresses
     dst = (((uint16_t)frame.dst_addr[0])<<8) + frame.dst_addr[1];
     src = (((uint16_t)frame.src_addr[0])<<8) + frame.src_addr[1];
 
+    // Get the payload, of a data frame for me in a buffer if the upper
+    // layer takes them, with the headroom before it
+    payload = frame.payload;
+    buf = 0x0;
+    if ( received_buf_cb && (frame.type == TYPE_DATA) &&
+         (dst == node_addr || dst == 0xFFFF) ) {
+        buf = pbuf_alloc(PBUF_HEADROOM);
+        if (buf == 0x0) {
+            // no buffer, the frame is not acknowledged
+            cc1101_cmd_idle();
+            cc1101_cmd_flush_rx();
+            set_wor();
+            return 0;
+        }
+        payload = pbuf_put(buf, frame.length-HEADER_LENGTH);
+    }
+    cc1101_fifo_get(payload, frame.length-HEADER_LENGTH);
+
+    // Get Status
+    cc1101_fifo_get( (uint8_t*) status, 2);
+
     // Check Frame Type
     if (frame.type == TYPE_PREAMBLE) {
         // preamble
         if ( dst == node_addr) {
             // for me !
-            // Prepare ACK Frame
-            frame.length = HEADER_LENGTH;
-            frame.type = TYPE_ACK;
-            frame.dst_addr[0] = frame.src_addr[0];
-            frame.dst_addr[1] = frame.src_addr[1];
-            frame.src_addr[0] = node_addr>>8;
-            frame.src_addr[1] = node_addr & 0xFF;
+            traffic_seen();
+
+            // Prepare ACK Frame, advertising our wake-up interval
+            prepare_ack(TYPE_ACK);
 
             // configure auto switch
             cc1101_cfg_txoff_mode(CC1101_TXOFF_MODE_RX);
@@ -623,7 +790,7 @@ static uint16_t read_frame(void) {
             cc1101_cmd_tx();
 
             // Put frame in TX FIFO
-            cc1101_fifo_put((uint8_t*)&frame.length, frame.length+1);
+            cc1101_fifo_put((uint8_t*)&ackframe.length, ackframe.length+1);
 
             return 0;
 
@@ -648,15 +815,14 @@ static uint16_t read_frame(void) {
         // data
         int len = frame.length-HEADER_LENGTH;
 
+        if (dst == node_addr || dst == 0xFFFF) {
+            traffic_seen();
+        }
+
         // if for me, send ACK
         if (dst == node_addr) {
             // send DATAACK
-            frame.length = HEADER_LENGTH;
-            frame.type = TYPE_DATAACK;
-            frame.dst_addr[0] = frame.src_addr[0];
-            frame.dst_addr[1] = frame.src_addr[1];
-            frame.src_addr[0] = node_addr>>8;
-            frame.src_addr[1] = node_addr & 0xFF;
+            prepare_ack(TYPE_DATAACK);
 
             // update callback
             cc1101_gdo0_register_callback(set_wor);
@@ -665,16 +831,20 @@ static uint16_t read_frame(void) {
             cc1101_cmd_tx();
 
             // Put frame in TX FIFO
-            cc1101_fifo_put((uint8_t*)&frame.length, frame.length+1);
+            cc1101_fifo_put((uint8_t*)&ackframe.length, ackframe.length+1);
         } else {
             set_wor();
         }
 
         if (dst == node_addr || dst == 0xFFFF) {
             // for me, call handler
-            if (received_cb) {
-                rssi = status[0] >= 128 ? status[0]-256 : status[0];
-                rssi -= 140;
+            rssi = status[0] >= 128 ? status[0]-256 : status[0];
+            rssi -= 140;
+            if (buf) {
+                ret_val = received_buf_cb(buf, src, rssi);
+                pbuf_free(buf);
+                return ret_val;
+            } else if (received_cb) {
                 return received_cb(frame.payload, len, src, rssi);
             }
         }
@@ -698,3 +868,84 @@ static uint16_t ack_sent(void) {
     return 0;
 }
 
+
+static void prepare_ack(uint8_t type) {
+    ackframe.length = ACK_LENGTH;
+    ackframe.type = type;
+    ackframe.dst_addr[0] = frame.src_addr[0];
+    ackframe.dst_addr[1] = frame.src_addr[1];
+    ackframe.src_addr[0] = node_addr>>8;
+    ackframe.src_addr[1] = node_addr & 0xFF;
+    ackframe.level = wor_level;
+}
+
+/*------------------Wake-up interval------------------*/
+
+static uint16_t adapt(void) {
+    uint16_t i;
+
+    // the neighbours' levels grow by at most one per period
+    for (i = 0; i < NEIGHBOUR_MAX; i++) {
+        if (neighbours[i].level < WOR_LEVEL_MAX)
+            neighbours[i].level++;
+    }
+
+    if (traffic) {
+        traffic = 0;
+    } else if (wor_level < WOR_LEVEL_MAX) {
+        // idle for a whole period, sleep twice longer
+        wor_level++;
+        if (state == STATE_WOR) {
+            set_wor();
+        }
+    }
+    return 0;
+}
+
+static void traffic_seen(void) {
+    // the new level is applied by the next set_wor()
+    wor_level >>= 1;
+    traffic = 1;
+}
+
+static void neighbour_update(uint16_t addr, uint8_t level) {
+    uint16_t i;
+
+    for (i = 0; i < NEIGHBOUR_MAX; i++) {
+        if (neighbours[i].addr == addr)
+            break;
+    }
+    if (i == NEIGHBOUR_MAX) {
+        i = neighbour_next;
+        neighbour_next = (neighbour_next + 1) % NEIGHBOUR_MAX;
+    }
+
+    neighbours[i].addr = addr;
+    neighbours[i].level = level;
+}
+
+static void neighbour_forget(uint16_t addr) {
+    uint16_t i;
+
+    for (i = 0; i < NEIGHBOUR_MAX; i++) {
+        if (neighbours[i].addr == addr)
+            neighbours[i].level = WOR_LEVEL_MAX;
+    }
+}
+
+static uint16_t neighbour_preambles(uint16_t addr) {
+    uint16_t i, level;
+
+    level = WOR_LEVEL_MAX;
+    for (i = 0; i < NEIGHBOUR_MAX; i++) {
+        if (neighbours[i].addr == addr) {
+            // add one for our periods not being aligned with the neighbour's
+            level = neighbours[i].level + 1;
+            if (level > WOR_LEVEL_MAX)
+                level = WOR_LEVEL_MAX;
+            break;
+        }
+    }
+
+    return (PREAMBLE_COUNT_MIN << level) + 1;
+}
@@ -0,0 +1,108 @@
+#include <io.h>
+
+#include "dupcache.h"
+#include "timerB.h"
+
+/* ----DEFINES---- */
+#define ALARM_CLOCK TIMERB_ALARM_CCR4
+#define CLOCK_PERIOD 32768 // 1s
+
+// slots looked at for a pair, bounds the lookup time
+#define MAX_PROBES 8
+
+// never used slot, no node has the broadcast address
+#define EMPTY_ADDR 0xFFFF
+
+#if (DUPCACHE_SIZE & (DUPCACHE_SIZE-1)) || (DUPCACHE_SIZE < MAX_PROBES)
+#error "DUPCACHE_SIZE must be a power of two, at least MAX_PROBES"
+#endif
+#if DUPCACHE_EXPIRY > 254
+#error "DUPCACHE_EXPIRY must fit the 8bit clock"
+#endif
+
+/* ----STRUCTURES---- */
+typedef struct {
+    uint16_t src_addr;
+    uint8_t id;
+    uint8_t stamp; // clock when last seen
+} entry_t;
+
+/* ----PROTOTYPES---- */
+static uint16_t clock_tick(void);
+
+/* ----DATA---- */
+static entry_t entries[DUPCACHE_SIZE];
+static uint8_t clock;
+
+void dupcache_init(void) {
+    int i;
+
+    for (i=0; i<DUPCACHE_SIZE; i++) {
+        entries[i].src_addr = EMPTY_ADDR;
+    }
+    clock = 0;
+
+    timerB_set_alarm_from_now(ALARM_CLOCK, CLOCK_PERIOD, CLOCK_PERIOD);
+    timerB_register_cb(ALARM_CLOCK, clock_tick);
+}
+
+uint16_t dupcache_check(uint16_t src_addr, uint8_t id) {
+    entry_t *e, *free = 0x0, *oldest = 0x0;
+    uint8_t age, oldest_age = 0;
+    uint16_t h, i;
+
+    h = src_addr ^ (src_addr >> 7) ^ ((uint16_t)id << 2) ^ id;
+
+    for (i=0; i<MAX_PROBES; i++) {
+        e = &entries[(h+i) & (DUPCACHE_SIZE-1)];
+
+        if (e->src_addr == EMPTY_ADDR) {
+            // end of the probe sequence
+            if (!free) {
+                free = e;
+            }
+            break;
+        }
+
+        age = clock - e->stamp;
+        if (age >= DUPCACHE_EXPIRY) {
+            // expired, the slot can be reused but the sequence goes on
+            if (!free) {
+                free = e;
+            }
+            continue;
+        }
+
+        if ( (e->src_addr == src_addr) && (e->id == id) ) {
+            return 1;
+        }
+
+        if (age >= oldest_age) {
+            oldest_age = age;
+            oldest = e;
+        }
+    }
+
+    // new packet, replace the oldest pair if there is no room
+    e = free ? free : oldest;
+    e->src_addr = src_addr;
+    e->id = id;
+    e->stamp = clock;
+
+    return 0;
+}
+
+static uint16_t clock_tick(void) {
+    int i;
+
+    clock++;
+
+    // pin the expired pairs, so that they don't come back when the clock wraps
+    for (i=0; i<DUPCACHE_SIZE; i++) {
+        if ( (entries[i].src_addr != EMPTY_ADDR) &&
+             ((uint8_t)(clock - entries[i].stamp) > DUPCACHE_EXPIRY) ) {
+            entries[i].stamp = clock - DUPCACHE_EXPIRY;
+        }
+    }
+    return 0;
+}
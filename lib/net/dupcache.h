@@ -0,0 +1,32 @@
+#ifndef DUPCACHE_H
+#define DUPCACHE_H
+
+/**
+ * Number of (source, id) pairs remembered, must be a power of two.
+ */
+#ifndef DUPCACHE_SIZE
+#define DUPCACHE_SIZE 32
+#endif
+
+/**
+ * Time after which a pair is forgotten, in seconds (254 max).
+ */
+#ifndef DUPCACHE_EXPIRY
+#define DUPCACHE_EXPIRY 30
+#endif
+
+/**
+ * Initialize the duplicate cache, and start its clock on timerB CCR4.
+ * TimerB must have been started by the MAC layer at 32768Hz.
+ */
+void dupcache_init(void);
+
+/**
+ * Check if a packet has already been seen, and remember it if not.
+ * \param src_addr the packet network source
+ * \param id the source packet id
+ * \return 1 if the packet is known, 0 if it is new
+ */
+uint16_t dupcache_check(uint16_t src_addr, uint8_t id);
+
+#endif
@@ -4,6 +4,8 @@
 #include <stdio.h>
 
 #include "flood.h"
+#include "dupcache.h"
+#include "netq.h"
 #include "mac.h"
 #include "timerB.h"
 
@@ -11,10 +13,22 @@
 #define HEADER_LENGTH 7
 #define MAX_DATA_LEN  25
 #define MAX_ROUTE_LEN 10
-#define MAX_KNOWN_PACKETS 4
-#define STATE_RX 0x1
-#define STATE_TX 0x2
-#define ALARM_TXDELAY TIMERB_ALARM_CCR2
+
+/*
+ * Counter-based suppression: with FLOOD_SUPPRESSION=1 a packet to forward
+ * is held for a random time in [I/2, I), and the forward is cancelled if
+ * FLOOD_K copies of it have been overheard meanwhile. The interval I grows
+ * with the neighbour density, estimated from the copies counted during the
+ * previous intervals.
+ */
+#ifndef FLOOD_SUPPRESSION
+#define FLOOD_SUPPRESSION 0
+#endif
+#ifndef FLOOD_K
+#define FLOOD_K 3
+#endif
+#define INTERVAL_MIN 8192 // 250ms
+#define INTERVAL_SHIFT_MAX 2 // 1s
 
 
 /* ----STRUCTURES---- */
@@ -27,85 +41,69 @@ typedef struct {
     uint8_t data[45];
 } packet_t;
 
-typedef struct {
-    uint8_t src_addr[2],
-            id;
-} packet_id_t;
-
 /* ----PROTOTYPES---- */
-static uint16_t frame_received(uint8_t packet[], uint16_t length, uint16_t src_addr, int16_t rssi);
-static void delay_packet(void);
-static uint16_t send(void);
-static inline int is_packet_known(packet_t* pkt);
+static uint16_t frame_received(pbuf_t *rx_buf, uint16_t src_addr, int16_t rssi);
+static uint16_t packet_delay(void);
+static uint16_t forward_delay(void);
+static uint16_t forward_ready(netq_buf_t *buf);
 
 
 /* ----DATA---- */
 static net_handler_t rx_cb;
-static packet_t tx_pkt;
-static uint16_t tx_length;
-static uint16_t state;
-static packet_id_t known_packets[MAX_KNOWN_PACKETS];
-static uint8_t known_packet_id = 0;
 static uint8_t my_packet_id = 0;
+static int16_t density; // copies heard per packet, x16
 
 void net_init() {
-    int i;
-
     //  initialize MAC layer, and timerB
     mac_init(4);
+    dupcache_init();
+    netq_init();
 
     // register mac callback
-    mac_set_rx_cb(frame_received);
+    mac_set_rx_buf_cb(frame_received);
+    netq_set_ready_cb(forward_ready);
 
     // init callback
     rx_cb = 0x0;
 
-    state = STATE_RX;
-
-    for (i=0; i<MAX_KNOWN_PACKETS; i++) {
-        known_packets[i].src_addr[0] = 0;
-        known_packets[i].src_addr[1] = 0;
-        known_packets[i].id = 0;
-    }
+    density = 0;
 }
 
 uint16_t net_send(uint8_t packet[], uint16_t length, uint16_t dst_addr) {
+    netq_buf_t *buf;
+    packet_t *tx_pkt;
     uint8_t* route;
-    if (state == STATE_TX) {
-        printf("net_send state error\n");
-        return 0;
-    }
 
     if (length > MAX_DATA_LEN) {
         printf("net_send length error\n");
         return 0;
     }
-    state = STATE_TX;
 
-    tx_pkt.dst_addr[0] = dst_addr>>8;
-    tx_pkt.dst_addr[1] = dst_addr&0xFF;
-    tx_pkt.src_addr[0] = node_addr>>8;
-    tx_pkt.src_addr[1] = node_addr&0xFF;
-    tx_pkt.id = my_packet_id++;
+    buf = netq_alloc(NETQ_LOCAL);
+    if (buf == 0x0) {
+        printf("net_send queue full\n");
+        return 0;
+    }
+    tx_pkt = (packet_t*) buf->data;
 
-    tx_pkt.data_len = length;
-    tx_pkt.route_len = 1;
-    memcpy(tx_pkt.data, packet, length);
+    tx_pkt->dst_addr[0] = dst_addr>>8;
+    tx_pkt->dst_addr[1] = dst_addr&0xFF;
+    tx_pkt->src_addr[0] = node_addr>>8;
+    tx_pkt->src_addr[1] = node_addr&0xFF;
+    tx_pkt->id = my_packet_id++;
 
-    route = tx_pkt.data + length;
+    tx_pkt->data_len = length;
+    tx_pkt->route_len = 1;
+    memcpy(tx_pkt->data, packet, length);
+
+    route = tx_pkt->data + length;
     route[0] = node_addr>>8;
     route[1] = node_addr&0xFF;
 
-    tx_length = HEADER_LENGTH + length + 2;
-
     // put packet to known packets
-    known_packets[known_packet_id].src_addr[0] = tx_pkt.src_addr[0];
-    known_packets[known_packet_id].src_addr[1] = tx_pkt.src_addr[1];
-    known_packets[known_packet_id].id = tx_pkt.id;
-    known_packet_id += 1;
-    known_packet_id %= MAX_KNOWN_PACKETS;
+    dupcache_check(node_addr, tx_pkt->id);
 
-    delay_packet();
+    netq_push(buf, HEADER_LENGTH + length + 2, MAC_BROADCAST, packet_delay());
 
     return 1;
 }
@@ -119,10 +117,12 @@ void net_stop() {
 }
 
 /* ----PRIVATE FUNCTIONS---- */
-static uint16_t frame_received(uint8_t packet[], uint16_t length, uint16_t src_addr, int16_t rssi) {
-    packet_t *rx_pkt;
-    uint16_t dst;
+static uint16_t frame_received(pbuf_t *rx_buf, uint16_t src_addr, int16_t rssi) {
+    packet_t *rx_pkt, *pkt;
+    netq_buf_t *buf;
+    uint16_t dst, src;
     uint16_t ret_val = 0;
+    uint16_t length = rx_buf->length;
 
     // check min length
     if (length < HEADER_LENGTH) {
@@ -130,32 +130,32 @@ static uint16_t frame_received(uint8_t packet[], uint16_t length, uint16_t src_a
     }
 
     // cast the received packet
-    rx_pkt = (packet_t*) packet;
+    rx_pkt = (packet_t*) rx_buf->head;
 
     // ckeck the length
     if ( (HEADER_LENGTH + (rx_pkt->data_len) + (rx_pkt->route_len*2)) != length ) {
         return 0;
     }
 
-    // if packet known, abort
-    if (is_packet_known(rx_pkt)) {
+    // if packet known, count the copy and abort, otherwise remember it
+    src = (rx_pkt->src_addr[0]<<8) + (rx_pkt->src_addr[1]);
+    if (dupcache_check(src, rx_pkt->id)) {
+        for (buf=netq_next(0x0); buf; buf=netq_next(buf)) {
+            pkt = (packet_t*) buf->data;
+            if ( (buf->prio == NETQ_FORWARD) &&
+                 (pkt->src_addr[0] == rx_pkt->src_addr[0]) &&
+                 (pkt->src_addr[1] == rx_pkt->src_addr[1]) &&
+                 (pkt->id == rx_pkt->id) && (buf->count < 0xFF) ) {
+                buf->count++;
+            }
+        }
         return 0;
     }
 
-
-    // put packet to known packets
-    known_packets[known_packet_id].src_addr[0] = rx_pkt->src_addr[0];
-    known_packets[known_packet_id].src_addr[1] = rx_pkt->src_addr[1];
-    known_packets[known_packet_id].id = rx_pkt->id;
-    known_packet_id += 1;
-    known_packet_id %= MAX_KNOWN_PACKETS;
-
     // check the destination, if for me call the callback
     dst = (rx_pkt->dst_addr[0]<<8) + (rx_pkt->dst_addr[1]);
 
     if ( (dst == node_addr || dst == MAC_BROADCAST) && rx_cb) {
-        uint16_t src;
-        src = (rx_pkt->src_addr[0]<<8) + (rx_pkt->src_addr[1]);
         ret_val = rx_cb(rx_pkt->data, rx_pkt->data_len, src);
 
         int i;
@@ -174,12 +174,6 @@ static uint16_t frame_received(uint8_t packet[], uint16_t length, uint16_t src_a
     if ( dst == MAC_BROADCAST || dst != node_addr ) {
         uint8_t *route;
 
-        // check if state is correct
-        if (state == STATE_TX) {
-            // already a packet being sent, abort
-            return ret_val;
-        }
-
         // check if there is room for one more hop
         if (rx_pkt->route_len >= MAX_ROUTE_LEN) {
             // too big, drop
@@ -187,50 +181,68 @@ static uint16_t frame_received(uint8_t packet[], uint16_t length, uint16_t src_a
             return ret_val;
         }
 
-        // insert my address
+        // get a queue entry for the received buffer
+        buf = netq_wrap(NETQ_FORWARD, rx_buf);
+        if (buf == 0x0) {
+            // queue full, drop
+            printf("Queue full!\n");
+            return ret_val;
+        }
+
+        // insert my address, in place
         route = rx_pkt->data + rx_pkt->data_len;
         route[rx_pkt->route_len*2] = node_addr>>8;
         route[rx_pkt->route_len*2+1] = node_addr & 0xFF;
         rx_pkt->route_len+=1;
         length +=2;
 
-        // copy packet to send in a local buffer
-        memcpy(&tx_pkt, rx_pkt, length);
-        tx_length = length;
-
-        // start delay to send
-        delay_packet();
+        // queue it after a delay
+        netq_push(buf, length, MAC_BROADCAST, forward_delay());
     }
 
     return ret_val;
 }
 
-static void delay_packet(void) {
+static uint16_t packet_delay(void) {
     uint16_t delay;
     delay = rand(); // 16383 ticks max (0.5s)
     delay &= 0x3FFF;
     delay += 1;
-
-    timerB_set_alarm_from_now(ALARM_TXDELAY, delay, 0);
-    timerB_register_cb(ALARM_TXDELAY, send);
+    return delay;
 }
 
-static uint16_t send(void) {
-    if ( mac_send((uint8_t*)&tx_pkt, tx_length, MAC_BROADCAST) ) {
-        delay_packet();
-    } else {
-        state = STATE_RX;
+static uint16_t forward_delay(void) {
+#if FLOOD_SUPPRESSION
+    uint16_t interval, delay;
+
+    // listen longer in dense areas, to overhear more copies
+    interval = INTERVAL_MIN;
+    if ( (density>>4) >= 2*FLOOD_K ) {
+        interval <<= INTERVAL_SHIFT_MAX;
+    } else if ( (density>>4) >= FLOOD_K ) {
+        interval <<= 1;
     }
 
-    return 0;
+    delay = rand();
+    delay %= interval/2;
+    delay += interval/2;
+    return delay;
+#else
+    return packet_delay();
+#endif
 }
 
-static inline int is_packet_known(packet_t *pkt) {
-    int i;
-    for (i=0; i<MAX_KNOWN_PACKETS; i++)
-        if ( (pkt->src_addr[0] == known_packets[i].src_addr[0]) &&
-             (pkt->src_addr[1] == known_packets[i].src_addr[1]) &&
-             (pkt->id == known_packets[i].id))
-            return 1;
-    return 0;
+static uint16_t forward_ready(netq_buf_t *buf) {
+#if FLOOD_SUPPRESSION
+    if (buf->prio == NETQ_FORWARD) {
+        // the copies heard during the interval tell how many neighbours forward
+        density += ( ((int16_t)buf->count<<4) - density ) >> 2;
+
+        if (buf->count >= FLOOD_K) {
+            // enough neighbours forwarded it already
+            return 0;
+        }
+    }
+#endif
+    return 1;
 }
@@ -0,0 +1,126 @@
+#include <io.h>
+
+#include "linkq.h"
+
+/* ----DEFINES---- */
+#define PRR_ONE 4096 // delivery ratio fixed point
+#define RSSI_SHIFT 3 // EWMA weight of a new RSSI sample, 1/8
+#define PRR_SHIFT 3  // EWMA weight of a new ACK sample, 1/8
+
+#if LINKQ_RSSI_GOOD <= LINKQ_RSSI_BAD
+#error "LINKQ_RSSI_GOOD must be above LINKQ_RSSI_BAD"
+#endif
+
+/* ----STRUCTURES---- */
+typedef struct {
+    uint16_t addr; // 0 if the entry is free
+    uint16_t heard; // linkq_clock when last heard
+    int16_t rssi; // average
+    uint16_t prr; // average delivery ratio, PRR_ONE is 1
+    uint8_t acked; // 1 once the delivery ratio comes from ACKs
+} entry_t;
+
+/* ----PROTOTYPES---- */
+static entry_t* find(uint16_t addr);
+static uint16_t prr_guess(int16_t rssi);
+
+/* ----DATA---- */
+static entry_t entries[LINKQ_SIZE];
+static uint16_t linkq_clock;
+
+void linkq_init(void) {
+    int i;
+
+    for (i=0; i<LINKQ_SIZE; i++) {
+        entries[i].addr = 0;
+    }
+    linkq_clock = 0;
+}
+
+void linkq_heard(uint16_t addr, int16_t rssi) {
+    entry_t *e;
+    int i;
+
+    e = find(addr);
+    if (e == 0x0) {
+        // a free entry, or the least recently heard
+        e = &entries[0];
+        for (i=0; i<LINKQ_SIZE && e->addr; i++) {
+            if ( (entries[i].addr == 0) ||
+                 (uint16_t)(linkq_clock - entries[i].heard) > (uint16_t)(linkq_clock - e->heard) ) {
+                e = &entries[i];
+            }
+        }
+
+        e->addr = addr;
+        e->rssi = rssi;
+        e->acked = 0;
+    } else {
+        e->rssi += (rssi - e->rssi) / (1<<RSSI_SHIFT);
+    }
+
+    e->heard = ++linkq_clock;
+    if (!e->acked) {
+        e->prr = prr_guess(e->rssi);
+    }
+}
+
+void linkq_sent(uint16_t addr, uint16_t acked) {
+    entry_t *e;
+    int16_t sample;
+
+    e = find(addr);
+    if (e == 0x0) {
+        return;
+    }
+
+    // start from the guess, a single sample would say too much
+    sample = acked ? PRR_ONE : 0;
+    e->prr += (sample - (int16_t)e->prr) / (1<<PRR_SHIFT);
+    e->acked = 1;
+}
+
+int16_t linkq_rssi(uint16_t addr) {
+    entry_t *e = find(addr);
+
+    return e ? e->rssi : LINKQ_RSSI_BAD;
+}
+
+uint16_t linkq_etx(uint16_t addr) {
+    entry_t *e = find(addr);
+    uint32_t etx;
+
+    if ( (e == 0x0) || (e->prr == 0) ) {
+        return LINKQ_ETX_MAX;
+    }
+
+    etx = ((uint32_t)LINKQ_ETX_ONE * PRR_ONE) / e->prr;
+    return etx > LINKQ_ETX_MAX ? LINKQ_ETX_MAX : etx;
+}
+
+static entry_t* find(uint16_t addr) {
+    int i;
+
+    for (i=0; i<LINKQ_SIZE; i++) {
+        if (entries[i].addr == addr) {
+            return &entries[i];
+        }
+    }
+    return 0x0;
+}
+
+/**
+ * Guess a delivery ratio from the RSSI, linear between the BAD and GOOD
+ * thresholds.
+ */
+static uint16_t prr_guess(int16_t rssi) {
+    if (rssi >= LINKQ_RSSI_GOOD) {
+        return PRR_ONE;
+    }
+    if (rssi <= LINKQ_RSSI_BAD) {
+        return (uint32_t)PRR_ONE * LINKQ_ETX_ONE / LINKQ_ETX_MAX;
+    }
+    return (uint32_t)PRR_ONE * LINKQ_ETX_ONE / LINKQ_ETX_MAX +
+           (uint32_t)(PRR_ONE - PRR_ONE * LINKQ_ETX_ONE / LINKQ_ETX_MAX) *
+           (rssi - LINKQ_RSSI_BAD) / (LINKQ_RSSI_GOOD - LINKQ_RSSI_BAD);
+}
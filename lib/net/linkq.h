@@ -0,0 +1,75 @@
+#ifndef LINKQ_H
+#define LINKQ_H
+
+/**
+ * Neighbour table with link quality estimates.
+ *
+ * Each neighbour has an average RSSI of the frames heard from it, and
+ * a delivery ratio of the unicast frames sent to it, from the MAC
+ * acknowledgements. Until a frame has been sent to a neighbour, its
+ * delivery ratio is guessed from the RSSI. The expected transmission
+ * count (ETX) is the inverse of the delivery ratio.
+ *
+ * The table doesn't use any timer nor MAC function, the network layer
+ * or application feeds it from its callbacks.
+ */
+
+/**
+ * Number of neighbours in the table, the least recently heard
+ * is replaced when it is full.
+ */
+#ifndef LINKQ_SIZE
+#define LINKQ_SIZE 16
+#endif
+
+/**
+ * RSSI range in the unit of the MAC receive callback (2*dBm+8 for the
+ * lib/mac CC1101 layers), for the delivery ratio guess.
+ * A link heard above GOOD is guessed perfect, one heard at BAD or below
+ * gets LINKQ_ETX_MAX.
+ */
+#ifndef LINKQ_RSSI_GOOD
+#define LINKQ_RSSI_GOOD (-152) // -80dBm
+#endif
+#ifndef LINKQ_RSSI_BAD
+#define LINKQ_RSSI_BAD  (-182) // -95dBm
+#endif
+
+/**
+ * ETX values are fixed point, LINKQ_ETX_ONE means one transmission.
+ */
+#define LINKQ_ETX_ONE 16
+#define LINKQ_ETX_MAX (8*LINKQ_ETX_ONE)
+
+/**
+ * Empty the table.
+ */
+void linkq_init(void);
+
+/**
+ * Account a frame received from a neighbour.
+ * \param addr the MAC source
+ * \param rssi the RSSI given by the MAC
+ */
+void linkq_heard(uint16_t addr, int16_t rssi);
+
+/**
+ * Account the outcome of a unicast frame sent to a neighbour.
+ * \param addr the MAC destination
+ * \param acked 1 if the MAC reported it sent, 0 if it gave up
+ */
+void linkq_sent(uint16_t addr, uint16_t acked);
+
+/**
+ * Get the average RSSI of a neighbour.
+ * \return the RSSI, or LINKQ_RSSI_BAD if unknown
+ */
+int16_t linkq_rssi(uint16_t addr);
+
+/**
+ * Get the ETX of the link to a neighbour.
+ * \return the ETX, LINKQ_ETX_MAX if unknown
+ */
+uint16_t linkq_etx(uint16_t addr);
+
+#endif
@@ -0,0 +1,242 @@
+#include <io.h>
+#include <stdio.h>
+
+#include "netq.h"
+#include "mac.h"
+#include "timerB.h"
+
+/* ----DEFINES---- */
+#define ALARM_QUEUE TIMERB_ALARM_CCR2
+#define RETRY_DELAY 33 // 1ms
+
+#define IS_DUE(buf, now) ((int16_t)((now) - (buf)->time) >= 0)
+
+/* ----PROTOTYPES---- */
+static uint16_t drain(void);
+static uint16_t mac_sent(void);
+static uint16_t mac_failed(void);
+
+/* ----DATA---- */
+static netq_buf_t pool[NETQ_SIZE];
+static netq_buf_t *free_list;
+static uint16_t free_count;
+static netq_buf_t *head[NETQ_PRIO_NUMBER], *tail[NETQ_PRIO_NUMBER];
+static netq_ready_t ready_cb;
+static netq_sent_t sent_cb;
+static netq_failed_t failed_cb;
+static netq_buf_t *mac_buf; // given to the MAC, until sent or failed
+
+void netq_init(void) {
+    int i;
+
+    free_list = 0x0;
+    for (i=0; i<NETQ_SIZE; i++) {
+        pool[i].next = free_list;
+        free_list = &pool[i];
+    }
+    free_count = NETQ_SIZE;
+    pbuf_init();
+
+    for (i=0; i<NETQ_PRIO_NUMBER; i++) {
+        head[i] = 0x0;
+        tail[i] = 0x0;
+    }
+
+    ready_cb = 0x0;
+    sent_cb = 0x0;
+    failed_cb = 0x0;
+    mac_buf = 0x0;
+
+    mac_set_sent_cb(mac_sent);
+    mac_set_error_cb(mac_failed);
+}
+
+void netq_set_ready_cb(netq_ready_t cb) {
+    ready_cb = cb;
+}
+
+void netq_set_sent_cb(netq_sent_t cb) {
+    sent_cb = cb;
+}
+
+void netq_set_failed_cb(netq_failed_t cb) {
+    failed_cb = cb;
+}
+
+critical netq_buf_t* netq_wrap(uint16_t prio, pbuf_t *pkt) {
+    netq_buf_t *buf;
+
+    if (free_count == 0 ||
+        (prio == NETQ_LOCAL && free_count <= NETQ_RESERVED)) {
+        return 0x0;
+    }
+
+    buf = free_list;
+    free_list = buf->next;
+    free_count--;
+
+    pbuf_ref(pkt);
+    buf->next = 0x0;
+    buf->pkt = pkt;
+    buf->data = pkt->head;
+    buf->prio = prio;
+    buf->count = 0;
+    return buf;
+}
+
+critical netq_buf_t* netq_alloc(uint16_t prio) {
+    netq_buf_t *buf;
+    pbuf_t *pkt;
+
+    pkt = pbuf_alloc(PBUF_HEADROOM);
+    if (pkt == 0x0) {
+        return 0x0;
+    }
+
+    buf = netq_wrap(prio, pkt);
+    // the entry has its own reference now
+    pbuf_free(pkt);
+    return buf;
+}
+
+critical void netq_free(netq_buf_t *buf) {
+    pbuf_free(buf->pkt);
+    buf->next = free_list;
+    free_list = buf;
+    free_count++;
+}
+
+critical void netq_push(netq_buf_t *buf, uint16_t length, uint16_t dst_addr, uint16_t delay) {
+    buf->pkt->length = length;
+    buf->dst_addr = dst_addr;
+    buf->time = timerB_time() + delay;
+    buf->next = 0x0;
+
+    // FIFO within the class
+    if (tail[buf->prio]) {
+        tail[buf->prio]->next = buf;
+    } else {
+        head[buf->prio] = buf;
+    }
+    tail[buf->prio] = buf;
+
+    if (!mac_buf) {
+        drain();
+    }
+}
+
+netq_buf_t* netq_next(netq_buf_t *buf) {
+    uint16_t prio;
+
+    if (buf && buf->next) {
+        return buf->next;
+    }
+
+    prio = buf ? buf->prio+1 : 0;
+    for (; prio<NETQ_PRIO_NUMBER; prio++) {
+        if (head[prio]) {
+            return head[prio];
+        }
+    }
+    return 0x0;
+}
+
+/* ----PRIVATE FUNCTIONS---- */
+
+/**
+ * Give the first due packet of the highest class to the MAC,
+ * or set an alarm for when the next one will be due.
+ */
+static uint16_t drain(void) {
+    netq_buf_t *buf, *prev, *wait;
+    uint16_t prio, now;
+
+    timerB_unset_alarm(ALARM_QUEUE);
+
+    while (!mac_buf) {
+        now = timerB_time();
+        wait = 0x0;
+
+        // find the first due packet
+        for (prio=0; prio<NETQ_PRIO_NUMBER; prio++) {
+            prev = 0x0;
+            for (buf=head[prio]; buf; prev=buf, buf=buf->next) {
+                if (IS_DUE(buf, now)) {
+                    break;
+                }
+                if (!wait || (int16_t)(buf->time - wait->time) < 0) {
+                    wait = buf;
+                }
+            }
+            if (buf) {
+                break;
+            }
+        }
+
+        if (!buf) {
+            if (wait) {
+                timerB_set_alarm_from_now(ALARM_QUEUE, wait->time - now, 0);
+                timerB_register_cb(ALARM_QUEUE, drain);
+            }
+            return 0;
+        }
+
+        // unlink it
+        if (prev) {
+            prev->next = buf->next;
+        } else {
+            head[prio] = buf->next;
+        }
+        if (tail[prio] == buf) {
+            tail[prio] = prev;
+        }
+
+        if (ready_cb && !ready_cb(buf)) {
+            // the network layer changed its mind
+            netq_free(buf);
+            continue;
+        }
+
+        switch (mac_send_buf(buf->pkt, buf->dst_addr)) {
+            case 0:
+                mac_buf = buf;
+                break;
+            case 1:
+                // the MAC is busy with someone else's packet, put it back
+                buf->next = head[prio];
+                head[prio] = buf;
+                if (!tail[prio]) {
+                    tail[prio] = buf;
+                }
+                timerB_set_alarm_from_now(ALARM_QUEUE, RETRY_DELAY, 0);
+                timerB_register_cb(ALARM_QUEUE, drain);
+                return 0;
+            default:
+                printf("netq, packet too long\n");
+                netq_free(buf);
+                break;
+        }
+    }
+    return 0;
+}
+
+static uint16_t mac_sent(void) {
+    if (mac_buf) {
+        if (sent_cb) {
+            sent_cb(mac_buf);
+        }
+        netq_free(mac_buf);
+        mac_buf = 0x0;
+    }
+    return drain();
+}
+
+static uint16_t mac_failed(void) {
+    netq_buf_t *buf = mac_buf;
+
+    mac_buf = 0x0;
+    if (buf && !(failed_cb && failed_cb(buf))) {
+        netq_free(buf);
+    }
+    return drain();
+}
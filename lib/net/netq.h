@@ -0,0 +1,132 @@
+#ifndef NETQ_H
+#define NETQ_H
+
+#include "pbuf.h"
+
+/**
+ * Priority classes, lower values are sent first.
+ * Forwarded packets go before the local ones, they have already
+ * cost the network some transmissions.
+ */
+#define NETQ_CONTROL 0
+#define NETQ_FORWARD 1
+#define NETQ_LOCAL   2
+#define NETQ_PRIO_NUMBER 3
+
+/**
+ * Number of queue entries. The packets are in pbuf_t buffers, a received
+ * packet is queued again in its own buffer to be forwarded.
+ */
+#ifndef NETQ_SIZE
+#define NETQ_SIZE 6
+#endif
+
+/**
+ * Entries that local packets can't take, kept for the other classes.
+ */
+#ifndef NETQ_RESERVED
+#define NETQ_RESERVED 1
+#endif
+
+/**
+ * Maximum network packet length, the MAC payload.
+ */
+#define NETQ_DATA_MAX PBUF_DATA_MAX
+
+/**
+ * Queue entry, the network layer builds its packet at data.
+ */
+typedef struct netq_buf {
+    struct netq_buf *next;
+    pbuf_t *pkt; // the packet, the entry holds a reference
+    uint8_t *data; // the packet head, where the network header starts
+    uint16_t dst_addr; // MAC destination
+    uint16_t time; // timerB time from which it may be sent
+    uint8_t prio;
+    uint8_t count; // free for the network layer
+} netq_buf_t;
+
+/**
+ * Function pointer prototype for the callback called right before a
+ * packet is given to the MAC.
+ * \param buf the packet buffer
+ * \return 1 to send it, 0 to drop it
+ */
+typedef uint16_t (*netq_ready_t)(netq_buf_t *buf);
+
+/**
+ * Function pointer prototype for the callback called when the MAC
+ * has sent a packet, before its buffer is released.
+ * \param buf the packet buffer
+ */
+typedef void (*netq_sent_t)(netq_buf_t *buf);
+
+/**
+ * Function pointer prototype for the callback called when the MAC
+ * failed to send a packet.
+ * \param buf the packet buffer, dst_addr is the unreachable neighbour
+ * \return 1 if the buffer has been pushed again, 0 to release it
+ */
+typedef uint16_t (*netq_failed_t)(netq_buf_t *buf);
+
+/**
+ * Initialize the queue and the packet buffer pool, and register the MAC
+ * sent/error callbacks. To be called after mac_init().
+ * The packets are given to the MAC with mac_send_buf().
+ */
+void netq_init(void);
+
+/**
+ * Register the callback called before each packet is sent.
+ */
+void netq_set_ready_cb(netq_ready_t cb);
+
+/**
+ * Register the callback called when the MAC has sent a packet.
+ */
+void netq_set_sent_cb(netq_sent_t cb);
+
+/**
+ * Register the callback called when the MAC failed to send a packet.
+ */
+void netq_set_failed_cb(netq_failed_t cb);
+
+/**
+ * Get a free entry, with an empty packet buffer.
+ * \param prio the priority class of the packet
+ * \return the entry, 0 if none is available for this class
+ */
+netq_buf_t* netq_alloc(uint16_t prio);
+
+/**
+ * Get a free entry for a packet buffer already filled, typically a
+ * received packet to forward. The entry takes a reference on it.
+ * \param prio the priority class of the packet
+ * \param pkt the packet buffer, its head is the network header
+ * \return the entry, 0 if none is available for this class
+ */
+netq_buf_t* netq_wrap(uint16_t prio, pbuf_t *pkt);
+
+/**
+ * Release an entry which has not been queued, and its buffer reference.
+ */
+void netq_free(netq_buf_t *buf);
+
+/**
+ * Queue a packet for the MAC layer. The buffer is released once the MAC
+ * has sent the packet or given up.
+ * \param buf the buffer, with data filled
+ * \param length the number of bytes of data to send
+ * \param dst_addr the MAC destination
+ * \param delay timerB ticks to wait before sending (32767 max)
+ */
+void netq_push(netq_buf_t *buf, uint16_t length, uint16_t dst_addr, uint16_t delay);
+
+/**
+ * Iterate on the queued packets, in no particular order.
+ * \param buf the previous packet, 0 to get the first one
+ * \return the next queued packet, 0 at the end
+ */
+netq_buf_t* netq_next(netq_buf_t *buf);
+
+#endif
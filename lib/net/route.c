@@ -4,26 +4,52 @@
 #include <stdio.h>
 
 #include "route.h"
+#include "dupcache.h"
+#include "netq.h"
+#include "sroute.h"
+#include "linkq.h"
 #include "mac.h"
 #include "timerB.h"
 
 /* ----DEFINES---- */
-#define MAX_DATA_LEN  25
+#define PAYLOAD_MAX   49 // 58 MAC bytes minus the header, for data and route
 #define MAX_ROUTE_LEN 10
-#define HEADER_LENGTH (sizeof(data_t)-(MAX_DATA_LEN+2*MAX_ROUTE_LEN))
+#define HEADER_LENGTH (sizeof(data_t)-PAYLOAD_MAX)
+
+// flooded data must leave room for the forwarders addresses
+#define MAX_FLOOD_LEN (PAYLOAD_MAX-2*MAX_ROUTE_LEN)
 
 #define TYPE_SOURCE_DATA 0x11
 #define TYPE_FLOOD_DATA  0x22
+#define TYPE_ROUTE_ERROR 0x33
+#define TYPE_ROUTE_REPLY 0x44
 
-#define ALARM_DELAY TIMERB_ALARM_CCR2
 #define ALARM_1MS 33
 
-#define ROUTE_NUMBER 3
-#define KNOWN_PACKET_NUMBER 4
+// mask of the random delay added to flood forwards (16ms)
+#define FLOOD_JITTER 0x1FF
+
+// flood forwards also wait 1ms per 1/16 of ETX above 1 on the link they
+// came by, the first copy to reach a node came by the lowest total ETX
+#define ETX_DELAY ALARM_1MS
+
+// number of destinations in the route cache
+#ifndef ROUTE_NUMBER
+#define ROUTE_NUMBER 6
+#endif
+
+// a cached route is replaced by a costlier one once it wasn't learned
+// again for this many route_clock ticks
+#define ROUTE_STALE 32
+
+// route_learn flags
+#define ROUTE_REVERSE 0x1
+#define ROUTE_EVICT   0x2
 
 #define ADDR_FROM_BYTES(a) (((a)[0]<<8)+((a)[1]))
 #define INSERT_ADDR_AT(addr, at) (at)[0]=(addr)>>8;(at)[1]=(addr)&0xFF
-#define ADDR_COPY(dst, src) (dst)[0]=(src)[0];(dst)[1]=(src)[1]
+
+#define PACKET_LENGTH(p) (HEADER_LENGTH + (p)->payload_len + sroute_size((p)->route_ctl))
 
 #define PRINT_PACKET(p) do { \
 printf("t=%x, dst=%.2x%.2x, src=%.2x%.2x, id=%u\n", \
@@ -31,8 +57,8 @@ printf("t=%x, dst=%.2x%.2x, src=%.2x%.2x, id=%u\n", \
 printf("pay[%u]", (p)->payload_len); \
 int i; \
 for (i=0;i<(p)->payload_len;i++)printf(":%x", (p)->payload[i]);\
-printf("\nroute[%u]=", (p)->route_len);\
-for (i=0;i<2*(p)->route_len;i++) printf(":%x", (p)->payload[(p)->payload_len+i]);\
+printf("\nroute[%x,%u]=", (p)->route_ctl, (p)->route_ptr);\
+for (i=0;i<sroute_size((p)->route_ctl);i++) printf(":%x", (p)->payload[(p)->payload_len+i]);\
 printf("\n");\
 } while (0)
 
@@ -44,102 +70,116 @@ typedef struct {
     uint8_t src_addr[2]; // network source
     uint8_t id; // source packet id
     uint8_t payload_len; // length of the data
-    uint8_t route_len; // length of the route
-    uint8_t payload[MAX_DATA_LEN + 2*MAX_ROUTE_LEN];
+    uint8_t route_ctl; // number of hops and encoding, see sroute.h
+    uint8_t route_ptr; // index of the next hop to handle a source routed packet
+    uint8_t payload[PAYLOAD_MAX]; // data, then encoded route
 } data_t;
 
 typedef struct {
-    uint8_t number;
-    uint8_t hops[2*(MAX_ROUTE_LEN+2)];
+    uint16_t dst; // destination, 0 if the entry is free
+    uint16_t used; // route_clock when last used
+    uint16_t learned; // route_clock when last learned
+    uint8_t number; // number of hops between me and dst
+    uint16_t hops[MAX_ROUTE_LEN];
 } route_t;
 
-typedef struct {
-    uint8_t src_addr[2],
-            id;
-} packet_id_t;
-
 /* ----PROTOTYPES---- */
-static uint16_t data_received(uint8_t packet[], uint16_t length, uint16_t src_addr, int16_t rssi);
-static uint16_t send_data(void);
+static uint16_t data_received(pbuf_t *pkt, uint16_t src_addr, int16_t rssi);
+static void forward_data(uint16_t prio, uint16_t delay);
 static uint16_t rx_flood_handle(void);
 static uint16_t rx_source_handle(void);
+static void send_done(netq_buf_t *buf);
+static uint16_t send_failed(netq_buf_t *buf);
+static void send_control(uint8_t type, uint16_t dst, uint16_t addr);
+static uint16_t set_packet_route(data_t *d, uint16_t *route, uint16_t route_len);
 
-static inline int16_t set_route_to_host(uint16_t addr);
-static inline int16_t find_pos_in_route(uint16_t addr, uint8_t *route, uint16_t route_len);
-static inline int16_t is_packet_known(data_t* pkt);
-static inline void store_route(void);
+static inline uint16_t set_route_to_host(data_t *d, uint16_t addr);
+static inline int16_t find_pos_in_route(uint16_t addr, uint16_t *route, uint16_t route_len);
+static route_t* route_find(uint16_t dst);
+static uint16_t route_cost(uint16_t first, uint16_t number);
+static void route_learn(uint16_t dst, uint16_t *hops, uint16_t number, uint16_t flags);
+static void route_invalidate_link(uint16_t from, uint16_t to);
 
 
 /* ----DATA---- */
 static net_handler_t rx_cb;
-static data_t data;
-static uint16_t data_length, data_addr;
-static uint8_t *data_route;
+static data_t *data; // packet being handled
+static pbuf_t *data_pkt; // its buffer, when received
+static uint16_t data_addr;
+static uint16_t data_from; // MAC source
+static uint16_t data_route[MAX_ROUTE_LEN+1]; // its decoded route
+static uint16_t data_route_len;
 static uint16_t packet_id;
-static packet_id_t known_packets[KNOWN_PACKET_NUMBER];
-static uint16_t known_packet_id = 0;
 static route_t known_routes[ROUTE_NUMBER];
-static uint16_t known_route_id = 0;
+static uint16_t route_clock;
 
 void net_init() {
     int16_t i;
 
     // initialize MAC layer, and timerB
     mac_init(6);
+    dupcache_init();
+    netq_init();
+    linkq_init();
 
     // init variables
     rx_cb = 0x0;
     packet_id = 0;
 
     // init
-    data_length = 0;
-    mac_set_rx_cb(data_received);
-    for (i=0; i<KNOWN_PACKET_NUMBER; i++) {
-        known_packets[i].src_addr[0] = 0;
-        known_packets[i].src_addr[1] = 0;
-        known_packets[i].id = 0;
-    }
-    known_packet_id = 0;
+    data_pkt = 0x0;
+    mac_set_rx_buf_cb(data_received);
+    netq_set_sent_cb(send_done);
+    netq_set_failed_cb(send_failed);
     for (i=0; i<ROUTE_NUMBER; i++) {
-        known_routes[i].number = 0;
+        known_routes[i].dst = 0;
     }
 
-    known_route_id = 0;
+    route_clock = 0;
 }
 
 uint16_t net_send(uint8_t packet[], uint16_t length, uint16_t dst_addr) {
+    netq_buf_t *buf;
+    data_t *pkt;
+    uint16_t next_hop;
 
-    if (length > MAX_DATA_LEN) {
+    if (length > PAYLOAD_MAX) {
         printf("net_send length error\n");
         return 0;
     }
 
-    if (data_length != 0) {
-        printf("net_send, buffer busy error\n");
+    buf = netq_alloc(NETQ_LOCAL);
+    if (buf == 0x0) {
+        printf("net_send, queue full error\n");
         return 0;
     }
+    // the packet being received may be in data, build this one aside
+    pkt = (data_t*) buf->data;
 
     /// prepare packet
-    data_length = HEADER_LENGTH + length;
-    INSERT_ADDR_AT(dst_addr, data.dst_addr);
-    INSERT_ADDR_AT(node_addr, data.src_addr);
-    data.id = packet_id++;
-    data.payload_len = length;
-    memcpy(data.payload, packet, length);
-    data_route = data.payload + data.payload_len;
-
-    if (set_route_to_host(dst_addr)) {
-        data.type = TYPE_SOURCE_DATA;
+    INSERT_ADDR_AT(dst_addr, pkt->dst_addr);
+    INSERT_ADDR_AT(node_addr, pkt->src_addr);
+    pkt->id = packet_id++;
+    pkt->payload_len = length;
+    memcpy(pkt->payload, packet, length);
+    pkt->route_ptr = 0;
+
+    next_hop = set_route_to_host(pkt, dst_addr);
+    if (next_hop) {
+        pkt->type = TYPE_SOURCE_DATA;
+    } else if (length > MAX_FLOOD_LEN) {
+        // no room for the flood route
+        printf("net_send length error\n");
+        netq_free(buf);
+        return 0;
     } else {
-        data.type = TYPE_FLOOD_DATA;
-        data_addr = MAC_BROADCAST;
+        pkt->type = TYPE_FLOOD_DATA;
+        pkt->route_ctl = 0;
+        next_hop = MAC_BROADCAST;
     }
 
-    data_length = HEADER_LENGTH + length + 2*data.route_len;
-
     // send
-    timerB_set_alarm_from_now(ALARM_DELAY, 2*ALARM_1MS, 0);
-    timerB_register_cb(ALARM_DELAY, send_data);
+    netq_push(buf, PACKET_LENGTH(pkt), next_hop, 2*ALARM_1MS);
 
     return 1;
 }
@@ -154,23 +194,29 @@ void net_stop() {
 
 /* ----STANDARD PACKET HANDLING---- */
 
-static uint16_t send_data(void) {
-    if (data_addr && data_length) {
-        if (mac_send((uint8_t*)&data, data_length, data_addr)) {}
-    } else {
-        printf("send_data, no data\n");
+/**
+ * Queue the received packet, in its own buffer, to be sent to data_addr.
+ * \param prio the netq class
+ * \param delay the ticks to wait before sending
+ */
+static void forward_data(uint16_t prio, uint16_t delay) {
+    netq_buf_t *buf;
+
+    buf = netq_wrap(prio, data_pkt);
+    if (buf == 0x0) {
+        printf("forward_data, queue full\n");
+        return;
     }
     //~ printf("SENT:\n");
-    //~ PRINT_PACKET(&data);
+    //~ PRINT_PACKET(data);
 
-    // clear the buffer
-    data_length = 0;
-    return 0;
+    netq_push(buf, PACKET_LENGTH(data), data_addr, delay);
 }
 
 
-static uint16_t data_received(uint8_t packet[], uint16_t length, uint16_t src_addr, int16_t rssi) {
+static uint16_t data_received(pbuf_t *pkt, uint16_t src_addr, int16_t rssi) {
     data_t *rx_data;
+    uint16_t length = pkt->length;
 
     // check min length
     if (length < HEADER_LENGTH) {
@@ -178,41 +224,47 @@ static uint16_t data_received(uint8_t packet[], uint16_t length, uint16_t src_ad
         return 0;
     }
 
+    // any frame tells about the link
+    linkq_heard(src_addr, rssi);
+
     // cast the received packet
-    rx_data = (data_t*) packet;
+    rx_data = (data_t*) pkt->head;
 
     //~ printf("RECEIVED, [%u]:\n", length);
     //~ PRINT_PACKET(rx_data);
 
     // ckeck the length
-    if ( (HEADER_LENGTH + (rx_data->payload_len) + (rx_data->route_len*2)) != length ) {
+    if ( (PACKET_LENGTH(rx_data) != length) || (SROUTE_COUNT(rx_data->route_ctl) > MAX_ROUTE_LEN) ||
+         (rx_data->route_ptr > SROUTE_COUNT(rx_data->route_ctl)) ) {
         printf("data_frame_received length doesn't match\n");
         return 0;
     }
 
-    if ( (rx_data->type != TYPE_FLOOD_DATA) && (rx_data->type != TYPE_SOURCE_DATA) ) {
+    if ( (rx_data->type != TYPE_FLOOD_DATA) && (rx_data->type != TYPE_SOURCE_DATA) &&
+         (rx_data->type != TYPE_ROUTE_ERROR) && (rx_data->type != TYPE_ROUTE_REPLY) ) {
         // unknown type, abort
         printf("data_frame_received type error (%x)\n", rx_data->type);
         return 0;
     }
 
     // if packet is mine or known, abort
-    if ( (ADDR_FROM_BYTES(rx_data->src_addr) == node_addr) || is_packet_known(rx_data)) {
+    if ( (ADDR_FROM_BYTES(rx_data->src_addr) == node_addr) || dupcache_check(ADDR_FROM_BYTES(rx_data->src_addr), rx_data->id)) {
         return 0;
     }
 
-    // packet is valid, copy packet
-    memcpy(&data, rx_data, length);
-    data_length = length;
-    data_route = data.payload + data.payload_len;
+    // packet is valid, handle it in place, the buffer has room to grow
+    data = rx_data;
+    data_pkt = pkt;
+    data_from = src_addr;
+    data_route_len = sroute_decode(data->route_ctl, data->payload + data->payload_len, data_route);
     data_addr = 0x0;
 
 
     // check the type
-    if (data.type==TYPE_SOURCE_DATA) {
-        return rx_source_handle();
-    } else {
+    if (data->type==TYPE_FLOOD_DATA) {
         return rx_flood_handle();
+    } else {
+        return rx_source_handle();
     }
 
     return 0;
@@ -224,47 +276,42 @@ static uint16_t rx_flood_handle(void) {
     uint16_t ret_val=0;
     printf("flood ");
     // check the destination
-    dst = ADDR_FROM_BYTES(data.dst_addr);
+    dst = ADDR_FROM_BYTES(data->dst_addr);
 
-    if ( dst == node_addr || dst == NET_BROADCAST) {
-
-        // store the route
-        store_route();
+    // the forwarders so far, backwards, lead to the source.
+    // Overheard floods don't evict the routes in use.
+    route_learn(ADDR_FROM_BYTES(data->src_addr), data_route, data_route_len,
+                (dst == node_addr) ? (ROUTE_REVERSE | ROUTE_EVICT) : ROUTE_REVERSE);
 
+    if ( dst == node_addr || dst == NET_BROADCAST) {
         // call the callback
-        ret_val = rx_cb ? rx_cb(data.payload, data.payload_len, ADDR_FROM_BYTES(data.src_addr)) \
+        ret_val = rx_cb ? rx_cb(data->payload, data->payload_len, ADDR_FROM_BYTES(data->src_addr)) \
                         : 0;
+    }
 
-        //~ int i;
-        //~ printf("route = %.4x-", ADDR_FROM_BYTES(data.src_addr));
-        //~ for (i=0; i<data.route_len; i++) {
-            //~ printf("%.4x-", ADDR_FROM_BYTES(data_route+2*i));
-        //~ }
-        //~ printf("%.4x\n", node_addr);
+    // give the source the route to me
+    if (dst == node_addr) {
+        send_control(TYPE_ROUTE_REPLY, ADDR_FROM_BYTES(data->src_addr), node_addr);
     }
 
     // check if it needs to be forwarded
     if ( dst == MAC_BROADCAST || dst != node_addr ) {
 
-        // check if there is room for one more hop
-        if (data.route_len >= MAX_ROUTE_LEN) {
+        // insert my address, if there is room for one more hop
+        data_route[data_route_len] = node_addr;
+        if ( (data_route_len >= MAX_ROUTE_LEN) ||
+             !set_packet_route(data, data_route, data_route_len+1) ) {
             // too big, drop
             printf("Too many hops!\n");
             return ret_val;
         }
-
-        // insert my address
-        INSERT_ADDR_AT( node_addr, data_route + data.route_len*2 );
-        data.route_len+=1;
-        data_length +=2;
         data_addr = MAC_BROADCAST;
 
-        // start delay to send
-        timerB_set_alarm_from_now(ALARM_DELAY, 2*ALARM_1MS, 0);
-        timerB_register_cb(ALARM_DELAY, send_data);
+        // queue it, later on a poor link,
+        // and neighbours forwarding together would collide
+        forward_data(NETQ_FORWARD, 2*ALARM_1MS + (rand() & FLOOD_JITTER) +
+                     (linkq_etx(data_from) - LINKQ_ETX_ONE) * ETX_DELAY);
         printf("fw\n");
-    } else {
-        data_length = 0;
     }
 
     return ret_val;
@@ -275,222 +322,326 @@ static uint16_t rx_flood_handle(void) {
 
 /*----SOURCE ROUTING----*/
 static uint16_t rx_source_handle(void) {
-    uint16_t dst;
+    uint16_t dst, src;
     uint16_t ret_val=0;
+    int16_t pos;
 
     printf("source ");
 
     // check the destination
-    dst = ADDR_FROM_BYTES(data.dst_addr);
-
-    // if for me, if for me call the callback
-    if ( (dst == node_addr) && rx_cb) {
-
-        // clear the data indicator
-        data_length = 0;
+    dst = ADDR_FROM_BYTES(data->dst_addr);
+    src = ADDR_FROM_BYTES(data->src_addr);
+
+    // the pointer gives the hop expected to handle the packet
+    pos = data->route_ptr;
+    if ( (pos == data_route_len) ? (dst != node_addr) : (data_route[pos] != node_addr) ) {
+        // next hop not found
+        printf("data_frame_received fw next hop not found\n");
+        return ret_val;
+    }
 
-        // store the route
-        store_route();
+    // learn the way back to the source, and on to the destination
+    route_learn(src, data_route, pos, ROUTE_REVERSE | ROUTE_EVICT);
+    if (pos < data_route_len) {
+        route_learn(dst, data_route+pos+1, data_route_len-pos-1, ROUTE_EVICT);
+    }
 
-        ret_val = rx_cb(data.payload, data.payload_len, ADDR_FROM_BYTES(data.src_addr));
-    } else {
-        // otherwise, forward
-        int16_t pos;
-        pos = find_pos_in_route(node_addr, data_route, data.route_len);
-
-        if (pos<0) {
-            // next hop not found
-            printf("data_frame_received fw next hop not found\n");
-            // clear the data indicator
-            data_length = 0;
-            data_addr = 0x0;
-            return ret_val;
+    if (data->type == TYPE_ROUTE_ERROR) {
+        // the source of the error can't reach the node in the payload
+        route_invalidate_link(src, ADDR_FROM_BYTES(data->payload));
+    }
 
-        } else if (pos==data.route_len-1){
-            data_addr = dst;
-        } else {
-            data_addr = ADDR_FROM_BYTES(data_route+2*pos);
+    // if for me, call the callback
+    if (dst == node_addr) {
+        if ( (data->type == TYPE_SOURCE_DATA) && rx_cb) {
+            ret_val = rx_cb(data->payload, data->payload_len, src);
         }
+        return ret_val;
+    }
 
-        // forward
-        timerB_set_alarm_from_now(ALARM_DELAY, 2*ALARM_1MS, 0);
-        timerB_register_cb(ALARM_DELAY, send_data);
-        printf("fw\n");
+    // otherwise, consume my hop and forward
+    data->route_ptr++;
+    if (data->route_ptr == data_route_len) {
+        data_addr = dst;
+    } else {
+        data_addr = data_route[data->route_ptr];
     }
+    forward_data(data->type == TYPE_SOURCE_DATA ? NETQ_FORWARD : NETQ_CONTROL, 2*ALARM_1MS);
+    printf("fw\n");
 
     return ret_val;
 }
 
-
-/*----OTHER----*/
+static void send_done(netq_buf_t *buf) {
+    if (buf->dst_addr != MAC_BROADCAST) {
+        linkq_sent(buf->dst_addr, 1);
+    }
+}
 
 /**
- * Function called when first sending a packet.
- * It should try to see if the destination node is in any known route.
- * Otherwise it declares flooding.
- * \param addr the destination address
+ * Called when the MAC could not deliver a packet to a neighbour.
+ * The routes through this link are dropped, then the packet is sent on
+ * another cached route if possible (local repair), or flooded from here.
+ * A broken last link leaves no hop past it to repair towards: the packet
+ * is flooded at once, as a route request the destination answers.
  */
-static inline int16_t set_route_to_host(uint16_t addr) {
-    int i,j;
-    int pos_dst, pos_src;
+static uint16_t send_failed(netq_buf_t *buf) {
+    data_t *d = (data_t*) buf->data;
+    uint16_t route[MAX_ROUTE_LEN];
+    uint16_t dst, src, to, hop, i;
+    int16_t pos, n, k;
+    route_t *r;
+
+    if (buf->dst_addr == MAC_BROADCAST) {
+        return 0;
+    }
 
-    printf("find_route\n");
+    linkq_sent(buf->dst_addr, 0);
+    route_invalidate_link(node_addr, buf->dst_addr);
 
-    data.route_len = 0;
-    if (addr==MAC_BROADCAST) {
-        printf("broadcast, flooding\n");
-        data_addr = MAC_BROADCAST;
+    if (d->type != TYPE_SOURCE_DATA) {
         return 0;
     }
 
-    for (i=0;i<ROUTE_NUMBER;i++) {
+    dst = ADDR_FROM_BYTES(d->dst_addr);
+    src = ADDR_FROM_BYTES(d->src_addr);
+    n = sroute_decode(d->route_ctl, d->payload + d->payload_len, route);
 
-        pos_dst = find_pos_in_route(addr, known_routes[i].hops, known_routes[i].number);
-        if (pos_dst != -1) {
-            // we've found a route !
-            pos_src = find_pos_in_route(node_addr, known_routes[i].hops, MAX_ROUTE_LEN);
-            if (pos_src == -1) {
-                // massive bug, a route without me!
-                printf("bug route without me!!\n");
-                continue;
-            }
-            printf("route found\n");
-
-            int r=0;
-            uint16_t hop;
-            uint8_t* r_addr;
-
-            if (pos_dst > pos_src) {
-                data.route_len = pos_dst-pos_src-1;
-
-                // recopy the route
-                r=0;
-                for (j=pos_src+1; j<pos_dst;j++) {
-                    hop = ADDR_FROM_BYTES(known_routes[i].hops+2*j);
-                    r_addr = data_route + 2*r;
-                    //~ printf("hop=%.4x, addr=%p\n", hop, r_addr);
-                    INSERT_ADDR_AT(hop, r_addr);
-                    //~ INSERT_ADDR_AT(known_routes[i].hops[j], data_route + 2*(j-pos_src));
-
-                    r+=1;
-                }
-            } else {
-                data.route_len = pos_src-pos_dst-1;
-
-                // recopy the route
-                for (j=pos_src-1; j>pos_dst;j--) {
-                    hop = ADDR_FROM_BYTES(known_routes[i].hops +2*j);
-                    r_addr = data_route + 2*r;
-                    //~ printf("hop=%x\n", hop);
-                    INSERT_ADDR_AT(hop, r_addr);
-                    //~ INSERT_ADDR_AT(known_routes[i].hops[j], data_route + 2*(pos_src-1-j));
-
-                    r+=1;
-                }
-            }
+    // the hops before the pointer (me included) are kept
+    pos = d->route_ptr - 1;
 
-            // say we found it
-            if (data.route_len>0) {
-                data_addr = ADDR_FROM_BYTES(data_route);
-            } else {
-                data_addr = ADDR_FROM_BYTES(data.dst_addr);
+    // local repair, with a cached route to the destination or to a hop
+    // past the broken link, unless the link was to the destination
+    for (k=n; (buf->dst_addr != dst) && (k>pos+1); k--) {
+        to = (k == n) ? dst : route[k];
+        r = route_find(to);
+        if ( (r == 0x0) || (pos+1+r->number+(n-k) > MAX_ROUTE_LEN) ) {
+            continue;
+        }
+
+        // the new hops must avoid the nodes already on the path
+        for (i=0; i<r->number; i++) {
+            hop = r->hops[i];
+            if ( (hop == src) || (hop == dst) || (hop == buf->dst_addr) ||
+                 (find_pos_in_route(hop, route, pos+1) >= 0) ||
+                 (find_pos_in_route(hop, route+k, n-k) >= 0) ) {
+                break;
             }
-            return 1;
         }
+        if (i < r->number) {
+            continue;
+        }
+
+        memmove(route+pos+1+r->number, route+k, (n-k)*sizeof(uint16_t));
+        memcpy(route+pos+1, r->hops, r->number*sizeof(uint16_t));
+        if (!set_packet_route(d, route, pos+1+r->number+(n-k))) {
+            // no room, put the route back
+            sroute_decode(d->route_ctl, d->payload + d->payload_len, route);
+            continue;
+        }
+
+        r->used = ++route_clock;
+        netq_push(buf, PACKET_LENGTH(d), r->number ? r->hops[0] : to, 2*ALARM_1MS);
+        return 1;
     }
 
-    printf("no route, flooding\n");
-    data_addr = MAC_BROADCAST;
-    return 0;
+    // tell the source its route is broken
+    if (src != node_addr) {
+        send_control(TYPE_ROUTE_ERROR, src, buf->dst_addr);
+    }
+
+    // flood from here, the route so far ends with me
+    d->type = TYPE_FLOOD_DATA;
+    d->route_ptr = 0;
+    set_packet_route(d, route, pos+1);
+    netq_push(buf, PACKET_LENGTH(d), MAC_BROADCAST, 2*ALARM_1MS);
+    return 1;
 }
 
-static inline int16_t is_packet_known(data_t* pkt) {
-    int i;
+/**
+ * Send a route error or reply on the cached route to a node.
+ * \param type TYPE_ROUTE_ERROR or TYPE_ROUTE_REPLY
+ * \param dst the destination
+ * \param addr the payload, the unreachable node or myself
+ */
+static void send_control(uint8_t type, uint16_t dst, uint16_t addr) {
+    netq_buf_t *buf;
+    data_t *c;
+    route_t *r;
 
-    // look for packet id
-    for (i=0; i<KNOWN_PACKET_NUMBER; i++)
-        if ( (ADDR_FROM_BYTES(pkt->src_addr) == ADDR_FROM_BYTES(known_packets[i].src_addr)) &&
-             (pkt->id == known_packets[i].id))
-            return 1;
+    r = route_find(dst);
+    if (r == 0x0) {
+        return;
+    }
 
+    buf = netq_alloc(NETQ_CONTROL);
+    if (buf == 0x0) {
+        return;
+    }
+    c = (data_t*) buf->data;
+
+    c->type = type;
+    INSERT_ADDR_AT(dst, c->dst_addr);
+    INSERT_ADDR_AT(node_addr, c->src_addr);
+    c->id = packet_id++;
+    c->payload_len = 2;
+    INSERT_ADDR_AT(addr, c->payload);
+    c->route_ptr = 0;
+    set_packet_route(c, r->hops, r->number);
+
+    netq_push(buf, PACKET_LENGTH(c), r->number ? r->hops[0] : dst, 2*ALARM_1MS);
+}
 
-    // if not known, put packet to known packets
-    INSERT_ADDR_AT(ADDR_FROM_BYTES(pkt->src_addr), known_packets[known_packet_id].src_addr);
-    known_packets[known_packet_id].id = pkt->id;
-    known_packet_id += 1;
-    known_packet_id %= KNOWN_PACKET_NUMBER;
+/**
+ * Encode a route in a packet, after its data.
+ * \return 1 if ok, 0 if it doesn't fit
+ */
+static uint16_t set_packet_route(data_t *d, uint16_t *route, uint16_t route_len) {
+    uint8_t encoded[2*MAX_ROUTE_LEN];
+    uint8_t ctl;
 
-    return 0;
+    ctl = sroute_encode(encoded, route, route_len);
+    if (d->payload_len + sroute_size(ctl) > PAYLOAD_MAX) {
+        return 0;
+    }
+
+    d->route_ctl = ctl;
+    memcpy(d->payload + d->payload_len, encoded, sroute_size(ctl));
+    return 1;
 }
 
-static inline int16_t find_pos_in_route(uint16_t addr, uint8_t *route, uint16_t route_len) {
-    uint8_t* p;
 
-    //~ int i;
-    //~ printf("route [%u]=", route_len);
-    //~ for (i=0;i<route_len;i++) printf("%.2x%.2x ", route[2*i], route[2*i+1]);
-    //~ printf("\n");
+/*----ROUTE CACHE----*/
 
+/**
+ * Function called when first sending a packet.
+ * It should try to see if the destination node has a cached route,
+ * which fits in the packet with its data.
+ * Otherwise it declares flooding.
+ * \param d the packet, its data already set
+ * \param addr the destination address
+ * \return the next hop, 0 if the packet must be flooded
+ */
+static inline uint16_t set_route_to_host(data_t *d, uint16_t addr) {
+    route_t *r;
 
-    for (p=route+2*(route_len-1); p-route>=0; p-=2) {
+    if (addr==MAC_BROADCAST) {
+        printf("broadcast, flooding\n");
+        return 0;
+    }
 
-        //~ printf("matching %.4x with %.4x...", addr, ADDR_FROM_BYTES(p));
+    r = route_find(addr);
+    if ( (r == 0x0) || !set_packet_route(d, r->hops, r->number) ) {
+        printf("no route, flooding\n");
+        return 0;
+    }
+
+    r->used = ++route_clock;
+    return (r->number>0) ? r->hops[0] : addr;
+}
 
-        if (ADDR_FROM_BYTES(p) == addr) {
-            //~ printf("found\n");
-            return (p-route)/2;
+static inline int16_t find_pos_in_route(uint16_t addr, uint16_t *route, uint16_t route_len) {
+    int16_t i;
+
+    for (i=route_len-1; i>=0; i--) {
+        if (route[i] == addr) {
+            return i;
         }
-        //~ printf("not found\n");
     }
     return -1;
 }
+static route_t* route_find(uint16_t dst) {
+    int16_t i;
 
-static inline void store_route(void) {
+    for (i=0; i<ROUTE_NUMBER; i++) {
+        if (known_routes[i].dst == dst) {
+            return &known_routes[i];
+        }
+    }
+    return 0x0;
+}
 
-    int i;
-    uint8_t* hops;
+/**
+ * Store a route to a node in a free entry, or in place of the least
+ * recently used one with ROUTE_EVICT.
+ * A cached route cheaper than the new one is kept, unless it is stale.
+ * \param dst the destination
+ * \param hops the addresses between me and dst
+ * \param number the number of hops
+ * \param flags ROUTE_REVERSE if hops are listed from dst to me, ROUTE_EVICT
+ */
+static void route_learn(uint16_t dst, uint16_t *hops, uint16_t number, uint16_t flags) {
+    route_t *r;
+    uint16_t i, first;
 
-    if (data.route_len > MAX_ROUTE_LEN) {
-        // too big, error
+    if ( (dst == node_addr) || (dst == MAC_BROADCAST) || (number > MAX_ROUTE_LEN) ||
+         (find_pos_in_route(node_addr, hops, number) >= 0) ) {
         return;
     }
 
-    // check if we already have a route to this node
-    for (i=0;i<ROUTE_NUMBER;i++) {
-        if (find_pos_in_route(ADDR_FROM_BYTES(data.src_addr), \
-                                        known_routes[i].hops, \
-                                        known_routes[i].number)!=-1) {
-            // route exists
+    r = route_find(dst);
+    if (r && ((uint16_t)(route_clock - r->learned) <= ROUTE_STALE)) {
+        first = (number == 0) ? dst : ((flags & ROUTE_REVERSE) ? hops[number-1] : hops[0]);
+        if (route_cost(r->number ? r->hops[0] : dst, r->number) < route_cost(first, number)) {
             return;
         }
     }
 
-    // easy pointer
-    hops = known_routes[known_route_id].hops;
-
-    // first hop, the sender
-    ADDR_COPY(hops, data.src_addr);
-    hops += 2;
+    if (r == 0x0) {
+        // a free entry, or the least recently used
+        r = &known_routes[0];
+        for (i=0; i<ROUTE_NUMBER && r->dst; i++) {
+            if ( (known_routes[i].dst == 0) ||
+                 (uint16_t)(route_clock - known_routes[i].used) > (uint16_t)(route_clock - r->used) ) {
+                r = &known_routes[i];
+            }
+        }
+        if (r->dst && !(flags & ROUTE_EVICT)) {
+            return;
+        }
+    }
 
-    // then the route
-    memcpy(hops, data_route, 2*data.route_len);
-    hops += (2*data.route_len);
+    r->dst = dst;
+    r->number = number;
+    r->used = ++route_clock;
+    r->learned = route_clock;
+    for (i=0; i<number; i++) {
+        r->hops[i] = (flags & ROUTE_REVERSE) ? hops[number-1-i] : hops[i];
+    }
+}
 
-    // then me
-    INSERT_ADDR_AT(node_addr, hops);
+/**
+ * Estimate the cost of a route, in LINKQ_ETX_ONE units: the ETX of its
+ * first link, which is the only one known here, and one per other hop.
+ * \param first the next hop, or the destination if there is no hop
+ * \param number the number of hops
+ */
+static uint16_t route_cost(uint16_t first, uint16_t number) {
+    return linkq_etx(first) + number*LINKQ_ETX_ONE;
+}
 
-    // update size
-    known_routes[known_route_id].number = 2+data.route_len;
+/**
+ * Drop the cached routes going from a node straight to another.
+ */
+static void route_invalidate_link(uint16_t from, uint16_t to) {
+    route_t *r;
+    uint16_t i, j, prev, next;
 
+    for (i=0; i<ROUTE_NUMBER; i++) {
+        r = &known_routes[i];
+        if (r->dst == 0) {
+            continue;
+        }
 
-    printf("new route!\n");
-    for (i=0; i<known_routes[known_route_id].number; i++) {
-        printf("%.4x-", ADDR_FROM_BYTES(known_routes[known_route_id].hops+2*i));
+        // walk me, hops..., dst
+        prev = node_addr;
+        for (j=0; j<=r->number; j++) {
+            next = (j < r->number) ? r->hops[j] : r->dst;
+            if ( (prev == from) && (next == to) ) {
+                r->dst = 0;
+                break;
+            }
+            prev = next;
+        }
     }
-
-    // increment id
-    known_route_id += 1;
-    known_route_id %= ROUTE_NUMBER;
-
 }
-
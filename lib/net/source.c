@@ -4,12 +4,13 @@
 #include <stdio.h>
 
 #include "source.h"
+#include "sroute.h"
 #include "mac.h"
 #include "timerB.h"
 
 /* ----DEFINES---- */
-#define HEADER_LENGTH (sizeof(data_t)-(MAX_DATA_LEN+2*MAX_ROUTE_LEN))
-#define MAX_DATA_LEN  25
+#define HEADER_LENGTH (sizeof(data_t)-PAYLOAD_MAX)
+#define PAYLOAD_MAX   49 // 58 MAC bytes minus the header, for data and route
 #define MAX_ROUTE_LEN 10
 
 #define STATE_RX    0x1 // waiting for data
@@ -29,8 +30,9 @@ typedef struct {
     uint8_t src_addr[2]; // network source
     uint8_t id; // source packet id
     uint8_t payload_len; // length of the data
-    uint8_t route_len; // length of the route
-    uint8_t payload[MAX_DATA_LEN + 2*MAX_ROUTE_LEN];
+    uint8_t route_ctl; // number of hops and encoding, see sroute.h
+    uint8_t route_ptr; // index of the next hop to handle the packet
+    uint8_t payload[PAYLOAD_MAX]; // data, then encoded route
 } data_t;
 
 /* ----PROTOTYPES---- */
@@ -39,7 +41,6 @@ static uint16_t delay_data(void);
 static uint16_t send_data(void);
 
 static inline void reset_all(void);
-static inline int16_t find_pos_in_route(uint8_t *route, uint16_t route_len);
 
 /* ----DATA---- */
 static net_handler_t rx_cb;
@@ -69,6 +70,8 @@ void net_init() {
 }
 
 uint16_t net_send(uint8_t packet[], uint16_t length, uint16_t route[], uint16_t route_len) {
+    uint8_t hops[2*MAX_ROUTE_LEN];
+    uint8_t ctl;
     uint16_t i;
 
     if (state != STATE_RX) {
@@ -76,13 +79,16 @@ uint16_t net_send(uint8_t packet[], uint16_t length, uint16_t route[], uint16_t
         return 0;
     }
 
-    if (length > MAX_DATA_LEN) {
-        printf("net_send length error\n");
+    if ((route_len==0) || (route_len > MAX_ROUTE_LEN)) {
+        printf("net_send route length error\n");
         return 0;
     }
 
-    if ((route_len==0) || (route_len > MAX_ROUTE_LEN)) {
-        printf("net_send route length error\n");
+    // encode the route (remove destination from route), the data gets
+    // what the route leaves
+    ctl = sroute_encode(hops, route, route_len-1);
+    if (length + sroute_size(ctl) > PAYLOAD_MAX) {
+        printf("net_send length error\n");
         return 0;
     }
 
@@ -104,17 +110,14 @@ uint16_t net_send(uint8_t packet[], uint16_t length, uint16_t route[], uint16_t
     data.payload_len = length;
     memcpy(data.payload, packet, length);
 
-    // copy route (remove destination from route)
-    data.route_len = route_len-1;
+    // copy route
+    data.route_ctl = ctl;
+    data.route_ptr = 0;
     data_route = data.payload + length;
-
-    for (i=0; i<data.route_len; i++) {
-        data_route[2*i]    = route[i] >> 8;
-        data_route[2*i +1] = route[i] & 0xFF;
-    }
+    memcpy(data_route, hops, sroute_size(ctl));
 
     // global length
-    data_length = HEADER_LENGTH + length + 2*data.route_len;
+    data_length = HEADER_LENGTH + length + sroute_size(ctl);
 
     // next hop
     data_addr = route[0];
@@ -178,8 +181,7 @@ static uint16_t send_data(void) {
 
 static uint16_t data_received(uint8_t packet[], uint16_t length, uint16_t src_addr, int16_t rssi) {
     data_t *rx_data;
-    uint16_t dst;
-    uint8_t *route;
+    uint16_t dst, count;
 
     // check min length
     if (length < HEADER_LENGTH) {
@@ -197,64 +199,59 @@ static uint16_t data_received(uint8_t packet[], uint16_t length, uint16_t src_ad
     }
 
     // ckeck the length
-    if ( (HEADER_LENGTH + (rx_data->payload_len) + (rx_data->route_len*2)) != length ) {
+    count = SROUTE_COUNT(rx_data->route_ctl);
+    if ( ((HEADER_LENGTH + (rx_data->payload_len) + sroute_size(rx_data->route_ctl)) != length) ||
+         (rx_data->route_ptr > count) ) {
         printf("data_frame_received length doesn't match\n");
         return 0;
     }
 
-    // set the route pointer
-    route = rx_data->payload + rx_data->payload_len;
-
     // copy packet
     memcpy(&data, rx_data, length);
     data_route = data.payload + data.payload_len;
 
-    // check the destination, if for me call the callback
-    dst = (rx_data->dst_addr[0]<<8) + (rx_data->dst_addr[1]);
-
-    // if for me, if for me call the callback
-    if ( (dst == node_addr) && rx_cb) {
-        uint16_t src;
-        src = (data_route[0]<<8) + (data_route[1]);
+    // check the destination
+    dst = (data.dst_addr[0]<<8) + (data.dst_addr[1]);
 
+    // the pointer gives the hop expected to handle the packet
+    if (data.route_ptr == count) {
         // clear the data indicator
         data_length = 0;
 
-        return rx_cb(data.payload, data.payload_len, src);
-    } else {
-        // otherwise, forward
-        int16_t pos;
-        pos = find_pos_in_route(route, rx_data->route_len);
-
-        if (pos<0) {
-            // next hop not found
-            printf("data_frame_received fw next hop not found\n");
-            // clear the data indicator
-            data_length = 0;
+        if (dst != node_addr) {
+            printf("data_frame_received not for me\n");
             return 0;
-        } else if (pos==rx_data->route_len-1){
-            data_addr = (((uint16_t)rx_data->dst_addr[0])<<8) + rx_data->dst_addr[1];
-        } else {
-            data_addr = (((uint16_t)route[2*pos])<<8) + route[2*pos+1];
-            data_length = length;
         }
 
-        // forward
-        data_length = length;
-        data_try_count = 1;
-        delay_data();
-        state = STATE_TX;
-        printf("fw\n");
+        // for me, call the callback
+        if (rx_cb) {
+            return rx_cb(data.payload, data.payload_len,
+                         (data.src_addr[0]<<8) + data.src_addr[1]);
+        }
+        return 0;
     }
-    return 0;
-}
 
-static inline int16_t find_pos_in_route(uint8_t *route, uint16_t route_len) {
-    uint8_t* p;
-    for (p=route+2*(route_len-1); p-route>=0; p-=2) {
-        if ((p[0]<<8)+p[1] == node_addr) {
-            return (p-route)/2;
-        }
+    if (sroute_get(data.route_ctl, data_route, data.route_ptr) != node_addr) {
+        // next hop not found
+        printf("data_frame_received fw next hop not found\n");
+        // clear the data indicator
+        data_length = 0;
+        return 0;
+    }
+
+    // otherwise, consume my hop and forward
+    data.route_ptr++;
+    if (data.route_ptr == count) {
+        data_addr = dst;
+    } else {
+        data_addr = sroute_get(data.route_ctl, data_route, data.route_ptr);
     }
-    return -1;
+
+    data_length = length;
+    data_try_count = 1;
+    delay_data();
+    state = STATE_TX;
+    printf("fw\n");
+
+    return 0;
 }
@@ -0,0 +1,61 @@
+#include <io.h>
+
+#include "sroute.h"
+
+#if SROUTE_LEN_MAX > 15
+#error "SROUTE_LEN_MAX must fit SROUTE_COUNT"
+#endif
+
+uint16_t sroute_size(uint8_t ctl) {
+    uint16_t count = SROUTE_COUNT(ctl);
+
+    if (count == 0) {
+        return 0;
+    }
+    return (ctl & SROUTE_SHORT) ? 1 + count : 2*count;
+}
+
+uint16_t sroute_get(uint8_t ctl, const uint8_t *route, uint16_t i) {
+    if (ctl & SROUTE_SHORT) {
+        return (((uint16_t)route[0])<<8) + route[1+i];
+    }
+    return (((uint16_t)route[2*i])<<8) + route[2*i+1];
+}
+
+uint8_t sroute_encode(uint8_t *route, const uint16_t *hops, uint16_t count) {
+    uint16_t i;
+
+    if (count == 0) {
+        return 0;
+    }
+
+    // check the hops share the same prefix
+    for (i=1; i<count; i++) {
+        if ( (hops[i]>>8) != (hops[0]>>8) ) {
+            break;
+        }
+    }
+
+    if (i == count) {
+        route[0] = hops[0]>>8;
+        for (i=0; i<count; i++) {
+            route[1+i] = hops[i] & 0xFF;
+        }
+        return SROUTE_SHORT | count;
+    }
+
+    for (i=0; i<count; i++) {
+        route[2*i] = hops[i]>>8;
+        route[2*i+1] = hops[i] & 0xFF;
+    }
+    return count;
+}
+
+uint16_t sroute_decode(uint8_t ctl, const uint8_t *route, uint16_t *hops) {
+    uint16_t i, count = SROUTE_COUNT(ctl);
+
+    for (i=0; i<count; i++) {
+        hops[i] = sroute_get(ctl, route, i);
+    }
+    return count;
+}
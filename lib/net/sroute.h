@@ -0,0 +1,53 @@
+#ifndef SROUTE_H
+#define SROUTE_H
+
+/**
+ * Compact encoding of the hop list carried by source routed packets.
+ *
+ * The control byte holds the number of hops and the encoding. When all
+ * the hops share the same high address byte (nodes of the same PAN), it
+ * is written once and each hop takes a single byte:
+ *     [prefix][low0][low1]...
+ * otherwise each hop takes two bytes:
+ *     [high0][low0][high1][low1]...
+ */
+
+/**
+ * Maximum number of hops in a route.
+ */
+#define SROUTE_LEN_MAX 15
+
+#define SROUTE_SHORT 0x80 // control byte flag, one byte per hop
+#define SROUTE_COUNT(ctl) ((ctl) & 0x0F)
+
+/**
+ * Get the number of bytes of an encoded route.
+ * \param ctl the route control byte
+ */
+uint16_t sroute_size(uint8_t ctl);
+
+/**
+ * Get the address of a hop.
+ * \param ctl the route control byte
+ * \param route the encoded route
+ * \param i the hop index, less than SROUTE_COUNT(ctl)
+ */
+uint16_t sroute_get(uint8_t ctl, const uint8_t *route, uint16_t i);
+
+/**
+ * Encode a list of hops, in the smallest form.
+ * \param route where to write the encoded route
+ * \param hops the addresses
+ * \param count the number of hops, SROUTE_LEN_MAX max
+ * \return the route control byte
+ */
+uint8_t sroute_encode(uint8_t *route, const uint16_t *hops, uint16_t count);
+
+/**
+ * Decode a route into a list of hops.
+ * \param hops where to write the addresses, SROUTE_COUNT(ctl) long
+ * \return the number of hops
+ */
+uint16_t sroute_decode(uint8_t ctl, const uint8_t *route, uint16_t *hops);
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef FREERTOS_CONFIG_H
+#define FREERTOS_CONFIG_H
+
+#include <io.h>
+
+/*-----------------------------------------------------------
+ * Configuration of the FreeRTOS MACs run on the host simulator, with the
+ * port of OS/FreeRTOS/Source/portable/GCC/Sim.
+ *
+ * The tick rate is the one of the MAC test programs, the Makefile sets it
+ * for each shared object.
+ *----------------------------------------------------------*/
+
+#define configUSE_PREEMPTION		1
+#define configUSE_IDLE_HOOK			1
+#define configUSE_TICK_HOOK			0
+#define configCPU_CLOCK_HZ			( ( unsigned portLONG ) 8000000 )
+#ifndef configTICK_RATE_HZ
+#define configTICK_RATE_HZ			( ( portTickType ) 1000 )
+#endif
+#define configMAX_PRIORITIES		( ( unsigned portBASE_TYPE ) 4 )
+#define configMINIMAL_STACK_SIZE	( ( unsigned portSHORT ) 64 )
+#define configTOTAL_HEAP_SIZE		( ( size_t ) ( 16000 ) )
+#define configMAX_TASK_NAME_LEN		( 8 )
+#define configUSE_TRACE_FACILITY	0
+#define configUSE_16_BIT_TICKS		1
+#define configIDLE_SHOULD_YIELD		1
+#define configUSE_MUTEXES           1
+
+/* The idle task stops the tick when it can, as on the nodes, which also
+saves simulator events. */
+#define configUSE_TICKLESS_IDLE		1
+
+/* Co-routine definitions. */
+#define configUSE_CO_ROUTINES 		0
+#define configMAX_CO_ROUTINE_PRIORITIES ( 2 )
+
+/* Set the following definitions to 1 to include the API function, or zero
+to exclude the API function. */
+
+#define INCLUDE_vTaskPrioritySet		0
+#define INCLUDE_uxTaskPriorityGet		0
+#define INCLUDE_vTaskDelete				1
+#define INCLUDE_vTaskCleanUpResources	0
+#define INCLUDE_vTaskSuspend			1
+#define INCLUDE_vTaskDelayUntil			1
+#define INCLUDE_vTaskDelay				1
+
+#endif /* FREERTOS_CONFIG_H */
@@ -0,0 +1,550 @@
+/*
+ * Copyright  2008-2009 INRIA/SensTools
+ *
+ * <dev-team@sentools.info>
+ *
+ * This software is a set of libraries designed to develop applications
+ * for the WSN430 embedded hardware platform.
+ *
+ * This software is governed by the CeCILL license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL license and that you accept its terms.
+ */
+
+/**
+ * \file
+ * \brief Host-side radio medium simulator, MAC benchmark
+ * \date October 2026
+ *
+ * Every node but node 0 generates packets for node 0 (the sink) with
+ * exponentially distributed inter-arrival times, and sends them one at
+ * a time through its MAC. The throughput, latency, duty cycle and number
+ * of frames sent per delivered packet are reported at the end.
+ *
+ * In broadcast mode every node counts the packets it receives, and the
+ * delivery ratio is relative to all the other nodes.
+ *
+ * Some nodes may be powered off half way through the traffic, to see
+ * how the network layers recover from broken links.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <libgen.h>
+#include <unistd.h>
+#include "bench.h"
+
+#define RETRY_DELAY SIM_MS(1)
+#define DRAIN_TIME  SIM_S(5)
+
+static const bench_mac_t *macs[] = {&bench_xmac, &bench_csma, &bench_tdma,
+                                    &bench_flood, &bench_flood_k, &bench_route,
+                                    &bench_rtos_csma, &bench_rtos_xmac, &bench_rtos_starnet,
+                                    &bench_rtos_tdma};
+
+static struct {
+    const bench_mac_t *mac;
+    uint16_t nodes;
+    const char *topology;
+    double spacing;
+    double rate;
+    uint16_t length;
+    double duration;
+    uint32_t seed;
+    uint16_t broadcast;
+    uint16_t kill;
+    uint8_t channel;
+    const char *objdir;
+} cfg = {
+    .mac = &bench_xmac,
+    .nodes = 10,
+    .topology = "star",
+    .spacing = 20.,
+    .rate = 0.2,
+    .length = 20,
+    .duration = 60.,
+    .seed = 1,
+    .broadcast = 0,
+    .kill = 0,
+    .channel = 0,
+    .objdir = 0
+};
+
+static bench_node_t bench_nodes[SIM_NODES_MAX];
+static sim_time_t traffic_end;
+
+static double *latencies;
+static uint32_t latency_count, latency_size;
+static uint32_t duplicates;
+
+bench_node_t* bench_self(void)
+{
+    return &bench_nodes[sim_current->id];
+}
+
+static void try_send(sim_node_t *node, uint32_t arg);
+
+static void schedule_try(bench_node_t *bn, sim_time_t delay)
+{
+    sim_schedule_cpu(sim_now() + delay, bn->node, try_send, 0);
+}
+
+static void try_send(sim_node_t *node, uint32_t arg)
+{
+    bench_node_t *bn = &bench_nodes[node->id];
+    uint8_t data[64];
+    uint16_t seq, i;
+
+    (void) arg;
+
+    if (bn->busy || bn->length == 0)
+    {
+        return;
+    }
+
+    // the source address and the sequence number identify the packet
+    seq = bn->queue[bn->head];
+    data[0] = node->id >> 8;
+    data[1] = node->id & 0xFF;
+    data[2] = seq >> 8;
+    data[3] = seq & 0xFF;
+    for (i = 4; i < cfg.length; i++)
+    {
+        data[i] = i;
+    }
+
+    bn->busy = 1;
+    if (!cfg.mac->send(bn, data, cfg.length, cfg.broadcast ? 0xFFFF : 1))
+    {
+        bn->busy = 0;
+        schedule_try(bn, RETRY_DELAY);
+    }
+}
+
+void bench_sent(bench_node_t *bn, uint16_t ok)
+{
+    if (!bn->busy)
+    {
+        return;
+    }
+
+    if (ok)
+    {
+        bn->sent++;
+    }
+    else
+    {
+        bn->failed++;
+    }
+    bn->busy = 0;
+    bn->head = (bn->head + 1) % BENCH_QUEUE;
+    bn->length--;
+
+    // not from the MAC callback, it may not be ready yet
+    schedule_try(bn, 0);
+}
+
+void bench_received(bench_node_t *bn, const uint8_t *data, uint16_t length)
+{
+    bench_node_t *src;
+    uint16_t id, seq;
+
+    if ((bn->node->id != 0 && !cfg.broadcast) || length < 4)
+    {
+        return;
+    }
+
+    id = (data[0] << 8) | data[1];
+    seq = (data[2] << 8) | data[3];
+    if (id == 0 || id >= sim_node_count)
+    {
+        return;
+    }
+    src = &bench_nodes[id];
+    if (seq >= src->gen_size || seq >= src->generated)
+    {
+        return;
+    }
+    if (bn->delivered == 0)
+    {
+        bn->delivered = calloc(sim_node_count, src->gen_size);
+    }
+    if (bn->delivered[id * src->gen_size + seq])
+    {
+        duplicates++;
+        return;
+    }
+    bn->delivered[id * src->gen_size + seq] = 1;
+
+    if (latency_count == latency_size)
+    {
+        latency_size = latency_size ? 2 * latency_size : 1024;
+        latencies = realloc(latencies, latency_size * sizeof(double));
+    }
+    latencies[latency_count++] = (sim_now() - src->gen_time[seq]) / 1e6;
+}
+
+static void generate(sim_node_t *node, uint32_t arg)
+{
+    bench_node_t *bn = &bench_nodes[node->id];
+    double gap;
+
+    (void) arg;
+
+    if (sim_now() >= traffic_end || bn->generated >= bn->gen_size)
+    {
+        return;
+    }
+
+    bn->gen_time[bn->generated] = sim_now();
+    if (bn->length < BENCH_QUEUE)
+    {
+        bn->queue[(bn->head + bn->length) % BENCH_QUEUE] = bn->generated;
+        bn->length++;
+        schedule_try(bn, 0);
+    }
+    else
+    {
+        bn->dropped++;
+    }
+    bn->generated++;
+
+    gap = -log(1. - sim_random()) / cfg.rate;
+    sim_schedule_cpu(sim_now() + (sim_time_t) (gap * 1e9), node, generate, 0);
+}
+
+static void start(sim_node_t *node, uint32_t arg)
+{
+    bench_node_t *bn = &bench_nodes[node->id];
+    double gap;
+
+    (void) arg;
+
+    cfg.mac->init(bn, cfg.channel);
+    if (node->id != 0)
+    {
+        // not all at once, the first packet also follows the arrival process
+        gap = -log(1. - sim_random()) / cfg.rate;
+        sim_schedule_cpu(sim_now() + (sim_time_t) (gap * 1e9), node, generate, 0);
+    }
+}
+
+static void kill(sim_node_t *node, uint32_t arg)
+{
+    uint16_t i, count = 0;
+
+    (void) node;
+    (void) arg;
+
+    while (count < cfg.kill)
+    {
+        i = 1 + (uint16_t) (sim_random() * (sim_node_count - 1));
+        if (i < sim_node_count && !sim_nodes[i].down)
+        {
+            sim_node_down(&sim_nodes[i]);
+            count++;
+        }
+    }
+}
+
+static void poll(sim_node_t *node, uint32_t arg)
+{
+    (void) arg;
+    if (cfg.mac->poll)
+    {
+        cfg.mac->poll(&bench_nodes[node->id]);
+    }
+}
+
+static void place(void)
+{
+    uint16_t i, side, best = 0;
+    double x, y, cx = 0., cy = 0., d, dmin = 1e30;
+
+    side = (uint16_t) ceil(sqrt(cfg.nodes));
+
+    for (i = 0; i < cfg.nodes; i++)
+    {
+        if (strcmp(cfg.topology, "line") == 0)
+        {
+            x = i * cfg.spacing;
+            y = 0.;
+        }
+        else if (strcmp(cfg.topology, "grid") == 0)
+        {
+            x = (i % side) * cfg.spacing;
+            y = (i / side) * cfg.spacing;
+        }
+        else if (strcmp(cfg.topology, "random") == 0)
+        {
+            x = sim_random() * side * cfg.spacing;
+            y = sim_random() * side * cfg.spacing;
+        }
+        else
+        {
+            // star, the sink in the middle of a circle
+            x = i ? cfg.spacing * cos(2. * M_PI * i / (cfg.nodes - 1)) : 0.;
+            y = i ? cfg.spacing * sin(2. * M_PI * i / (cfg.nodes - 1)) : 0.;
+        }
+        sim_node_add(x, y);
+        cx += x / cfg.nodes;
+        cy += y / cfg.nodes;
+    }
+
+    if (strcmp(cfg.topology, "grid") == 0 || strcmp(cfg.topology, "random") == 0)
+    {
+        // the sink is the node closest to the center
+        for (i = 0; i < cfg.nodes; i++)
+        {
+            d = hypot(sim_nodes[i].x - cx, sim_nodes[i].y - cy);
+            if (d < dmin)
+            {
+                dmin = d;
+                best = i;
+            }
+        }
+        x = sim_nodes[0].x;
+        y = sim_nodes[0].y;
+        sim_nodes[0].x = sim_nodes[best].x;
+        sim_nodes[0].y = sim_nodes[best].y;
+        sim_nodes[best].x = x;
+        sim_nodes[best].y = y;
+    }
+}
+
+static int compare(const void *a, const void *b)
+{
+    double x = *(const double*) a, y = *(const double*) b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(double p)
+{
+    uint32_t i;
+    if (latency_count == 0)
+    {
+        return 0.;
+    }
+    i = (uint32_t) ceil(p * latency_count) - 1;
+    return latencies[i < latency_count ? i : latency_count - 1];
+}
+
+static void report(void)
+{
+    uint32_t generated = 0, sent = 0, failed = 0, dropped = 0, frames = 0, copied = 0, expected, i;
+    double duty = 0., sink_duty, end = cfg.duration + DRAIN_TIME / 1e9;
+    sim_radio_t *r;
+
+    for (i = 0; i < sim_node_count; i++)
+    {
+        sim_radio_account(&sim_nodes[i]);
+        r = &sim_nodes[i].radio;
+        frames += r->frames_tx;
+        copied += sim_nodes[i].copied;
+        if (i == 0)
+        {
+            continue;
+        }
+        generated += bench_nodes[i].generated;
+        sent += bench_nodes[i].sent;
+        failed += bench_nodes[i].failed;
+        dropped += bench_nodes[i].dropped;
+        duty += (r->time_rx + r->time_tx) / 1e9 / end / (sim_node_count - 1);
+    }
+    r = &sim_nodes[0].radio;
+    expected = cfg.broadcast ? generated * (sim_node_count - 1) : generated;
+    sink_duty = (r->time_rx + r->time_tx) / 1e9 / end;
+
+    qsort(latencies, latency_count, sizeof(double), compare);
+
+    fprintf(stdout, "mac             %s\n", cfg.mac->name);
+    fprintf(stdout, "nodes           %u (%s, %.1fm)\n", sim_node_count, cfg.topology, cfg.spacing);
+    fprintf(stdout, "offered load    %.3f pkt/s/node, %u bytes\n", cfg.rate, cfg.length);
+    fprintf(stdout, "generated       %u\n", generated);
+    fprintf(stdout, "delivered       %u (%.1f%%)\n", latency_count,
+            expected ? 100. * latency_count / expected : 0.);
+    fprintf(stdout, "duplicates      %u\n", duplicates);
+    fprintf(stdout, "mac sent/failed %u/%u\n", sent, failed);
+    fprintf(stdout, "queue drops     %u\n", dropped);
+    fprintf(stdout, "throughput      %.1f bit/s\n", latency_count * cfg.length * 8. / cfg.duration);
+    fprintf(stdout, "latency p50     %.1f ms\n", percentile(0.50));
+    fprintf(stdout, "latency p90     %.1f ms\n", percentile(0.90));
+    fprintf(stdout, "latency p99     %.1f ms\n", percentile(0.99));
+    fprintf(stdout, "duty cycle      %.2f%% (sink %.2f%%)\n", 100. * duty, 100. * sink_duty);
+    fprintf(stdout, "frames/packet   %.2f\n", latency_count ? (double) frames / latency_count : 0.);
+    fprintf(stdout, "frames/source   %.2f\n", generated ? (double) frames / generated : 0.);
+    fprintf(stdout, "copied/frame    %.1f bytes\n", frames ? (double) copied / frames : 0.);
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -m mac       xmac, csma, tdma, flood, flood-k, route, rtos-csma,\n"
+            "               rtos-xmac, rtos-starnet or rtos-tdma (xmac)\n"
+            "  -n nodes     number of nodes, node 0 is the sink (10)\n"
+            "  -t topology  star, line, grid or random (star)\n"
+            "  -s meters    node spacing (20)\n"
+            "  -r rate      packets per second per node (0.2)\n"
+            "  -l bytes     payload length (20)\n"
+            "  -d seconds   traffic duration (60)\n"
+            "  -S seed      random seed (1)\n"
+            "  -c channel   radio channel (0)\n"
+            "  -b           broadcast instead of unicast to the sink\n"
+            "  -k count     nodes powered off at half the duration (0)\n"
+            "  -e exponent  path loss exponent (3)\n"
+            "  -w dB        shadowing deviation (0)\n"
+            "  -p ppm       maximum crystal error (20)\n"
+            "  -o dir       directory of the MAC shared objects\n"
+            "  -v           print the MAC debug output\n", name);
+    exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+    char path[1024], self[1024];
+    uint16_t i;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "m:n:t:s:r:l:d:S:c:bk:e:w:p:o:vh")) != -1)
+    {
+        switch (opt)
+        {
+            case 'm':
+                cfg.mac = 0;
+                for (i = 0; i < sizeof(macs) / sizeof(macs[0]); i++)
+                {
+                    if (strcmp(optarg, macs[i]->name) == 0)
+                    {
+                        cfg.mac = macs[i];
+                    }
+                }
+                if (cfg.mac == 0)
+                {
+                    usage(argv[0]);
+                }
+                break;
+            case 'n':
+                cfg.nodes = atoi(optarg);
+                break;
+            case 't':
+                cfg.topology = optarg;
+                break;
+            case 's':
+                cfg.spacing = atof(optarg);
+                break;
+            case 'r':
+                cfg.rate = atof(optarg);
+                break;
+            case 'l':
+                cfg.length = atoi(optarg);
+                break;
+            case 'd':
+                cfg.duration = atof(optarg);
+                break;
+            case 'S':
+                cfg.seed = atoi(optarg);
+                break;
+            case 'c':
+                cfg.channel = atoi(optarg);
+                break;
+            case 'b':
+                cfg.broadcast = 1;
+                break;
+            case 'k':
+                cfg.kill = atoi(optarg);
+                break;
+            case 'e':
+                sim_medium.pl_exp = atof(optarg);
+                break;
+            case 'w':
+                sim_medium.shadowing = atof(optarg);
+                break;
+            case 'p':
+                sim_medium.ppm = atof(optarg);
+                break;
+            case 'o':
+                cfg.objdir = optarg;
+                break;
+            case 'v':
+                sim_verbose = 1;
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+
+    if (cfg.nodes < 2 || cfg.nodes > SIM_NODES_MAX || cfg.kill >= cfg.nodes || cfg.rate <= 0. || cfg.length < 4
+            || cfg.length > cfg.mac->payload_max)
+    {
+        usage(argv[0]);
+    }
+    if (cfg.mac->nodes_max && cfg.nodes > cfg.mac->nodes_max)
+    {
+        fprintf(stderr, "%s: at most %u nodes\n", cfg.mac->name, cfg.mac->nodes_max);
+        return 1;
+    }
+    if (cfg.objdir == 0)
+    {
+        strncpy(self, argv[0], sizeof(self) - 1);
+        cfg.objdir = dirname(self);
+    }
+
+    sim_init(cfg.seed);
+    place();
+    traffic_end = (sim_time_t) (cfg.duration * 1e9);
+
+    for (i = 0; i < sim_node_count; i++)
+    {
+        bench_node_t *bn = &bench_nodes[i];
+
+        snprintf(path, sizeof(path), "%s/%s", cfg.objdir, cfg.mac->object(i));
+        if (!sim_node_load(&sim_nodes[i], path))
+        {
+            return 1;
+        }
+        bn->node = &sim_nodes[i];
+        bn->gen_size = (uint32_t) (cfg.rate * cfg.duration * 2.) + 64;
+        if (bn->gen_size > 0x10000)
+        {
+            bn->gen_size = 0x10000;
+        }
+        bn->gen_time = calloc(bn->gen_size, sizeof(sim_time_t));
+
+        // nodes are switched on within the first second
+        sim_schedule_cpu((sim_time_t) (sim_random() * 1e9), &sim_nodes[i], start, 0);
+    }
+
+    if (cfg.kill)
+    {
+        sim_schedule(traffic_end / 2, 0, kill, 0);
+    }
+
+    sim_run(traffic_end + DRAIN_TIME, poll);
+    report();
+    return 0;
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright  2008-2009 INRIA/SensTools
+ *
+ * <dev-team@sentools.info>
+ *
+ * This software is a set of libraries designed to develop applications
+ * for the WSN430 embedded hardware platform.
+ *
+ * This software is governed by the CeCILL license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL license and that you accept its terms.
+ */
+
+/**
+ * \file
+ * \brief Host-side radio medium simulator, MAC benchmark interface
+ * \date October 2026
+ */
+
+#ifndef _BENCH_H_
+#define _BENCH_H_
+
+#include "sim.h"
+
+#define BENCH_QUEUE 16
+
+typedef struct {
+    sim_node_t *node;
+    uint16_t queue[BENCH_QUEUE]; // sequence numbers waiting to be sent
+    uint16_t head, length;
+    uint16_t busy;
+    uint32_t generated, sent, failed, dropped;
+    sim_time_t *gen_time;        // generation time of each sequence number
+    uint32_t gen_size;
+    uint8_t *delivered;          // at the receiver, one byte per sequence number
+    void *mac;                   // adapter data
+} bench_node_t;
+
+/**
+ * Adapter between the benchmark and a MAC layer API.
+ */
+typedef struct {
+    const char *name;
+    /** shared object name for a node */
+    const char* (*object)(uint16_t id);
+    /** initialize the MAC, in the node context */
+    void (*init)(bench_node_t *bn, uint8_t channel);
+    /** send a packet, return 1 if accepted, 0 to retry later */
+    uint16_t (*send)(bench_node_t *bn, uint8_t *data, uint16_t length, uint16_t dst);
+    /** called after each event of the node, may be 0 */
+    void (*poll)(bench_node_t *bn);
+    /** maximum payload length */
+    uint16_t payload_max;
+    /** maximum number of nodes, the sink included, 0 for SIM_NODES_MAX */
+    uint16_t nodes_max;
+} bench_mac_t;
+
+extern const bench_mac_t bench_xmac, bench_csma, bench_tdma;
+extern const bench_mac_t bench_flood, bench_flood_k, bench_route;
+extern const bench_mac_t bench_rtos_csma, bench_rtos_xmac, bench_rtos_starnet, bench_rtos_tdma;
+
+/**
+ * Get the benchmark node of the current context.
+ */
+bench_node_t* bench_self(void);
+
+/**
+ * Signal the end of the current send, called by the adapters.
+ * \param ok 1 if sent, 0 if the MAC gave up
+ */
+void bench_sent(bench_node_t *bn, uint16_t ok);
+
+/**
+ * Signal a received packet, called by the adapters.
+ */
+void bench_received(bench_node_t *bn, const uint8_t *data, uint16_t length);
+
+#endif
@@ -0,0 +1,120 @@
+/*
+ * Copyright  2008-2009 INRIA/SensTools
+ *
+ * <dev-team@sentools.info>
+ *
+ * This software is a set of libraries designed to develop applications
+ * for the WSN430 embedded hardware platform.
+ *
+ * This software is governed by the CeCILL license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL license and that you accept its terms.
+ */
+
+/**
+ * \file
+ * \brief Host-side radio medium simulator, adapter for the mac.h API
+ * \date October 2026
+ *
+ * Used for xmac.c and csma_cc1101.c.
+ */
+
+#include <stdlib.h>
+#include "bench.h"
+#include "mac.h"
+
+typedef struct {
+    uint16_t (*send)(uint8_t packet[], uint16_t length, uint16_t dst_addr);
+} mac_api_t;
+
+static uint16_t rx_cb(uint8_t packet[], uint16_t length, uint16_t src_addr, int16_t rssi)
+{
+    (void) src_addr;
+    (void) rssi;
+    bench_received(bench_self(), packet, length);
+    return 0;
+}
+
+static uint16_t sent_cb(void)
+{
+    bench_sent(bench_self(), 1);
+    return 0;
+}
+
+static uint16_t error_cb(void)
+{
+    bench_sent(bench_self(), 0);
+    return 0;
+}
+
+static void init(bench_node_t *bn, uint8_t channel)
+{
+    mac_api_t *api;
+
+    api = malloc(sizeof(mac_api_t));
+    api->send = sim_node_sym(bn->node, "mac_send");
+    bn->mac = api;
+
+    ((void (*)(uint8_t)) sim_node_sym(bn->node, "mac_init"))(channel);
+    ((void (*)(mac_received_t)) sim_node_sym(bn->node, "mac_set_rx_cb"))(rx_cb);
+    ((void (*)(mac_sent_t)) sim_node_sym(bn->node, "mac_set_sent_cb"))(sent_cb);
+    ((void (*)(mac_error_t)) sim_node_sym(bn->node, "mac_set_error_cb"))(error_cb);
+}
+
+static uint16_t send(bench_node_t *bn, uint8_t *data, uint16_t length, uint16_t dst)
+{
+    mac_api_t *api = bn->mac;
+    return api->send(data, length, dst) == 0;
+}
+
+static const char* xmac_object(uint16_t id)
+{
+    (void) id;
+    return "xmac.so";
+}
+
+static const char* csma_object(uint16_t id)
+{
+    (void) id;
+    return "csma.so";
+}
+
+const bench_mac_t bench_xmac = {
+    .name = "xmac",
+    .object = xmac_object,
+    .init = init,
+    .send = send,
+    .poll = 0,
+    .payload_max = 56
+};
+
+const bench_mac_t bench_csma = {
+    .name = "csma",
+    .object = csma_object,
+    .init = init,
+    .send = send,
+    .poll = 0,
+    .payload_max = 58
+};
@@ -0,0 +1,132 @@
+/*
+ * Copyright  2008-2009 INRIA/SensTools
+ *
+ * <dev-team@sentools.info>
+ *
+ * This software is a set of libraries designed to develop applications
+ * for the WSN430 embedded hardware platform.
+ *
+ * This software is governed by the CeCILL license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL license and that you accept its terms.
+ */
+
+/**
+ * \file
+ * \brief Host-side radio medium simulator, adapter for the lib/net API
+ * \date October 2026
+ *
+ * Used for flood.c over csma_cc1101.c, with and without suppression,
+ * and for route.c over csma_cc1101.c.
+ */
+
+#include <stdlib.h>
+#include "bench.h"
+
+typedef struct {
+    uint16_t (*send)(uint8_t packet[], uint16_t length, uint16_t dst_addr);
+} net_api_t;
+
+static uint16_t rx_cb(uint8_t packet[], uint16_t length, uint16_t src_addr)
+{
+    (void) src_addr;
+    bench_received(bench_self(), packet, length);
+    return 0;
+}
+
+static void init(bench_node_t *bn, uint8_t channel)
+{
+    net_api_t *api;
+
+    // the network layers choose their channel
+    (void) channel;
+
+    api = malloc(sizeof(net_api_t));
+    api->send = sim_node_sym(bn->node, "net_send");
+    bn->mac = api;
+
+    ((void (*)(void)) sim_node_sym(bn->node, "net_init"))();
+    ((void (*)(uint16_t (*)(uint8_t*, uint16_t, uint16_t)))
+            sim_node_sym(bn->node, "net_register_rx_cb"))(rx_cb);
+}
+
+static uint16_t send(bench_node_t *bn, uint8_t *data, uint16_t length, uint16_t dst)
+{
+    net_api_t *api = bn->mac;
+
+    if (!api->send(data, length, dst))
+    {
+        return 0;
+    }
+
+    // there is no end of transmission callback
+    bench_sent(bn, 1);
+    return 1;
+}
+
+static const char* flood_object(uint16_t id)
+{
+    (void) id;
+    return "flood.so";
+}
+
+static const char* flood_k_object(uint16_t id)
+{
+    (void) id;
+    return "flood_k.so";
+}
+
+static const char* route_object(uint16_t id)
+{
+    (void) id;
+    return "route.so";
+}
+
+const bench_mac_t bench_flood = {
+    .name = "flood",
+    .object = flood_object,
+    .init = init,
+    .send = send,
+    .poll = 0,
+    .payload_max = 25
+};
+
+const bench_mac_t bench_flood_k = {
+    .name = "flood-k",
+    .object = flood_k_object,
+    .init = init,
+    .send = send,
+    .poll = 0,
+    .payload_max = 25
+};
+
+const bench_mac_t bench_route = {
+    .name = "route",
+    .object = route_object,
+    .init = init,
+    .send = send,
+    .poll = 0,
+    .payload_max = 29
+};
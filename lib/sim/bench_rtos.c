@@ -0,0 +1,130 @@
+/*
+ * Copyright  2008-2009 INRIA/SensTools
+ *
+ * <dev-team@sentools.info>
+ *
+ * This software is a set of libraries designed to develop applications
+ * for the WSN430 embedded hardware platform.
+ *
+ * This software is governed by the CeCILL license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL license and that you accept its terms.
+ */
+
+/**
+ * \file
+ * \brief Host-side radio medium simulator, adapter for the FreeRTOS MACs
+ * \date October 2026
+ *
+ * Each node runs the FreeRTOS kernel, a MAC of OS/FreeRTOS/lib and the
+ * application of rtos_app.c. Node 0 runs the sink (starnet) or the
+ * coordinator (TDMA) when the MAC has one.
+ */
+
+#include "bench.h"
+#include "rtos_app.h"
+#include "tdma_userconfig.h"
+
+static void received(const uint8_t *data, uint16_t length)
+{
+    bench_received(bench_self(), data, length);
+}
+
+static void sent(uint16_t ok)
+{
+    bench_sent(bench_self(), ok);
+}
+
+static void init(bench_node_t *bn, uint8_t channel)
+{
+    bn->mac = sim_node_sym(bn->node, "rtos_app_send");
+    ((void (*)(uint8_t, rtos_app_received_t, rtos_app_sent_t))
+            sim_node_sym(bn->node, "rtos_app_start"))(channel, received, sent);
+}
+
+static uint16_t send(bench_node_t *bn, uint8_t *data, uint16_t length, uint16_t dst)
+{
+    return ((uint16_t (*)(const uint8_t*, uint16_t, uint16_t)) bn->mac)(data, length, dst);
+}
+
+static const char* csma_object(uint16_t id)
+{
+    (void) id;
+    return "rtos_csma.so";
+}
+
+static const char* xmac_object(uint16_t id)
+{
+    (void) id;
+    return "rtos_xmac.so";
+}
+
+static const char* starnet_object(uint16_t id)
+{
+    return id == 0 ? "rtos_starnet_s.so" : "rtos_starnet_n.so";
+}
+
+static const char* tdma_object(uint16_t id)
+{
+    return id == 0 ? "rtos_tdma_c.so" : "rtos_tdma_n.so";
+}
+
+const bench_mac_t bench_rtos_csma = {
+    .name = "rtos-csma",
+    .object = csma_object,
+    .init = init,
+    .send = send,
+    .poll = 0,
+    .payload_max = 58
+};
+
+const bench_mac_t bench_rtos_xmac = {
+    .name = "rtos-xmac",
+    .object = xmac_object,
+    .init = init,
+    .send = send,
+    .poll = 0,
+    .payload_max = 58
+};
+
+const bench_mac_t bench_rtos_starnet = {
+    .name = "rtos-starnet",
+    .object = starnet_object,
+    .init = init,
+    .send = send,
+    .poll = 0,
+    .payload_max = 48
+};
+
+const bench_mac_t bench_rtos_tdma = {
+    .name = "rtos-tdma",
+    .object = tdma_object,
+    .init = init,
+    .send = send,
+    .poll = 0,
+    .payload_max = 58,
+    // the coordinator and a node per slot but the last one
+    .nodes_max = SLOT_COUNT
+};
@@ -0,0 +1,141 @@
+/*
+ * Copyright  2008-2009 INRIA/SensTools
+ *
+ * <dev-team@sentools.info>
+ *
+ * This software is a set of libraries designed to develop applications
+ * for the WSN430 embedded hardware platform.
+ *
+ * This software is governed by the CeCILL license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL license and that you accept its terms.
+ */
+
+/**
+ * \file
+ * \brief Host-side radio medium simulator, adapter for the TDMA MAC
+ * \date October 2026
+ *
+ * Node 0 runs the coordinator, whose slots are polled after each of its
+ * events, the others run the node MAC and send at their slot.
+ */
+
+#include <stdlib.h>
+#include "bench.h"
+#include "tdma_c.h"
+#include "tdma_n.h"
+
+typedef struct {
+    slot_t *slots;
+    uint8_t * const *payload;
+    int16_t (*is_access_allowed)(void);
+    void (*send)(void);
+} tdma_api_t;
+
+static uint16_t access_allowed(void)
+{
+    // the previous frame has been put in the radio FIFO for its slot
+    bench_sent(bench_self(), 1);
+    return 0;
+}
+
+static void init(bench_node_t *bn, uint8_t channel)
+{
+    tdma_api_t *api;
+
+    api = calloc(1, sizeof(tdma_api_t));
+    bn->mac = api;
+
+    if (bn->node->id == 0)
+    {
+        api->slots = sim_node_sym(bn->node, "mac_slots");
+    }
+    else
+    {
+        api->payload = sim_node_sym(bn->node, "mac_payload");
+        api->is_access_allowed = sim_node_sym(bn->node, "mac_is_access_allowed");
+        api->send = sim_node_sym(bn->node, "mac_send");
+    }
+    ((void (*)(uint8_t)) sim_node_sym(bn->node, "mac_init"))(channel);
+    if (bn->node->id != 0)
+    {
+        ((void (*)(uint16_t (*)(void))) sim_node_sym(bn->node, "mac_set_access_allowed_cb"))
+                (access_allowed);
+    }
+}
+
+static uint16_t send(bench_node_t *bn, uint8_t *data, uint16_t length, uint16_t dst)
+{
+    tdma_api_t *api = bn->mac;
+    uint16_t i;
+
+    (void) dst;
+
+    if (api->send == 0 || !api->is_access_allowed())
+    {
+        return 0;
+    }
+
+    for (i = 0; i < TDMA_PAYLOAD_SIZE; i++)
+    {
+        (*api->payload)[i] = i < length ? data[i] : 0;
+    }
+    api->send();
+    return 1;
+}
+
+static void poll(bench_node_t *bn)
+{
+    tdma_api_t *api = bn->mac;
+    uint16_t i;
+
+    if (api->slots == 0)
+    {
+        return;
+    }
+
+    for (i = 0; i < MAC_SLOT_NUMBER; i++)
+    {
+        if (api->slots[i].ready)
+        {
+            bench_received(bn, api->slots[i].data, MAC_PAYLOAD_SIZE);
+            api->slots[i].ready = 0;
+        }
+    }
+}
+
+static const char* object(uint16_t id)
+{
+    return id == 0 ? "tdma_c.so" : "tdma_n.so";
+}
+
+const bench_mac_t bench_tdma = {
+    .name = "tdma",
+    .object = object,
+    .init = init,
+    .send = send,
+    .poll = poll,
+    .payload_max = MAC_PAYLOAD_SIZE < TDMA_PAYLOAD_SIZE ? MAC_PAYLOAD_SIZE : TDMA_PAYLOAD_SIZE
+};
@@ -0,0 +1,90 @@
+/*
+ * Copyright  2008-2009 INRIA/SensTools
+ *
+ * <dev-team@sentools.info>
+ *
+ * This software is a set of libraries designed to develop applications
+ * for the WSN430 embedded hardware platform.
+ *
+ * This software is governed by the CeCILL license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL license and that you accept its terms.
+ */
+
+/**
+ * \file
+ * \brief Host-side radio medium simulator, replacement for the msp430 io.h
+ * \date October 2026
+ *
+ * Maps the port 1 registers on the current simulated node, and turns
+ * the other registers and the mspgcc keywords into harmless definitions.
+ */
+
+#ifndef _SIM_IO_H_
+#define _SIM_IO_H_
+
+#include <stdint.h>
+#include "sim.h"
+
+#define P1IE  (sim_port->ie)
+#define P1IES (sim_port->ies)
+#define P1IFG (sim_port->ifg)
+#define P1IN  (sim_spin(), sim_port->in)
+
+// TimerB counter, from the emulation
+uint16_t timerB_time(void);
+#define TBR timerB_time()
+
+extern volatile uint8_t sim_dummy_reg;
+#define P1SEL sim_dummy_reg
+#define P1DIR sim_dummy_reg
+#define P1OUT sim_dummy_reg
+#define P5OUT sim_dummy_reg
+#define P5DIR sim_dummy_reg
+
+#define BIT0 0x01
+#define BIT1 0x02
+#define BIT2 0x04
+#define BIT3 0x08
+#define BIT4 0x10
+#define BIT5 0x20
+#define BIT6 0x40
+#define BIT7 0x80
+
+#define critical
+#define interrupt(x) void
+#define eint()
+#define dint()
+#define nop()
+#define LPM0
+#define LPM1
+#define LPM3
+#define LPM4
+#define LPM0_EXIT
+#define LPM1_EXIT
+#define LPM3_EXIT
+#define LPM4_EXIT
+
+#endif
@@ -0,0 +1,203 @@
+/*
+ * Copyright  2008-2009 INRIA/SensTools
+ *
+ * <dev-team@sentools.info>
+ *
+ * This software is a set of libraries designed to develop applications
+ * for the WSN430 embedded hardware platform.
+ *
+ * This software is governed by the CeCILL license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL license and that you accept its terms.
+ */
+
+/**
+ * \file
+ * \brief Host-side radio medium simulator, benchmark application of the
+ * FreeRTOS MACs
+ * \date October 2026
+ *
+ * Linked in each FreeRTOS MAC shared object, built with one of RTOS_CSMA,
+ * RTOS_XMAC, RTOS_STARNET_NODE, RTOS_STARNET_SINK, RTOS_TDMA_NODE or
+ * RTOS_TDMA_COORD defined. The application task takes the packets of the benchmark from a
+ * queue and gives them to the MAC, the packets received by the MAC are
+ * given back to the benchmark.
+ */
+
+#include <io.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "semphr.h"
+
+#if defined(RTOS_CSMA) || defined(RTOS_XMAC)
+#include "mac.h"
+#elif defined(RTOS_STARNET_NODE)
+#include "starnet_node.h"
+#elif defined(RTOS_STARNET_SINK)
+#include "starnet_sink.h"
+#elif defined(RTOS_TDMA_NODE)
+#include "tdma_node.h"
+#elif defined(RTOS_TDMA_COORD)
+#include "tdma_coord.h"
+#else
+#error "no FreeRTOS MAC selected"
+#endif
+
+#include "rtos_app.h"
+
+typedef struct
+{
+    uint16_t dst;
+    uint16_t length;
+    uint8_t data[RTOS_APP_PAYLOAD_MAX];
+} app_packet_t;
+
+static xSemaphoreHandle xSPIMutex;
+static xQueueHandle xAppQ;
+static app_packet_t app_packet; // the benchmark sends one packet at a time
+static rtos_app_received_t received_cb;
+static rtos_app_sent_t sent_cb;
+
+static uint16_t send_packet(app_packet_t *pkt)
+{
+#if defined(RTOS_CSMA)
+    return mac_send(pkt->dst, pkt->data, pkt->length, pkt->dst != MAC_BROADCAST_ADDR);
+#elif defined(RTOS_XMAC)
+    return mac_send(pkt->dst, pkt->data, pkt->length);
+#elif defined(RTOS_STARNET_NODE)
+    return xSendPacket(pkt->length, pkt->data);
+#elif defined(RTOS_TDMA_NODE)
+    return mac_send(pkt->data, pkt->length);
+#else
+    // the sink doesn't generate traffic
+    (void) pkt;
+    return 0;
+#endif
+}
+
+static void vAppTask(void *pvParameters)
+{
+    app_packet_t *pkt;
+
+    (void) pvParameters;
+
+    for (;;)
+    {
+        if (xQueueReceive(xAppQ, &pkt, portMAX_DELAY) == pdTRUE)
+        {
+            sent_cb(send_packet(pkt));
+        }
+    }
+}
+
+#if defined(RTOS_CSMA) || defined(RTOS_XMAC)
+static void mac_received(uint16_t src_addr, uint8_t *data, uint16_t length, int8_t rssi)
+{
+    (void) src_addr;
+    (void) rssi;
+    received_cb(data, length);
+}
+#elif defined(RTOS_STARNET_NODE)
+void vPacketReceived(uint16_t pktLength, uint8_t *pkt)
+{
+    received_cb(pkt, pktLength);
+}
+#elif defined(RTOS_STARNET_SINK)
+void vPacketReceivedFrom(starnet_addr_t srcAddr, uint16_t pktLength, uint8_t *pkt)
+{
+    (void) srcAddr;
+    received_cb(pkt, pktLength);
+}
+#elif defined(RTOS_TDMA_NODE)
+static void mac_received(uint8_t *data, uint16_t length)
+{
+    received_cb(data, length);
+}
+#elif defined(RTOS_TDMA_COORD)
+static void mac_received(uint16_t node, uint8_t *data, uint16_t length)
+{
+    (void) node;
+    received_cb(data, length);
+}
+#endif
+
+void rtos_app_start(uint8_t channel, rtos_app_received_t received, rtos_app_sent_t sent)
+{
+    received_cb = received;
+    sent_cb = sent;
+
+    xSPIMutex = xSemaphoreCreateMutex();
+    xAppQ = xQueueCreate(1, sizeof(app_packet_t*));
+    xTaskCreate(vAppTask, (const signed char*) "app", configMINIMAL_STACK_SIZE, NULL, 1, NULL);
+
+#if defined(RTOS_CSMA) || defined(RTOS_XMAC)
+    mac_init(xSPIMutex, mac_received, channel);
+#else
+    // the other MACs have a fixed channel
+    (void) channel;
+#if defined(RTOS_STARNET_NODE) || defined(RTOS_STARNET_SINK)
+    vCreateMacTask(xSPIMutex, configMAX_PRIORITIES - 1);
+#else
+    mac_create_task(xSPIMutex);
+    mac_set_data_received_handler(mac_received);
+#if defined(RTOS_TDMA_NODE)
+    mac_send_command(MAC_ASSOCIATE);
+#endif
+#endif
+#endif
+
+    vTaskStartScheduler();
+}
+
+uint16_t rtos_app_send(const uint8_t *data, uint16_t length, uint16_t dst)
+{
+    app_packet_t *pkt = &app_packet;
+    portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
+    uint16_t i;
+
+    if (length > RTOS_APP_PAYLOAD_MAX || uxQueueMessagesWaitingFromISR(xAppQ) != 0)
+    {
+        return 0;
+    }
+
+    // not with memcpy, which counts the copies of the MAC
+    pkt->dst = dst;
+    pkt->length = length;
+    for (i = 0; i < length; i++)
+    {
+        pkt->data[i] = data[i];
+    }
+
+    // the switch to the application task is made at the end of the event
+    return xQueueSendToBackFromISR(xAppQ, &pkt, &xHigherPriorityTaskWoken) == pdTRUE;
+}
+
+void vApplicationIdleHook(void);
+void vApplicationIdleHook(void)
+{
+    vPortSleep();
+}
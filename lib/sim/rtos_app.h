@@ -0,0 +1,74 @@
+/*
+ * Copyright  2008-2009 INRIA/SensTools
+ *
+ * <dev-team@sentools.info>
+ *
+ * This software is a set of libraries designed to develop applications
+ * for the WSN430 embedded hardware platform.
+ *
+ * This software is governed by the CeCILL license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL license and that you accept its terms.
+ */
+
+/**
+ * \file
+ * \brief Host-side radio medium simulator, benchmark application of the
+ * FreeRTOS MACs
+ * \date October 2026
+ */
+
+#ifndef _RTOS_APP_H_
+#define _RTOS_APP_H_
+
+#include <stdint.h>
+
+/**
+ * Maximum payload given to rtos_send().
+ */
+#define RTOS_APP_PAYLOAD_MAX 64
+
+typedef void (*rtos_app_received_t)(const uint8_t *data, uint16_t length);
+typedef void (*rtos_app_sent_t)(uint16_t ok);
+
+/**
+ * Create the MAC and application tasks and start the scheduler, in the
+ * node context. Returns once the tasks sleep.
+ * \param channel the radio channel, for the MACs that can change it
+ * \param received called for each packet received by the MAC
+ * \param sent called when a packet has been given to the MAC, with 1 if
+ * it was accepted and 0 if it was refused
+ */
+void rtos_app_start(uint8_t channel, rtos_app_received_t received, rtos_app_sent_t sent);
+
+/**
+ * Give a packet to the application task, from an interrupt of the node.
+ * \param dst the destination address, 0xFFFF for broadcast, only used by
+ * the MACs with several possible destinations
+ * \return 1 if the packet is taken, 0 to retry later
+ */
+uint16_t rtos_app_send(const uint8_t *data, uint16_t length, uint16_t dst);
+
+#endif
@@ -0,0 +1,532 @@
+/*
+ * Copyright  2008-2009 INRIA/SensTools
+ *
+ * <dev-team@sentools.info>
+ *
+ * This software is a set of libraries designed to develop applications
+ * for the WSN430 embedded hardware platform.
+ *
+ * This software is governed by the CeCILL license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL license and that you accept its terms.
+ */
+
+/**
+ * \file
+ * \brief Host-side radio medium simulator, event kernel
+ * \date October 2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include <dlfcn.h>
+#include "sim.h"
+#include "cc1101_gdo.h"
+
+typedef struct {
+    sim_time_t time;
+    uint64_t seq;
+    sim_node_t *node;
+    sim_handler_t handler;
+    uint32_t arg;
+    uint8_t cpu;
+} event_t;
+
+sim_medium_t sim_medium = {
+    .pl_d0 = 40.,
+    .pl_exp = 3.,
+    .shadowing = 0.,
+    .noise = -100.,
+    .sensitivity = -95.,
+    .capture = 10.,
+    .cs_base = -95.,
+    .ppm = 20.
+};
+
+sim_node_t sim_nodes[SIM_NODES_MAX];
+uint16_t sim_node_count;
+sim_node_t *sim_current;
+sim_port_t *sim_port;
+uint16_t sim_verbose;
+
+static sim_port_t dummy_port;
+volatile uint8_t sim_dummy_reg;
+
+static event_t *heap;
+static uint32_t heap_len, heap_size;
+static uint64_t heap_seq;
+static sim_time_t now;
+static uint8_t in_cpu;
+static uint64_t prng;
+
+static sim_node_t *pending[SIM_NODES_MAX];
+static uint16_t pending_count;
+
+void sim_init(uint32_t seed)
+{
+    memset(sim_nodes, 0, sizeof(sim_nodes));
+    sim_node_count = 0;
+    sim_current = 0;
+    sim_port = &dummy_port;
+    heap_len = 0;
+    heap_seq = 0;
+    now = 0;
+    pending_count = 0;
+    prng = 0x9E3779B97F4A7C15ULL ^ seed;
+    if (prng == 0)
+    {
+        prng = 1;
+    }
+}
+
+double sim_random(void)
+{
+    // xorshift64*
+    prng ^= prng >> 12;
+    prng ^= prng << 25;
+    prng ^= prng >> 27;
+    return ((prng * 0x2545F4914F6CDD1DULL) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+double sim_gauss(void)
+{
+    double u = sim_random(), v = sim_random();
+    if (u < 1e-12)
+    {
+        u = 1e-12;
+    }
+    return sqrt(-2. * log(u)) * cos(2. * M_PI * v);
+}
+
+sim_time_t sim_now(void)
+{
+    if (in_cpu && sim_current && sim_current->busy_until > now)
+    {
+        return sim_current->busy_until;
+    }
+    return now;
+}
+
+void sim_spin(void)
+{
+    if (sim_current && sim_current->spin)
+    {
+        sim_current->spin(sim_current);
+    }
+}
+
+void sim_delay(sim_time_t delay)
+{
+    if (sim_current)
+    {
+        sim_current->busy_until = sim_now() + delay;
+    }
+}
+
+sim_node_t* sim_node_add(double x, double y)
+{
+    sim_node_t *node;
+
+    if (sim_node_count >= SIM_NODES_MAX)
+    {
+        return 0;
+    }
+
+    node = &sim_nodes[sim_node_count];
+    node->id = sim_node_count++;
+    node->x = x;
+    node->y = y;
+    node->rand_seed = 1;
+
+    sim_timer_reset(node);
+    sim_radio_reset(node);
+    return node;
+}
+
+void sim_node_down(sim_node_t *node)
+{
+    sim_radio_account(node);
+    sim_radio_reset(node);
+    node->radio.state = SIM_RADIO_SLEEP;
+    node->down = 1;
+}
+
+uint16_t sim_node_load(sim_node_t *node, const char *path)
+{
+    char copy[] = "/tmp/simXXXXXX";
+    char buf[4096];
+    FILE *in;
+    int fd;
+    size_t n;
+
+    // dlopen returns the same handle for the same file, so each node
+    // gets its own copy of the object to have private static variables
+    in = fopen(path, "rb");
+    if (in == 0)
+    {
+        fprintf(stderr, "sim: can't open %s\n", path);
+        return 0;
+    }
+    fd = mkstemp(copy);
+    if (fd < 0)
+    {
+        fclose(in);
+        return 0;
+    }
+    while ((n = fread(buf, 1, sizeof(buf), in)) > 0)
+    {
+        if (write(fd, buf, n) != (ssize_t) n)
+        {
+            break;
+        }
+    }
+    fclose(in);
+    close(fd);
+
+    node->handle = dlopen(copy, RTLD_NOW | RTLD_LOCAL);
+    unlink(copy);
+
+    if (node->handle == 0)
+    {
+        fprintf(stderr, "sim: %s\n", dlerror());
+        return 0;
+    }
+    return 1;
+}
+
+void* sim_node_sym(sim_node_t *node, const char *name)
+{
+    void *sym;
+
+    sym = dlsym(node->handle, name);
+    if (sym == 0)
+    {
+        fprintf(stderr, "sim: node %u, missing symbol %s\n", node->id, name);
+        exit(1);
+    }
+    return sym;
+}
+
+sim_node_t* sim_enter(sim_node_t *node)
+{
+    sim_node_t *prev = sim_current;
+    sim_current = node;
+    sim_port = node ? &node->port : &dummy_port;
+    return prev;
+}
+
+void sim_leave(sim_node_t *prev)
+{
+    sim_current = prev;
+    sim_port = prev ? &prev->port : &dummy_port;
+}
+
+void sim_port_pending(sim_node_t *node)
+{
+    if (!node->pending)
+    {
+        node->pending = 1;
+        pending[pending_count++] = node;
+    }
+}
+
+/**
+ * Run the port 1 interrupt routine of a node while flags are pending,
+ * the same way the cc1101 driver does.
+ */
+static void port_dispatch(sim_node_t *node, uint32_t arg)
+{
+    sim_node_t *prev;
+    uint8_t flags, served = 0;
+
+    (void) arg;
+
+    node->pending = 0;
+    prev = sim_enter(node);
+    for (;;)
+    {
+        flags = node->port.ifg & node->port.ie;
+        served |= flags;
+        if (flags & GDO0_PIN)
+        {
+            node->port.ifg &= ~GDO0_PIN;
+            if (node->radio.gdo0_cb)
+            {
+                node->radio.gdo0_cb();
+            }
+        }
+        else if (flags & GDO2_PIN)
+        {
+            node->port.ifg &= ~GDO2_PIN;
+            if (node->radio.gdo2_cb)
+            {
+                node->radio.gdo2_cb();
+            }
+        }
+        else
+        {
+            break;
+        }
+    }
+    if (served && node->irq_exit)
+    {
+        node->irq_exit(node);
+    }
+    sim_leave(prev);
+}
+
+static void schedule(sim_time_t at, sim_node_t *node, sim_handler_t handler, uint32_t arg, uint8_t cpu)
+{
+    uint32_t i, parent;
+    event_t ev;
+
+    if (at < now)
+    {
+        at = now;
+    }
+
+    if (heap_len == heap_size)
+    {
+        heap_size = heap_size ? 2 * heap_size : 1024;
+        heap = realloc(heap, heap_size * sizeof(event_t));
+        if (heap == 0)
+        {
+            fprintf(stderr, "sim: out of memory\n");
+            exit(1);
+        }
+    }
+
+    ev.time = at;
+    ev.seq = heap_seq++;
+    ev.node = node;
+    ev.handler = handler;
+    ev.arg = arg;
+    ev.cpu = cpu;
+
+    // sift up, ties are broken by insertion order
+    i = heap_len++;
+    while (i > 0)
+    {
+        parent = (i - 1) / 2;
+        if (heap[parent].time < at || (heap[parent].time == at && heap[parent].seq < ev.seq))
+        {
+            break;
+        }
+        heap[i] = heap[parent];
+        i = parent;
+    }
+    heap[i] = ev;
+}
+
+void sim_schedule(sim_time_t at, sim_node_t *node, sim_handler_t handler, uint32_t arg)
+{
+    schedule(at, node, handler, arg, 0);
+}
+
+void sim_schedule_cpu(sim_time_t at, sim_node_t *node, sim_handler_t handler, uint32_t arg)
+{
+    schedule(at, node, handler, arg, 1);
+}
+
+static event_t pop(void)
+{
+    event_t top, last;
+    uint32_t i, child;
+
+    top = heap[0];
+    last = heap[--heap_len];
+
+    // sift down
+    i = 0;
+    while ((child = 2 * i + 1) < heap_len)
+    {
+        if (child + 1 < heap_len && (heap[child + 1].time < heap[child].time
+                || (heap[child + 1].time == heap[child].time && heap[child + 1].seq < heap[child].seq)))
+        {
+            child++;
+        }
+        if (last.time < heap[child].time || (last.time == heap[child].time && last.seq < heap[child].seq))
+        {
+            break;
+        }
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = last;
+    return top;
+}
+
+void sim_run(sim_time_t until, sim_handler_t hook)
+{
+    sim_node_t *prev, *node;
+    event_t ev;
+
+    while (heap_len > 0 && heap[0].time <= until)
+    {
+        ev = pop();
+        now = ev.time;
+
+        if (ev.node && ev.node->down)
+        {
+            continue;
+        }
+
+        if (ev.cpu && ev.node && ev.node->busy_until > now)
+        {
+            // the MCU is busy waiting, the interrupt is served later
+            schedule(ev.node->busy_until, ev.node, ev.handler, ev.arg, 1);
+            continue;
+        }
+
+        in_cpu = ev.cpu;
+        prev = sim_enter(ev.node);
+        ev.handler(ev.node, ev.arg);
+        if (ev.cpu && ev.node && ev.node->irq_exit && ev.handler != port_dispatch)
+        {
+            ev.node->irq_exit(ev.node);
+        }
+        sim_leave(prev);
+        in_cpu = 0;
+
+        // the handler may have enabled an interrupt whose flag was set
+        if (ev.node)
+        {
+            sim_port_pending(ev.node);
+        }
+
+        while (pending_count > 0)
+        {
+            node = pending[--pending_count];
+            if (node->down)
+            {
+                continue;
+            }
+            if (node->busy_until > now)
+            {
+                // still pending, the flag is cleared by the dispatch
+                sim_schedule_cpu(node->busy_until, node, port_dispatch, 0);
+                continue;
+            }
+            in_cpu = 1;
+            port_dispatch(node, 0);
+            in_cpu = 0;
+        }
+
+        if (hook && ev.node)
+        {
+            prev = sim_enter(ev.node);
+            hook(ev.node, 0);
+            sim_leave(prev);
+        }
+    }
+    if (now < until)
+    {
+        now = until;
+    }
+}
+
+void sim_serial_number(uint8_t raw[8])
+{
+    uint16_t addr = sim_current->id + 1;
+
+    // CRC, serial5 ... serial0, family
+    memset(raw, 0, 8);
+    raw[5] = addr >> 8;
+    raw[6] = addr & 0xFF;
+    raw[7] = 0x01;
+}
+
+/*
+ * The libc functions below are called by the MAC code and are
+ * overridden so that they act per node.
+ */
+
+int printf(const char *fmt, ...)
+{
+    va_list ap;
+    int ret;
+
+    if (!sim_verbose)
+    {
+        return 0;
+    }
+
+    fprintf(stderr, "%12.6f ", sim_now() / 1e9);
+    if (sim_current)
+    {
+        fprintf(stderr, "[%3u] ", sim_current->id);
+    }
+    va_start(ap, fmt);
+    ret = vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    return ret;
+}
+
+int puts(const char *s)
+{
+    return printf("%s\n", s);
+}
+
+/*
+ * The node code is built with memcpy and memmove renamed to these, to
+ * count the bytes it copies around.
+ */
+void *sim_memcpy(void *dst, const void *src, size_t n)
+{
+    if (sim_current)
+    {
+        sim_current->copied += n;
+    }
+    return memcpy(dst, src, n);
+}
+
+void *sim_memmove(void *dst, const void *src, size_t n)
+{
+    if (sim_current)
+    {
+        sim_current->copied += n;
+    }
+    return memmove(dst, src, n);
+}
+
+// same generator as the msp430 libc, RAND_MAX is 0x7FFF there
+int rand(void)
+{
+    uint32_t *seed = sim_current ? &sim_current->rand_seed : &sim_nodes[0].rand_seed;
+    *seed = *seed * 1103515245 + 12345;
+    return (*seed >> 16) & 0x7FFF;
+}
+
+void srand(unsigned int seed)
+{
+    if (sim_current)
+    {
+        sim_current->rand_seed = seed;
+    }
+}
@@ -0,0 +1,299 @@
+/*
+ * Copyright  2008-2009 INRIA/SensTools
+ *
+ * <dev-team@sentools.info>
+ *
+ * This software is a set of libraries designed to develop applications
+ * for the WSN430 embedded hardware platform.
+ *
+ * This software is governed by the CeCILL license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL license and that you accept its terms.
+ */
+
+/**
+ * \file
+ * \brief Host-side radio medium simulator, kernel interface
+ * \date October 2026
+ *
+ * The simulator runs the unmodified MAC sources on the host. Each
+ * simulated node loads its own copy of a MAC shared object, so that
+ * all its static state is private, and gets its own timerB, CC1101
+ * and port 1 emulation. Everything is driven by a single discrete
+ * event queue, with nanosecond resolution.
+ */
+
+#ifndef _SIM_H_
+#define _SIM_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define SIM_NODES_MAX 256
+
+#define SIM_NS(x)  ((sim_time_t)(x))
+#define SIM_US(x)  ((sim_time_t)(x)*1000ULL)
+#define SIM_MS(x)  ((sim_time_t)(x)*1000000ULL)
+#define SIM_S(x)   ((sim_time_t)(x)*1000000000ULL)
+
+typedef uint64_t sim_time_t;
+
+typedef struct sim_node sim_node_t;
+typedef struct sim_tx sim_tx_t;
+
+/**
+ * Event handler, called in the context of the node it was scheduled for.
+ * \param node the node
+ * \param arg the argument given at schedule time
+ */
+typedef void (*sim_handler_t)(sim_node_t *node, uint32_t arg);
+
+/**
+ * MSP430 port 1 registers, the only ones the radio drives.
+ */
+typedef struct {
+    uint8_t ie, ies, ifg, in;
+} sim_port_t;
+
+/**
+ * TimerB emulation state.
+ */
+typedef struct {
+    double rate;        // nominal tick rate in Hz, 0 when stopped
+    double ppm;         // crystal error
+    double origin;      // tick count at time 0 (fractional)
+    uint16_t frozen;    // counter value when stopped
+    uint16_t ccr[7];
+    uint16_t period[7];
+    uint16_t (*cb[8])(void);
+    uint32_t gen[7];    // invalidates pending alarm events
+    uint8_t armed;      // alarms enabled, one bit per CCR
+} sim_timer_t;
+
+/**
+ * A frame on the air.
+ */
+struct sim_tx {
+    sim_node_t *src;
+    uint8_t channel;
+    double power;       // dBm at the antenna
+    sim_time_t start, sync, end;
+    uint8_t data[64];
+    uint8_t length;     // bytes in data, length byte included
+    uint8_t aborted;
+    uint8_t used;
+};
+
+/**
+ * CC1101 emulation state.
+ */
+typedef struct {
+    uint8_t regs[0x2F];
+    uint8_t patable;
+    uint8_t state;      // one of the SIM_RADIO_x states
+    uint8_t wor;        // RX entered from a WOR wake up
+    uint8_t sync;       // sync word sent/received, until end of packet
+    uint8_t lqi, rssi;  // last packet status
+    uint8_t rxfifo[64];
+    uint8_t rxlen;
+    uint8_t rxpos;      // bytes of the locked frame already in rxfifo
+    uint8_t txfifo[64];
+    uint8_t txlen;
+    sim_time_t ready;   // time at which RX is effective
+    sim_time_t since;   // time of the last state change
+    sim_time_t wor_next; // next WOR wake up
+    sim_tx_t *lock;     // frame being received
+    sim_tx_t *tx;       // frame being sent
+    uint32_t gen;       // invalidates pending radio events
+    uint16_t (*gdo0_cb)(void);
+    uint16_t (*gdo2_cb)(void);
+    // statistics
+    sim_time_t time_rx, time_tx;
+    uint32_t frames_tx;
+} sim_radio_t;
+
+enum {
+    SIM_RADIO_SLEEP,
+    SIM_RADIO_IDLE,
+    SIM_RADIO_RX,
+    SIM_RADIO_TX,
+    SIM_RADIO_FSTXON,
+    SIM_RADIO_RX_OVERFLOW,
+    SIM_RADIO_TX_UNDERFLOW
+};
+
+struct sim_node {
+    uint16_t id;
+    double x, y;        // position in meters
+    sim_port_t port;
+    sim_timer_t timer;
+    sim_radio_t radio;
+    uint32_t rand_seed;
+    uint8_t pending;    // port 1 interrupts may need dispatching
+    uint8_t down;       // powered off, its events are dropped
+    sim_time_t busy_until; // end of the current busy wait of the MCU
+    uint32_t copied;    // bytes moved by memcpy/memmove in the node code
+    void *handle;       // MAC shared object
+    void *app;          // application data
+    // set by an RTOS port (OS/FreeRTOS/Source/portable/GCC/Sim), may be 0
+    void (*spin)(sim_node_t *node);     // a register is read by the node code
+    void (*irq_exit)(sim_node_t *node); // after each interrupt of the node
+};
+
+/**
+ * Medium parameters. Powers are in dBm, distances in meters.
+ */
+typedef struct {
+    double pl_d0;       // path loss at 1m
+    double pl_exp;      // path loss exponent
+    double shadowing;   // per link log-normal shadowing deviation
+    double noise;       // noise floor
+    double sensitivity; // minimum power to detect a sync word
+    double capture;     // SINR needed to keep a frame
+    double cs_base;     // carrier sense threshold for CARRIER_SENSE_ABS_THR=0
+    double ppm;         // maximum crystal error, drawn per node
+} sim_medium_t;
+
+extern sim_medium_t sim_medium;
+extern sim_node_t sim_nodes[SIM_NODES_MAX];
+extern uint16_t sim_node_count;
+extern sim_node_t *sim_current;
+extern sim_port_t *sim_port;
+extern uint16_t sim_verbose;
+
+/**
+ * Initialize the kernel.
+ * \param seed the random generator seed
+ */
+void sim_init(uint32_t seed);
+
+/**
+ * Add a node to the simulation.
+ * \return the node, or 0 if there are too many
+ */
+sim_node_t* sim_node_add(double x, double y);
+
+/**
+ * Power a node off for the rest of the simulation.
+ */
+void sim_node_down(sim_node_t *node);
+
+/**
+ * Load a private copy of a shared object for a node.
+ * \return 1 if ok, 0 if error
+ */
+uint16_t sim_node_load(sim_node_t *node, const char *path);
+
+/**
+ * Find a symbol in the node's shared object.
+ */
+void* sim_node_sym(sim_node_t *node, const char *name);
+
+/**
+ * Enter a node context. Nested calls are allowed.
+ * \return the previous context, to be given to sim_leave()
+ */
+sim_node_t* sim_enter(sim_node_t *node);
+
+/**
+ * Leave a node context, dispatching its pending port 1 interrupts.
+ */
+void sim_leave(sim_node_t *prev);
+
+/**
+ * Schedule an event.
+ * \param at the absolute time
+ * \param node the node context the handler runs in
+ * \param handler the function to call
+ * \param arg its argument
+ */
+void sim_schedule(sim_time_t at, sim_node_t *node, sim_handler_t handler, uint32_t arg);
+
+/**
+ * Schedule an event handled by the node's MCU, that is delayed while the
+ * MCU is busy waiting.
+ */
+void sim_schedule_cpu(sim_time_t at, sim_node_t *node, sim_handler_t handler, uint32_t arg);
+
+/**
+ * memcpy and memmove of the node code, which count the bytes copied.
+ */
+void *sim_memcpy(void *dst, const void *src, size_t n);
+void *sim_memmove(void *dst, const void *src, size_t n);
+
+/**
+ * Run the simulation until the given time.
+ * \param hook called after each event, in its node context (may be 0)
+ */
+void sim_run(sim_time_t until, sim_handler_t hook);
+
+/**
+ * Current simulated time, as seen by the current node's MCU.
+ */
+sim_time_t sim_now(void);
+
+/**
+ * Let time pass for the current node's MCU, for the busy waits of the
+ * code being simulated. Its interrupts are delayed meanwhile.
+ */
+void sim_delay(sim_time_t delay);
+
+/**
+ * Account a register read of the node code, called by the hardware
+ * emulation. An RTOS task busy waiting on a register lets time pass.
+ */
+void sim_spin(void);
+
+/**
+ * Simulator random number generator.
+ * \return a uniform number in [0,1)
+ */
+double sim_random(void);
+
+/**
+ * Gaussian random number, zero mean, unit deviation.
+ */
+double sim_gauss(void);
+
+/**
+ * Mark a node for port 1 interrupt dispatch after the current event.
+ */
+void sim_port_pending(sim_node_t *node);
+
+/**
+ * Get the serial number of the current node, for the ds2411 emulation.
+ * The address derived from it by the MACs is the node index plus one.
+ */
+void sim_serial_number(uint8_t raw[8]);
+
+// radio medium, sim_cc1101.c
+void sim_radio_reset(sim_node_t *node);
+double sim_link_gain(const sim_node_t *a, const sim_node_t *b);
+void sim_radio_account(sim_node_t *node);
+
+// timer, sim_timerB.c
+void sim_timer_reset(sim_node_t *node);
+
+#endif
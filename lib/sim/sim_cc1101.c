@@ -0,0 +1,1032 @@
+/*
+ * Copyright  2008-2009 INRIA/SensTools
+ *
+ * <dev-team@sentools.info>
+ *
+ * This software is a set of libraries designed to develop applications
+ * for the WSN430 embedded hardware platform.
+ *
+ * This software is governed by the CeCILL license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL license and that you accept its terms.
+ */
+
+/**
+ * \file
+ * \brief Host-side radio medium simulator, CC1101 and medium emulation
+ * \date October 2026
+ *
+ * Implements the cc1101 driver API for the current node. The model
+ * covers what the MAC layers rely on: the main radio control state
+ * machine with its RXOFF/TXOFF modes, settling and calibration delays,
+ * clear channel assessment, the FIFOs, the SYNC_WORD GDO signal with
+ * port 1 edge interrupts, appended status bytes and Wake On Radio.
+ *
+ * The medium uses a log-distance path loss. A receiver locks on a frame
+ * when it hears its sync word above the sensitivity, and the frame is
+ * received with a correct CRC if the signal to interference and noise
+ * ratio stays above the capture threshold for its whole duration.
+ */
+
+#include <math.h>
+#include <string.h>
+#include "sim.h"
+#include "cc1101.h"
+#include "cc1101_gdo.h"
+#include "cc1101_globals.h"
+
+#define TX_POOL 1024
+
+// settling times, from the datasheet
+#define IDLE_TO_RXTX      SIM_NS(88400)
+#define IDLE_TO_RXTX_CAL  SIM_NS(809000)
+#define FSTXON_TO_TX      SIM_NS(31000)
+#define RX_TO_TX          SIM_NS(31000)
+#define TX_TO_RX          SIM_NS(21500)
+#define WOR_TO_RX         SIM_NS(240000)
+#define CALIBRATE         SIM_NS(721000)
+
+static const uint8_t reg_defaults[0x2F] = {
+    [CC1101_REG_IOCFG2] = CC1101_REG_IOCFG2_DEFAULT,
+    [CC1101_REG_IOCFG1] = CC1101_REG_IOCFG1_DEFAULT,
+    [CC1101_REG_IOCFG0] = CC1101_REG_IOCFG0_DEFAULT,
+    [CC1101_REG_FIFOTHR] = CC1101_REG_FIFOTHR_DEFAULT,
+    [CC1101_REG_SYNC1] = CC1101_REG_SYNC1_DEFAULT,
+    [CC1101_REG_SYNC0] = CC1101_REG_SYNC0_DEFAULT,
+    [CC1101_REG_PKTLEN] = CC1101_REG_PKTLEN_DEFAULT,
+    [CC1101_REG_PKTCTRL1] = CC1101_REG_PKTCTRL1_DEFAULT,
+    [CC1101_REG_PKTCTRL0] = CC1101_REG_PKTCTRL0_DEFAULT,
+    [CC1101_REG_ADDR] = CC1101_REG_ADDR_DEFAULT,
+    [CC1101_REG_CHANNR] = CC1101_REG_CHANNR_DEFAULT,
+    [CC1101_REG_FSCTRL1] = CC1101_REG_FSCTRL1_DEFAULT,
+    [CC1101_REG_FSCTRL0] = CC1101_REG_FSCTRL0_DEFAULT,
+    [CC1101_REG_FREQ2] = CC1101_REG_FREQ2_DEFAULT,
+    [CC1101_REG_FREQ1] = CC1101_REG_FREQ1_DEFAULT,
+    [CC1101_REG_FREQ0] = CC1101_REG_FREQ0_DEFAULT,
+    [CC1101_REG_MDMCFG4] = CC1101_REG_MDMCFG4_DEFAULT,
+    [CC1101_REG_MDMCFG3] = CC1101_REG_MDMCFG3_DEFAULT,
+    [CC1101_REG_MDMCFG2] = CC1101_REG_MDMCFG2_DEFAULT,
+    [CC1101_REG_MDMCFG1] = CC1101_REG_MDMCFG1_DEFAULT,
+    [CC1101_REG_MDMCFG0] = CC1101_REG_MDMCFG0_DEFAULT,
+    [CC1101_REG_DEVIATN] = CC1101_REG_DEVIATN_DEFAULT,
+    [CC1101_REG_MCSM2] = CC1101_REG_MCSM2_DEFAULT,
+    [CC1101_REG_MCSM1] = CC1101_REG_MCSM1_DEFAULT,
+    [CC1101_REG_MCSM0] = CC1101_REG_MCSM0_DEFAULT,
+    [CC1101_REG_FOCCFG] = CC1101_REG_FOCCFG_DEFAULT,
+    [CC1101_REG_BSCFG] = CC1101_REG_BSCFG_DEFAULT,
+    [CC1101_REG_AGCCTRL2] = CC1101_REG_AGCCTRL2_DEFAULT,
+    [CC1101_REG_AGCCTRL1] = CC1101_REG_AGCCTRL1_DEFAULT,
+    [CC1101_REG_AGCCTRL0] = CC1101_REG_AGCCTRL0_DEFAULT,
+    [CC1101_REG_WOREVT1] = CC1101_REG_WOREVT1_DEFAULT,
+    [CC1101_REG_WOREVT0] = CC1101_REG_WOREVT0_DEFAULT,
+    [CC1101_REG_WORCTRL] = CC1101_REG_WORCTRL_DEFAULT,
+    [CC1101_REG_FREND1] = CC1101_REG_FREND1_DEFAULT,
+    [CC1101_REG_FREND0] = CC1101_REG_FREND0_DEFAULT,
+    [CC1101_REG_FSCAL3] = CC1101_REG_FSCAL3_DEFAULT,
+    [CC1101_REG_FSCAL2] = CC1101_REG_FSCAL2_DEFAULT,
+    [CC1101_REG_FSCAL1] = CC1101_REG_FSCAL1_DEFAULT,
+    [CC1101_REG_FSCAL0] = CC1101_REG_FSCAL0_DEFAULT,
+    [CC1101_REG_RCCTRL1] = CC1101_REG_RCCTRL1_DEFAULT,
+    [CC1101_REG_RCCTRL0] = CC1101_REG_RCCTRL0_DEFAULT,
+};
+
+// RX timeout coefficients, indexed by WOR_RES and RX_TIME
+static const double rx_time_coef[4][7] = {
+    {3.6058, 1.8029, 0.9014, 0.4507, 0.2254, 0.1127, 0.0563},
+    {18.0288, 9.0144, 4.5072, 2.2536, 1.1268, 0.5634, 0.2817},
+    {32.4519, 16.2260, 8.1130, 4.0565, 2.0282, 1.0141, 0.5071},
+    {46.8750, 23.4375, 11.7188, 5.8594, 2.9297, 1.4648, 0.7324}
+};
+
+static const struct {
+    uint8_t pa;
+    int8_t dbm;
+} pa_table[] = {
+    {0x03, -30}, {0x17, -20}, {0x1D, -15}, {0x26, -10}, {0x37, -6},
+    {0x50, 0}, {0x86, 5}, {0xCD, 7}, {0xC5, 10}, {0xC0, 12}
+};
+
+static sim_tx_t tx_pool[TX_POOL];
+static double gain[SIM_NODES_MAX][SIM_NODES_MAX];
+static uint8_t gain_set[SIM_NODES_MAX][SIM_NODES_MAX];
+
+static void tx_start(sim_node_t *node, uint32_t gen);
+static void tx_sync(sim_node_t *node, uint32_t gen);
+static void tx_end(sim_node_t *node, uint32_t gen);
+static void wor_wake(sim_node_t *node, uint32_t gen);
+static void wor_timeout(sim_node_t *node, uint32_t gen);
+
+/*----------------------- configuration decoding -----------------------*/
+
+static double byte_time(const sim_radio_t *r)
+{
+    double rate;
+    rate = (256. + r->regs[CC1101_REG_MDMCFG3]) * (1 << (r->regs[CC1101_REG_MDMCFG4] & 0x0F))
+            * 26e6 / (double) (1 << 28);
+    return 8e9 / rate;
+}
+
+static uint16_t preamble_bytes(const sim_radio_t *r)
+{
+    static const uint8_t nb[8] = {2, 3, 4, 6, 8, 12, 16, 24};
+    uint16_t sync;
+
+    switch (r->regs[CC1101_REG_MDMCFG2] & 0x3)
+    {
+        case 0:
+            sync = 0;
+            break;
+        case 3:
+            sync = 4;
+            break;
+        default:
+            sync = 2;
+    }
+    return nb[(r->regs[CC1101_REG_MDMCFG1] >> 4) & 0x7] + sync;
+}
+
+static uint16_t crc_bytes(const sim_radio_t *r)
+{
+    return (r->regs[CC1101_REG_PKTCTRL0] & 0x04) ? 2 : 0;
+}
+
+static double tx_power(const sim_radio_t *r)
+{
+    uint16_t i;
+    for (i = 0; i < sizeof(pa_table) / sizeof(pa_table[0]); i++)
+    {
+        if (pa_table[i].pa == r->patable)
+        {
+            return pa_table[i].dbm;
+        }
+    }
+    return 0.;
+}
+
+static sim_time_t wor_period(const sim_radio_t *r)
+{
+    uint16_t event0 = (r->regs[CC1101_REG_WOREVT1] << 8) | r->regs[CC1101_REG_WOREVT0];
+    uint16_t res = r->regs[CC1101_REG_WORCTRL] & 0x3;
+    return (sim_time_t) (750. / 26e6 * event0 * (1 << (5 * res)) * 1e9);
+}
+
+static sim_time_t wor_rx_time(const sim_radio_t *r)
+{
+    uint16_t event0 = (r->regs[CC1101_REG_WOREVT1] << 8) | r->regs[CC1101_REG_WOREVT0];
+    uint16_t res = r->regs[CC1101_REG_WORCTRL] & 0x3;
+    uint16_t rx_time = r->regs[CC1101_REG_MCSM2] & 0x7;
+
+    if (rx_time == 7)
+    {
+        return 0;
+    }
+    return (sim_time_t) (event0 * rx_time_coef[res][rx_time] * 1e3);
+}
+
+/*------------------------------ medium --------------------------------*/
+
+double sim_link_gain(const sim_node_t *a, const sim_node_t *b)
+{
+    double d;
+
+    if (!gain_set[a->id][b->id])
+    {
+        d = hypot(a->x - b->x, a->y - b->y);
+        if (d < 1.)
+        {
+            d = 1.;
+        }
+        gain[a->id][b->id] = -(sim_medium.pl_d0 + 10. * sim_medium.pl_exp * log10(d))
+                + sim_medium.shadowing * sim_gauss();
+        gain[b->id][a->id] = gain[a->id][b->id];
+        gain_set[a->id][b->id] = gain_set[b->id][a->id] = 1;
+    }
+    return gain[a->id][b->id];
+}
+
+static double rx_power(const sim_node_t *node, const sim_tx_t *tx)
+{
+    return tx->power + sim_link_gain(tx->src, node);
+}
+
+static double mw(double dbm)
+{
+    return pow(10., dbm / 10.);
+}
+
+/**
+ * Total power heard by a node now, in dBm.
+ */
+static double channel_power(const sim_node_t *node)
+{
+    sim_time_t now = sim_now();
+    double sum = mw(sim_medium.noise);
+    uint16_t i;
+
+    for (i = 0; i < TX_POOL; i++)
+    {
+        sim_tx_t *tx = &tx_pool[i];
+        if (tx->used && tx->src != node && tx->channel == node->radio.regs[CC1101_REG_CHANNR]
+                && tx->start <= now && now < tx->end)
+        {
+            sum += mw(rx_power(node, tx));
+        }
+    }
+    return 10. * log10(sum);
+}
+
+/**
+ * Signal to interference and noise ratio of a frame at a node, taking
+ * every frame overlapping it between two instants into account.
+ */
+static double sinr(const sim_node_t *node, const sim_tx_t *tx, sim_time_t from, sim_time_t to)
+{
+    double sum = mw(sim_medium.noise);
+    uint16_t i;
+
+    for (i = 0; i < TX_POOL; i++)
+    {
+        sim_tx_t *other = &tx_pool[i];
+        if (other->used && other != tx && other->src != node && other->channel == tx->channel
+                && other->start < to && other->end > from)
+        {
+            sum += mw(rx_power(node, other));
+        }
+    }
+    return rx_power(node, tx) - 10. * log10(sum);
+}
+
+static uint8_t rssi_reg(double dbm)
+{
+    double v = (dbm + 74.) * 2.;
+    if (v > 127.)
+    {
+        v = 127.;
+    }
+    if (v < -128.)
+    {
+        v = -128.;
+    }
+    return (uint8_t) (int8_t) lrint(v);
+}
+
+static sim_tx_t* tx_alloc(void)
+{
+    sim_time_t now = sim_now();
+    uint16_t i;
+
+    for (i = 0; i < TX_POOL; i++)
+    {
+        sim_tx_t *tx = &tx_pool[i];
+        // old frames are kept a little for the interference computation
+        if (!tx->used || (tx->end + SIM_MS(10) < now && tx->src->radio.tx != tx))
+        {
+            memset(tx, 0, sizeof(*tx));
+            tx->used = 1;
+            return tx;
+        }
+    }
+    return 0;
+}
+
+/*--------------------------- state machine ----------------------------*/
+
+static void gdo_update(sim_node_t *node)
+{
+    static const uint8_t pins[2] = {GDO0_PIN, GDO2_PIN};
+    sim_radio_t *r = &node->radio;
+    uint8_t cfg[2], level, i;
+
+    cfg[0] = r->regs[CC1101_REG_IOCFG0];
+    cfg[1] = r->regs[CC1101_REG_IOCFG2];
+
+    for (i = 0; i < 2; i++)
+    {
+        switch (cfg[i] & 0x3F)
+        {
+            case CC1101_GDOx_SYNC_WORD:
+                level = r->sync;
+                break;
+            default:
+                level = 0;
+        }
+        if (cfg[i] & 0x40)
+        {
+            level = !level;
+        }
+
+        if (level != !!(node->port.in & pins[i]))
+        {
+            if (level)
+            {
+                node->port.in |= pins[i];
+            }
+            else
+            {
+                node->port.in &= ~pins[i];
+            }
+            if (level != !!(node->port.ies & pins[i]))
+            {
+                node->port.ifg |= pins[i];
+                sim_port_pending(node);
+            }
+        }
+    }
+}
+
+static void set_sync(sim_node_t *node, uint8_t sync)
+{
+    node->radio.sync = sync;
+    gdo_update(node);
+}
+
+static void set_state(sim_node_t *node, uint8_t state)
+{
+    sim_radio_t *r = &node->radio;
+
+    sim_radio_account(node);
+    r->state = state;
+    r->gen++;
+}
+
+void sim_radio_account(sim_node_t *node)
+{
+    sim_radio_t *r = &node->radio;
+    sim_time_t now = sim_now();
+
+    if (r->state == SIM_RADIO_RX)
+    {
+        r->time_rx += now - r->since;
+    }
+    else if (r->state == SIM_RADIO_TX)
+    {
+        r->time_tx += now - r->since;
+    }
+    r->since = now;
+}
+
+static void rx_complete(sim_node_t *node, sim_tx_t *tx);
+
+/**
+ * Stop any ongoing transmission or reception, before a state change.
+ */
+static void radio_stop(sim_node_t *node)
+{
+    sim_radio_t *r = &node->radio;
+    sim_tx_t *tx = r->tx;
+    uint16_t i;
+
+    if (tx)
+    {
+        r->tx = 0;
+        tx->aborted = 1;
+        tx->end = sim_now();
+        for (i = 0; i < sim_node_count; i++)
+        {
+            if (sim_nodes[i].radio.lock == tx)
+            {
+                rx_complete(&sim_nodes[i], tx);
+            }
+        }
+    }
+    r->lock = 0;
+    r->rxpos = 0;
+    r->wor = 0;
+    set_sync(node, 0);
+}
+
+static void tx_begin(sim_node_t *node, sim_time_t delay)
+{
+    sim_radio_t *r = &node->radio;
+
+    radio_stop(node);
+    set_state(node, SIM_RADIO_TX);
+    sim_schedule(sim_now() + delay, node, tx_start, r->gen);
+}
+
+static void rx_begin(sim_node_t *node, sim_time_t delay)
+{
+    sim_radio_t *r = &node->radio;
+    uint8_t wor = r->wor;
+
+    radio_stop(node);
+    set_state(node, SIM_RADIO_RX);
+    r->wor = wor;
+    r->ready = sim_now() + delay;
+}
+
+static void wake(sim_node_t *node)
+{
+    // any SPI access wakes the chip up from SLEEP, and stops WOR
+    if (node->radio.state == SIM_RADIO_SLEEP)
+    {
+        node->radio.wor = 0;
+        set_state(node, SIM_RADIO_IDLE);
+    }
+}
+
+static uint16_t channel_busy(sim_node_t *node)
+{
+    sim_radio_t *r = &node->radio;
+    uint8_t mode = (r->regs[CC1101_REG_MCSM1] >> 4) & 0x3;
+    int8_t thr = r->regs[CC1101_REG_AGCCTRL1] & 0x0F;
+
+    if (thr & 0x8)
+    {
+        thr -= 16;
+    }
+
+    if ((mode & CC1101_CCA_MODE_RSSI) && thr != -8
+            && channel_power(node) > sim_medium.cs_base + thr)
+    {
+        return 1;
+    }
+    if ((mode & CC1101_CCA_MODE_PKT_RX) && r->lock)
+    {
+        return 1;
+    }
+    return 0;
+}
+
+static void tx_start(sim_node_t *node, uint32_t gen)
+{
+    sim_radio_t *r = &node->radio;
+    sim_tx_t *tx;
+
+    if (gen != r->gen)
+    {
+        return;
+    }
+
+    tx = tx_alloc();
+    if (tx == 0)
+    {
+        return;
+    }
+    tx->src = node;
+    tx->channel = r->regs[CC1101_REG_CHANNR];
+    tx->power = tx_power(r);
+    tx->start = sim_now();
+    tx->sync = tx->start + (sim_time_t) (preamble_bytes(r) * byte_time(r));
+    tx->end = ~(sim_time_t) 0;
+    r->tx = tx;
+    r->frames_tx++;
+
+    sim_schedule(tx->sync, node, tx_sync, gen);
+}
+
+static void tx_sync(sim_node_t *node, uint32_t gen)
+{
+    sim_radio_t *r = &node->radio;
+    sim_tx_t *tx = r->tx;
+    uint16_t i, length;
+
+    if (gen != r->gen || tx == 0)
+    {
+        return;
+    }
+
+    // the packet must be in the FIFO once the sync word is sent
+    if ((r->regs[CC1101_REG_PKTCTRL0] & 0x3) == CC1101_PACKET_LENGTH_FIXED)
+    {
+        length = r->regs[CC1101_REG_PKTLEN];
+    }
+    else
+    {
+        length = r->txlen ? r->txfifo[0] + 1 : 1;
+    }
+    if (r->txlen == 0 || r->txlen < length || length > sizeof(tx->data))
+    {
+        radio_stop(node);
+        set_state(node, SIM_RADIO_TX_UNDERFLOW);
+        return;
+    }
+
+    memcpy(tx->data, r->txfifo, length);
+    tx->length = length;
+    r->txlen -= length;
+    memmove(r->txfifo, r->txfifo + length, r->txlen);
+    tx->end = tx->sync + (sim_time_t) ((length + crc_bytes(r)) * byte_time(r));
+
+    set_sync(node, 1);
+
+    // the listening nodes that hear this sync word lock on the frame
+    for (i = 0; i < sim_node_count; i++)
+    {
+        sim_node_t *rx = &sim_nodes[i];
+        if (rx == node || rx->radio.state != SIM_RADIO_RX || rx->radio.lock || rx->radio.tx
+                || rx->radio.regs[CC1101_REG_CHANNR] != tx->channel || rx->radio.ready > tx->sync
+                || rx_power(rx, tx) < sim_medium.sensitivity
+                || sinr(rx, tx, tx->start, tx->sync) < sim_medium.capture)
+        {
+            continue;
+        }
+        rx->radio.lock = tx;
+        set_sync(rx, 1);
+    }
+
+    sim_schedule(tx->end, node, tx_end, gen);
+}
+
+static void tx_end(sim_node_t *node, uint32_t gen)
+{
+    sim_radio_t *r = &node->radio;
+    sim_tx_t *tx = r->tx;
+    uint16_t i;
+
+    if (gen != r->gen || tx == 0)
+    {
+        return;
+    }
+
+    r->tx = 0;
+    set_sync(node, 0);
+
+    for (i = 0; i < sim_node_count; i++)
+    {
+        if (sim_nodes[i].radio.lock == tx)
+        {
+            rx_complete(&sim_nodes[i], tx);
+        }
+    }
+
+    switch (r->regs[CC1101_REG_MCSM1] & 0x3)
+    {
+        case CC1101_TXOFF_MODE_IDLE:
+            set_state(node, SIM_RADIO_IDLE);
+            break;
+        case CC1101_TXOFF_MODE_FSTXON:
+            set_state(node, SIM_RADIO_FSTXON);
+            break;
+        case CC1101_TXOFF_MODE_STAY_TX:
+            tx_begin(node, 0);
+            break;
+        case CC1101_TXOFF_MODE_RX:
+            rx_begin(node, TX_TO_RX);
+            break;
+    }
+}
+
+static void rx_complete(sim_node_t *node, sim_tx_t *tx)
+{
+    sim_radio_t *r = &node->radio;
+    uint8_t crc_ok, append, lqi;
+    double power;
+
+    r->lock = 0;
+
+    power = rx_power(node, tx);
+    crc_ok = !tx->aborted && sinr(node, tx, tx->sync, tx->end) >= sim_medium.capture;
+    append = (r->regs[CC1101_REG_PKTCTRL1] & 0x04) != 0;
+    // lower is better, as on the chip
+    lqi = (uint8_t) fmin(0x7F, fmax(0., (30. - (power - sim_medium.sensitivity)) * 2.));
+
+    r->lqi = (crc_ok ? 0x80 : 0) | lqi;
+    r->rssi = rssi_reg(power);
+
+    if (crc_ok || !(r->regs[CC1101_REG_PKTCTRL1] & 0x08))
+    {
+        // the beginning may be in the FIFO already, see rx_fill()
+        if (r->rxlen + tx->length - r->rxpos + (append ? 2 : 0) > sizeof(r->rxfifo))
+        {
+            r->rxpos = 0;
+            set_sync(node, 0);
+            set_state(node, SIM_RADIO_RX_OVERFLOW);
+            return;
+        }
+        memcpy(r->rxfifo + r->rxlen, tx->data + r->rxpos, tx->length - r->rxpos);
+        r->rxlen += tx->length - r->rxpos;
+        if (!crc_ok && tx->length > 1)
+        {
+            // corrupt the payload, not the length
+            r->rxfifo[r->rxlen - 1] ^= 0x5A;
+        }
+        if (append)
+        {
+            r->rxfifo[r->rxlen++] = r->rssi;
+            r->rxfifo[r->rxlen++] = r->lqi;
+        }
+    }
+    else
+    {
+        // autoflush, the beginning goes too if it has not been read
+        r->rxlen -= r->rxpos < r->rxlen ? r->rxpos : r->rxlen;
+    }
+    r->rxpos = 0;
+
+    set_sync(node, 0);
+
+    switch ((r->regs[CC1101_REG_MCSM1] >> 2) & 0x3)
+    {
+        case CC1101_RXOFF_MODE_IDLE:
+            r->wor = 0;
+            set_state(node, SIM_RADIO_IDLE);
+            break;
+        case CC1101_RXOFF_MODE_FSTXON:
+            r->wor = 0;
+            set_state(node, SIM_RADIO_FSTXON);
+            break;
+        case CC1101_RXOFF_MODE_TX:
+            tx_begin(node, RX_TO_TX);
+            break;
+        case CC1101_RXOFF_MODE_STAY_RX:
+            break;
+    }
+}
+
+/**
+ * Move the bytes of the frame being received that have been on the air
+ * for a byte time to the RX FIFO, so that a driver reading it during the
+ * reception sees it fill up. The last byte is kept for rx_complete().
+ */
+static void rx_fill(sim_node_t *node)
+{
+    sim_radio_t *r = &node->radio;
+    sim_tx_t *tx = r->lock;
+    sim_time_t now = sim_now();
+    uint16_t n;
+
+    if (tx == 0 || now <= tx->sync)
+    {
+        return;
+    }
+
+    n = (uint16_t) ((now - tx->sync) / byte_time(r));
+    if (n > tx->length - 1)
+    {
+        n = tx->length - 1;
+    }
+    if (n <= r->rxpos || r->rxlen + n - r->rxpos > sizeof(r->rxfifo))
+    {
+        return;
+    }
+
+    memcpy(r->rxfifo + r->rxlen, tx->data + r->rxpos, n - r->rxpos);
+    r->rxlen += n - r->rxpos;
+    r->rxpos = n;
+}
+
+static void wor_schedule(sim_node_t *node)
+{
+    sim_radio_t *r = &node->radio;
+    sim_time_t period = wor_period(r);
+
+    if (period == 0)
+    {
+        return;
+    }
+    while (r->wor_next <= sim_now())
+    {
+        r->wor_next += period;
+    }
+    sim_schedule(r->wor_next, node, wor_wake, r->gen);
+}
+
+static void wor_wake(sim_node_t *node, uint32_t gen)
+{
+    sim_radio_t *r = &node->radio;
+    sim_time_t timeout;
+
+    if (gen != r->gen || !r->wor)
+    {
+        return;
+    }
+
+    rx_begin(node, WOR_TO_RX);
+    timeout = wor_rx_time(r);
+    if (timeout)
+    {
+        sim_schedule(sim_now() + WOR_TO_RX + timeout, node, wor_timeout, r->gen);
+    }
+}
+
+static void wor_timeout(sim_node_t *node, uint32_t gen)
+{
+    sim_radio_t *r = &node->radio;
+
+    if (gen != r->gen || !r->wor || r->lock)
+    {
+        // a sync word has been found, the packet is received
+        return;
+    }
+
+    set_state(node, SIM_RADIO_SLEEP);
+    wor_schedule(node);
+}
+
+void sim_radio_reset(sim_node_t *node)
+{
+    sim_radio_t *r = &node->radio;
+
+    memcpy(r->regs, reg_defaults, sizeof(r->regs));
+    r->patable = 0xC6;
+    r->rxlen = r->txlen = 0;
+    r->lock = r->tx = 0;
+    r->rxpos = 0;
+    r->wor = 0;
+    r->sync = 0;
+    r->state = SIM_RADIO_IDLE;
+    r->since = sim_now();
+    r->gen++;
+    gdo_update(node);
+}
+
+/*----------------------------- driver API -----------------------------*/
+
+void cc1101_init(void)
+{
+    sim_node_t *node = sim_current;
+
+    node->radio.gdo0_cb = 0x0;
+    node->radio.gdo2_cb = 0x0;
+    node->port.ie &= ~(GDO0_PIN | GDO2_PIN);
+
+    radio_stop(node);
+    sim_radio_reset(node);
+
+    cc1101_write_reg(CC1101_REG_FREQ2, 0x20);
+    cc1101_write_reg(CC1101_REG_FREQ1, 0x25);
+    cc1101_write_reg(CC1101_REG_FREQ0, 0xED);
+    cc1101_write_reg(CC1101_REG_DEVIATN, 0x0);
+}
+
+void cc1101_reinit(void)
+{
+}
+
+uint8_t cc1101_read_reg(uint8_t addr)
+{
+    sim_node_t *node = sim_current;
+    sim_radio_t *r = &node->radio;
+    uint8_t a = addr & 0x3F, v;
+
+    sim_spin();
+    wake(node);
+
+    if (a < sizeof(r->regs))
+    {
+        return r->regs[a];
+    }
+
+    switch (a)
+    {
+        case CC1101_REG_PARTNUM:
+            return 0x00;
+        case CC1101_REG_VERSION:
+            return 0x04;
+        case CC1101_REG_LQI:
+            return r->lqi;
+        case CC1101_REG_RSSI:
+            return r->state == SIM_RADIO_RX ? rssi_reg(channel_power(node)) : r->rssi;
+        case CC1101_REG_MARCSTATE:
+        {
+            static const uint8_t marc[] = {0x00, 0x01, 0x0D, 0x13, 0x12, 0x11, 0x16};
+            return marc[r->state];
+        }
+        case CC1101_REG_PKTSTATUS:
+            v = 0;
+            if (node->port.in & GDO0_PIN)
+                v |= 0x01;
+            if (node->port.in & GDO2_PIN)
+                v |= 0x04;
+            if (r->sync)
+                v |= 0x08;
+            if (r->state == SIM_RADIO_RX && !channel_busy(node))
+                v |= 0x10;
+            if (r->lqi & 0x80)
+                v |= 0x80;
+            return v;
+        case CC1101_REG_TXBYTES:
+            return r->txlen | (r->state == SIM_RADIO_TX_UNDERFLOW ? 0x80 : 0);
+        case CC1101_REG_RXBYTES:
+            rx_fill(node);
+            return r->rxlen | (r->state == SIM_RADIO_RX_OVERFLOW ? 0x80 : 0);
+        case CC1101_PATABLE_ADDR:
+            return r->patable;
+        case CC1101_DATA_FIFO_ADDR:
+            cc1101_fifo_get(&v, 1);
+            return v;
+        default:
+            return 0;
+    }
+}
+
+void cc1101_write_reg(uint8_t addr, uint8_t value)
+{
+    sim_node_t *node = sim_current;
+    sim_radio_t *r = &node->radio;
+    uint8_t a = addr & 0x3F;
+
+    wake(node);
+
+    if (a < sizeof(r->regs))
+    {
+        r->regs[a] = value;
+        if (a == CC1101_REG_IOCFG0 || a == CC1101_REG_IOCFG2)
+        {
+            gdo_update(node);
+        }
+    }
+    else if (a == CC1101_PATABLE_ADDR)
+    {
+        r->patable = value;
+    }
+    else if (a == CC1101_DATA_FIFO_ADDR)
+    {
+        cc1101_fifo_put(&value, 1);
+    }
+}
+
+uint8_t cc1101_read_status(uint8_t addr)
+{
+    return cc1101_read_reg(addr | CC1101_ACCESS_STATUS);
+}
+
+void cc1101_fifo_put(uint8_t* buffer, uint16_t length)
+{
+    sim_radio_t *r = &sim_current->radio;
+
+    wake(sim_current);
+
+    if (length > sizeof(r->txfifo) - r->txlen)
+    {
+        length = sizeof(r->txfifo) - r->txlen;
+    }
+    memcpy(r->txfifo + r->txlen, buffer, length);
+    r->txlen += length;
+}
+
+void cc1101_fifo_get(uint8_t* buffer, uint16_t length)
+{
+    sim_radio_t *r = &sim_current->radio;
+    uint16_t n;
+
+    wake(sim_current);
+    rx_fill(sim_current);
+
+    n = length < r->rxlen ? length : r->rxlen;
+    memcpy(buffer, r->rxfifo, n);
+    memset(buffer + n, 0, length - n);
+    r->rxlen -= n;
+    memmove(r->rxfifo, r->rxfifo + n, r->rxlen);
+}
+
+uint8_t cc1101_strobe_cmd(uint8_t cmd)
+{
+    static const uint8_t status[] = {
+        CC1101_STATUS_IDLE, CC1101_STATUS_IDLE, CC1101_STATUS_RX, CC1101_STATUS_TX,
+        CC1101_STATUS_FSTXON, CC1101_STATUS_RXFIFO_OVERFLOW, CC1101_STATUS_TXFIFO_UNDERFLOW
+    };
+    sim_node_t *node = sim_current;
+    sim_radio_t *r = &node->radio;
+    uint8_t ret, autocal;
+
+    // the status byte is returned before the command is executed
+    wake(node);
+    ret = status[r->state] | (sizeof(r->txfifo) - r->txlen > 15 ? 15 : sizeof(r->txfifo) - r->txlen);
+    autocal = ((r->regs[CC1101_REG_MCSM0] >> 4) & 0x3) == CC1101_AUTOCAL_IDLE_TO_TX_RX;
+
+    switch (cmd & 0x3F)
+    {
+        case CC1101_STROBE_SRES:
+            radio_stop(node);
+            sim_radio_reset(node);
+            break;
+        case CC1101_STROBE_SFSTXON:
+            if (r->state == SIM_RADIO_IDLE)
+            {
+                set_state(node, SIM_RADIO_FSTXON);
+            }
+            break;
+        case CC1101_STROBE_SXOFF:
+        case CC1101_STROBE_SPWD:
+            radio_stop(node);
+            set_state(node, SIM_RADIO_SLEEP);
+            break;
+        case CC1101_STROBE_SRX:
+            if (r->state == SIM_RADIO_IDLE)
+            {
+                r->wor = 0;
+                rx_begin(node, autocal ? IDLE_TO_RXTX_CAL : IDLE_TO_RXTX);
+            }
+            else if (r->state == SIM_RADIO_FSTXON || r->state == SIM_RADIO_TX)
+            {
+                rx_begin(node, TX_TO_RX);
+            }
+            break;
+        case CC1101_STROBE_STX:
+            if (r->state == SIM_RADIO_IDLE)
+            {
+                tx_begin(node, autocal ? IDLE_TO_RXTX_CAL : IDLE_TO_RXTX);
+            }
+            else if (r->state == SIM_RADIO_FSTXON)
+            {
+                tx_begin(node, FSTXON_TO_TX);
+            }
+            else if (r->state == SIM_RADIO_RX && !channel_busy(node))
+            {
+                tx_begin(node, RX_TO_TX);
+            }
+            break;
+        case CC1101_STROBE_SIDLE:
+            radio_stop(node);
+            set_state(node, SIM_RADIO_IDLE);
+            break;
+        case CC1101_STROBE_SWOR:
+            if (r->state == SIM_RADIO_IDLE)
+            {
+                set_state(node, SIM_RADIO_SLEEP);
+                r->wor = 1;
+                r->wor_next = sim_now();
+                wor_schedule(node);
+            }
+            break;
+        case CC1101_STROBE_SFRX:
+            if (r->state == SIM_RADIO_IDLE || r->state == SIM_RADIO_RX_OVERFLOW)
+            {
+                r->rxlen = 0;
+                if (r->state == SIM_RADIO_RX_OVERFLOW)
+                {
+                    set_state(node, SIM_RADIO_IDLE);
+                }
+            }
+            break;
+        case CC1101_STROBE_SFTX:
+            if (r->state == SIM_RADIO_IDLE || r->state == SIM_RADIO_TX_UNDERFLOW)
+            {
+                r->txlen = 0;
+                if (r->state == SIM_RADIO_TX_UNDERFLOW)
+                {
+                    set_state(node, SIM_RADIO_IDLE);
+                }
+            }
+            break;
+        case CC1101_STROBE_SWORRST:
+            if (r->wor && r->state == SIM_RADIO_SLEEP)
+            {
+                r->gen++;
+                r->wor_next = sim_now();
+                wor_schedule(node);
+            }
+            break;
+        default:
+            break;
+    }
+    return ret;
+}
+
+void cc1101_cmd_calibrate(void)
+{
+    cc1101_cmd_idle();
+    cc1101_strobe_cmd(CC1101_STROBE_SCAL);
+
+    // the driver waits for the calibration to complete
+    sim_delay(CALIBRATE);
+}
+
+void cc1101_cmd_idle(void)
+{
+    switch (cc1101_cmd_nop() & CC1101_STATUS_MASK)
+    {
+        case CC1101_STATUS_RXFIFO_OVERFLOW:
+            cc1101_cmd_flush_rx();
+            break;
+        case CC1101_STATUS_TXFIFO_UNDERFLOW:
+            cc1101_cmd_flush_tx();
+            break;
+        default:
+            cc1101_strobe_cmd(CC1101_STROBE_SIDLE);
+    }
+}
+
+void cc1101_gdo0_register_callback(uint16_t (*cb)(void))
+{
+    sim_current->radio.gdo0_cb = cb;
+}
+
+void cc1101_gdo2_register_callback(uint16_t (*cb)(void))
+{
+    sim_current->radio.gdo2_cb = cb;
+}
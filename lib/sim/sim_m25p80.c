@@ -0,0 +1,129 @@
+/*
+ * Copyright  2008-2009 INRIA/SensTools
+ *
+ * <dev-team@sentools.info>
+ *
+ * This software is a set of libraries designed to develop applications
+ * for the WSN430 embedded hardware platform.
+ *
+ * This software is governed by the CeCILL license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL license and that you accept its terms.
+ */
+
+/**
+ * \file
+ * \brief Host-side radio medium simulator, M25P80 emulation
+ * \date October 2026
+ *
+ * The memory is kept in RAM, with the flash semantics: a write only
+ * clears bits, an erase sets them back. The erases are immediate, the
+ * state register never shows a write in progress.
+ *
+ * Like sim_ds2411.c, this file is linked in the MAC shared objects, so
+ * that every node has its own memory, blank when the node starts.
+ */
+
+#include <io.h>
+#include "m25p80.h"
+
+#define MEMORY_SIZE ((uint32_t) M25P80_PAGE_SIZE * M25P80_PAGE_NUMBER)
+#define SECTOR_BYTES ((uint32_t) M25P80_PAGE_SIZE * M25P80_SECTOR_SIZE)
+
+static uint8_t memory[MEMORY_SIZE];
+static uint8_t blank;
+
+uint8_t m25p80_init(void)
+{
+    if (!blank)
+    {
+        m25p80_erase_bulk();
+        blank = 1;
+    }
+    return m25p80_get_signature();
+}
+
+uint8_t m25p80_get_signature(void)
+{
+    return 0x13;
+}
+
+uint8_t m25p80_get_state(void)
+{
+    return 0;
+}
+
+void m25p80_wakeup(void)
+{
+}
+
+void m25p80_power_down(void)
+{
+}
+
+void m25p80_erase_sector_start(uint8_t sector)
+{
+    uint32_t i, start = (sector % M25P80_SECTOR_NUMBER) * SECTOR_BYTES;
+
+    for (i = 0; i < SECTOR_BYTES; i++)
+    {
+        memory[start + i] = 0xFF;
+    }
+}
+
+void m25p80_erase_sector(uint8_t sector)
+{
+    m25p80_erase_sector_start(sector);
+}
+
+void m25p80_erase_bulk(void)
+{
+    uint8_t sector;
+
+    for (sector = 0; sector < M25P80_SECTOR_NUMBER; sector++)
+    {
+        m25p80_erase_sector_start(sector);
+    }
+}
+
+void m25p80_write(uint32_t addr, uint8_t *buffer, uint16_t size)
+{
+    uint16_t i;
+
+    for (i = 0; i < size; i++)
+    {
+        memory[(addr + i) % MEMORY_SIZE] &= buffer[i];
+    }
+}
+
+void m25p80_read(uint32_t addr, uint8_t *buffer, uint16_t size)
+{
+    uint16_t i;
+
+    for (i = 0; i < size; i++)
+    {
+        buffer[i] = memory[(addr + i) % MEMORY_SIZE];
+    }
+}
@@ -0,0 +1,289 @@
+/*
+ * Copyright  2008-2009 INRIA/SensTools
+ *
+ * <dev-team@sentools.info>
+ *
+ * This software is a set of libraries designed to develop applications
+ * for the WSN430 embedded hardware platform.
+ *
+ * This software is governed by the CeCILL license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL license and that you accept its terms.
+ */
+
+/**
+ * \file
+ * \brief Host-side radio medium simulator, timerB emulation
+ * \date October 2026
+ *
+ * Implements the timerB driver API for the current node. The counter
+ * runs from the node's own crystal, which has a random frequency error,
+ * and starts from a random value so that nodes are not aligned.
+ * Alarms fire when the 16bit counter reaches the compare value, exactly
+ * like the hardware: an alarm set in the past fires after a wrap.
+ */
+
+#include <math.h>
+#include <string.h>
+#include "sim.h"
+#include "timerB.h"
+
+#define ALARM_BITS 3
+#define ALARM_MASK ((1<<ALARM_BITS)-1)
+
+static double ticks_at(const sim_timer_t *t, sim_time_t at)
+{
+    return t->origin + at * 1e-9 * t->rate * (1. + t->ppm * 1e-6);
+}
+
+static uint16_t counter(const sim_timer_t *t)
+{
+    if (t->rate == 0.)
+    {
+        return t->frozen;
+    }
+    return (uint16_t) (uint64_t) floor(ticks_at(t, sim_now()));
+}
+
+static void alarm_fire(sim_node_t *node, uint32_t arg);
+
+static void alarm_arm(sim_node_t *node, uint16_t alarm)
+{
+    sim_timer_t *t = &node->timer;
+    double c, target, at;
+    uint32_t delta;
+
+    t->gen[alarm]++;
+    t->armed |= 1 << alarm;
+
+    if (t->rate == 0.)
+    {
+        return;
+    }
+
+    c = floor(ticks_at(t, sim_now()));
+    delta = (uint16_t) (t->ccr[alarm] - (uint16_t) (uint64_t) c);
+    if (delta == 0)
+    {
+        delta = 0x10000;
+    }
+    target = c + delta;
+    at = (target - t->origin) / (t->rate * (1. + t->ppm * 1e-6)) * 1e9;
+
+    sim_schedule_cpu((sim_time_t) ceil(at), node, alarm_fire,
+            alarm | (t->gen[alarm] << ALARM_BITS));
+}
+
+static void alarm_disarm(sim_timer_t *t, uint16_t alarm)
+{
+    t->gen[alarm]++;
+    t->armed &= ~(1 << alarm);
+}
+
+static void alarm_fire(sim_node_t *node, uint32_t arg)
+{
+    sim_timer_t *t = &node->timer;
+    uint16_t alarm = arg & ALARM_MASK;
+
+    if ((t->gen[alarm] & (0xFFFFFFFF >> ALARM_BITS)) != (arg >> ALARM_BITS))
+    {
+        // the alarm has been changed or removed meanwhile
+        return;
+    }
+
+    if (t->period[alarm])
+    {
+        t->ccr[alarm] += t->period[alarm];
+        alarm_arm(node, alarm);
+    }
+    else
+    {
+        t->ccr[alarm] = 0;
+        alarm_disarm(t, alarm);
+    }
+
+    if (t->cb[alarm])
+    {
+        t->cb[alarm]();
+    }
+}
+
+void sim_timer_reset(sim_node_t *node)
+{
+    sim_timer_t *t = &node->timer;
+    uint16_t i;
+
+    for (i = 0; i < TIMERB_CCR_NUMBER; i++)
+    {
+        alarm_disarm(t, i);
+    }
+    memset(t->cb, 0, sizeof(t->cb));
+    memset(t->ccr, 0, sizeof(t->ccr));
+    memset(t->period, 0, sizeof(t->period));
+    t->rate = 0.;
+    t->ppm = (2. * sim_random() - 1.) * sim_medium.ppm;
+    t->frozen = (uint16_t) (sim_random() * 65536.);
+}
+
+void timerB_init(void)
+{
+    sim_timer_t *t = &sim_current->timer;
+    uint16_t i;
+
+    t->frozen = counter(t);
+    t->rate = 0.;
+
+    for (i = 0; i < TIMERB_CCR_NUMBER; i++)
+    {
+        alarm_disarm(t, i);
+        t->ccr[i] = 0;
+        t->period[i] = 0;
+        t->cb[i] = 0x0;
+    }
+    t->cb[TIMERB_ALARM_OVER] = 0x0;
+}
+
+static uint16_t start(double rate, uint16_t s_div)
+{
+    sim_timer_t *t = &sim_current->timer;
+    uint16_t i;
+
+    if (s_div > 3)
+    {
+        return 0;
+    }
+
+    // keep counting from the current value
+    t->frozen = counter(t);
+    t->rate = rate / (1 << s_div);
+    t->origin = t->frozen - ticks_at(t, sim_now()) + 0.5;
+
+    for (i = 0; i < TIMERB_CCR_NUMBER; i++)
+    {
+        if (t->armed & (1 << i))
+        {
+            alarm_arm(sim_current, i);
+        }
+    }
+    return 1;
+}
+
+uint16_t timerB_start_SMCLK_div(uint16_t s_div)
+{
+    return start(1000000., s_div);
+}
+
+uint16_t timerB_start_ACLK_div(uint16_t s_div)
+{
+    return start(32768., s_div);
+}
+
+uint16_t timerB_register_cb(uint16_t alarm, timerBcb f)
+{
+    if (alarm > TIMERB_CCR_NUMBER)
+    {
+        return 0;
+    }
+    // the overflow interrupt is not emulated
+    sim_current->timer.cb[alarm] = f;
+    return 1;
+}
+
+uint16_t timerB_capture_start(uint16_t s_div)
+{
+    (void) s_div;
+    return 0;
+}
+
+uint16_t timerB_capture_stop(void)
+{
+    return 0;
+}
+
+uint16_t timerB_time_capture(void)
+{
+    return 0;
+}
+
+uint16_t timerB_ctl_status(void)
+{
+    return 0;
+}
+
+uint16_t timerB_time(void)
+{
+    sim_spin();
+    return counter(&sim_current->timer);
+}
+
+uint16_t timerB_set_alarm_from_now(uint16_t alarm, uint16_t ticks, uint16_t period)
+{
+    return timerB_set_alarm_from_time(alarm, ticks, period, timerB_time());
+}
+
+uint16_t timerB_set_alarm_from_time(uint16_t alarm, uint16_t ticks, uint16_t period, uint16_t ref)
+{
+    sim_timer_t *t = &sim_current->timer;
+
+    if (alarm >= TIMERB_CCR_NUMBER)
+    {
+        return 0;
+    }
+
+    t->ccr[alarm] = ref + ticks;
+    t->period[alarm] = period;
+    alarm_arm(sim_current, alarm);
+    return 1;
+}
+
+uint16_t timerB_unset_alarm(uint16_t alarm)
+{
+    sim_timer_t *t = &sim_current->timer;
+
+    if (alarm >= TIMERB_CCR_NUMBER)
+    {
+        return 0;
+    }
+
+    t->ccr[alarm] = 0;
+    t->period[alarm] = 0;
+    alarm_disarm(t, alarm);
+    return 1;
+}
+
+void timerB_stop(void)
+{
+    sim_timer_t *t = &sim_current->timer;
+    uint16_t i;
+
+    t->frozen = counter(t);
+    t->rate = 0.;
+
+    // pending alarms stay enabled and resume with the counter
+    for (i = 0; i < TIMERB_CCR_NUMBER; i++)
+    {
+        t->gen[i]++;
+    }
+}